@@ -4,6 +4,12 @@ TARGET="$(basename $PWD)"
 
 BUILD_DIR="build"
 ASSET_DIR="assets"
+BAKE_DIRS="levels dialogue" # under $ASSET_DIR, JSON in here is baked to .pdbk
+PACK_FILE="assets.pak"
+# asset types pdc compiles itself, left as loose files next to the pack
+PACK_EXCLUDE="png,gif,wav,aif,aiff,mp3,fnt,pdv"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4)}
+LISTINGS=${LISTINGS:-0} # 1 writes a -fverbose-asm listing next to each object
 
 # ------------------------------------------------------------------------------
 # ------------------------------------------------------------------------------
@@ -12,11 +18,14 @@ ASSET_DIR="assets"
 replace() { echo "$1" | sed "s/\\$2/$3/"; }
 addprefix() { echo "$1" | sed "s|^|$2|"; }
 
-SRC=$(find . -type f -name "*.c" | sed 's|^\./||')
-OBJS=$(replace "$SRC" .c .o)
-OBJS=$(addprefix "$OBJS" "$BUILD_DIR/")
+sources() {
+  SRC=$(find . -type f -name "*.c" ! -path "./host/*" | sed 's|^\./||')
+  OBJS=$(replace "$SRC" .c .o)
+  OBJS=$(addprefix "$OBJS" "$BUILD_DIR/")
 
-LSTS=$(addprefix "$(replace "$SRC" .c .lst)" "$BUILD_DIR/")
+  LSTS=$(addprefix "$(replace "$SRC" .c .lst)" "$BUILD_DIR/")
+}
+sources
 
 # TOOLS PATH
 SDK=$PLAYDATE_SDK_PATH
@@ -33,7 +42,7 @@ LIBS="-Ideps"
 WARNINGS="-Wall" 
 # WARNINGS="$WARNINGS -Wno-unused -Wstrict-prototypes -Wno-unknown-pragmas"
 # WARNINGS="$WARNINGS -Wlto-type-mismatch -Wdouble-promotion"
-DEBUG="-g3 -gdwarf-2 -fverbose-asm -Wa,-ahlms=$LSTS"
+DEBUG="-g3 -gdwarf-2"
 CPU="-mthumb -mcpu=cortex-m7 -mfloat-abi=hard -mfpu=fpv5-sp-d16 -D__FPU_USED=1"
 
 # -- OPTIMIZATION ----
@@ -50,71 +59,315 @@ LINKER_FLAGS="$LINKER_FLAGS -Wl,-Map=$BUILD_DIR/pdex.map,--cref"
 LINKER_FLAGS="$LINKER_FLAGS,--gc-sections,--no-warn-mismatch,--emit-relocs"
 PDC_FLAGS="-sdkpath $SDK -q"
 
+# -- HOST ----
+# headless Linux build against the stand-in PlaydateAPI in host/
+HOST_DIR=$BUILD_DIR/host
+HOST_CC=${HOST_CC:-cc}
+HOST_FLAGS="-O2 -g $WARNINGS -DTARGET_HOST=1 -DTARGET_EXTENSION=1 $LIBS -Ihost -Isrc"
+HOST_RUNTIME="host/runtime.c host/system.c host/graphics.c host/file.c host/json.c host/stubs.c"
+HOST_FRAMES=${HOST_FRAMES:-300}
+REPLAY=${REPLAY:-session.pdrp}
+BENCH_THRESHOLD=${BENCH_THRESHOLD:-5} # percent slower than the previous run that counts as a regression
+COUNT_FRAMES=${COUNT_FRAMES:-30}     # update callbacks the interpreter runs for counts
+VID_SAMPLES="sprite scroll wipe" # pdvid.py samples the video benchmarks decode
+VID_CLIPS=${VID_CLIPS:-}          # .pbm frame directories for build.sh vid
+
 lst() {
   echo "$LSTS"
 }
 
+now() { python3 -c "import time; print(int(time.time() * 1000))"; }
+elapsed() { echo "$(( $(now) - $1 ))" | awk '{ printf "%.2fs", $1 / 1000 }'; }
+
 clean() {
   echo "$(basename $0): Cleaning up $BUILD_DIR/ and $TARGET.pdx"
   rm -rf $BUILD_DIR
   rm -rf $TARGET.pdx
 }
 
+ASSETS_STAMP=$BUILD_DIR/.assets
 assets() {
+  if [ -e $ASSETS_STAMP ] && [ -z "$(find $ASSET_DIR pdxinfo -newer $ASSETS_STAMP | head -n 1)" ]; then
+    return
+  fi
+  START=$(now)
   echo "$(basename $0): Copying pdxinfo and static assets from $ASSET_DIR"
   mkdir -p $BUILD_DIR/Source/$ASSET_DIR
   cp -R $ASSET_DIR/* $BUILD_DIR/Source/$ASSET_DIR
   cp pdxinfo $BUILD_DIR/Source
+  bake
+  pack
+  touch $ASSETS_STAMP
+  echo "$(basename $0): Assets done in $(elapsed $START)"
+}
+
+bake() {
+  for dir in $BAKE_DIRS; do
+    if [ -d $BUILD_DIR/Source/$ASSET_DIR/$dir ]; then
+      echo "$(basename $0): Baking JSON in $ASSET_DIR/$dir"
+      python3 pdbake.py --remove $BUILD_DIR/Source/$ASSET_DIR/$dir
+    fi
+  done
+}
+
+pack() {
+  echo "$(basename $0): Packing $ASSET_DIR into $PACK_FILE"
+  python3 pdpack.py $BUILD_DIR/Source/$ASSET_DIR $BUILD_DIR/Source/$PACK_FILE \
+    --exclude "$PACK_EXCLUDE" --compress --remove
+}
+
+# headers with // @lua annotations get <name>_lua.c glue from pdluagen.py
+luagen() {
+  HEADERS=$(grep -l "// *@lua" $(find src -type f -name "*.h"))
+  if [ -n "$HEADERS" ]; then
+    echo "$(basename $0): Generating Lua bindings"
+    python3 pdluagen.py $HEADERS
+    sources
+  fi
+}
+
+# an object is stale when it is missing or older than its source or any
+# header listed in the depfile gcc wrote next to it (-MMD -MP)
+stale() {
+  obj=$BUILD_DIR/"${1%.c}.o"
+  dep=$BUILD_DIR/"${1%.c}.d"
+  [ -e "$obj" ] && [ -e "$dep" ] || return 0
+  for f in $1 $(sed -e 's/\\$//' -e 's/^[^:]*://' "$dep"); do
+    [ "$f" -nt "$obj" ] && return 0
+  done
+  return 1
+}
+
+compile() {
+  obj=$BUILD_DIR/"${1%.c}.o"
+  mkdir -p $(dirname "$obj")
+  if [ "$LISTINGS" = "1" ]; then
+    LST="-fverbose-asm -Wa,-ahlms=${obj%.o}.lst"
+  else
+    LST=""
+  fi
+  $GCC -c $C_FLAGS $LST -MMD -MP $1 -o "$obj" || touch $BUILD_DIR/.failed
 }
 
 OBJS_DONE=0
 objs() {
   assets
-  echo "$(basename $0): Building .o files"
+  luagen
+  START=$(now)
+  mkdir -p $BUILD_DIR
+  rm -f $BUILD_DIR/.failed
+
+  # a change of flags invalidates every object
+  if [ "$(cat $BUILD_DIR/.cflags 2>/dev/null)" != "$C_FLAGS $LISTINGS" ]; then
+    rm -f $OBJS
+    echo "$C_FLAGS $LISTINGS" > $BUILD_DIR/.cflags
+  fi
+
+  STALE=""
   for file in $SRC; do
-    mkdir -p $(dirname $BUILD_DIR/"${file%.c}.o")
-    $GCC -c $C_FLAGS $file -o $BUILD_DIR/"${file%.c}.o"
+    if stale $file; then STALE="$STALE $file"; fi
   done
+  TOTAL=$(echo $SRC | wc -w | tr -d ' ')
+  COUNT=$(echo $STALE | wc -w | tr -d ' ')
+
+  if [ "$COUNT" != "0" ]; then
+    echo "$(basename $0): Building $COUNT of $TOTAL .o files ($JOBS jobs)"
+    RUNNING=0
+    for file in $STALE; do
+      compile $file &
+      RUNNING=$((RUNNING + 1))
+      if [ $RUNNING -ge $JOBS ]; then
+        wait
+        RUNNING=0
+      fi
+    done
+    wait
+    if [ -e $BUILD_DIR/.failed ]; then
+      echo "$(basename $0): Compilation failed"
+      exit 1
+    fi
+  fi
+  echo "$(basename $0): $COUNT of $TOTAL objects rebuilt in $(elapsed $START)"
   OBJS_DONE=1
 }
 
+# nothing to relink when the output exists and no object is newer
+linked() {
+  [ -e "$1" ] && [ -z "$(find $OBJS -newer "$1" | head -n 1)" ]
+}
+
+package() {
+  if linked $TARGET.pdx && [ -z "$(find $BUILD_DIR/Source -newer $TARGET.pdx | head -n 1)" ]; then
+    echo "$(basename $0): $TARGET.pdx is up to date"
+    return
+  fi
+  START=$(now)
+  # only the device code changed: repack pdex.bin in place instead of running pdc
+  if [ -e $TARGET.pdx/pdex.bin ] && [ -z "$(find $BUILD_DIR/Source -type f -newer $TARGET.pdx ! -name pdex.elf | head -n 1)" ]; then
+    python3 elf2pdex.py $BUILD_DIR/pdex.elf $TARGET.pdx/pdex.bin || exit 1
+    touch $TARGET.pdx
+    echo "$(basename $0): Repacked $TARGET.pdx/pdex.bin in $(elapsed $START)"
+    return
+  fi
+  $PDC $PDC_FLAGS $BUILD_DIR/Source $TARGET.pdx || exit 1
+  touch $TARGET.pdx
+  SIZE=$(ls -lh | grep $TARGET.pdx | awk '{ print $5 }')
+  echo "$(basename $0): Packaging $TARGET.pdx ($SIZE) in $(elapsed $START)"
+}
+
 sim_bin() {
   if [ "$OBJS_DONE" = "0" ]; then 
     objs
   fi
+  if linked $BUILD_DIR/pdex.dylib; then
+    return
+  fi
+  START=$(now)
   echo "$(basename $0): Building simulator executable"
 	clang -g -dynamiclib -rdynamic -lm -DTARGET_SIMULATOR=1 -DTARGET_EXTENSION=1 -Ideps -o $BUILD_DIR/pdex.dylib $SRC
   cp $BUILD_DIR/pdex.dylib $BUILD_DIR/Source
+  echo "$(basename $0): Simulator executable built in $(elapsed $START)"
 }
 
 dev_bin() {
   if [ "$OBJS_DONE" = "0" ]; then 
     objs
   fi
+  if linked $BUILD_DIR/pdex.elf; then
+    return
+  fi
+  START=$(now)
   echo "$(basename $0): Building device executable"
   $GCC $OBJS $LINKER_FLAGS -o $BUILD_DIR/pdex.elf
   cp $BUILD_DIR/pdex.elf $BUILD_DIR/Source
+  echo "$(basename $0): Device executable linked in $(elapsed $START)"
 }
 
 sim() {
   sim_bin
-  $PDC $PDC_FLAGS $BUILD_DIR/Source $TARGET.pdx
-  SIZE=$(ls -lh | grep $TARGET.pdx | awk '{ print $5 }')
-  echo "$(basename $0): Packaging $TARGET.pdx ($SIZE)"
+  package
 }
 
 dev() {
   dev_bin
-  $PDC $PDC_FLAGS $BUILD_DIR/Source $TARGET.pdx
-  SIZE=$(ls -lh | grep $TARGET.pdx | awk '{ print $5 }')
-  echo "$(basename $0): Packaging $TARGET.pdx ($SIZE)"
+  package
 }
 
 all() {
   sim_bin; dev_bin
-  $PDC $PDC_FLAGS $BUILD_DIR/Source $TARGET.pdx
-  SIZE=$(ls -lh | grep $TARGET.pdx | awk '{ print $5 }')
-  echo "$(basename $0): Packaging $TARGET.pdx ($SIZE)"
+  package
+}
+
+# reports a clean device build, a no-op rebuild and a one-file rebuild
+buildtimes() {
+  clean
+  START=$(now); (dev) > /dev/null; CLEAN=$(elapsed $START)
+  START=$(now); (dev) > /dev/null; NOOP=$(elapsed $START)
+  touch $(echo "$SRC" | head -n 1)
+  START=$(now); (dev) > /dev/null; ONE=$(elapsed $START)
+  echo "$(basename $0): clean $CLEAN, no-op $NOOP, one file touched $ONE ($JOBS jobs)"
+}
+
+# lists the API calls on the per-frame path of the device build, deepest loops first
+apiscan() {
+  dev_bin
+  python3 pdapiscan.py $BUILD_DIR/pdex.elf || exit 1
+}
+
+host_bin() {
+  luagen
+  START=$(now)
+  echo "$(basename $0): Building host executable"
+  mkdir -p $HOST_DIR
+  $HOST_CC $HOST_FLAGS -o $HOST_DIR/pdhost $SRC $HOST_RUNTIME host/run.c -lm || exit 1
+  echo "$(basename $0): Host executable built in $(elapsed $START)"
+}
+
+# runs HOST_FRAMES frames headlessly; extra runner flags go in HOST_ARGS
+host() {
+  assets
+  host_bin
+  $HOST_DIR/pdhost -n $HOST_FRAMES --data $HOST_DIR/Data --pdx $BUILD_DIR/Source $HOST_ARGS
+}
+
+# replays REPLAY (a recording in build/host/Data) with a fixed clock, writes
+# build/host/replay.csv and compares it with the previous run's trace
+replay() {
+  assets
+  host_bin
+  [ -e $HOST_DIR/replay.csv ] && mv $HOST_DIR/replay.csv $HOST_DIR/replay.prev.csv
+  $HOST_DIR/pdhost --data $HOST_DIR/Data --pdx $BUILD_DIR/Source --fixed --quiet \
+    --replay $REPLAY --trace $HOST_DIR/replay.csv $HOST_ARGS || exit 1
+  if [ -e $HOST_DIR/replay.prev.csv ]; then
+    $HOST_DIR/pdhost --compare $HOST_DIR/replay.prev.csv $HOST_DIR/replay.csv || exit 1
+  fi
+}
+
+bench_bin() {
+  luagen
+  echo "$(basename $0): Building host benchmarks"
+  mkdir -p $HOST_DIR
+  $HOST_CC $HOST_FLAGS -o $HOST_DIR/pdbench $SRC $HOST_RUNTIME host/bench/*.c -lm -lz || exit 1
+}
+
+# sample clips the video benchmarks decode, in both formats; remade when
+# pdvid.py changes
+vid_samples() {
+  mkdir -p $HOST_DIR/Data
+  for kind in $VID_SAMPLES; do
+    out=$HOST_DIR/Data/bench_$kind
+    [ $out.pdvd -nt pdvid.py ] && [ -e $out.pdv ] || python3 pdvid.py sample $kind $out.pdvd --pdv $out.pdv || exit 1
+  done
+}
+
+# the LZ benchmarks' corpus: the files pack() would compress, or the C
+# sources when there are none, cut to LZ_SAMPLE_MAX bytes and written raw,
+# as a PDLZ frame and as a zlib stream
+LZ_SAMPLE_MAX=524288
+lz_samples() {
+  mkdir -p $HOST_DIR/Data
+  out=$HOST_DIR/Data/bench_assets
+  FILES=$(find $ASSET_DIR -type f 2>/dev/null | grep -Ev "\.($(echo $PACK_EXCLUDE | tr , '|'))\$" | sort)
+  [ -n "$FILES" ] || FILES=$(find src -type f -name "*.[ch]" ! -name "*_lua.[ch]" | sort)
+  cat $FILES | head -c $LZ_SAMPLE_MAX > $out.new
+  if cmp -s $out.new $out.raw && [ $out.pdlz -nt pdlz.py ] && [ -e $out.z ]; then
+    rm $out.new
+    return
+  fi
+  mv $out.new $out.raw
+  python3 pdlz.py compress $out.raw $out.pdlz --zlib $out.z || exit 1
+}
+
+# PDVD size against raw frames and the built-in .pdv format, for the sample
+# clips and any clips (.pbm directories) listed in VID_CLIPS
+vid() {
+  python3 pdvid.py bench --samples $VID_CLIPS || exit 1
+}
+
+# runs the micro-benchmarks into build/host/bench.tsv and compares against
+# the previous run if there is one; extra flags (--filter gfx/) go in BENCH_ARGS
+bench() {
+  assets
+  bench_bin
+  vid_samples
+  lz_samples
+  [ -e $HOST_DIR/bench.tsv ] && mv $HOST_DIR/bench.tsv $HOST_DIR/bench.prev.tsv
+  $HOST_DIR/pdbench $BENCH_ARGS | tee $HOST_DIR/bench.tsv
+  if [ -e $HOST_DIR/bench.prev.tsv ]; then
+    $HOST_DIR/pdbench --compare $HOST_DIR/bench.prev.tsv $HOST_DIR/bench.tsv --threshold $BENCH_THRESHOLD || exit 1
+  fi
+}
+
+# runs the device build in the Thumb-2 interpreter into build/host/counts.csv;
+# instruction and memory counts do not vary between runs, so any growth fails
+counts() {
+  dev
+  mkdir -p $HOST_DIR
+  [ -e $HOST_DIR/counts.csv ] && mv $HOST_DIR/counts.csv $HOST_DIR/counts.prev.csv
+  COMPARE=""
+  [ -e $HOST_DIR/counts.prev.csv ] && COMPARE="--compare $HOST_DIR/counts.prev.csv --threshold 0"
+  python3 pdexrun.py $TARGET.pdx/pdex.bin -n $COUNT_FRAMES --pdx $BUILD_DIR/Source --quiet \
+    --csv $HOST_DIR/counts.csv $COMPARE || exit 1
 }
 
 run() {
@@ -1500,8 +1500,10 @@ playdate_event_handler low_power;
 playdate_event_handler key_pressed;
 playdate_event_handler key_released;
 
+extern int pacing_update(int (*update)(void)); // src/pacing.c, a plain call until enabled
+
 static inline __attribute__((always_inline)) int shim(void* userdata) {
-	return playdate_update();
+	return pacing_update(playdate_update);
 }
 
 int eventHandlerShim(PlaydateAPI* pd, PDSystemEvent event, uint32_t arg) {
@@ -1526,7 +1528,7 @@ int eventHandlerShim(PlaydateAPI* pd, PDSystemEvent event, uint32_t arg) {
 void* _malloc_r(struct _reent* _REENT, size_t nbytes) { return pdrealloc(NULL, nbytes); }
 void* _realloc_r(struct _reent* _REENT, void* ptr, size_t nbytes) { return pdrealloc(ptr, nbytes); }
 void  _free_r(struct _reent* _REENT, void* ptr) { if ( ptr != NULL ) pdrealloc(ptr, 0); }
-#else
+#elif !TARGET_HOST // the host runtime's realloc is libc's own
 void* malloc(size_t nbytes) { return pdrealloc(NULL, nbytes); }
 void* realloc(void* ptr, size_t nbytes) { return pdrealloc(ptr, nbytes); }
 void  free(void* ptr ) { if ( ptr != NULL ) pdrealloc(ptr, 0); }
@@ -0,0 +1,133 @@
+import argparse
+import hashlib
+import os
+import struct
+import zlib
+
+import pdex2elf
+
+# Packs a linked device ELF (build/pdex.elf, linked with --emit-relocs) into
+# the v2 pdex.bin layout pdex2elf.py reads, so a code-only change does not
+# need a pdc run:
+#
+#   "Playdate PDX", u32 flags, 16 byte MD5 of the image, u32 filesz,
+#   u32 memsz, u32 entry, u32 relocation count, then zlib(image + offsets)
+#
+# The image is every PT_LOAD segment's file contents at its address, and the
+# offsets are the R_ARM_ABS32 words in it the loader adds its base to.
+
+MAGIC = b'Playdate PDX'
+
+SHT_REL = 9
+SHF_ALLOC = 0x2
+SHN_UNDEF = 0
+SHN_ABS = 0xfff1
+PT_LOAD = 1
+R_ARM_ABS32 = 2
+R_ARM_TARGET1 = 38  # .init_array entries, ABS32 on this target
+
+
+def read_elf(data):
+    """Returns (image, memsz, entry, relocations) for a 32-bit little-endian
+    ARM executable."""
+    if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+        raise ValueError('not a 32-bit little-endian ELF file')
+    (e_type, e_machine, _, e_entry, e_phoff, e_shoff, _, _, e_phentsize, e_phnum,
+     e_shentsize, e_shnum, _) = struct.unpack_from('<HHIIIIIHHHHHH', data, 16)
+    if e_machine != 0x28:
+        raise ValueError('not an ARM ELF file')
+    if e_type != 2:
+        raise ValueError('not an executable; link the ELF first')
+
+    segments = []
+    for i in range(e_phnum):
+        p_type, p_offset, p_vaddr, _, p_filesz, p_memsz, _, _ = struct.unpack_from('<8I', data, e_phoff + i * e_phentsize)
+        if p_type == PT_LOAD and p_memsz:
+            segments.append((p_vaddr, data[p_offset:p_offset + p_filesz], p_memsz))
+    if not segments:
+        raise ValueError('no loadable segments')
+    if min(s[0] for s in segments) != 0:
+        raise ValueError('the image must be linked at address 0')
+
+    filesz = max(vaddr + len(contents) for vaddr, contents, _ in segments)
+    memsz = max(vaddr + size for vaddr, _, size in segments)
+    image = bytearray(filesz)
+    for vaddr, contents, _ in segments:
+        image[vaddr:vaddr + len(contents)] = contents
+
+    sections = [struct.unpack_from('<10I', data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+    relocations = set()
+    for _, sh_type, _, _, sh_offset, sh_size, sh_link, sh_info, _, _ in sections:
+        if sh_type != SHT_REL or not sections[sh_info][2] & SHF_ALLOC:
+            continue
+        symtab = sections[sh_link]
+        for r_offset, r_info in struct.iter_unpack('<II', data[sh_offset:sh_offset + sh_size]):
+            if r_info & 0xff not in (R_ARM_ABS32, R_ARM_TARGET1):
+                continue
+            # absolute and undefined weak symbols stay as they are when loaded
+            st_shndx = struct.unpack_from('<H', data, symtab[4] + (r_info >> 8) * 16 + 14)[0]
+            if r_info >> 8 and st_shndx in (SHN_UNDEF, SHN_ABS):
+                continue
+            if r_offset + 4 > filesz:
+                raise ValueError('relocation at {:#x} is outside the image'.format(r_offset))
+            relocations.add(r_offset)
+
+    return bytes(image), memsz, e_entry, sorted(relocations)
+
+
+def pack(image, memsz, entry, relocations, level):
+    payload = image + b''.join(struct.pack('<I', r) for r in relocations)
+    header = MAGIC + struct.pack('<I', 0) + hashlib.md5(image).digest()
+    header += struct.pack('<4I', len(image), memsz, entry, len(relocations))
+    return header + zlib.compress(payload, level)
+
+
+def unchanged(path, image, memsz, entry, relocations):
+    """True if path already holds this image; the header's MD5 rules out
+    most changes and only a match costs inflating the old payload."""
+    try:
+        with open(path, 'rb') as f:
+            old = pdex2elf.read_header(f)
+    except (OSError, ValueError):
+        return False
+    if old.checksum != hashlib.md5(image).digest():
+        return False
+    if (old.filesz, old.memsz, old.entry, old.relnum) != (len(image), memsz, entry, len(relocations)):
+        return False
+    return pdex2elf.read_pdex(path).relocations() == relocations
+
+
+def verify(path, image, memsz, entry, relocations):
+    pdex = pdex2elf.read_pdex(path)
+    if (pdex.text != image or pdex.memsz != memsz or pdex.entry != entry or pdex.relocations() != relocations or
+            pdex.checksum.hex() != pdex.computed_checksum):
+        raise ValueError('{} does not read back as written'.format(path))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='elf2pdex.py',
+        description='Packs a linked device ELF into a Playdate pdex.bin file.'
+    )
+    parser.add_argument('elf', help='the path to the ELF, linked with --emit-relocs')
+    parser.add_argument('pdex', help='the path to the output pdex.bin')
+    parser.add_argument('-l', '--level', type=int, default=9, choices=range(0, 10), metavar='0-9',
+                        help='zlib compression level (default 9)')
+    parser.add_argument('--force', action='store_true', help='write even if the code is unchanged')
+    args = parser.parse_args()
+
+    with open(args.elf, 'rb') as f:
+        image, memsz, entry, relocations = read_elf(f.read())
+
+    if not args.force and unchanged(args.pdex, image, memsz, entry, relocations):
+        print('{}: unchanged'.format(args.pdex))
+        raise SystemExit(0)
+
+    blob = pack(image, memsz, entry, relocations, args.level)
+    tmp = args.pdex + '.tmp'
+    with open(tmp, 'wb') as f:
+        f.write(blob)
+    verify(tmp, image, memsz, entry, relocations)
+    os.replace(tmp, args.pdex)
+    print('{}: {} bytes of code, {} bss, {} relocations, {} bytes packed'.format(
+        args.pdex, len(image), memsz - len(image), len(relocations), len(blob)))
@@ -0,0 +1,60 @@
+#include "bench.h"
+
+// Allocation patterns through playdate->system->realloc, the hook api.h
+// routes malloc/realloc/free through on device.
+
+#define CHURN_LIVE 64
+
+typedef struct
+{
+  size_t size;
+} AllocCase;
+
+static void allocFree(void* ctx, uint32_t n) {
+  void* (*pdrealloc)(void*, size_t) = host_api()->system->realloc;
+  size_t size = ((AllocCase*)ctx)->size;
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t* p = pdrealloc(NULL, size);
+    p[0] = (uint8_t)i;
+    bench_sink = p[0];
+    pdrealloc(p, 0);
+  }
+}
+
+// a working set of live blocks, one replaced per op with a random size
+static void churn(void* ctx, uint32_t n) {
+  void* (*pdrealloc)(void*, size_t) = host_api()->system->realloc;
+  static void* live[CHURN_LIVE];
+  for (uint32_t i = 0; i < n; i++) {
+    int slot = bench_random() % CHURN_LIVE;
+    if (live[slot]) pdrealloc(live[slot], 0);
+    live[slot] = pdrealloc(NULL, 8 + bench_random() % 504);
+  }
+  for (int i = 0; i < CHURN_LIVE; i++) {
+    if (live[i]) pdrealloc(live[i], 0);
+    live[i] = NULL;
+  }
+}
+
+// a buffer doubled from 16 bytes to 4 KB, the way dynamic arrays grow
+static void grow(void* ctx, uint32_t n) {
+  void* (*pdrealloc)(void*, size_t) = host_api()->system->realloc;
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t* p = NULL;
+    for (size_t size = 16; size <= 4096; size *= 2) {
+      p = pdrealloc(p, size);
+      p[size - 1] = (uint8_t)size;
+    }
+    bench_sink = p[4095];
+    pdrealloc(p, 0);
+  }
+}
+
+void bench_alloc(void) {
+  static AllocCase small = { 16 }, medium = { 256 }, large = { 65536 };
+  bench_run("alloc/free_16", allocFree, &small, 0);
+  bench_run("alloc/free_256", allocFree, &medium, 0);
+  bench_run("alloc/free_64k", allocFree, &large, 0);
+  bench_run("alloc/churn_64_live", churn, NULL, 0);
+  bench_run("alloc/grow_16_to_4k", grow, NULL, 0);
+}
@@ -0,0 +1,160 @@
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "bench.h"
+
+#define BENCH_MAX_SAMPLES 1000
+#define BENCH_MAX_RESULTS 256
+
+volatile uint32_t bench_sink;
+
+static int reps = 25;
+static int warmup = 3;
+static uint64_t sampleNs = 2000000; // grow iterations until a sample takes this long
+static const char* filter;
+
+static uint64_t nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+uint32_t bench_random(void) {
+  static uint32_t state = 0x12345678;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static int compare(const void* a, const void* b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return x < y ? -1 : x > y;
+}
+
+void bench_run(const char* name, BenchFunction* fn, void* ctx, uint32_t bytesPerOp) {
+  if (filter && strstr(name, filter) == NULL) return;
+
+  uint32_t iterations = 1;
+  for (;;) {
+    uint64_t start = nowNs();
+    fn(ctx, iterations);
+    if (nowNs() - start >= sampleNs || iterations >= (1u << 30)) break;
+    iterations *= 2;
+  }
+  for (int i = 0; i < warmup; i++) fn(ctx, iterations);
+
+  double samples[BENCH_MAX_SAMPLES];
+  for (int i = 0; i < reps; i++) {
+    uint64_t start = nowNs();
+    fn(ctx, iterations);
+    samples[i] = (double)(nowNs() - start) / iterations;
+  }
+  qsort(samples, reps, sizeof(double), compare);
+
+  double median = reps & 1 ? samples[reps / 2] : (samples[reps / 2 - 1] + samples[reps / 2]) / 2;
+  double p99 = samples[(int)ceil(reps * 0.99) - 1]; // nearest rank
+  double mbps = bytesPerOp ? bytesPerOp / median * 1000.0 : 0;
+  printf("%s\t%u\t%.2f\t%.2f\t%.2f\t%.1f\n", name, iterations, median, p99, samples[0], mbps);
+  fflush(stdout);
+}
+
+// -- Comparison ---------------------------------------------------------------
+
+typedef struct
+{
+  char name[64];
+  double median;
+} Result;
+
+static int load(const char* path, Result* out) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "pdbench: cannot read %s\n", path);
+    return -1;
+  }
+  char line[256];
+  int count = 0;
+  while (fgets(line, sizeof(line), f) && count < BENCH_MAX_RESULTS) {
+    if (line[0] == '#' || strncmp(line, "name\t", 5) == 0) continue;
+    if (sscanf(line, "%63[^\t]\t%*u\t%lf", out[count].name, &out[count].median) == 2) count++;
+  }
+  fclose(f);
+  return count;
+}
+
+// prints the change in median for every benchmark in both runs; returns 1
+// if any got slower by more than threshold percent
+static int compareRuns(const char* basePath, const char* newPath, double threshold) {
+  static Result base[BENCH_MAX_RESULTS], next[BENCH_MAX_RESULTS];
+  int baseCount = load(basePath, base);
+  int nextCount = load(newPath, next);
+  if (baseCount < 0 || nextCount < 0) return 2;
+
+  int regressions = 0;
+  printf("name\tbase_ns\tnew_ns\tchange\n");
+  for (int i = 0; i < nextCount; i++) {
+    for (int j = 0; j < baseCount; j++) {
+      if (strcmp(next[i].name, base[j].name) != 0) continue;
+      double change = (next[i].median - base[j].median) / base[j].median * 100.0;
+      const char* flag = change > threshold ? "\tREGRESSION" : change < -threshold ? "\tfaster" : "";
+      printf("%s\t%.2f\t%.2f\t%+.1f%%%s\n", next[i].name, base[j].median, next[i].median, change, flag);
+      if (change > threshold) regressions++;
+      break;
+    }
+  }
+  if (regressions) fprintf(stderr, "pdbench: %d regression(s) over %.1f%%\n", regressions, threshold);
+  return regressions ? 1 : 0;
+}
+
+// -- Main ---------------------------------------------------------------------
+
+static void usage(void) {
+  fprintf(stderr,
+    "usage: pdbench [--filter <text>] [--reps <n>] [--warmup <n>] [--sample-ms <ms>]\n"
+    "       pdbench --compare <base.tsv> <new.tsv> [--threshold <percent>]\n");
+}
+
+int main(int argc, char** argv) {
+  const char* basePath = NULL;
+  const char* newPath = NULL;
+  double threshold = 5.0;
+
+  for (int i = 1; i < argc; i++) {
+    int more = i + 1 < argc;
+    if (strcmp(argv[i], "--filter") == 0 && more) filter = argv[++i];
+    else if (strcmp(argv[i], "--reps") == 0 && more) reps = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--warmup") == 0 && more) warmup = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--sample-ms") == 0 && more) sampleNs = (uint64_t)(atof(argv[++i]) * 1000000);
+    else if (strcmp(argv[i], "--threshold") == 0 && more) threshold = atof(argv[++i]);
+    else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc) {
+      basePath = argv[++i];
+      newPath = argv[++i];
+    }
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (basePath) return compareRuns(basePath, newPath, threshold);
+  if (reps < 1 || reps > BENCH_MAX_SAMPLES) reps = 25;
+
+  HostConfig config = { "build/host/Data", "build/Source", NULL, 1, 1 };
+  if (host_init(&config) < 0) {
+    fprintf(stderr, "pdbench: game initialisation failed\n");
+    return 1;
+  }
+
+  printf("# pdbench reps=%d warmup=%d sample_ms=%.1f\n", reps, warmup, sampleNs / 1e6);
+  printf("name\titerations\tmedian_ns\tp99_ns\tmin_ns\tmb_s\n");
+  bench_gfx();
+  bench_alloc();
+  bench_json();
+  bench_io();
+  bench_lua();
+  bench_input();
+  bench_video();
+  bench_collide();
+  bench_flow();
+  return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "host.h"
+
+// Micro-benchmark harness for the host build. A benchmark is a function
+// that runs its operation `iterations` times; the harness doubles the
+// iteration count until one sample takes long enough to time reliably, runs
+// a few warmup samples, then reports the median, p99 and minimum ns/op over
+// the measured samples as one tab-separated line per benchmark.
+
+typedef void BenchFunction(void* ctx, uint32_t iterations);
+
+// bytesPerOp > 0 also reports throughput in MB/s
+void bench_run(const char* name, BenchFunction* fn, void* ctx, uint32_t bytesPerOp);
+
+// results stored here cannot be optimised away
+extern volatile uint32_t bench_sink;
+
+// deterministic data for inputs
+uint32_t bench_random(void);
+
+void bench_gfx(void);
+void bench_alloc(void);
+void bench_json(void);
+void bench_io(void);
+void bench_lua(void);
+void bench_input(void);
+void bench_video(void);
+void bench_collide(void);
+void bench_flow(void);
+
+#endif // BENCH_H
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include "bench.h"
+#include "colmask.h"
+
+// Pixel-exact overlap between two masked bitmaps at nearby offsets: the
+// reference reads mask bits pixel by pixel over the shared rectangle the way
+// a general test has to, against prepared colmask masks. The setup checks
+// both agree on every offset and flip it tries.
+
+#define PAIRS 256
+
+typedef struct
+{
+  int dx, dy;
+  LCDBitmapFlip flipA, flipB;
+} Pair;
+
+static LCDBitmap *ring, *bar;
+static Pair pairs[PAIRS];
+static ColMask* masks[2][4];
+
+static int opaque(LCDBitmap* b, LCDBitmapFlip flip, int x, int y) {
+  int width, height, rowbytes;
+  uint8_t *mask, *data;
+  host_api()->graphics->getBitmapData(b, &width, &height, &rowbytes, &mask, &data);
+  if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+  if (flip & kBitmapFlippedX) x = width - 1 - x;
+  if (flip & kBitmapFlippedY) y = height - 1 - y;
+  return mask[y * rowbytes + (x >> 3)] & (0x80 >> (x & 7));
+}
+
+static int pixelOverlap(LCDBitmap* a, LCDBitmapFlip fa, LCDBitmap* b, int bx, int by, LCDBitmapFlip fb) {
+  int aw, ah, bw, bh;
+  host_api()->graphics->getBitmapData(a, &aw, &ah, NULL, NULL, NULL);
+  host_api()->graphics->getBitmapData(b, &bw, &bh, NULL, NULL, NULL);
+  int x0 = bx > 0 ? bx : 0, x1 = bx + bw < aw ? bx + bw : aw;
+  int y0 = by > 0 ? by : 0, y1 = by + bh < ah ? by + bh : ah;
+  for (int y = y0; y < y1; y++) {
+    for (int x = x0; x < x1; x++) {
+      if (opaque(a, fa, x, y) && opaque(b, fb, x - bx, y - by)) return 1;
+    }
+  }
+  return 0;
+}
+
+static LCDBitmap* maskedBitmap(int width, int height, int ring) {
+  LCDBitmap* b = host_api()->graphics->newBitmap(width, height, kColorClear);
+  int rowbytes;
+  uint8_t* mask;
+  host_api()->graphics->getBitmapData(b, NULL, NULL, &rowbytes, &mask, NULL);
+  int cx = width / 2, cy = height / 2;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      int d = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+      // a ring with a notch, or a slanted bar, so flips and offsets matter
+      int set = ring ? d < cx * cx && d > (cx - 5) * (cx - 5) && !(x > cx && y < cy - 4) : x >= y && x < y + 28;
+      if (set) mask[y * rowbytes + (x >> 3)] |= 0x80 >> (x & 7);
+    }
+  }
+  return b;
+}
+
+static void pixelPairs(void* ctx, uint32_t n) {
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    const Pair* p = &pairs[i % PAIRS];
+    hits += pixelOverlap(ring, p->flipA, bar, p->dx, p->dy, p->flipB);
+  }
+  bench_sink = hits;
+}
+
+static void maskPairs(void* ctx, uint32_t n) {
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    const Pair* p = &pairs[i % PAIRS];
+    hits += colmask_overlap(masks[0][p->flipA], 0, 0, masks[1][p->flipB], p->dx, p->dy);
+  }
+  bench_sink = hits;
+}
+
+static void build(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    ColMask* m = colmask_build(ring, i & 3);
+    bench_sink = m->bottom;
+    colmask_free(m);
+  }
+}
+
+void bench_collide(void) {
+  ring = maskedBitmap(32, 32, 1);
+  bar = maskedBitmap(48, 20, 0);
+  for (int f = 0; f < 4; f++) {
+    masks[0][f] = colmask_get(ring, f);
+    masks[1][f] = colmask_get(bar, f);
+  }
+  for (int i = 0; i < PAIRS; i++) {
+    pairs[i] = (Pair){ (int)(bench_random() % 80) - 48, (int)(bench_random() % 52) - 20, bench_random() & 3, bench_random() & 3 };
+    const Pair* p = &pairs[i];
+    if (pixelOverlap(ring, p->flipA, bar, p->dx, p->dy, p->flipB) !=
+        colmask_overlap(masks[0][p->flipA], 0, 0, masks[1][p->flipB], p->dx, p->dy)) {
+      fprintf(stderr, "pdbench: colmask disagrees with the pixel test at %d,%d flips %d/%d\n", p->dx, p->dy, p->flipA, p->flipB);
+      exit(1);
+    }
+  }
+
+  bench_run("collide/pixel_pairs", pixelPairs, NULL, 0);
+  bench_run("collide/mask_pairs", maskPairs, NULL, 0);
+  bench_run("collide/build_32x32", build, NULL, 0);
+
+  colmask_clear();
+  host_api()->graphics->freeBitmap(ring);
+  host_api()->graphics->freeBitmap(bar);
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include "bench.h"
+#include "flow.h"
+
+// Flow fields on a 256x256 map with scattered walls and patches of costly
+// ground: a full rebuild toward a new goal, the repair after one tile turns
+// into a wall or back, and a thousand agents looking up their direction.
+// The setup checks that fields repaired through many changes hold the same
+// distances as a field built from scratch.
+
+#define MAP_SIZE 256
+#define AGENTS 1000
+
+static FlowGrid* grid;
+static FlowField* field;
+static int agents[AGENTS][2];
+
+static void settle(FlowGrid* g) {
+  while (flow_update(g, 1000000) == 0) {}
+}
+
+static void buildMap(void) {
+  for (int y = 0; y < MAP_SIZE; y++) {
+    for (int x = 0; x < MAP_SIZE; x++) {
+      uint32_t r = bench_random() % 100;
+      flow_setCost(grid, x, y, r < 20 ? FLOW_BLOCKED : r < 30 ? 5 : 1);
+    }
+  }
+}
+
+static void rebuild(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    flow_setGoal(field, i & 1 ? 10 : MAP_SIZE - 10, MAP_SIZE / 2);
+    flow_setCost(grid, i & 1 ? 10 : MAP_SIZE - 10, MAP_SIZE / 2, 1);
+    settle(grid);
+  }
+  bench_sink = field->stats.expanded;
+}
+
+static void repairWall(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    int x = bench_random() % MAP_SIZE, y = bench_random() % MAP_SIZE;
+    uint8_t cost = flow_cost(grid, x, y);
+    flow_setCost(grid, x, y, cost == FLOW_BLOCKED ? 1 : FLOW_BLOCKED);
+    settle(grid);
+  }
+  bench_sink = field->stats.repairs;
+}
+
+static void sample(void* ctx, uint32_t n) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    for (int a = 0; a < AGENTS; a++) {
+      int d = flow_dir(field, agents[a][0], agents[a][1]);
+      sum += flow_dx[d] + 2 * flow_dy[d];
+    }
+  }
+  bench_sink = sum;
+}
+
+static int repairsMatchRebuild(void) {
+  FlowField* fresh = flow_newField(grid);
+  flow_setGoal(field, 40, 40);
+  flow_setCost(grid, 40, 40, 1);
+  settle(grid);
+  for (int i = 0; i < 500; i++) {
+    int x = bench_random() % MAP_SIZE, y = bench_random() % MAP_SIZE;
+    if (x == 40 && y == 40) continue;
+    flow_setCost(grid, x, y, flow_cost(grid, x, y) == FLOW_BLOCKED ? 1 + (i & 3) : FLOW_BLOCKED);
+    if (i % 7 == 0) settle(grid); // some changes land mid-pass
+    else flow_update(grid, 0);
+  }
+  flow_setGoal(fresh, 40, 40);
+  settle(grid);
+
+  int same = 1;
+  for (int y = 0; y < MAP_SIZE && same; y++) {
+    for (int x = 0; x < MAP_SIZE && same; x++) same = flow_distance(field, x, y) == flow_distance(fresh, x, y);
+  }
+  flow_freeField(fresh);
+  return same;
+}
+
+void bench_flow(void) {
+  grid = flow_newGrid(MAP_SIZE, MAP_SIZE);
+  field = grid ? flow_newField(grid) : NULL;
+  if (field == NULL) {
+    fprintf(stderr, "pdbench: flow setup failed\n");
+    exit(1);
+  }
+  buildMap();
+  if (!repairsMatchRebuild()) {
+    fprintf(stderr, "pdbench: repaired flow field differs from a rebuilt one\n");
+    exit(1);
+  }
+  for (int a = 0; a < AGENTS; a++) {
+    agents[a][0] = bench_random() % MAP_SIZE;
+    agents[a][1] = bench_random() % MAP_SIZE;
+  }
+
+  bench_run("flow/rebuild_256", rebuild, NULL, 0);
+  bench_run("flow/repair_wall_256", repairWall, NULL, 0);
+  bench_run("flow/sample_1000", sample, NULL, 0);
+  flow_freeGrid(grid);
+}
@@ -0,0 +1,117 @@
+#include "bench.h"
+
+// Rendering kernels on a 400x240, LCD_ROWSIZE stride, 1 bit per pixel
+// frame like the one getFrame() returns.
+
+static uint8_t frame[LCD_ROWSIZE * LCD_ROWS];
+static uint8_t gray[LCD_COLUMNS * LCD_ROWS];
+static uint32_t sprite[32], spriteMask[32];
+
+static void clearFrame(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    memset(frame, i & 1 ? 0x00 : 0xff, sizeof(frame));
+    bench_sink = frame[i % sizeof(frame)];
+  }
+}
+
+static inline void putBit(uint8_t* row, int x, int white) {
+  uint8_t bit = 0x80 >> (x & 7);
+  if (white) row[x >> 3] |= bit;
+  else row[x >> 3] &= ~bit;
+}
+
+// reference: one pixel at a time
+static void fillRectPixels(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    for (int y = 40; y < 40 + 77; y++) {
+      uint8_t* row = frame + y * LCD_ROWSIZE;
+      for (int x = 13; x < 13 + 123; x++) putBit(row, x, i & 1);
+    }
+    bench_sink = frame[40 * LCD_ROWSIZE + 2];
+  }
+}
+
+// masked partial bytes at either end, memset in between
+static void fillRectSpans(void* ctx, uint32_t n) {
+  int x0 = 13, x1 = 13 + 123;
+  int first = x0 >> 3, last = (x1 - 1) >> 3;
+  uint8_t head = 0xff >> (x0 & 7), tail = 0xff << (7 - ((x1 - 1) & 7));
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t fill = i & 1 ? 0xff : 0x00;
+    for (int y = 40; y < 40 + 77; y++) {
+      uint8_t* p = frame + y * LCD_ROWSIZE;
+      p[first] = (p[first] & ~head) | (fill & head);
+      memset(p + first + 1, fill, last - first - 1);
+      p[last] = (p[last] & ~tail) | (fill & tail);
+    }
+    bench_sink = frame[40 * LCD_ROWSIZE + 2];
+  }
+}
+
+// 32x32 masked sprite at an unaligned x, shifted a word at a time
+static void blitSprite(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    int x = 37 + (i & 63), y = 50;
+    int shift = x & 7;
+    for (int row = 0; row < 32; row++) {
+      uint8_t* p = frame + (y + row) * LCD_ROWSIZE + (x >> 3);
+      uint64_t bits = (uint64_t)sprite[row] << (32 - shift);
+      uint64_t mask = (uint64_t)spriteMask[row] << (32 - shift);
+      for (int b = 0; b < 5; b++) {
+        uint8_t m = mask >> (56 - 8 * b);
+        p[b] = (p[b] & ~m) | ((bits >> (56 - 8 * b)) & m);
+      }
+    }
+    bench_sink = frame[y * LCD_ROWSIZE + (x >> 3)];
+  }
+}
+
+static void scrollFrame(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    memmove(frame, frame + LCD_ROWSIZE, sizeof(frame) - LCD_ROWSIZE);
+    bench_sink = frame[0];
+  }
+}
+
+// 8-bit grayscale to 1 bit through a 4x4 Bayer matrix
+static void ditherFrame(void* ctx, uint32_t n) {
+  static const uint8_t bayer[4][4] = {
+    { 8, 136, 40, 168 }, { 200, 72, 232, 104 }, { 56, 184, 24, 152 }, { 248, 120, 216, 88 }
+  };
+  for (uint32_t i = 0; i < n; i++) {
+    for (int y = 0; y < LCD_ROWS; y++) {
+      const uint8_t* src = gray + y * LCD_COLUMNS;
+      const uint8_t* threshold = bayer[y & 3];
+      uint8_t* dst = frame + y * LCD_ROWSIZE;
+      for (int x = 0; x < LCD_COLUMNS; x += 8) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) byte = (byte << 1) | (src[x + b] > threshold[(x + b) & 3]);
+        dst[x >> 3] = byte;
+      }
+    }
+    bench_sink = frame[i % sizeof(frame)];
+  }
+}
+
+// the host runtime's own fillRect, through the API table
+static void apiFillRect(void* ctx, uint32_t n) {
+  const struct playdate_graphics* gfx = host_api()->graphics;
+  for (uint32_t i = 0; i < n; i++) gfx->fillRect(13, 40, 123, 77, i & 1 ? kColorWhite : kColorBlack);
+  bench_sink = gfx->getFrame()[40 * LCD_ROWSIZE + 2];
+}
+
+void bench_gfx(void) {
+  for (size_t i = 0; i < sizeof(gray); i++) gray[i] = (uint8_t)((i % LCD_COLUMNS) * 255 / LCD_COLUMNS + (bench_random() & 15));
+  for (int i = 0; i < 32; i++) {
+    sprite[i] = bench_random();
+    spriteMask[i] = 0xffffffffu >> (i & 7);
+  }
+
+  bench_run("gfx/clear", clearFrame, NULL, sizeof(frame));
+  bench_run("gfx/fillrect_pixels", fillRectPixels, NULL, 0);
+  bench_run("gfx/fillrect_spans", fillRectSpans, NULL, 0);
+  bench_run("gfx/fillrect_api", apiFillRect, NULL, 0);
+  bench_run("gfx/blit32_masked", blitSprite, NULL, 0);
+  bench_run("gfx/scroll_row", scrollFrame, NULL, sizeof(frame));
+  bench_run("gfx/dither_bayer4", ditherFrame, NULL, sizeof(gray));
+}
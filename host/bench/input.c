@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include "bench.h"
+#include "input.h"
+
+// The button event queue: one injected event through the ring, a burst of
+// the size a slow frame might see, and polling getButtonState for scale.
+// The setup injects an interleaved burst and checks it drains in order.
+
+#define INPUT_CAPACITY 64
+#define INPUT_BURST 32
+
+static void injectNext(void* ctx, uint32_t n) {
+  InputEvent e;
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    input_inject(kButtonA, i & 1, i);
+    input_next(&e);
+    sum += e.when;
+  }
+  bench_sink = sum;
+}
+
+static void burst(void* ctx, uint32_t n) {
+  InputEvent e;
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    for (int k = 0; k < INPUT_BURST; k++) input_inject(1 << (k % 6), k & 1, k);
+    while (input_next(&e)) sum += e.button;
+  }
+  bench_sink = sum;
+}
+
+static void poll(void* ctx, uint32_t n) {
+  const struct playdate_sys* sys = host_api()->system;
+  PDButtons current, pushed, released;
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    sys->getButtonState(&current, &pushed, &released);
+    sum += current | pushed | released;
+  }
+  bench_sink = sum;
+}
+
+static int drainsInOrder(void) {
+  InputEvent e;
+  for (int k = 0; k < INPUT_BURST; k++) input_inject(1 << (k % 6), k & 1, 1000 + k);
+  for (int k = 0; k < INPUT_BURST; k++) {
+    if (!input_next(&e) || e.when != 1000u + k || e.button != 1u << (k % 6) || e.down != (k & 1) || !e.injected) return 0;
+  }
+  return !input_next(&e);
+}
+
+void bench_input(void) {
+  if (input_start(INPUT_CAPACITY) < 0 || !drainsInOrder()) {
+    fprintf(stderr, "pdbench: input queue does not return injected events in order\n");
+    exit(1);
+  }
+  bench_run("input/inject_next", injectNext, NULL, 0);
+  bench_run("input/burst_32", burst, NULL, 0);
+  bench_run("input/poll_state", poll, NULL, 0);
+  input_stop();
+}
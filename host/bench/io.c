@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <zlib.h>
+#include "bench.h"
+#include "bufio.h"
+#include "lz.h"
+
+// File streaming against an in-memory playdate->file, so the numbers are
+// the cost of the calls and the copying rather than of the host's disk, and
+// LZ4 block decoding throughput. The in-memory file also counts the calls
+// it gets: a scripted mix of small reads, seeks and writes runs through
+// bufio and straight through playdate->file, must leave the same bytes, and
+// fails the run if bufio issues more file calls than the unbuffered path.
+//
+// The asset benchmarks decode the corpus build.sh writes into the data
+// directory, once as a pdlz.py frame through lz_decode and once as a zlib
+// stream through uncompress(), and print both compressed sizes.
+
+#define IO_SIZE 65536
+#define LZ_RAW_SIZE 65536
+#define IO_SCRIPT_OPS 4096
+#define LZ_ASSET_MAX (512 * 1024) // build.sh LZ_SAMPLE_MAX
+
+static uint8_t fileData[IO_SIZE];
+static uint8_t outData[2][IO_SIZE];
+
+typedef struct
+{
+  uint8_t* data;
+  int size;
+  int pos;
+} MemFile;
+
+typedef struct
+{
+  uint32_t reads, writes, seeks, tells, flushes;
+} FileCalls;
+
+static MemFile memFile, memOut;
+static FileCalls fileCalls;
+
+static uint32_t callCount(void) {
+  return fileCalls.reads + fileCalls.writes + fileCalls.seeks + fileCalls.tells + fileCalls.flushes;
+}
+
+static SDFile* memOpen(const char* name, FileOptions mode) {
+  if (mode & (kFileWrite | kFileAppend)) {
+    memOut.pos = mode & kFileAppend ? memOut.size : 0;
+    if (!(mode & kFileAppend)) memOut.size = 0;
+    return &memOut;
+  }
+  memFile.pos = 0;
+  return &memFile;
+}
+
+static int memClose(SDFile* file) {
+  return 0;
+}
+
+static int memRead(SDFile* file, void* buf, unsigned int len) {
+  MemFile* f = file;
+  fileCalls.reads++;
+  if (len > (unsigned int)(f->size - f->pos)) len = f->size - f->pos;
+  memcpy(buf, f->data + f->pos, len);
+  f->pos += len;
+  return len;
+}
+
+static int memWrite(SDFile* file, const void* buf, unsigned int len) {
+  MemFile* f = file;
+  fileCalls.writes++;
+  if (f != &memOut || len > (unsigned int)(IO_SIZE - f->pos)) return -1;
+  memcpy(f->data + f->pos, buf, len);
+  f->pos += len;
+  if (f->pos > f->size) f->size = f->pos;
+  return len;
+}
+
+static int memFlush(SDFile* file) {
+  fileCalls.flushes++;
+  return 0;
+}
+
+static int memTell(SDFile* file) {
+  fileCalls.tells++;
+  return ((MemFile*)file)->pos;
+}
+
+static int memSeek(SDFile* file, int pos, int whence) {
+  MemFile* f = file;
+  fileCalls.seeks++;
+  if (whence == SEEK_CUR) pos += f->pos;
+  else if (whence == SEEK_END) pos += f->size;
+  if (pos < 0 || pos > f->size) return -1;
+  f->pos = pos;
+  return 0;
+}
+
+// one little-endian u32 per read call, the way unbuffered loaders do it
+static void rawU32(void* ctx, uint32_t n) {
+  const struct playdate_file* fs = host_api()->file;
+  for (uint32_t i = 0; i < n; i++) {
+    SDFile* file = fs->open("bench.bin", kFileRead);
+    uint32_t sum = 0;
+    uint8_t b[4];
+    while (fs->read(file, b, 4) == 4) sum += (uint32_t)b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+    fs->close(file);
+    bench_sink = sum;
+  }
+}
+
+static void bufioU32(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    BufFile* file = bufio_open("bench.bin", kFileRead, 0);
+    uint32_t sum = 0, v;
+    while (bufio_readU32(file, &v) == 0) sum += v;
+    bufio_close(file);
+    bench_sink = sum;
+  }
+}
+
+static void chunked(void* ctx, uint32_t n) {
+  const struct playdate_file* fs = host_api()->file;
+  static uint8_t chunk[4096];
+  for (uint32_t i = 0; i < n; i++) {
+    SDFile* file = fs->open("bench.bin", kFileRead);
+    uint32_t sum = 0;
+    while (fs->read(file, chunk, sizeof(chunk)) > 0) sum += chunk[0];
+    fs->close(file);
+    bench_sink = sum;
+  }
+}
+
+// -- Scripted mix -------------------------------------------------------------
+
+enum
+{
+  kOpRead,  // a small field
+  kOpBlock, // a larger record, sometimes bigger than the bufio buffer
+  kOpSkip,  // SEEK_CUR a little forwards or back
+  kOpSeek   // SEEK_SET anywhere
+};
+
+typedef struct
+{
+  uint8_t kind;
+  int len;
+} IoOp;
+
+static IoOp script[IO_SCRIPT_OPS];
+
+// the shape of a level or save loader: mostly small fields, some records,
+// short skips over unused data and the odd jump to a table elsewhere
+static void buildScript(void) {
+  int written = 0;
+  for (int i = 0; i < IO_SCRIPT_OPS; i++) {
+    uint32_t r = bench_random() % 100;
+    IoOp* op = &script[i];
+    if (r < 70) *op = (IoOp){ kOpRead, 1 + bench_random() % 8 };
+    else if (r < 80) *op = (IoOp){ kOpBlock, 16 + bench_random() % (r < 79 ? 256 : 6000) };
+    else if (r < 95) *op = (IoOp){ kOpSkip, (int)(bench_random() % 96) - 32 };
+    else *op = (IoOp){ kOpSeek, bench_random() % (IO_SIZE / 2) };
+    // the write pass goes the same way, so keep it inside the file
+    if (op->kind == kOpRead || op->kind == kOpBlock) written += op->len;
+    if (written > IO_SIZE / 2) {
+      *op = (IoOp){ kOpSeek, 0 };
+      written = 0;
+    }
+  }
+}
+
+static uint32_t mix(uint32_t h, const uint8_t* b, int len) {
+  for (int i = 0; i < len; i++) h = (h ^ b[i]) * 16777619u;
+  return h;
+}
+
+static uint32_t rawReads(void) {
+  const struct playdate_file* fs = host_api()->file;
+  static uint8_t b[8192];
+  SDFile* file = fs->open("bench.bin", kFileRead);
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < IO_SCRIPT_OPS; i++) {
+    const IoOp* op = &script[i];
+    if (op->kind == kOpSkip) fs->seek(file, op->len, SEEK_CUR);
+    else if (op->kind == kOpSeek) fs->seek(file, op->len, SEEK_SET);
+    else h = mix(h, b, fs->read(file, b, op->len));
+  }
+  fs->close(file);
+  return h;
+}
+
+static uint32_t bufioReads(void) {
+  static uint8_t b[8192];
+  BufFile* file = bufio_open("bench.bin", kFileRead, 0);
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < IO_SCRIPT_OPS; i++) {
+    const IoOp* op = &script[i];
+    if (op->kind == kOpSkip) bufio_seek(file, op->len, SEEK_CUR);
+    else if (op->kind == kOpSeek) bufio_seek(file, op->len, SEEK_SET);
+    else h = mix(h, b, bufio_read(file, b, op->len));
+  }
+  bufio_close(file);
+  return h;
+}
+
+// writes go forwards from wherever the last seek left them; skips back
+// rewrite what is already there
+static void rawWrites(void) {
+  const struct playdate_file* fs = host_api()->file;
+  SDFile* file = fs->open("out.bin", kFileWrite);
+  int pos = 0;
+  for (int i = 0; i < IO_SCRIPT_OPS; i++) {
+    const IoOp* op = &script[i];
+    if (op->kind == kOpRead || op->kind == kOpBlock) pos += fs->write(file, fileData + i, op->len);
+    else if (op->kind == kOpSeek) {
+      fs->seek(file, 0, SEEK_SET);
+      pos = 0;
+    }
+    else if (op->len < 0 && pos + op->len >= 0) {
+      fs->seek(file, op->len, SEEK_CUR);
+      pos += op->len;
+    }
+  }
+  fs->flush(file);
+  fs->close(file);
+}
+
+static void bufioWrites(void) {
+  BufFile* file = bufio_open("out.bin", kFileWrite, 0);
+  int pos = 0;
+  for (int i = 0; i < IO_SCRIPT_OPS; i++) {
+    const IoOp* op = &script[i];
+    if (op->kind == kOpRead || op->kind == kOpBlock) pos += bufio_write(file, fileData + i, op->len);
+    else if (op->kind == kOpSeek) {
+      bufio_seek(file, 0, SEEK_SET);
+      pos = 0;
+    }
+    else if (op->len < 0 && pos + op->len >= 0) {
+      bufio_seek(file, op->len, SEEK_CUR);
+      pos += op->len;
+    }
+  }
+  bufio_close(file);
+}
+
+// 0 if bufio read and wrote the same bytes with no more file calls
+static int compareCalls(void) {
+  fileCalls = (FileCalls){ 0 };
+  uint32_t rawHash = rawReads();
+  uint32_t rawRead = callCount();
+  fileCalls = (FileCalls){ 0 };
+  uint32_t bufHash = bufioReads();
+  uint32_t bufRead = callCount();
+
+  memOut.data = outData[0];
+  fileCalls = (FileCalls){ 0 };
+  rawWrites();
+  uint32_t rawWrite = callCount();
+  int rawSize = memOut.size;
+  memOut.data = outData[1];
+  fileCalls = (FileCalls){ 0 };
+  bufioWrites();
+  uint32_t bufWrite = callCount();
+
+  printf("# io/script_read\tfile_calls raw=%u bufio=%u saved=%u\n", rawRead, bufRead, rawRead - bufRead);
+  printf("# io/script_write\tfile_calls raw=%u bufio=%u saved=%u\n", rawWrite, bufWrite, rawWrite - bufWrite);
+  if (rawHash != bufHash || rawSize != memOut.size || memcmp(outData[0], outData[1], rawSize) != 0) {
+    fprintf(stderr, "pdbench: bufio read or wrote different bytes than playdate->file\n");
+    return -1;
+  }
+  if (bufRead > rawRead || bufWrite > rawWrite) {
+    fprintf(stderr, "pdbench: bufio issued more file calls than playdate->file\n");
+    return -1;
+  }
+  return 0;
+}
+
+// -- LZ -----------------------------------------------------------------------
+
+static uint8_t lzBlock[LZ_RAW_SIZE * 2];
+static uint32_t lzBlockSize;
+static uint8_t lzOut[LZ_RAW_SIZE];
+
+static uint32_t putLength(uint8_t* out, uint32_t n) {
+  uint32_t len = 0;
+  for (; n >= 255; n -= 255) out[len++] = 255;
+  out[len++] = n;
+  return len;
+}
+
+// writes an LZ4 block directly as a sequence of random literal runs and
+// back references, which gives roughly the mix of a tile map or bitmap
+static void buildLzBlock(void) {
+  uint32_t raw = 0, size = 0;
+  while (raw < LZ_RAW_SIZE - 64) {
+    uint32_t literals = bench_random() % 12;
+    uint32_t match = 4 + bench_random() % 40;
+    if (raw == 0) literals = 16;
+    uint32_t behind = raw + literals;
+    uint32_t offset = 1 + bench_random() % (behind < 4096 ? behind : 4096);
+
+    lzBlock[size++] = (literals < 15 ? literals : 15) << 4 | (match - 4 < 15 ? match - 4 : 15);
+    if (literals >= 15) size += putLength(lzBlock + size, literals - 15);
+    for (uint32_t i = 0; i < literals; i++) lzBlock[size++] = bench_random() & 0x0f;
+    lzBlock[size++] = offset & 0xff;
+    lzBlock[size++] = offset >> 8;
+    if (match - 4 >= 15) size += putLength(lzBlock + size, match - 4 - 15);
+    raw += literals + match;
+  }
+  uint32_t tail = LZ_RAW_SIZE - raw;
+  lzBlock[size++] = (tail < 15 ? tail : 15) << 4;
+  if (tail >= 15) size += putLength(lzBlock + size, tail - 15);
+  for (uint32_t i = 0; i < tail; i++) lzBlock[size++] = bench_random() & 0x0f;
+  lzBlockSize = size;
+}
+
+#define LZ_CHECK_SLICE 1000
+
+// 0 if decoding in small slices gives the same bytes and never overshoots,
+// both for the benchmark block and for one long run, which the fast path
+// must not copy whole
+static int lzSlicesHold(void) {
+  static uint8_t sliced[LZ_RAW_SIZE], run[LZ_RAW_SIZE / 255 + 16];
+  uint32_t size = 0, match = LZ_RAW_SIZE - 1 - 5 - 4 - 15;
+  run[size++] = 0x1f;
+  run[size++] = 0x55;
+  run[size++] = 1;
+  run[size++] = 0;
+  size += putLength(run + size, match);
+  run[size++] = 0x50;
+  for (int i = 0; i < 5; i++) run[size++] = 0x55;
+
+  const uint8_t* blocks[2] = { lzBlock, run };
+  uint32_t sizes[2] = { lzBlockSize, size };
+  for (int b = 0; b < 2; b++) {
+    LZDecoder dec;
+    lz_init(&dec, sliced, LZ_RAW_SIZE, 1);
+    lz_feed(&dec, blocks[b], sizes[b]);
+    while (!lz_done(&dec)) {
+      int n = lz_decode(&dec, LZ_CHECK_SLICE);
+      if (n <= 0 || n > LZ_CHECK_SLICE) return -1;
+    }
+    for (uint32_t i = 0; i < LZ_RAW_SIZE; i++) {
+      if (sliced[i] != (b == 0 ? lzOut[i] : 0x55)) return -1;
+    }
+  }
+  return 0;
+}
+
+static void lzDecode(void* ctx, uint32_t n) {
+  int safe = *(int*)ctx;
+  for (uint32_t i = 0; i < n; i++) {
+    LZDecoder dec;
+    lz_init(&dec, lzOut, LZ_RAW_SIZE, safe);
+    lz_feed(&dec, lzBlock, lzBlockSize);
+    while (!lz_done(&dec) && lz_decode(&dec, LZ_RAW_SIZE) > 0) {}
+    bench_sink = lzOut[LZ_RAW_SIZE - 1];
+  }
+}
+
+static uint8_t assetRaw[LZ_ASSET_MAX], assetOut[LZ_ASSET_MAX];
+static uint8_t assetLz[LZ_ASSET_MAX + LZ_ASSET_MAX / 128], assetZ[LZ_ASSET_MAX + LZ_ASSET_MAX / 128];
+static int assetRawSize, assetLzSize, assetZSize;
+
+// a whole file from the data directory; -1 if missing or larger than cap
+static int loadData(const char* path, uint8_t* data, int cap) {
+  const struct playdate_file* fs = host_api()->file;
+  SDFile* file = fs->open(path, kFileRead | kFileReadData);
+  if (file == NULL) return -1;
+  int size = 0, n;
+  while (size < cap && (n = fs->read(file, data + size, cap - size)) > 0) size += n;
+  fs->close(file);
+  return size < cap ? size : -1;
+}
+
+static int lzAssets(uint8_t* out) {
+  LZDecoder dec;
+  lz_init(&dec, out, assetRawSize, 1);
+  lz_feed(&dec, assetLz + LZ_FRAME_SIZE, assetLzSize - LZ_FRAME_SIZE);
+  while (!lz_done(&dec) && lz_decode(&dec, assetRawSize) > 0) {}
+  return lz_done(&dec) ? 0 : -1;
+}
+
+static int zlibAssets(uint8_t* out) {
+  uLongf len = assetRawSize;
+  return uncompress(out, &len, assetZ, assetZSize) == Z_OK && len == (uLongf)assetRawSize ? 0 : -1;
+}
+
+static void lzAssetDecode(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) lzAssets(assetOut);
+  bench_sink = assetOut[assetRawSize - 1];
+}
+
+static void zlibAssetDecode(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) zlibAssets(assetOut);
+  bench_sink = assetOut[assetRawSize - 1];
+}
+
+// 0 if the corpus loaded and both streams decode to it
+static int loadAssets(void) {
+  assetRawSize = loadData("bench_assets.raw", assetRaw, LZ_ASSET_MAX);
+  assetLzSize = loadData("bench_assets.pdlz", assetLz, sizeof(assetLz));
+  assetZSize = loadData("bench_assets.z", assetZ, sizeof(assetZ));
+  if (assetRawSize <= 0 || assetLzSize < LZ_FRAME_SIZE || assetZSize < 0) {
+    fprintf(stderr, "pdbench: no bench_assets.raw, .pdlz or .z, run pdbench through build.sh bench\n");
+    return -1;
+  }
+  const uint8_t* f = assetLz;
+  uint32_t rawSize = f[4] | (f[5] << 8) | (f[6] << 16) | ((uint32_t)f[7] << 24);
+  uint32_t size = f[8] | (f[9] << 8) | (f[10] << 16) | ((uint32_t)f[11] << 24);
+  if (memcmp(f, "PDLZ", 4) != 0 || rawSize != (uint32_t)assetRawSize || size != (uint32_t)(assetLzSize - LZ_FRAME_SIZE) ||
+      lzAssets(assetOut) < 0 || memcmp(assetOut, assetRaw, assetRawSize) != 0 || zlibAssets(assetOut) < 0 ||
+      memcmp(assetOut, assetRaw, assetRawSize) != 0) {
+    fprintf(stderr, "pdbench: bench_assets.pdlz or .z does not decode to bench_assets.raw\n");
+    exit(1);
+  }
+  printf("# io/assets\tbytes raw=%d pdlz=%d (%.1f%%) zlib=%d (%.1f%%)\n", assetRawSize, assetLzSize,
+         100.0 * assetLzSize / assetRawSize, assetZSize, 100.0 * assetZSize / assetRawSize);
+  return 0;
+}
+
+void bench_io(void) {
+  for (int i = 0; i < IO_SIZE; i++) fileData[i] = (uint8_t)bench_random();
+
+  PlaydateAPI* pd = host_api();
+  const struct playdate_file* saved = pd->file;
+  static struct playdate_file memory;
+  memory = *saved;
+  memory.open = memOpen;
+  memory.close = memClose;
+  memory.read = memRead;
+  memory.write = memWrite;
+  memory.flush = memFlush;
+  memory.tell = memTell;
+  memory.seek = memSeek;
+  pd->file = &memory;
+  memFile = (MemFile){ fileData, IO_SIZE, 0 };
+
+  buildScript();
+  if (compareCalls() < 0) exit(1);
+
+  bench_run("io/raw_u32", rawU32, NULL, IO_SIZE);
+  bench_run("io/bufio_u32", bufioU32, NULL, IO_SIZE);
+  bench_run("io/chunk_4k", chunked, NULL, IO_SIZE);
+  pd->file = saved;
+
+  buildLzBlock();
+  static int safe = 1, trusted = 0;
+  LZDecoder check;
+  lz_init(&check, lzOut, LZ_RAW_SIZE, 1);
+  lz_feed(&check, lzBlock, lzBlockSize);
+  while (!lz_done(&check) && lz_decode(&check, LZ_RAW_SIZE) > 0) {}
+  if (!lz_done(&check)) {
+    fprintf(stderr, "pdbench: lz benchmark block does not decode\n");
+    exit(1);
+  }
+  if (lzSlicesHold() < 0) {
+    fprintf(stderr, "pdbench: lz_decode overshoots maxOut or decodes differently in slices\n");
+    exit(1);
+  }
+  bench_run("io/lz_decode_safe", lzDecode, &safe, LZ_RAW_SIZE);
+  bench_run("io/lz_decode_trusted", lzDecode, &trusted, LZ_RAW_SIZE);
+
+  if (loadAssets() == 0) {
+    bench_run("io/lz_assets", lzAssetDecode, NULL, assetRawSize);
+    bench_run("io/zlib_assets", zlibAssetDecode, NULL, assetRawSize);
+  }
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include "bench.h"
+#include "jsonbind.h"
+
+// Decoding a level description through playdate->json: jsonbind's schema
+// binding against a hand-written decoder that compares every key.
+
+typedef struct
+{
+  char name[16];
+  int hp;
+  float speed;
+  float x, y;
+  int tags[4];
+  int tagCount;
+} Enemy;
+
+typedef struct
+{
+  char title[32];
+  int width, height;
+  Enemy enemies[32];
+  int enemyCount;
+} Level;
+
+static const JsonField enemyFields[] = {
+  JSONBIND_STRING(Enemy, name),
+  JSONBIND_INT(Enemy, hp),
+  JSONBIND_FLOAT(Enemy, speed),
+  JSONBIND_FLOAT(Enemy, x),
+  JSONBIND_FLOAT(Enemy, y),
+  JSONBIND_ARRAY(Enemy, tags, tagCount, kBindInt),
+};
+static JsonSchema enemySchema = JSONBIND_SCHEMA(enemyFields);
+
+static const JsonField levelFields[] = {
+  JSONBIND_STRING(Level, title),
+  JSONBIND_INT(Level, width),
+  JSONBIND_INT(Level, height),
+  JSONBIND_TABLE_ARRAY(Level, enemies, enemyCount, enemySchema),
+};
+static JsonSchema levelSchema = JSONBIND_SCHEMA(levelFields);
+
+static char document[8192];
+
+static void buildDocument(void) {
+  int n = snprintf(document, sizeof(document),
+    "{\"title\": \"Bench level\", \"width\": 400, \"height\": 240, \"music\": {\"track\": \"a\", \"loop\": true},\n"
+    " \"enemies\": [\n");
+  for (int i = 0; i < 32; i++) {
+    n += snprintf(document + n, sizeof(document) - n,
+      "  {\"name\": \"enemy%d\", \"hp\": %d, \"speed\": %d.5, \"x\": %d, \"y\": %d, \"tags\": [1, 2, %d],"
+      " \"editor\": {\"color\": \"#ff00ff\", \"notes\": \"ignored at runtime\"}}%s\n",
+      i, 10 + i, i % 4, i * 12, i * 7, i, i < 31 ? "," : "");
+  }
+  snprintf(document + n, sizeof(document) - n, " ]\n}\n");
+}
+
+static void bind(void* ctx, uint32_t n) {
+  static Level level;
+  for (uint32_t i = 0; i < n; i++) {
+    jsonbind_decodeString(&levelSchema, &level, document, NULL);
+    bench_sink = level.enemies[31].hp;
+  }
+}
+
+// -- Naive decoder ------------------------------------------------------------
+
+// tracks nesting depth and compares every key it is handed; the whole
+// document is parsed, including subtrees nothing reads
+typedef struct
+{
+  Level* level;
+  Enemy* enemy;
+  int depth;
+  int inTags;
+} Naive;
+
+static void naiveWillDecodeSublist(json_decoder* d, const char* name, json_value_type type) {
+  Naive* s = d->userdata;
+  s->depth++;
+  if (s->depth == 3 && type == kJSONTable && atoi(name) <= 32) {
+    s->enemy = &s->level->enemies[atoi(name) - 1];
+    s->level->enemyCount = atoi(name);
+  }
+  else if (s->depth == 4 && strcmp(name, "tags") == 0) s->inTags = 1;
+}
+
+static void* naiveDidDecodeSublist(json_decoder* d, const char* name, json_value_type type) {
+  Naive* s = d->userdata;
+  if (s->depth == 4) s->inTags = 0;
+  else if (s->depth == 3) s->enemy = NULL;
+  s->depth--;
+  return NULL;
+}
+
+static void copyString(char* dst, size_t size, json_value v) {
+  snprintf(dst, size, "%s", v.type == kJSONString ? json_stringValue(v) : "");
+}
+
+static void naiveTableValue(json_decoder* d, const char* key, json_value v) {
+  Naive* s = d->userdata;
+  if (s->depth == 3 && s->enemy) {
+    Enemy* e = s->enemy;
+    if (strcmp(key, "name") == 0) copyString(e->name, sizeof(e->name), v);
+    else if (strcmp(key, "hp") == 0) e->hp = json_intValue(v);
+    else if (strcmp(key, "speed") == 0) e->speed = json_floatValue(v);
+    else if (strcmp(key, "x") == 0) e->x = json_floatValue(v);
+    else if (strcmp(key, "y") == 0) e->y = json_floatValue(v);
+  }
+  else if (s->depth == 1) {
+    if (strcmp(key, "title") == 0) copyString(s->level->title, sizeof(s->level->title), v);
+    else if (strcmp(key, "width") == 0) s->level->width = json_intValue(v);
+    else if (strcmp(key, "height") == 0) s->level->height = json_intValue(v);
+  }
+}
+
+static void naiveArrayValue(json_decoder* d, int pos, json_value v) {
+  Naive* s = d->userdata;
+  if (s->inTags && s->enemy && pos >= 1 && pos <= 4) {
+    s->enemy->tags[pos - 1] = json_intValue(v);
+    s->enemy->tagCount = pos;
+  }
+}
+
+static Level naiveLevel;
+
+static void naive(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    Naive state = { &naiveLevel, NULL, 0, 0 };
+    json_decoder d = { 0 };
+    d.willDecodeSublist = naiveWillDecodeSublist;
+    d.didDecodeSublist = naiveDidDecodeSublist;
+    d.didDecodeTableValue = naiveTableValue;
+    d.didDecodeArrayValue = naiveArrayValue;
+    d.userdata = &state;
+    json_value root;
+    host_api()->json->decodeString(&d, document, &root);
+    bench_sink = naiveLevel.enemies[31].hp;
+  }
+}
+
+static int checkLevel(const Level* level) {
+  return level->enemyCount == 32 && level->enemies[31].hp == 41 && level->enemies[5].tagCount == 3 &&
+         level->enemies[5].tags[2] == 5 && level->width == 400 && strcmp(level->enemies[7].name, "enemy7") == 0;
+}
+
+void bench_json(void) {
+  buildDocument();
+
+  // both decoders have to get it right before their timings mean anything
+  static Level level;
+  jsonbind_decodeString(&levelSchema, &level, document, NULL);
+  naive(NULL, 1);
+  if (!checkLevel(&level) || !checkLevel(&naiveLevel)) {
+    fprintf(stderr, "pdbench: json benchmarks decoded the level incorrectly\n");
+    exit(1);
+  }
+
+  uint32_t bytes = (uint32_t)strlen(document);
+  bench_run("json/jsonbind_level", bind, NULL, bytes);
+  bench_run("json/naive_level", naive, NULL, bytes);
+}
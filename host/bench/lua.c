@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include "bench.h"
+#include "flowlua.h"
+#include "flowlua_lua.h"
+#include "luaarray.h"
+#include "luapool.h"
+
+// Lua/C marshalling cost with a mock playdate->lua: arguments come from a
+// small array, pushes only count, and registerClass keeps the method tables
+// so benchmarks call luaarray's and luapool's bindings the way the VM
+// would. The numbers are the C side of each binding; on device every
+// argument fetch and push also pays for the VM's stack handling, which is
+// why the per-element versions lose by more there.
+//
+// flow.step compares pdluagen.py's wrapper from flowlua.h with the same
+// binding written by hand in the style of luaarray's. Both type-check each
+// argument through playdate->lua before reading it, and the generated one
+// also checks the count; setup makes sure it rejects a wrong type.
+
+#define MOCK_ARGS 300
+#define MOCK_CLASSES 8
+#define ELEMENTS 256
+#define AGENTS 256
+#define FLOW_MAP 64
+
+extern PlaydateAPI* playdate;
+
+typedef struct
+{
+  enum LuaType type;
+  int i;
+  float f;
+  const char* bytes;
+  size_t len;
+  void* object;
+  const char* className;
+} MockValue;
+
+static MockValue args[MOCK_ARGS + 1]; // 1-based like the Lua stack
+static int argCount;
+static uint32_t pushed;
+
+static struct
+{
+  const char* name;
+  const lua_reg* reg;
+} classes[MOCK_CLASSES];
+static int classCount;
+
+static int registerClass(const char* name, const lua_reg* reg, const lua_val* vals, int isstatic, const char** outErr) {
+  if (classCount == MOCK_CLASSES) {
+    if (outErr) *outErr = "too many classes";
+    return 0;
+  }
+  classes[classCount].name = name;
+  classes[classCount].reg = reg;
+  classCount++;
+  return 1;
+}
+
+static lua_CFunction method(const char* className, const char* name) {
+  for (int i = 0; i < classCount; i++) {
+    if (strcmp(classes[i].name, className) != 0) continue;
+    for (const lua_reg* r = classes[i].reg; r->name; r++) {
+      if (strcmp(r->name, name) == 0) return r->func;
+    }
+  }
+  fprintf(stderr, "pdbench: no method %s.%s\n", className, name);
+  exit(1);
+}
+
+static int getArgCount(void) {
+  return argCount;
+}
+
+static enum LuaType getArgType(int pos, const char** outClass) {
+  if (outClass) *outClass = args[pos].className;
+  return pos <= argCount ? args[pos].type : kTypeNil;
+}
+
+static int getArgInt(int pos) {
+  return args[pos].type == kTypeFloat ? (int)args[pos].f : args[pos].i;
+}
+
+static float getArgFloat(int pos) {
+  return args[pos].type == kTypeFloat ? args[pos].f : (float)args[pos].i;
+}
+
+static const char* getArgString(int pos) {
+  return args[pos].bytes;
+}
+
+static const char* getArgBytes(int pos, size_t* outlen) {
+  if (outlen) *outlen = args[pos].len;
+  return args[pos].bytes;
+}
+
+// checks the class name the way the VM compares metatables
+static void* getArgObject(int pos, char* type, LuaUDObject** outud) {
+  MockValue* v = &args[pos];
+  if (v->type != kTypeObject || strcmp(v->className, type) != 0) return NULL;
+  return v->object;
+}
+
+// order matters, so pushes can be compared between bindings
+static void pushInt(int val) {
+  pushed = pushed * 31 + val;
+}
+
+static void pushFloat(float val) {
+  pushed += (uint32_t)val;
+}
+
+static void pushBytes(const char* str, size_t len) {
+  pushed += (uint32_t)len;
+}
+
+static void pushString(const char* str) {
+  pushed++;
+}
+
+static LuaUDObject* pushObject(void* obj, char* type, int nValues) {
+  pushed++;
+  args[0].object = obj; // position 0 is scratch for the most recent object
+  return (LuaUDObject*)&args[0];
+}
+
+static LuaUDObject* retainObject(LuaUDObject* obj) {
+  return obj;
+}
+
+static void releaseObject(LuaUDObject* obj) {}
+
+// a benchmark that reaches one would measure nothing, so stop
+static int unimplemented(void) {
+  host_system.error("pdbench: mock playdate->lua function not implemented");
+  return 0;
+}
+
+static struct playdate_lua mockLua;
+
+static void setObject(int pos, void* object, const char* className) {
+  args[pos] = (MockValue){ .type = kTypeObject, .object = object, .className = className };
+}
+
+static void setInt(int pos, int i) {
+  args[pos] = (MockValue){ .type = kTypeInt, .i = i };
+}
+
+// -- luaarray -----------------------------------------------------------------
+
+static LuaArray* array;
+static int16_t values[ELEMENTS];
+
+// a:set(i, v) once per element
+static void setEach(void* ctx, uint32_t n) {
+  lua_CFunction set = method(LUAARRAY_CLASS, "set");
+  for (uint32_t i = 0; i < n; i++) {
+    argCount = 3;
+    setObject(1, array, LUAARRAY_CLASS);
+    for (int k = 0; k < ELEMENTS; k++) {
+      setInt(2, k + 1);
+      setInt(3, values[k]);
+      set(NULL);
+    }
+    bench_sink = ((int16_t*)array->data)[ELEMENTS - 1];
+  }
+}
+
+// a:setMany(1, v1, ..., v256)
+static void setMany(void* ctx, uint32_t n) {
+  lua_CFunction fn = method(LUAARRAY_CLASS, "setMany");
+  for (uint32_t i = 0; i < n; i++) {
+    argCount = 2 + ELEMENTS;
+    setObject(1, array, LUAARRAY_CLASS);
+    setInt(2, 1);
+    for (int k = 0; k < ELEMENTS; k++) setInt(3 + k, values[k]);
+    fn(NULL);
+    bench_sink = ((int16_t*)array->data)[ELEMENTS - 1];
+  }
+}
+
+// a:setBytes(s) with a string packed on the Lua side
+static void setBytes(void* ctx, uint32_t n) {
+  lua_CFunction fn = method(LUAARRAY_CLASS, "setBytes");
+  for (uint32_t i = 0; i < n; i++) {
+    argCount = 2;
+    setObject(1, array, LUAARRAY_CLASS);
+    args[2] = (MockValue){ .type = kTypeString, .bytes = (const char*)values, .len = sizeof(values) };
+    fn(NULL);
+    bench_sink = ((int16_t*)array->data)[ELEMENTS - 1];
+  }
+}
+
+static void getEach(void* ctx, uint32_t n) {
+  lua_CFunction get = method(LUAARRAY_CLASS, "get");
+  for (uint32_t i = 0; i < n; i++) {
+    argCount = 2;
+    setObject(1, array, LUAARRAY_CLASS);
+    for (int k = 0; k < ELEMENTS; k++) {
+      setInt(2, k + 1);
+      get(NULL);
+    }
+    bench_sink = pushed;
+  }
+}
+
+static void getMany(void* ctx, uint32_t n) {
+  lua_CFunction fn = method(LUAARRAY_CLASS, "getMany");
+  for (uint32_t i = 0; i < n; i++) {
+    argCount = 3;
+    setObject(1, array, LUAARRAY_CLASS);
+    setInt(2, 1);
+    setInt(3, ELEMENTS);
+    fn(NULL);
+    bench_sink = pushed;
+  }
+}
+
+// -- luapool ------------------------------------------------------------------
+
+typedef struct
+{
+  float x, y;
+} Vec;
+
+static LuaPool* vecPool;
+
+static int vec_gc(lua_State* L) {
+  return luapool_gc(vecPool);
+}
+
+static const lua_reg vecClass[] = {
+  { "__gc", vec_gc },
+  { NULL, NULL }
+};
+
+static int fresh_gc(lua_State* L) {
+  host_api()->system->realloc(getArgObject(1, "benchvec", NULL), 0);
+  return 0;
+}
+
+static const lua_reg freshClass[] = {
+  { "__gc", fresh_gc },
+  { NULL, NULL }
+};
+
+// a vector returned to Lua and collected, from the pool
+static void poolPush(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    Vec* v = luapool_push(vecPool);
+    v->x = (float)i;
+    argCount = 1;
+    setObject(1, v, "vec");
+    vec_gc(NULL);
+  }
+  luapool_frame();
+}
+
+// the same with a fresh allocation per object
+static void mallocPush(void* ctx, uint32_t n) {
+  void* (*pdrealloc)(void*, size_t) = host_api()->system->realloc;
+  for (uint32_t i = 0; i < n; i++) {
+    Vec* v = pdrealloc(NULL, sizeof(Vec));
+    memset(v, 0, sizeof(Vec));
+    v->x = (float)i;
+    mockLua.pushObject(v, "benchvec", 0);
+    argCount = 1;
+    setObject(1, v, "benchvec");
+    fresh_gc(NULL);
+  }
+}
+
+// -- Generated bindings -------------------------------------------------------
+
+static int agentX[AGENTS], agentY[AGENTS];
+static int stepField;
+
+static int handStep(lua_State* L) {
+  for (int pos = 1; pos <= 3; pos++) {
+    if (playdate->lua->getArgType(pos, NULL) != kTypeInt) {
+      playdate->system->error("flow.step: argument %d is not an integer", pos);
+      return 0;
+    }
+  }
+  int dx, dy;
+  flowlua_step(playdate->lua->getArgInt(1), playdate->lua->getArgInt(2), playdate->lua->getArgInt(3), &dx, &dy);
+  playdate->lua->pushInt(dx);
+  playdate->lua->pushInt(dy);
+  return 2;
+}
+
+static int typeErrors;
+
+static void countError(const char* fmt, ...) {
+  typeErrors++;
+}
+
+// local dx, dy = flow.step(f, x, y) for every agent
+static void stepAgents(lua_CFunction step) {
+  argCount = 3;
+  setInt(1, stepField);
+  for (int k = 0; k < AGENTS; k++) {
+    setInt(2, agentX[k]);
+    setInt(3, agentY[k]);
+    step(NULL);
+  }
+}
+
+static void handSteps(void* ctx, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) stepAgents(handStep);
+  bench_sink = pushed;
+}
+
+static void genSteps(void* ctx, uint32_t n) {
+  lua_CFunction step = method("flow", "step");
+  for (uint32_t i = 0; i < n; i++) stepAgents(step);
+  bench_sink = pushed;
+}
+
+// a walled map with one goal, built through the generated bindings; 0 if
+// both versions of flow.step give the same steps and the generated one
+// raises an error for a string where an int belongs
+static int setupFlow(void) {
+  argCount = 2;
+  setInt(1, FLOW_MAP);
+  setInt(2, FLOW_MAP);
+  method("flow", "setMap")(NULL);
+  argCount = 0;
+  method("flow", "newField")(NULL);
+  stepField = 1;
+  if (flowlua_field(stepField) == NULL) return -1;
+
+  argCount = 3;
+  for (int y = 8; y < FLOW_MAP - 8; y += 8) {
+    for (int x = 0; x < FLOW_MAP - 6; x++) {
+      setInt(1, (y & 8) ? x + 6 : x);
+      setInt(2, y);
+      setInt(3, FLOW_BLOCKED);
+      method("flow", "setCost")(NULL);
+    }
+  }
+  setInt(1, stepField);
+  setInt(2, FLOW_MAP / 2);
+  setInt(3, FLOW_MAP - 1);
+  method("flow", "setGoal")(NULL);
+  argCount = 1;
+  setInt(1, 1000000);
+  method("flow", "update")(NULL);
+  if (!flow_ready(flowlua_field(stepField))) return -1;
+
+  for (int k = 0; k < AGENTS; k++) {
+    agentX[k] = bench_random() % FLOW_MAP;
+    agentY[k] = bench_random() % FLOW_MAP;
+  }
+  pushed = 0;
+  stepAgents(handStep);
+  uint32_t hand = pushed;
+  pushed = 0;
+  stepAgents(method("flow", "step"));
+  if (pushed != hand) return -1;
+
+  void (*error)(const char* fmt, ...) = host_system.error;
+  host_system.error = countError;
+  typeErrors = 0;
+  pushed = 0;
+  args[2] = (MockValue){ .type = kTypeString, .bytes = "3", .len = 1 };
+  method("flow", "step")(NULL);
+  host_system.error = error;
+  return typeErrors == 1 && pushed == 0 ? 0 : -1;
+}
+
+void bench_lua(void) {
+  host_fillStubs(&mockLua, sizeof(mockLua), unimplemented);
+  mockLua.registerClass = registerClass;
+  mockLua.getArgCount = getArgCount;
+  mockLua.getArgType = getArgType;
+  mockLua.getArgInt = getArgInt;
+  mockLua.getArgFloat = getArgFloat;
+  mockLua.getArgString = getArgString;
+  mockLua.getArgBytes = getArgBytes;
+  mockLua.getArgObject = getArgObject;
+  mockLua.pushInt = pushInt;
+  mockLua.pushFloat = pushFloat;
+  mockLua.pushBytes = pushBytes;
+  mockLua.pushString = pushString;
+  mockLua.pushObject = pushObject;
+  mockLua.retainObject = retainObject;
+  mockLua.releaseObject = releaseObject;
+
+  PlaydateAPI* pd = host_api();
+  const struct playdate_lua* saved = pd->lua;
+  pd->lua = &mockLua;
+
+  const char* err = NULL;
+  classCount = 0;
+  luaarray_register(&err);
+  luagen_register_flowlua(&err);
+  registerClass("benchvec", freshClass, NULL, 0, &err);
+  if (vecPool == NULL) vecPool = luapool_new("vec", sizeof(Vec), vecClass, 64, &err);
+  array = luaarray_new(kLuaArrayInt16, ELEMENTS);
+  if (vecPool == NULL || array == NULL) {
+    fprintf(stderr, "pdbench: lua setup failed: %s\n", err ? err : "out of memory");
+    exit(1);
+  }
+  for (int k = 0; k < ELEMENTS; k++) values[k] = (int16_t)bench_random();
+  if (setupFlow() < 0) {
+    fprintf(stderr, "pdbench: generated flow.step disagrees with the hand-written one or skips its type checks\n");
+    exit(1);
+  }
+
+  bench_run("lua/array_set_each_256", setEach, NULL, sizeof(values));
+  bench_run("lua/array_setmany_256", setMany, NULL, sizeof(values));
+  bench_run("lua/array_setbytes_256", setBytes, NULL, sizeof(values));
+  bench_run("lua/array_get_each_256", getEach, NULL, sizeof(values));
+  bench_run("lua/array_getmany_256", getMany, NULL, sizeof(values));
+  bench_run("lua/pool_push_gc", poolPush, NULL, 0);
+  bench_run("lua/malloc_push_gc", mallocPush, NULL, 0);
+  bench_run("lua/hand_flow_step_256", handSteps, NULL, 0);
+  bench_run("lua/gen_flow_step_256", genSteps, NULL, 0);
+
+  luaarray_free(array);
+  flowlua_setMap(0, 0);
+  pd->lua = saved;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <zlib.h>
+#include "bench.h"
+#include "vid.h"
+
+// PDVD decoding into the frame buffer, one frame per op, on the sample clips
+// build.sh writes into the data directory, next to the same clips in the
+// built-in .pdv format. playdate->graphics->video only exists on the device,
+// so its reference here is what that path does with a frame: inflate it
+// (zlib standing in for the device's own inflate), XOR a P-frame into the
+// context bitmap, copy the context into the frame buffer and mark every row.
+// Before timing, both are decoded side by side and must agree on every frame.
+
+#define PDV_HEADER_SIZE 28
+#define PDV_MAX_SIZE (256 * 1024)
+
+static const char* clips[] = { "sprite", "scroll", "wipe" };
+
+typedef struct
+{
+  uint8_t data[PDV_MAX_SIZE];
+  int frames;
+  int width, height;
+  int rowBytes;
+  int current;
+  uint8_t frame[LCD_ROWS * LCD_ROWSIZE];   // inflated
+  uint8_t context[LCD_ROWS * LCD_ROWSIZE];
+} PdvClip;
+
+static uint32_t readU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int pdvOpen(PdvClip* c, const char* path) {
+  const struct playdate_file* fs = host_api()->file;
+  SDFile* file = fs->open(path, kFileRead | kFileReadData);
+  if (file == NULL) return -1;
+  int size = fs->read(file, c->data, PDV_MAX_SIZE);
+  fs->close(file);
+  if (size < PDV_HEADER_SIZE || size == PDV_MAX_SIZE || memcmp(c->data, "Playdate VID", 12) != 0) return -1;
+  c->frames = c->data[16] | (c->data[17] << 8);
+  c->width = c->data[24] | (c->data[25] << 8);
+  c->height = c->data[26] | (c->data[27] << 8);
+  c->rowBytes = (c->width + 7) >> 3;
+  c->current = 0;
+  if (c->width > LCD_COLUMNS || c->height > LCD_ROWS) return -1;
+  if (PDV_HEADER_SIZE + 4 * (c->frames + 1) + (readU32(c->data + PDV_HEADER_SIZE + 4 * c->frames) >> 2) > (uint32_t)size) return -1;
+  return 0;
+}
+
+// the next frame into the context bitmap, wrapping at the end
+static void pdvDecode(PdvClip* c) {
+  if (c->current == c->frames) c->current = 0;
+  const uint8_t* table = c->data + PDV_HEADER_SIZE + 4 * c->current;
+  const uint8_t* chunks = c->data + PDV_HEADER_SIZE + 4 * (c->frames + 1);
+  uint32_t entry = readU32(table);
+  uint32_t start = entry >> 2;
+  uLongf len = c->rowBytes * c->height;
+  if (uncompress(c->frame, &len, chunks + start, (readU32(table + 4) >> 2) - start) != Z_OK ||
+      len != (uLongf)c->rowBytes * c->height) {
+    fprintf(stderr, "pdbench: pdv frame %d does not inflate\n", c->current);
+    exit(1);
+  }
+  if ((entry & 3) == 1) memcpy(c->context, c->frame, len);
+  else {
+    for (uLongf i = 0; i < len; i++) c->context[i] ^= c->frame[i];
+  }
+  c->current++;
+}
+
+static void pdv(void* ctx, uint32_t n) {
+  PdvClip* c = ctx;
+  const struct playdate_graphics* gfx = host_api()->graphics;
+  for (uint32_t i = 0; i < n; i++) {
+    pdvDecode(c);
+    uint8_t* frame = gfx->getFrame();
+    for (int y = 0; y < c->height; y++) memcpy(frame + y * LCD_ROWSIZE, c->context + y * c->rowBytes, c->rowBytes);
+    gfx->markUpdatedRows(0, c->height - 1);
+  }
+  bench_sink = c->context[0];
+}
+
+static void decode(void* ctx, uint32_t n) {
+  VidPlayer* v = ctx;
+  for (uint32_t i = 0; i < n; i++) {
+    if (vid_done(v)) vid_rewind(v);
+    if (vid_decodeFrame(v) < 0) {
+      fprintf(stderr, "pdbench: video decode failed\n");
+      exit(1);
+    }
+  }
+  bench_sink = v->stats.rowsChanged;
+}
+
+// every frame of both files, PDVD into a buffer of its own
+static void sameFrames(VidPlayer* v, PdvClip* c, const char* clip) {
+  static uint8_t target[LCD_ROWS * LCD_ROWSIZE];
+  if (v->width != c->width || v->height != c->height || (int)v->frameCount != c->frames) {
+    fprintf(stderr, "pdbench: bench_%s.pdvd and .pdv are not the same clip\n", clip);
+    exit(1);
+  }
+  vid_setTarget(v, target, v->rowBytes);
+  for (int i = 0; i < c->frames; i++) {
+    pdvDecode(c);
+    if (vid_decodeFrame(v) != 1 || memcmp(target, c->context, c->rowBytes * c->height) != 0) {
+      fprintf(stderr, "pdbench: bench_%s.pdvd differs from .pdv at frame %d\n", clip, i);
+      exit(1);
+    }
+  }
+  vid_setTarget(v, NULL, 0);
+  vid_setPosition(v, (LCD_COLUMNS - v->width) / 2, (LCD_ROWS - v->height) / 2);
+  vid_rewind(v);
+  c->current = 0;
+}
+
+void bench_video(void) {
+  static PdvClip clip;
+  char name[64], path[64];
+  for (int i = 0; i < (int)(sizeof(clips) / sizeof(clips[0])); i++) {
+    snprintf(path, sizeof(path), "bench_%s.pdvd", clips[i]);
+    VidPlayer* v = vid_open(path);
+    snprintf(path, sizeof(path), "bench_%s.pdv", clips[i]);
+    if (v == NULL || pdvOpen(&clip, path) < 0) {
+      fprintf(stderr, "pdbench: no bench_%s.pdvd or .pdv, run pdbench through build.sh bench\n", clips[i]);
+      vid_close(v);
+      continue;
+    }
+    sameFrames(v, &clip, clips[i]);
+
+    snprintf(name, sizeof(name), "video/pdv_%s", clips[i]);
+    bench_run(name, pdv, &clip, 0);
+    snprintf(name, sizeof(name), "video/decode_%s", clips[i]);
+    bench_run(name, decode, v, 0);
+    vid_close(v);
+  }
+}
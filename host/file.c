@@ -0,0 +1,192 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "host.h"
+
+// Files live in two directories like on the device: the read-only pdx
+// contents and the game's writable data directory. kFileRead looks in the
+// pdx, kFileReadData in the data directory, both together try data first.
+// Paths are sandboxed: absolute paths and ".." components are refused.
+
+static const char* dataDir;
+static const char* pdxDir;
+static const char* lastError;
+
+static int resolve(char* out, size_t size, const char* root, const char* path) {
+  size_t len = strlen(path);
+  int parent = strcmp(path, "..") == 0 || strncmp(path, "../", 3) == 0 || strstr(path, "/../") != NULL
+    || (len >= 3 && strcmp(path + len - 3, "/..") == 0);
+  if (path[0] == '/' || parent) {
+    lastError = "path outside the sandbox";
+    return -1;
+  }
+  snprintf(out, size, "%s/%s", root, path);
+  return 0;
+}
+
+static int fail(void) {
+  lastError = strerror(errno);
+  return -1;
+}
+
+static const char* geterr(void) {
+  const char* err = lastError;
+  lastError = NULL;
+  return err;
+}
+
+static SDFile* fileOpen(const char* name, FileOptions mode) {
+  char path[1024];
+  FILE* f = NULL;
+  lastError = NULL;
+
+  if (mode & (kFileWrite | kFileAppend)) {
+    if (resolve(path, sizeof(path), dataDir, name) < 0) return NULL;
+    f = fopen(path, (mode & kFileAppend) == kFileAppend ? "ab" : "wb");
+  }
+  else {
+    if ((mode & kFileReadData) && resolve(path, sizeof(path), dataDir, name) == 0) f = fopen(path, "rb");
+    if (f == NULL && (mode & kFileRead) && resolve(path, sizeof(path), pdxDir, name) == 0) f = fopen(path, "rb");
+  }
+  if (f == NULL && lastError == NULL) fail();
+  return f;
+}
+
+static int fileClose(SDFile* file) {
+  return fclose(file) == 0 ? 0 : fail();
+}
+
+static int fileRead(SDFile* file, void* buf, unsigned int len) {
+  size_t n = fread(buf, 1, len, file);
+  if (n < len && ferror(file)) return fail();
+  return (int)n;
+}
+
+static int fileWrite(SDFile* file, const void* buf, unsigned int len) {
+  size_t n = fwrite(buf, 1, len, file);
+  return n < len ? fail() : (int)n;
+}
+
+static int fileFlush(SDFile* file) {
+  return fflush(file) == 0 ? 0 : fail();
+}
+
+static int fileTell(SDFile* file) {
+  long pos = ftell(file);
+  return pos < 0 ? fail() : (int)pos;
+}
+
+static int fileSeek(SDFile* file, int pos, int whence) {
+  return fseek(file, pos, whence) == 0 ? 0 : fail();
+}
+
+static int statPath(const char* path, FileStat* st) {
+  struct stat s;
+  if (stat(path, &s) != 0) return -1;
+  struct tm tm;
+  localtime_r(&s.st_mtime, &tm);
+  st->isdir = S_ISDIR(s.st_mode);
+  st->size = (unsigned int)s.st_size;
+  st->m_year = tm.tm_year + 1900;
+  st->m_month = tm.tm_mon + 1;
+  st->m_day = tm.tm_mday;
+  st->m_hour = tm.tm_hour;
+  st->m_minute = tm.tm_min;
+  st->m_second = tm.tm_sec;
+  return 0;
+}
+
+static int fileStat(const char* name, FileStat* st) {
+  char path[1024];
+  if (resolve(path, sizeof(path), dataDir, name) == 0 && statPath(path, st) == 0) return 0;
+  if (resolve(path, sizeof(path), pdxDir, name) == 0 && statPath(path, st) == 0) return 0;
+  return fail();
+}
+
+static int makeDir(const char* name) {
+  char path[1024];
+  if (resolve(path, sizeof(path), dataDir, name) < 0) return -1;
+  return mkdir(path, 0755) == 0 || errno == EEXIST ? 0 : fail();
+}
+
+static int removePath(const char* path, int recursive) {
+  struct stat s;
+  if (recursive && stat(path, &s) == 0 && S_ISDIR(s.st_mode)) {
+    DIR* dir = opendir(path);
+    struct dirent* e;
+    while (dir && (e = readdir(dir)) != NULL) {
+      if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+      char child[1536];
+      snprintf(child, sizeof(child), "%s/%s", path, e->d_name);
+      removePath(child, 1);
+    }
+    if (dir) closedir(dir);
+  }
+  return remove(path) == 0 ? 0 : -1;
+}
+
+static int unlinkFile(const char* name, int recursive) {
+  char path[1024];
+  if (resolve(path, sizeof(path), dataDir, name) < 0) return -1;
+  return removePath(path, recursive) == 0 ? 0 : fail();
+}
+
+static int renameFile(const char* from, const char* to) {
+  char src[1024], dst[1024];
+  if (resolve(src, sizeof(src), dataDir, from) < 0 || resolve(dst, sizeof(dst), dataDir, to) < 0) return -1;
+  return rename(src, dst) == 0 ? 0 : fail();
+}
+
+static int listDir(const char* root, const char* name, void (*callback)(const char*, void*), void* userdata, int showhidden) {
+  char path[1024];
+  if (resolve(path, sizeof(path), root, name) < 0) return -1;
+  DIR* dir = opendir(path);
+  if (dir == NULL) return -1;
+
+  struct dirent* e;
+  while ((e = readdir(dir)) != NULL) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+    if (!showhidden && e->d_name[0] == '.') continue;
+
+    // directories are reported with a trailing slash
+    char child[1536], entry[512];
+    struct stat s;
+    snprintf(child, sizeof(child), "%s/%s", path, e->d_name);
+    int isdir = stat(child, &s) == 0 && S_ISDIR(s.st_mode);
+    snprintf(entry, sizeof(entry), "%s%s", e->d_name, isdir ? "/" : "");
+    callback(entry, userdata);
+  }
+  closedir(dir);
+  return 0;
+}
+
+static int listfiles(const char* name, void (*callback)(const char* path, void* userdata), void* userdata, int showhidden) {
+  int data = listDir(dataDir, name, callback, userdata, showhidden);
+  int pdx = listDir(pdxDir, name, callback, userdata, showhidden);
+  return data == 0 || pdx == 0 ? 0 : fail();
+}
+
+struct playdate_file host_file = {
+  .geterr = geterr,
+  .listfiles = listfiles,
+  .stat = fileStat,
+  .mkdir = makeDir,
+  .unlink = unlinkFile,
+  .rename = renameFile,
+  .open = fileOpen,
+  .close = fileClose,
+  .read = fileRead,
+  .write = fileWrite,
+  .flush = fileFlush,
+  .tell = fileTell,
+  .seek = fileSeek,
+};
+
+void host_initFile(const HostConfig* config) {
+  dataDir = config->dataDir;
+  pdxDir = config->pdxDir;
+  mkdir(dataDir, 0755);
+}
@@ -0,0 +1,406 @@
+#include <stdio.h>
+#include "host.h"
+
+// 1 bit per pixel, MSB first, set bits are white, like the device
+struct LCDBitmap
+{
+  int width, height, rowbytes;
+  uint8_t* data;
+  uint8_t* mask; // same layout as data, set bits are opaque
+  LCDBitmap* maskBitmap;
+  int owned;
+};
+
+static uint8_t frame[LCD_ROWSIZE * LCD_ROWS];
+static uint8_t displayFrame[LCD_ROWSIZE * LCD_ROWS];
+static LCDBitmap screen = { LCD_COLUMNS, LCD_ROWS, LCD_ROWSIZE, frame, NULL, NULL, 0 };
+static LCDBitmap displayScreen = { LCD_COLUMNS, LCD_ROWS, LCD_ROWSIZE, displayFrame, NULL, NULL, 0 };
+
+#define CONTEXT_DEPTH 8
+
+typedef struct
+{
+  LCDBitmap* target;
+  LCDBitmapDrawMode mode;
+  int dx, dy;
+  int clipX0, clipY0, clipX1, clipY1; // target coordinates, exclusive end
+} Context;
+
+static Context stack[CONTEXT_DEPTH];
+static int depth;
+static Context* ctx = &stack[0];
+static LCDSolidColor background = kColorWhite;
+
+// -- Pixels -------------------------------------------------------------------
+
+static inline int getBit(const uint8_t* row, int x) {
+  return (row[x >> 3] >> (7 - (x & 7))) & 1;
+}
+
+static inline void putBit(uint8_t* row, int x, int white) {
+  uint8_t bit = 0x80 >> (x & 7);
+  if (white) row[x >> 3] |= bit;
+  else row[x >> 3] &= ~bit;
+}
+
+// x, y in target coordinates, already clipped
+static inline void plot(LCDBitmap* target, int x, int y, LCDColor color) {
+  uint8_t* row = target->data + y * target->rowbytes;
+  switch (color) {
+    case kColorBlack: putBit(row, x, 0); break;
+    case kColorWhite: putBit(row, x, 1); break;
+    case kColorClear: return;
+    case kColorXOR: row[x >> 3] ^= 0x80 >> (x & 7); break;
+    default: {
+      const uint8_t* pattern = (const uint8_t*)color;
+      if (!((pattern[8 + (y & 7)] >> (7 - (x & 7))) & 1)) return;
+      putBit(row, x, (pattern[y & 7] >> (7 - (x & 7))) & 1);
+      return;
+    }
+  }
+  if (target->mask) putBit(target->mask + y * target->rowbytes, x, 1);
+}
+
+static inline int clipped(int x, int y) {
+  return x < ctx->clipX0 || y < ctx->clipY0 || x >= ctx->clipX1 || y >= ctx->clipY1;
+}
+
+static void setPixel(int x, int y, LCDColor color) {
+  x += ctx->dx;
+  y += ctx->dy;
+  if (!clipped(x, y)) plot(ctx->target, x, y, color);
+}
+
+static void fillRect(int x, int y, int width, int height, LCDColor color) {
+  int x0 = x + ctx->dx, y0 = y + ctx->dy;
+  int x1 = x0 + width, y1 = y0 + height;
+  if (x0 < ctx->clipX0) x0 = ctx->clipX0;
+  if (y0 < ctx->clipY0) y0 = ctx->clipY0;
+  if (x1 > ctx->clipX1) x1 = ctx->clipX1;
+  if (y1 > ctx->clipY1) y1 = ctx->clipY1;
+  if (x0 >= x1 || y0 >= y1) return;
+
+  LCDBitmap* target = ctx->target;
+  if ((color == kColorBlack || color == kColorWhite) && target->mask == NULL) {
+    // whole bytes with memset, partial bytes at either end with masks
+    uint8_t fill = color == kColorWhite ? 0xff : 0x00;
+    int first = x0 >> 3, last = (x1 - 1) >> 3;
+    uint8_t head = 0xff >> (x0 & 7), tail = 0xff << (7 - ((x1 - 1) & 7));
+    for (int row = y0; row < y1; row++) {
+      uint8_t* p = target->data + row * target->rowbytes;
+      if (first == last) {
+        uint8_t m = head & tail;
+        p[first] = (p[first] & ~m) | (fill & m);
+        continue;
+      }
+      p[first] = (p[first] & ~head) | (fill & head);
+      memset(p + first + 1, fill, last - first - 1);
+      p[last] = (p[last] & ~tail) | (fill & tail);
+    }
+    return;
+  }
+
+  for (int row = y0; row < y1; row++) {
+    for (int col = x0; col < x1; col++) plot(target, col, row, color);
+  }
+}
+
+static void clear(LCDColor color) {
+  Context saved = *ctx;
+  ctx->dx = ctx->dy = 0;
+  ctx->clipX0 = ctx->clipY0 = 0;
+  ctx->clipX1 = ctx->target->width;
+  ctx->clipY1 = ctx->target->height;
+  fillRect(0, 0, ctx->target->width, ctx->target->height, color);
+  *ctx = saved;
+}
+
+static void drawRect(int x, int y, int width, int height, LCDColor color) {
+  if (width <= 0 || height <= 0) return;
+  fillRect(x, y, width, 1, color);
+  if (height > 1) fillRect(x, y + height - 1, width, 1, color);
+  if (height > 2) {
+    fillRect(x, y + 1, 1, height - 2, color);
+    if (width > 1) fillRect(x + width - 1, y + 1, 1, height - 2, color);
+  }
+}
+
+static void drawLine(int x1, int y1, int x2, int y2, int width, LCDColor color) {
+  int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+  int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+  int err = dx + dy;
+  int half = width > 1 ? width / 2 : 0;
+
+  for (;;) {
+    if (half) fillRect(x1 - half, y1 - half, width, width, color);
+    else setPixel(x1, y1, color);
+    if (x1 == x2 && y1 == y2) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x1 += sx; }
+    if (e2 <= dx) { err += dx; y1 += sy; }
+  }
+}
+
+// -- Context ------------------------------------------------------------------
+
+static void resetContext(Context* c, LCDBitmap* target) {
+  c->target = target;
+  c->mode = kDrawModeCopy;
+  c->dx = c->dy = 0;
+  c->clipX0 = c->clipY0 = 0;
+  c->clipX1 = target->width;
+  c->clipY1 = target->height;
+}
+
+static void pushContext(LCDBitmap* target) {
+  if (depth + 1 >= CONTEXT_DEPTH) {
+    host_system.error("host: pushContext nested too deep");
+    return;
+  }
+  Context* next = &stack[++depth];
+  *next = *ctx;
+  if (target) resetContext(next, target);
+  ctx = next;
+}
+
+static void popContext(void) {
+  if (depth > 0) ctx = &stack[--depth];
+}
+
+static LCDBitmapDrawMode setDrawMode(LCDBitmapDrawMode mode) {
+  LCDBitmapDrawMode previous = ctx->mode;
+  ctx->mode = mode;
+  return previous;
+}
+
+static void setDrawOffset(int dx, int dy) {
+  ctx->dx = dx;
+  ctx->dy = dy;
+}
+
+static void setScreenClipRect(int x, int y, int width, int height) {
+  ctx->clipX0 = x > 0 ? x : 0;
+  ctx->clipY0 = y > 0 ? y : 0;
+  ctx->clipX1 = x + width < ctx->target->width ? x + width : ctx->target->width;
+  ctx->clipY1 = y + height < ctx->target->height ? y + height : ctx->target->height;
+}
+
+static void setClipRect(int x, int y, int width, int height) {
+  setScreenClipRect(x + ctx->dx, y + ctx->dy, width, height);
+}
+
+static void clearClipRect(void) {
+  setScreenClipRect(0, 0, ctx->target->width, ctx->target->height);
+}
+
+static void setBackgroundColor(LCDSolidColor color) {
+  background = color;
+}
+
+// -- Bitmaps ------------------------------------------------------------------
+
+static LCDBitmap* newBitmap(int width, int height, LCDColor bgcolor) {
+  LCDBitmap* b = calloc(1, sizeof(LCDBitmap));
+  b->width = width;
+  b->height = height;
+  b->rowbytes = (width + 31) / 32 * 4; // rows are word aligned on device
+  b->data = calloc(b->rowbytes, height);
+  b->owned = 1;
+  if (bgcolor == kColorClear) {
+    b->mask = calloc(b->rowbytes, height);
+  }
+  else if (bgcolor != kColorBlack) {
+    pushContext(b);
+    clear(bgcolor);
+    popContext();
+  }
+  return b;
+}
+
+static void freeBitmap(LCDBitmap* b) {
+  if (b == NULL || !b->owned) return;
+  free(b->data);
+  free(b->mask);
+  free(b->maskBitmap);
+  free(b);
+}
+
+static LCDBitmap* copyBitmap(LCDBitmap* src) {
+  LCDBitmap* b = newBitmap(src->width, src->height, kColorBlack);
+  memcpy(b->data, src->data, src->rowbytes * src->height);
+  if (src->mask) {
+    b->mask = malloc(src->rowbytes * src->height);
+    memcpy(b->mask, src->mask, src->rowbytes * src->height);
+  }
+  return b;
+}
+
+static void getBitmapData(LCDBitmap* b, int* width, int* height, int* rowbytes, uint8_t** mask, uint8_t** data) {
+  if (width) *width = b->width;
+  if (height) *height = b->height;
+  if (rowbytes) *rowbytes = b->rowbytes;
+  if (mask) *mask = b->mask;
+  if (data) *data = b->data;
+}
+
+static void clearBitmap(LCDBitmap* b, LCDColor bgcolor) {
+  pushContext(b);
+  clear(bgcolor == kColorClear ? kColorBlack : bgcolor);
+  popContext();
+  if (b->mask) memset(b->mask, bgcolor == kColorClear ? 0x00 : 0xff, b->rowbytes * b->height);
+}
+
+static LCDSolidColor getBitmapPixel(LCDBitmap* b, int x, int y) {
+  if (x < 0 || y < 0 || x >= b->width || y >= b->height) return kColorClear;
+  if (b->mask && !getBit(b->mask + y * b->rowbytes, x)) return kColorClear;
+  return getBit(b->data + y * b->rowbytes, x) ? kColorWhite : kColorBlack;
+}
+
+static int setBitmapMask(LCDBitmap* b, LCDBitmap* mask) {
+  if (mask->width != b->width || mask->height != b->height) return 0;
+  if (b->mask == NULL) b->mask = malloc(b->rowbytes * b->height);
+  for (int y = 0; y < b->height; y++) memcpy(b->mask + y * b->rowbytes, mask->data + y * mask->rowbytes, b->rowbytes);
+  return 1;
+}
+
+// the returned bitmap shares the mask bits with its owner
+static LCDBitmap* getBitmapMask(LCDBitmap* b) {
+  if (b->mask == NULL) return NULL;
+  if (b->maskBitmap == NULL) b->maskBitmap = calloc(1, sizeof(LCDBitmap));
+  *b->maskBitmap = (LCDBitmap){ b->width, b->height, b->rowbytes, b->mask, NULL, NULL, 0 };
+  return b->maskBitmap;
+}
+
+static void drawBitmap(LCDBitmap* b, int x, int y, LCDBitmapFlip flip) {
+  LCDBitmap* target = ctx->target;
+  x += ctx->dx;
+  y += ctx->dy;
+
+  for (int row = 0; row < b->height; row++) {
+    int ty = y + row;
+    if (ty < ctx->clipY0 || ty >= ctx->clipY1) continue;
+    int sy = (flip == kBitmapFlippedY || flip == kBitmapFlippedXY) ? b->height - 1 - row : row;
+    const uint8_t* src = b->data + sy * b->rowbytes;
+    const uint8_t* mask = b->mask ? b->mask + sy * b->rowbytes : NULL;
+
+    for (int col = 0; col < b->width; col++) {
+      int tx = x + col;
+      if (tx < ctx->clipX0 || tx >= ctx->clipX1) continue;
+      int sx = (flip == kBitmapFlippedX || flip == kBitmapFlippedXY) ? b->width - 1 - col : col;
+      if (mask && !getBit(mask, sx)) continue;
+
+      int white = getBit(src, sx);
+      LCDColor color;
+      switch (ctx->mode) {
+        case kDrawModeWhiteTransparent: if (white) continue; color = kColorBlack; break;
+        case kDrawModeBlackTransparent: if (!white) continue; color = kColorWhite; break;
+        case kDrawModeFillWhite: color = kColorWhite; break;
+        case kDrawModeFillBlack: color = kColorBlack; break;
+        case kDrawModeXOR: if (!white) continue; color = kColorXOR; break;
+        case kDrawModeNXOR: if (white) continue; color = kColorXOR; break;
+        case kDrawModeInverted: color = white ? kColorBlack : kColorWhite; break;
+        default: color = white ? kColorWhite : kColorBlack; break;
+      }
+      plot(target, tx, ty, color);
+    }
+  }
+}
+
+static LCDBitmap* notOnHost(const char* path, const char** outerr) {
+  // compiled .pdi/.pdt/.pft assets need the pdc toolchain's decoders
+  if (outerr) *outerr = "not supported by the host runtime";
+  return NULL;
+}
+
+static LCDBitmap* loadBitmap(const char* path, const char** outerr) { return notOnHost(path, outerr); }
+static LCDBitmapTable* loadBitmapTable(const char* path, const char** outerr) { notOnHost(path, outerr); return NULL; }
+static LCDFont* loadFont(const char* path, const char** outerr) { notOnHost(path, outerr); return NULL; }
+
+// text is not rendered on the host
+static int drawText(const void* text, size_t len, PDStringEncoding encoding, int x, int y) { return 0; }
+static int getTextWidth(LCDFont* font, const void* text, size_t len, PDStringEncoding encoding, int tracking) { return 0; }
+static uint8_t getFontHeight(LCDFont* font) { return 0; }
+static void setFont(LCDFont* font) {}
+static void setTextTracking(int tracking) {}
+static int getTextTracking(void) { return 0; }
+static void setTextLeading(int leading) {}
+static void setLineCapStyle(LCDLineCapStyle style) {}
+static void setStencil(LCDBitmap* stencil) {}
+static void setStencilImage(LCDBitmap* stencil, int tile) {}
+
+// -- Frame buffer -------------------------------------------------------------
+
+static uint8_t* getFrame(void) { return frame; }
+static uint8_t* getDisplayFrame(void) { return displayFrame; }
+static LCDBitmap* getDisplayBufferBitmap(void) { return &displayScreen; }
+static LCDBitmap* copyFrameBufferBitmap(void) { return copyBitmap(&screen); }
+static void markUpdatedRows(int start, int end) {}
+
+void host_present(void) {
+  memcpy(displayFrame, frame, sizeof(frame));
+}
+
+static void display(void) {
+  host_present();
+}
+
+// -- Table --------------------------------------------------------------------
+
+static int unimplemented(void) {
+  return host_unimplemented("a playdate->graphics call");
+}
+
+struct playdate_graphics host_graphics;
+
+void host_initGraphics(void) {
+  depth = 0;
+  ctx = &stack[0];
+  resetContext(ctx, &screen);
+  memset(frame, 0xff, sizeof(frame));
+  memset(displayFrame, 0xff, sizeof(displayFrame));
+
+  host_fillStubs(&host_graphics, sizeof(host_graphics), unimplemented);
+  host_graphics.video = NULL;
+  host_graphics.clear = clear;
+  host_graphics.setBackgroundColor = setBackgroundColor;
+  host_graphics.setStencil = setStencil;
+  host_graphics.setStencilImage = setStencilImage;
+  host_graphics.setDrawMode = setDrawMode;
+  host_graphics.setDrawOffset = setDrawOffset;
+  host_graphics.setClipRect = setClipRect;
+  host_graphics.setScreenClipRect = setScreenClipRect;
+  host_graphics.clearClipRect = clearClipRect;
+  host_graphics.setLineCapStyle = setLineCapStyle;
+  host_graphics.setFont = setFont;
+  host_graphics.setTextTracking = setTextTracking;
+  host_graphics.getTextTracking = getTextTracking;
+  host_graphics.setTextLeading = setTextLeading;
+  host_graphics.pushContext = pushContext;
+  host_graphics.popContext = popContext;
+  host_graphics.drawBitmap = drawBitmap;
+  host_graphics.drawLine = drawLine;
+  host_graphics.drawRect = drawRect;
+  host_graphics.fillRect = fillRect;
+  host_graphics.setPixel = setPixel;
+  host_graphics.drawText = drawText;
+  host_graphics.getTextWidth = getTextWidth;
+  host_graphics.getFontHeight = getFontHeight;
+  host_graphics.newBitmap = newBitmap;
+  host_graphics.freeBitmap = freeBitmap;
+  host_graphics.loadBitmap = loadBitmap;
+  host_graphics.copyBitmap = copyBitmap;
+  host_graphics.getBitmapData = getBitmapData;
+  host_graphics.clearBitmap = clearBitmap;
+  host_graphics.getBitmapPixel = getBitmapPixel;
+  host_graphics.setBitmapMask = setBitmapMask;
+  host_graphics.getBitmapMask = getBitmapMask;
+  host_graphics.loadBitmapTable = loadBitmapTable;
+  host_graphics.loadFont = loadFont;
+  host_graphics.getFrame = getFrame;
+  host_graphics.getDisplayFrame = getDisplayFrame;
+  host_graphics.getDisplayBufferBitmap = getDisplayBufferBitmap;
+  host_graphics.copyFrameBufferBitmap = copyFrameBufferBitmap;
+  host_graphics.getDebugBitmap = NULL; // NULL on device as well
+  host_graphics.markUpdatedRows = markUpdatedRows;
+  host_graphics.display = display;
+}
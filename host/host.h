@@ -0,0 +1,86 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdio.h>
+#include <playdate/api.h>
+
+// Headless stand-in for the Playdate runtime, used to run and measure the
+// game on Linux. It fills the PlaydateAPI tables with in-memory versions of
+// the parts the game needs (framebuffer, display, clock, sandboxed files,
+// input). Calls into parts it does not implement, such as sound, sprites
+// and Lua, return 0 and are reported once per table on stderr instead of
+// ending the run; playdate->system->error still stops it, as on device. The
+// runtime drives eventHandlerShim exactly like the device: kEventInit, one
+// update callback per frame, kEventTerminate.
+
+typedef struct
+{
+  const char* dataDir;  // writable, what kFileReadData and writes see
+  const char* pdxDir;   // read-only, what kFileRead sees (build/Source)
+  const char* inputPath; // optional input script, see host_loadInput
+  int fixedClock;       // advance the clock by one frame period per frame
+  int quiet;            // drop logToConsole output
+} HostConfig;
+
+typedef struct
+{
+  uint32_t frames;
+  uint32_t minUs, maxUs;
+  uint32_t medianUs, p99Us;
+  double meanUs;
+} HostTimings;
+
+PlaydateAPI* host_api(void);
+
+// sends kEventInit; -1 if the game failed to initialise
+int host_init(const HostConfig* config);
+
+// applies this frame's input, runs the update callback and presents the
+// frame; returns the microseconds the callback took
+uint32_t host_frame(void);
+
+void host_terminate(void);
+
+uint32_t host_frameIndex(void);
+int host_timings(HostTimings* out); // over every frame run so far
+void host_writeTrace(FILE* out);    // frame,us,hash per line, hash of the displayed frame
+
+// -- Input --------------------------------------------------------------------
+
+// script lines are "<frame> <command> [args]", # starts a comment:
+//   press|release left|right|up|down|a|b [ms]
+//                          ms: how long before the frame the button changed,
+//                          for sub-frame `when` times; list in order
+//   crank <degrees>        crank change reported for that frame
+//   dock | undock
+//   accel <x> <y> <z>
+int host_loadInput(const char* path);
+
+void host_setButton(PDButtons button, int down);
+void host_setCrank(float change);
+void host_setCrankDocked(int docked);
+void host_setAccelerometer(float x, float y, float z);
+
+// -- Internal -----------------------------------------------------------------
+
+extern struct playdate_sys host_system;
+extern struct playdate_display host_display;
+extern struct playdate_graphics host_graphics;
+extern struct playdate_file host_file;
+extern struct playdate_json host_json;
+
+void host_initSystem(const HostConfig* config);
+void host_initGraphics(void);
+void host_initFile(const HostConfig* config);
+void host_initJson(void);
+void host_initStubs(PlaydateAPI* api);
+
+PDCallbackFunction* host_updateCallback(void** userdata);
+float host_refreshRate(void);
+void host_beginFrame(uint32_t frame); // input and clock for the coming frame
+void host_present(void);              // copies the frame to the display buffer
+
+void host_fillStubs(void* table, size_t size, int (*stub)(void));
+int host_unimplemented(const char* table); // reports table once, returns 0
+
+#endif // HOST_H
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include "host.h"
+
+// playdate->json->decode for the host: a recursive descent parser that
+// drives json_decoder callbacks in the same order as the device, including
+// the "_root" sublist, 1-based array positions, shouldDecode* skipping and
+// returnString. The encoder is not implemented.
+
+typedef struct
+{
+  json_decoder* decoder;
+  const char* p;
+  int line;
+  int failed;
+  char* scratch; // decoded string values, valid during their callback
+  size_t scratchSize;
+} Parser;
+
+static void fail(Parser* ps, const char* error) {
+  if (ps->failed) return;
+  ps->failed = 1;
+  if (ps->decoder->decodeError) ps->decoder->decodeError(ps->decoder, error, ps->line);
+}
+
+static void skipSpace(Parser* ps) {
+  for (;;) {
+    char c = *ps->p;
+    if (c == '\n') ps->line++;
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return;
+    ps->p++;
+  }
+}
+
+static int literal(Parser* ps, const char* word) {
+  size_t len = strlen(word);
+  if (strncmp(ps->p, word, len) != 0) return 0;
+  ps->p += len;
+  return 1;
+}
+
+// decodes the string at ps->p (on the opening quote) into scratch at offset
+static char* parseString(Parser* ps, size_t offset) {
+  ps->p++;
+  size_t n = offset;
+  for (;;) {
+    char c = *ps->p++;
+    if (c == '\0' || c == '\n') {
+      fail(ps, "unterminated string");
+      return NULL;
+    }
+    if (c == '"') break;
+    if (c == '\\') {
+      c = *ps->p++;
+      switch (c) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          unsigned int code = 0;
+          if (sscanf(ps->p, "%4x", &code) != 1) {
+            fail(ps, "bad unicode escape");
+            return NULL;
+          }
+          ps->p += 4;
+          // UTF-8 encode, BMP only
+          char utf[3];
+          int len = 0;
+          if (code < 0x80) utf[len++] = code;
+          else if (code < 0x800) {
+            utf[len++] = 0xc0 | (code >> 6);
+            utf[len++] = 0x80 | (code & 0x3f);
+          }
+          else {
+            utf[len++] = 0xe0 | (code >> 12);
+            utf[len++] = 0x80 | ((code >> 6) & 0x3f);
+            utf[len++] = 0x80 | (code & 0x3f);
+          }
+          if (n + len + 1 > ps->scratchSize) {
+            ps->scratchSize = (n + len + 1) * 2;
+            ps->scratch = realloc(ps->scratch, ps->scratchSize);
+          }
+          memcpy(ps->scratch + n, utf, len);
+          n += len;
+          continue;
+        }
+        default: break; // \" \\ \/
+      }
+    }
+    if (n + 2 > ps->scratchSize) {
+      ps->scratchSize = (n + 2) * 2;
+      ps->scratch = realloc(ps->scratch, ps->scratchSize);
+    }
+    ps->scratch[n++] = c;
+  }
+  ps->scratch[n] = '\0';
+  return ps->scratch + offset;
+}
+
+static void skipValue(Parser* ps);
+
+static void skipContainer(Parser* ps, char open, char close) {
+  int depth = 0;
+  do {
+    char c = *ps->p;
+    if (c == '\0') {
+      fail(ps, "unexpected end of data");
+      return;
+    }
+    if (c == '"') {
+      parseString(ps, 0);
+      if (ps->failed) return;
+      continue;
+    }
+    if (c == '\n') ps->line++;
+    if (c == open) depth++;
+    else if (c == close) depth--;
+    ps->p++;
+  } while (depth > 0);
+}
+
+static void skipValue(Parser* ps) {
+  skipSpace(ps);
+  if (*ps->p == '{') skipContainer(ps, '{', '}');
+  else if (*ps->p == '[') skipContainer(ps, '[', ']');
+  else if (*ps->p == '"') parseString(ps, 0);
+  else while (*ps->p && !strchr(",]} \t\r\n", *ps->p)) ps->p++;
+}
+
+static int parseValue(Parser* ps, const char* name, json_value* out);
+
+static void parseTable(Parser* ps) {
+  json_decoder* d = ps->decoder;
+  ps->p++;
+  skipSpace(ps);
+  if (*ps->p == '}') {
+    ps->p++;
+    return;
+  }
+
+  for (;;) {
+    skipSpace(ps);
+    if (*ps->p != '"') {
+      fail(ps, "expected a key");
+      return;
+    }
+    // scratch is reused for the value, so the key is copied out
+    char* key = parseString(ps, 0);
+    if (key == NULL) return;
+    skipSpace(ps);
+    if (*ps->p++ != ':') {
+      fail(ps, "expected ':'");
+      return;
+    }
+
+    char keyCopy[256];
+    snprintf(keyCopy, sizeof(keyCopy), "%s", key);
+
+    if (d->shouldDecodeTableValueForKey && !d->shouldDecodeTableValueForKey(d, keyCopy)) {
+      skipValue(ps);
+    }
+    else {
+      json_value value;
+      if (parseValue(ps, keyCopy, &value) < 0) return;
+      if (d->didDecodeTableValue) d->didDecodeTableValue(d, keyCopy, value);
+    }
+    if (ps->failed) return;
+
+    skipSpace(ps);
+    if (*ps->p == ',') {
+      ps->p++;
+      continue;
+    }
+    if (*ps->p == '}') {
+      ps->p++;
+      return;
+    }
+    fail(ps, "expected ',' or '}'");
+    return;
+  }
+}
+
+static void parseArray(Parser* ps) {
+  json_decoder* d = ps->decoder;
+  ps->p++;
+  skipSpace(ps);
+  if (*ps->p == ']') {
+    ps->p++;
+    return;
+  }
+
+  for (int pos = 1;; pos++) {
+    if (d->shouldDecodeArrayValueAtIndex && !d->shouldDecodeArrayValueAtIndex(d, pos)) {
+      skipValue(ps);
+    }
+    else {
+      char name[16];
+      snprintf(name, sizeof(name), "%d", pos);
+      json_value value;
+      if (parseValue(ps, name, &value) < 0) return;
+      if (d->didDecodeArrayValue) d->didDecodeArrayValue(d, pos, value);
+    }
+    if (ps->failed) return;
+
+    skipSpace(ps);
+    if (*ps->p == ',') {
+      ps->p++;
+      continue;
+    }
+    if (*ps->p == ']') {
+      ps->p++;
+      return;
+    }
+    fail(ps, "expected ',' or ']'");
+    return;
+  }
+}
+
+static int parseValue(Parser* ps, const char* name, json_value* out) {
+  json_decoder* d = ps->decoder;
+  skipSpace(ps);
+  char c = *ps->p;
+  memset(out, 0, sizeof(json_value));
+
+  if (c == '{' || c == '[') {
+    json_value_type type = c == '{' ? kJSONTable : kJSONArray;
+    const char* start = ps->p;
+    d->returnString = 0;
+    if (d->willDecodeSublist) d->willDecodeSublist(d, name, type);
+
+    if (d->returnString) {
+      d->returnString = 0;
+      skipValue(ps);
+      size_t len = ps->p - start;
+      if (len + 1 > ps->scratchSize) {
+        ps->scratchSize = len + 1;
+        ps->scratch = realloc(ps->scratch, ps->scratchSize);
+      }
+      memcpy(ps->scratch, start, len);
+      ps->scratch[len] = '\0';
+      out->type = kJSONString;
+      out->data.stringval = ps->scratch;
+      return ps->failed ? -1 : 0;
+    }
+
+    d->path = name;
+    if (type == kJSONTable) parseTable(ps);
+    else parseArray(ps);
+    if (ps->failed) return -1;
+
+    void* result = d->didDecodeSublist ? d->didDecodeSublist(d, name, type) : NULL;
+    out->type = type;
+    out->data.tableval = result;
+    return 0;
+  }
+
+  if (c == '"') {
+    char* s = parseString(ps, 0);
+    if (s == NULL) return -1;
+    out->type = kJSONString;
+    out->data.stringval = s;
+    return 0;
+  }
+  if (literal(ps, "true")) { out->type = kJSONTrue; return 0; }
+  if (literal(ps, "false")) { out->type = kJSONFalse; return 0; }
+  if (literal(ps, "null")) { out->type = kJSONNull; return 0; }
+
+  char* end;
+  double number = strtod(ps->p, &end);
+  if (end == ps->p) {
+    fail(ps, "unexpected character");
+    return -1;
+  }
+  int isFloat = 0;
+  for (const char* q = ps->p; q < end; q++) {
+    if (*q == '.' || *q == 'e' || *q == 'E') isFloat = 1;
+  }
+  ps->p = end;
+  if (isFloat) {
+    out->type = kJSONFloat;
+    out->data.floatval = (float)number;
+  }
+  else {
+    out->type = kJSONInteger;
+    out->data.intval = (int)number;
+  }
+  return 0;
+}
+
+static int decodeString(json_decoder* decoder, const char* json, json_value* outval) {
+  Parser ps = { decoder, json, 1, 0, NULL, 0 };
+  json_value value;
+
+  skipSpace(&ps);
+  int bare = *ps.p != '{' && *ps.p != '[';
+  int ok = parseValue(&ps, "_root", &value) == 0;
+  if (ok) {
+    skipSpace(&ps);
+    if (*ps.p != '\0') {
+      fail(&ps, "trailing characters");
+      ok = 0;
+    }
+  }
+  if (ok && bare && decoder->didDecodeArrayValue) decoder->didDecodeArrayValue(decoder, 0, value);
+  if (outval) *outval = value;
+  free(ps.scratch);
+  return ok;
+}
+
+static int decode(json_decoder* decoder, json_reader reader, json_value* outval) {
+  size_t size = 0, capacity = 4096;
+  char* text = malloc(capacity);
+  for (;;) {
+    if (capacity - size < 1025) text = realloc(text, capacity *= 2);
+    int n = reader.read(reader.userdata, (uint8_t*)text + size, 1024);
+    if (n <= 0) break;
+    size += n;
+  }
+  text[size] = '\0';
+  int ok = decodeString(decoder, text, outval);
+  free(text);
+  return ok;
+}
+
+static int unimplemented(void) {
+  return host_unimplemented("the playdate->json encoder");
+}
+
+struct playdate_json host_json;
+
+void host_initJson(void) {
+  host_fillStubs(&host_json, sizeof(host_json), unimplemented);
+  host_json.decode = decode;
+  host_json.decodeString = decodeString;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include "host.h"
+#include "replay.h"
+
+// Headless runner: initialises the game, runs a number of frames and
+// terminates it, then prints per-frame timing statistics. With --replay the
+// game's input comes from a recording made with replay_record and the run
+// lasts as long as the recording; traces of two builds replaying the same
+// file can then be checked with --compare.
+
+static void usage(const char* name) {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  -n <frames>      frames to run (default 300)\n"
+    "  --data <dir>     writable data directory (default build/host/Data)\n"
+    "  --pdx <dir>      read-only pdx contents (default build/Source)\n"
+    "  --input <file>   scripted input, see host.h\n"
+    "  --trace <file>   write frame,us,hash for every frame\n"
+    "  --record <file>  record input to a replay file in the data directory\n"
+    "  --replay <file>  replay a recording; runs until it ends unless -n is given\n"
+    "  --fixed          advance the clock by one frame period per frame\n"
+    "  --quiet          drop logToConsole output\n"
+    "       %s --compare <base.csv> <new.csv>\n", name, name);
+}
+
+// -- Trace comparison ---------------------------------------------------------
+
+typedef struct
+{
+  uint32_t* us;
+  uint32_t* hash;
+  uint32_t count;
+} Trace;
+
+static int loadTrace(const char* path, Trace* t) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "host: cannot read %s\n", path);
+    return -1;
+  }
+  uint32_t capacity = 0, frame, us, hash;
+  char line[128];
+  memset(t, 0, sizeof(Trace));
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "%u,%u,%x", &frame, &us, &hash) != 3) continue;
+    if (t->count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      t->us = realloc(t->us, capacity * sizeof(uint32_t));
+      t->hash = realloc(t->hash, capacity * sizeof(uint32_t));
+    }
+    t->us[t->count] = us;
+    t->hash[t->count] = hash;
+    t->count++;
+  }
+  fclose(f);
+  return 0;
+}
+
+static int compareUs(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint32_t median(uint32_t* us, uint32_t count) {
+  if (count == 0) return 0;
+  uint32_t* sorted = malloc(count * sizeof(uint32_t));
+  memcpy(sorted, us, count * sizeof(uint32_t));
+  qsort(sorted, count, sizeof(uint32_t), compareUs);
+  uint32_t m = sorted[count / 2];
+  free(sorted);
+  return m;
+}
+
+// reports the first frame whose picture differs and the change in median
+// frame time; returns 1 if the two runs did not draw the same frames
+static int compareTraces(const char* basePath, const char* newPath) {
+  Trace base, next;
+  if (loadTrace(basePath, &base) < 0 || loadTrace(newPath, &next) < 0) return 2;
+
+  uint32_t frames = base.count < next.count ? base.count : next.count;
+  int diverged = -1;
+  for (uint32_t i = 0; i < frames && diverged < 0; i++) {
+    if (base.hash[i] != next.hash[i]) diverged = i;
+  }
+  uint32_t a = median(base.us, frames), b = median(next.us, frames);
+  printf("host: %u frames compared, median %uus -> %uus (%+.1f%%)\n", frames, a, b, a ? (b - (double)a) / a * 100.0 : 0.0);
+  if (base.count != next.count) printf("host: runs differ in length, %u vs %u frames\n", base.count, next.count);
+  if (diverged >= 0) printf("host: frames differ from frame %d\n", diverged);
+  else printf("host: all frames identical\n");
+  return diverged >= 0 || base.count != next.count ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  HostConfig config = { "build/host/Data", "build/Source", NULL, 0, 0 };
+  const char* tracePath = NULL;
+  const char* recordPath = NULL;
+  const char* replayPath = NULL;
+  int frames = -1;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    int more = i + 1 < argc;
+    if (strcmp(arg, "-n") == 0 && more) frames = atoi(argv[++i]);
+    else if (strcmp(arg, "--data") == 0 && more) config.dataDir = argv[++i];
+    else if (strcmp(arg, "--pdx") == 0 && more) config.pdxDir = argv[++i];
+    else if (strcmp(arg, "--input") == 0 && more) config.inputPath = argv[++i];
+    else if (strcmp(arg, "--trace") == 0 && more) tracePath = argv[++i];
+    else if (strcmp(arg, "--fixed") == 0) config.fixedClock = 1;
+    else if (strcmp(arg, "--quiet") == 0) config.quiet = 1;
+    else if (strcmp(arg, "--record") == 0 && more) recordPath = argv[++i];
+    else if (strcmp(arg, "--replay") == 0 && more) replayPath = argv[++i];
+    else if (strcmp(arg, "--compare") == 0 && i + 2 < argc) return compareTraces(argv[i + 1], argv[i + 2]);
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (host_init(&config) < 0) {
+    fprintf(stderr, "host: game initialisation failed\n");
+    return 1;
+  }
+  if (recordPath && replay_record(recordPath) < 0) {
+    fprintf(stderr, "host: cannot record to %s\n", recordPath);
+    return 1;
+  }
+  if (replayPath && replay_play(replayPath) < 0) {
+    fprintf(stderr, "host: cannot replay %s\n", replayPath);
+    return 1;
+  }
+
+  if (frames < 0 && replayPath) {
+    while (!replay_finished()) {
+      uint32_t replayed = replay_frameIndex();
+      host_frame();
+      if (replay_frameIndex() == replayed) {
+        fprintf(stderr, "host: the game's update does not call replay_frame()\n");
+        return 1;
+      }
+    }
+  }
+  else {
+    if (frames < 0) frames = 300;
+    for (int i = 0; i < frames; i++) host_frame();
+  }
+  replay_stop();
+  host_terminate();
+
+  HostTimings t;
+  if (host_timings(&t) == 0) {
+    printf("host: %u frames, mean %.1fus, median %uus, p99 %uus, min %uus, max %uus\n",
+      t.frames, t.meanUs, t.medianUs, t.p99Us, t.minUs, t.maxUs);
+  }
+
+  if (tracePath) {
+    FILE* f = fopen(tracePath, "w");
+    if (f == NULL) {
+      fprintf(stderr, "host: cannot write %s\n", tracePath);
+      return 1;
+    }
+    host_writeTrace(f);
+    fclose(f);
+  }
+  return 0;
+}
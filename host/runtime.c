@@ -0,0 +1,112 @@
+#include <time.h>
+#include "host.h"
+
+// defined by the PLAYDATE_SETUP section of api.h in the game's main.c
+extern int eventHandlerShim(PlaydateAPI* pd, PDSystemEvent event, uint32_t arg);
+
+static PlaydateAPI api;
+static uint32_t frameIndex;
+static uint32_t* frameUs;
+static uint32_t* frameHash;
+static uint32_t frameCapacity;
+
+static uint64_t nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+PlaydateAPI* host_api(void) {
+  return &api;
+}
+
+int host_init(const HostConfig* config) {
+  host_initSystem(config);
+  host_initGraphics();
+  host_initFile(config);
+  host_initJson();
+
+  api.system = &host_system;
+  api.file = &host_file;
+  api.graphics = &host_graphics;
+  api.display = &host_display;
+  api.json = &host_json;
+  host_initStubs(&api);
+
+  if (config->inputPath && host_loadInput(config->inputPath) < 0) {
+    fprintf(stderr, "host: cannot load input script %s\n", config->inputPath);
+    return -1;
+  }
+
+  frameIndex = 0;
+  return eventHandlerShim(&api, kEventInit, 0) == 0 ? 0 : -1;
+}
+
+// FNV-1a over the displayed frame
+static uint32_t hashDisplay(void) {
+  const uint8_t* p = host_graphics.getDisplayFrame();
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < LCD_ROWSIZE * LCD_ROWS; i++) hash = (hash ^ p[i]) * 16777619u;
+  return hash;
+}
+
+uint32_t host_frame(void) {
+  void* userdata = NULL;
+  PDCallbackFunction* update = host_updateCallback(&userdata);
+
+  host_beginFrame(frameIndex);
+  uint64_t start = nowNs();
+  int updated = update ? update(userdata) : 0;
+  uint32_t us = (uint32_t)((nowNs() - start) / 1000);
+
+  // like the device, the display only changes when update returns nonzero
+  if (updated) host_present();
+
+  if (frameIndex >= frameCapacity) {
+    frameCapacity = frameCapacity ? frameCapacity * 2 : 1024;
+    frameUs = realloc(frameUs, frameCapacity * sizeof(uint32_t));
+    frameHash = realloc(frameHash, frameCapacity * sizeof(uint32_t));
+  }
+  frameUs[frameIndex] = us;
+  frameHash[frameIndex] = hashDisplay();
+  frameIndex++;
+  return us;
+}
+
+void host_terminate(void) {
+  eventHandlerShim(&api, kEventTerminate, 0);
+}
+
+uint32_t host_frameIndex(void) {
+  return frameIndex;
+}
+
+static int compare(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+int host_timings(HostTimings* out) {
+  memset(out, 0, sizeof(HostTimings));
+  if (frameIndex == 0) return -1;
+
+  uint32_t* sorted = malloc(frameIndex * sizeof(uint32_t));
+  memcpy(sorted, frameUs, frameIndex * sizeof(uint32_t));
+  qsort(sorted, frameIndex, sizeof(uint32_t), compare);
+
+  double sum = 0;
+  for (uint32_t i = 0; i < frameIndex; i++) sum += sorted[i];
+  out->frames = frameIndex;
+  out->minUs = sorted[0];
+  out->maxUs = sorted[frameIndex - 1];
+  out->medianUs = sorted[frameIndex / 2];
+  out->p99Us = sorted[(uint32_t)((frameIndex - 1) * 0.99)];
+  out->meanUs = sum / frameIndex;
+  free(sorted);
+  return 0;
+}
+
+void host_writeTrace(FILE* out) {
+  fprintf(out, "frame,us,hash\n");
+  for (uint32_t i = 0; i < frameIndex; i++) fprintf(out, "%u,%u,%08x\n", i, frameUs[i], frameHash[i]);
+}
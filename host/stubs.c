@@ -0,0 +1,69 @@
+#include "host.h"
+
+// Tables the host runtime does not implement. Every slot points at a stub
+// that returns 0 (NULL for pointers), and the first call into each table is
+// reported on stderr, so a game that uses sound or sprites still runs
+// headless without them and the log says what was skipped.
+
+#define MAX_REPORTED 16
+
+void host_fillStubs(void* table, size_t size, int (*stub)(void)) {
+  int (**slot)(void) = table;
+  for (size_t i = 0; i < size / sizeof(*slot); i++) slot[i] = stub;
+}
+
+int host_unimplemented(const char* table) {
+  static const char* reported[MAX_REPORTED];
+  static int reportedCount;
+  for (int i = 0; i < reportedCount; i++) {
+    if (reported[i] == table) return 0;
+  }
+  if (reportedCount < MAX_REPORTED) reported[reportedCount++] = table;
+  fprintf(stderr, "host: %s not implemented, calls return 0\n", table);
+  return 0;
+}
+
+#define STUB(name) \
+  static int stub_##name(void) { return host_unimplemented("playdate->" #name); }
+
+STUB(sprite)
+STUB(sound)
+STUB(lua)
+STUB(scoreboards)
+
+static struct playdate_sprite sprite;
+static struct playdate_sound sound;
+static struct playdate_lua lua;
+static struct playdate_scoreboards scoreboards;
+
+// shared by every playdate->sound sub-table; large enough for the biggest
+static void (*soundTable[128])(void);
+
+void host_initStubs(PlaydateAPI* api) {
+  host_fillStubs(&sprite, sizeof(sprite), stub_sprite);
+  host_fillStubs(&lua, sizeof(lua), stub_lua);
+  host_fillStubs(&scoreboards, sizeof(scoreboards), stub_scoreboards);
+
+  host_fillStubs(&sound, sizeof(sound), stub_sound);
+  host_fillStubs(soundTable, sizeof(soundTable), stub_sound);
+  const void* sub = soundTable;
+  sound.channel = sub;
+  sound.fileplayer = sub;
+  sound.sample = sub;
+  sound.sampleplayer = sub;
+  sound.synth = sub;
+  sound.sequence = sub;
+  sound.effect = sub;
+  sound.lfo = sub;
+  sound.envelope = sub;
+  sound.source = sub;
+  sound.controlsignal = sub;
+  sound.track = sub;
+  sound.instrument = sub;
+  sound.signal = sub;
+
+  api->sprite = &sprite;
+  api->sound = &sound;
+  api->lua = &lua;
+  api->scoreboards = &scoreboards;
+}
@@ -0,0 +1,361 @@
+#define _GNU_SOURCE // vasprintf
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include "host.h"
+
+// -- Clock --------------------------------------------------------------------
+
+static int fixedClock;
+static uint64_t startNs;
+static uint32_t virtualMs; // used instead of the real clock with fixedClock
+static uint32_t elapsedBase;
+
+static uint64_t monotonicNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static unsigned int getCurrentTimeMilliseconds(void) {
+  if (fixedClock) return virtualMs;
+  return (unsigned int)((monotonicNs() - startNs) / 1000000);
+}
+
+static unsigned int getSecondsSinceEpoch(unsigned int* milliseconds) {
+  if (fixedClock) {
+    if (milliseconds) *milliseconds = virtualMs % 1000;
+    return virtualMs / 1000;
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  if (milliseconds) *milliseconds = ts.tv_nsec / 1000000;
+  return (unsigned int)(ts.tv_sec - 946684800); // the Playdate epoch is 2000-01-01
+}
+
+static float getElapsedTime(void) {
+  return (getCurrentTimeMilliseconds() - elapsedBase) / 1000.0f;
+}
+
+static void resetElapsedTime(void) {
+  elapsedBase = getCurrentTimeMilliseconds();
+}
+
+// -- Console ------------------------------------------------------------------
+
+static int quiet;
+
+static void* hostRealloc(void* ptr, size_t size) {
+  if (size == 0) {
+    free(ptr);
+    return NULL;
+  }
+  return realloc(ptr, size);
+}
+
+static int vaFormatString(char** outstr, const char* fmt, va_list args) {
+  return vasprintf(outstr, fmt, args);
+}
+
+static int formatString(char** outstr, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vasprintf(outstr, fmt, args);
+  va_end(args);
+  return n;
+}
+
+static void logToConsole(const char* fmt, ...) {
+  if (quiet) return;
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  putchar('\n');
+}
+
+// the device stops the game on error, so does the host
+static void error(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fputs("error: ", stderr);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+  fflush(stdout);
+  exit(1);
+}
+
+static PDLanguage getLanguage(void) { return kPDLanguageEnglish; }
+static void drawFPS(int x, int y) {}
+
+// -- Update callback ----------------------------------------------------------
+
+static PDCallbackFunction* update;
+static void* updateUserdata;
+
+static void setUpdateCallback(PDCallbackFunction* callback, void* userdata) {
+  update = callback;
+  updateUserdata = userdata;
+}
+
+PDCallbackFunction* host_updateCallback(void** userdata) {
+  *userdata = updateUserdata;
+  return update;
+}
+
+// -- Input --------------------------------------------------------------------
+
+typedef enum
+{
+  kInputPress,
+  kInputRelease,
+  kInputCrank,
+  kInputDock,
+  kInputUndock,
+  kInputAccel
+} InputKind;
+
+typedef struct
+{
+  uint32_t frame;
+  InputKind kind;
+  PDButtons button;
+  float value[3];
+} InputEvent;
+
+static InputEvent* script;
+static int scriptCount, scriptNext;
+
+static PDButtons current, pushed, released;
+static PDButtons pendingPushed, pendingReleased;
+static float crankChange, crankAngle, pendingCrank;
+static int crankDocked;
+static float accel[3] = { 0, 0, 1 };
+
+static PDButtonCallbackFunction* buttonCallback;
+static void* buttonUserdata;
+
+static void getButtonState(PDButtons* outCurrent, PDButtons* outPushed, PDButtons* outReleased) {
+  if (outCurrent) *outCurrent = current;
+  if (outPushed) *outPushed = pushed;
+  if (outReleased) *outReleased = released;
+}
+
+static void setButtonCallback(PDButtonCallbackFunction* cb, void* userdata, int queuesize) {
+  buttonCallback = cb;
+  buttonUserdata = userdata;
+}
+
+static void setPeripheralsEnabled(PDPeripherals mask) {}
+
+static void getAccelerometer(float* outx, float* outy, float* outz) {
+  if (outx) *outx = accel[0];
+  if (outy) *outy = accel[1];
+  if (outz) *outz = accel[2];
+}
+
+static float getCrankChange(void) { return crankChange; }
+static float getCrankAngle(void) { return crankAngle; }
+static int isCrankDocked(void) { return crankDocked; }
+static int setCrankSoundsDisabled(int flag) { return 0; }
+
+static void setButton(PDButtons button, int down, uint32_t when) {
+  if (down == ((current & button) != 0)) return;
+  if (down) {
+    current |= button;
+    pendingPushed |= button;
+  }
+  else {
+    current &= ~button;
+    pendingReleased |= button;
+  }
+  if (buttonCallback) buttonCallback(button, down, when, buttonUserdata);
+}
+
+void host_setButton(PDButtons button, int down) {
+  setButton(button, down, getCurrentTimeMilliseconds());
+}
+
+void host_setCrank(float change) {
+  pendingCrank += change;
+}
+
+void host_setCrankDocked(int docked) {
+  crankDocked = docked;
+}
+
+void host_setAccelerometer(float x, float y, float z) {
+  accel[0] = x;
+  accel[1] = y;
+  accel[2] = z;
+}
+
+static const char* buttonNames[] = { "left", "right", "up", "down", "b", "a" };
+
+int host_loadInput(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) return -1;
+
+  char line[256];
+  int lineno = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineno++;
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+
+    InputEvent e = { 0 };
+    char command[16], arg[16];
+    int n = sscanf(line, "%u %15s %15s", &e.frame, command, arg);
+    if (n <= 0) continue;
+
+    if (n == 3 && (strcmp(command, "press") == 0 || strcmp(command, "release") == 0)) {
+      e.kind = command[0] == 'p' ? kInputPress : kInputRelease;
+      for (int i = 0; i < 6; i++) {
+        if (strcmp(arg, buttonNames[i]) == 0) e.button = 1 << i;
+      }
+      sscanf(line, "%*u %*s %*s %f", &e.value[0]);
+    }
+    else if (n == 3 && strcmp(command, "crank") == 0) {
+      e.kind = kInputCrank;
+      e.value[0] = strtof(arg, NULL);
+    }
+    else if (n == 2 && strcmp(command, "dock") == 0) e.kind = kInputDock;
+    else if (n == 2 && strcmp(command, "undock") == 0) e.kind = kInputUndock;
+    else if (n == 3 && strcmp(command, "accel") == 0) {
+      e.kind = kInputAccel;
+      sscanf(line, "%*u %*s %f %f %f", &e.value[0], &e.value[1], &e.value[2]);
+    }
+    else e.kind = -1;
+
+    if (e.kind == (InputKind)-1 || ((e.kind == kInputPress || e.kind == kInputRelease) && e.button == 0)) {
+      fprintf(stderr, "%s:%d: cannot parse input line\n", path, lineno);
+      fclose(f);
+      return -1;
+    }
+
+    // keep the script sorted by frame, stable for events on the same frame
+    script = realloc(script, (scriptCount + 1) * sizeof(InputEvent));
+    int i = scriptCount++;
+    while (i > 0 && script[i - 1].frame > e.frame) {
+      script[i] = script[i - 1];
+      i--;
+    }
+    script[i] = e;
+  }
+  fclose(f);
+  return 0;
+}
+
+// -- Display ------------------------------------------------------------------
+
+static float refreshRate = 30;
+
+static int getWidth(void) { return LCD_COLUMNS; }
+static int getHeight(void) { return LCD_ROWS; }
+static void setRefreshRate(float rate) { refreshRate = rate; }
+static void setInverted(int flag) {}
+static void setScale(unsigned int s) {}
+static void setMosaic(unsigned int x, unsigned int y) {}
+static void setFlipped(int x, int y) {}
+static void setOffset(int x, int y) {}
+
+float host_refreshRate(void) {
+  return refreshRate;
+}
+
+struct playdate_display host_display = {
+  .getWidth = getWidth,
+  .getHeight = getHeight,
+  .setRefreshRate = setRefreshRate,
+  .setInverted = setInverted,
+  .setScale = setScale,
+  .setMosaic = setMosaic,
+  .setFlipped = setFlipped,
+  .setOffset = setOffset,
+};
+
+// -- Frame --------------------------------------------------------------------
+
+// the callback time for a scripted event `ago` ms before the frame
+static uint32_t scriptTime(float ago) {
+  uint32_t now = getCurrentTimeMilliseconds();
+  return ago > 0 && ago < now ? now - (uint32_t)ago : now;
+}
+
+static float clockRate;
+static uint32_t clockBaseFrame, clockBaseMs;
+
+void host_beginFrame(uint32_t frame) {
+  if (fixedClock) {
+    float rate = refreshRate > 0 ? refreshRate : 50; // unlimited runs at the 50fps cap
+    // a new rate applies from the previous frame on, so the clock never
+    // runs backwards when a game changes it
+    if (rate != clockRate) {
+      if (clockRate > 0 && frame > 0) {
+        clockBaseFrame = frame - 1;
+        clockBaseMs = virtualMs;
+      }
+      clockRate = rate;
+    }
+    virtualMs = clockBaseMs + (uint32_t)((frame - clockBaseFrame) * 1000.0f / rate);
+  }
+
+  for (; scriptNext < scriptCount && script[scriptNext].frame <= frame; scriptNext++) {
+    InputEvent* e = &script[scriptNext];
+    switch (e->kind) {
+      case kInputPress: setButton(e->button, 1, scriptTime(e->value[0])); break;
+      case kInputRelease: setButton(e->button, 0, scriptTime(e->value[0])); break;
+      case kInputCrank: host_setCrank(e->value[0]); break;
+      case kInputDock: host_setCrankDocked(1); break;
+      case kInputUndock: host_setCrankDocked(0); break;
+      case kInputAccel: host_setAccelerometer(e->value[0], e->value[1], e->value[2]); break;
+    }
+  }
+
+  pushed = pendingPushed;
+  released = pendingReleased;
+  pendingPushed = pendingReleased = 0;
+
+  crankChange = crankDocked ? 0 : pendingCrank;
+  pendingCrank = 0;
+  crankAngle += crankChange;
+  while (crankAngle >= 360) crankAngle -= 360;
+  while (crankAngle < 0) crankAngle += 360;
+}
+
+// -- Table --------------------------------------------------------------------
+
+static int unimplemented(void) {
+  return host_unimplemented("a playdate->system call");
+}
+
+struct playdate_sys host_system;
+
+void host_initSystem(const HostConfig* config) {
+  fixedClock = config->fixedClock;
+  quiet = config->quiet;
+  startNs = monotonicNs();
+
+  host_fillStubs(&host_system, sizeof(host_system), unimplemented);
+  host_system.realloc = hostRealloc;
+  host_system.formatString = formatString;
+  host_system.vaFormatString = vaFormatString;
+  host_system.logToConsole = logToConsole;
+  host_system.error = error;
+  host_system.getLanguage = getLanguage;
+  host_system.getCurrentTimeMilliseconds = getCurrentTimeMilliseconds;
+  host_system.getSecondsSinceEpoch = getSecondsSinceEpoch;
+  host_system.drawFPS = drawFPS;
+  host_system.setUpdateCallback = setUpdateCallback;
+  host_system.getButtonState = getButtonState;
+  host_system.setButtonCallback = setButtonCallback;
+  host_system.setPeripheralsEnabled = setPeripheralsEnabled;
+  host_system.getAccelerometer = getAccelerometer;
+  host_system.getCrankChange = getCrankChange;
+  host_system.getCrankAngle = getCrankAngle;
+  host_system.isCrankDocked = isCrankDocked;
+  host_system.setCrankSoundsDisabled = setCrankSoundsDisabled;
+  host_system.getElapsedTime = getElapsedTime;
+  host_system.resetElapsedTime = resetElapsedTime;
+}
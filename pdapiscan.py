@@ -0,0 +1,381 @@
+import argparse
+import os
+import re
+import struct
+
+import pdex2elf
+
+# Finds the Playdate API calls a pdex.bin (or a linked pdex.elf) makes on its
+# per-frame path without running it. Each recovered function is swept once
+# while tracking what its registers hold: the API pointer, one of its tables
+# (playdate->graphics), or a function loaded from a table. A blx through the
+# last is an API call, named from the member offsets in deps/playdate/api.h.
+#
+# The per-frame path is everything reachable by direct calls from the
+# function the entry point passes to system->setUpdateCallback. Calls are
+# ranked by loop nesting: the backward branches around the call site plus
+# those around the call sites leading to its function.
+#
+# The sweep is linear and ignores branches, which is right for the code
+# compilers emit around API calls (load the table, load the member, call)
+# but will miss pointers kept across calls in the stack or passed as
+# arguments.
+
+API_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'deps', 'playdate', 'api.h')
+
+_COMMENT = re.compile(r'//[^\n]*|/\*.*?\*/', re.S)
+_STRUCT = re.compile(r'^struct\s+(PlaydateAPI|playdate_\w+)\s*\{(.*?)^\};', re.S | re.M)
+_FUNCTION_MEMBER = re.compile(r'\(\s*\*\s*(\w+)\s*\)')
+_TABLE_MEMBER = re.compile(r'struct\s+(\w+)\s*\*\s*(\w+)$')
+
+
+def read_api_tables(path=API_HEADER):
+    """Returns {struct name: [(member, struct name or None), ...]} for the API
+    function tables, in declaration order; every member is a 4 byte pointer on
+    the device, so a member's offset is its index times 4."""
+    with open(path) as f:
+        source = _COMMENT.sub('', f.read())
+    tables = {}
+    for name, body in _STRUCT.findall(source):
+        members = []
+        for declaration in body.split(';'):
+            declaration = ' '.join(declaration.split())
+            if not declaration:
+                continue
+            function = _FUNCTION_MEMBER.search(declaration)
+            if function:
+                members.append((function.group(1), None))
+                continue
+            table = _TABLE_MEMBER.search(declaration)
+            if not table:
+                raise ValueError('{}: cannot parse member of {}: {}'.format(path, name, declaration))
+            members.append((table.group(2), table.group(1)))
+        tables[name] = members
+    if 'PlaydateAPI' not in tables:
+        raise ValueError('{}: no struct PlaydateAPI'.format(path))
+    return tables
+
+
+# ==== Register tracking ====
+
+# Register values: ('const', word), ('api',), ('table', struct, path) or
+# ('func', path); anything else is None.
+
+API = ('api',)
+
+
+def _signed(value, bits):
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def branch_target(addr, hw1, hw2, wide):
+    """Target of a B or B<cond> at addr, or None if it is not one."""
+    if not wide:
+        if hw1 & 0xf000 == 0xd000 and hw1 & 0x0e00 != 0x0e00:
+            return addr + 4 + _signed(hw1 & 0xff, 8) * 2
+        if hw1 & 0xf800 == 0xe000:
+            return addr + 4 + _signed(hw1 & 0x7ff, 11) * 2
+        return None
+    if hw1 & 0xf800 != 0xf000:
+        return None
+    s = (hw1 >> 10) & 1
+    j1 = (hw2 >> 13) & 1
+    j2 = (hw2 >> 11) & 1
+    if hw2 & 0xd000 == 0x8000 and hw1 & 0x0380 != 0x0380:  # b<cond>.w
+        imm = (s << 20) | (j2 << 19) | (j1 << 18) | ((hw1 & 0x3f) << 12) | ((hw2 & 0x7ff) << 1)
+        return addr + 4 + _signed(imm, 21)
+    if hw2 & 0xd000 == 0x9000:  # b.w
+        i1 = 1 - (j1 ^ s)
+        i2 = 1 - (j2 ^ s)
+        imm = (s << 24) | (i1 << 23) | (i2 << 22) | ((hw1 & 0x3ff) << 12) | ((hw2 & 0x7ff) << 1)
+        return addr + 4 + _signed(imm, 25)
+    return None
+
+
+class Scanner:
+    def __init__(self, pdex, functions, tables):
+        self.text = pdex.text
+        self.functions = functions
+        self.tables = tables
+        self.globals = {}  # address -> value stored there by some function
+        self.update = None
+
+    def word(self, addr):
+        if 0 <= addr and addr + 4 <= len(self.text):
+            return struct.unpack_from('<I', self.text, addr)[0]
+        return None
+
+    def load(self, base, offset):
+        if base is None:
+            return None
+        if base[0] == 'const':
+            return self.globals.get(base[1] + offset)
+        if base[0] == 'api':
+            struct_name, path = 'PlaydateAPI', ''
+        elif base[0] == 'table':
+            struct_name, path = base[1], base[2] + '->'
+        else:
+            return None
+        members = self.tables.get(struct_name, [])
+        if offset % 4 or not 0 <= offset // 4 < len(members):
+            return None
+        member, table = members[offset // 4]
+        if table:
+            return ('table', table, path + member)
+        return ('func', path + member)
+
+    def literal(self, addr, offset):
+        value = self.word(((addr + 4) & ~3) + offset)
+        return ('const', value) if value is not None else None
+
+    def scan(self, function, entry=False):
+        """Sweeps one function; returns (calls, api_calls, loops) where calls
+        are (site, target) direct calls, api_calls (site, path) and loops
+        (start, end) address ranges closed by a backward branch."""
+        start, size, _ = function
+        regs = [None] * 16
+        slots = {}
+        if entry:
+            regs[0] = API  # eventHandler(PlaydateAPI* playdate, ...)
+        calls, api_calls, loops = [], [], []
+
+        def clobber(*numbers):
+            for n in numbers:
+                regs[n] = None
+                if n == 13:
+                    slots.clear()
+
+        def call_through(addr, rm, tail):
+            value = regs[rm]
+            if value is not None and value[0] == 'func':
+                api_calls.append((addr, value[1]))
+                if value[1] == 'system->setUpdateCallback' and regs[0] and regs[0][0] == 'const':
+                    self.update = regs[0][1] & ~1
+            if not tail:
+                clobber(0, 1, 2, 3, 12, 14)
+
+        addr = start
+        end = start + size
+        while addr + 2 <= end:
+            hw1 = pdex2elf.halfword(self.text, addr)
+            wide = pdex2elf.is_32bit(hw1) and addr + 4 <= end
+            hw2 = pdex2elf.halfword(self.text, addr + 2) if wide else 0
+
+            target = branch_target(addr, hw1, hw2, wide)
+            if target is not None:
+                if start <= target <= addr:
+                    loops.append((target, addr))
+                elif not start <= target < end:
+                    calls.append((addr, target))  # tail call
+            elif wide and pdex2elf.bl_target(addr, hw1, hw2) is not None:
+                calls.append((addr, pdex2elf.bl_target(addr, hw1, hw2)))
+                clobber(0, 1, 2, 3, 12, 14)
+            elif wide:
+                self.step32(addr, hw1, hw2, regs, slots, clobber)
+            elif hw1 & 0xff80 in (0x4780, 0x4700):  # blx / bx
+                call_through(addr, (hw1 >> 3) & 0xf, hw1 & 0x80 == 0)
+            else:
+                self.step16(addr, hw1, regs, slots, clobber)
+            addr += 4 if wide else 2
+        return calls, api_calls, loops
+
+    def store(self, base, offset, value):
+        if base is not None and base[0] == 'const' and value is not None:
+            self.globals[base[1] + offset] = value
+
+    def step16(self, addr, hw1, regs, slots, clobber):
+        rt, rn = hw1 & 7, (hw1 >> 3) & 7
+        if hw1 & 0xf800 == 0x4800:  # ldr rt, [pc, #imm]
+            regs[(hw1 >> 8) & 7] = self.literal(addr, (hw1 & 0xff) * 4)
+        elif hw1 & 0xf800 == 0x6800:  # ldr rt, [rn, #imm]
+            regs[rt] = self.load(regs[rn], ((hw1 >> 6) & 0x1f) * 4)
+        elif hw1 & 0xf800 == 0x6000:  # str rt, [rn, #imm]
+            self.store(regs[rn], ((hw1 >> 6) & 0x1f) * 4, regs[rt])
+        elif hw1 & 0xf800 == 0x9800:  # ldr rt, [sp, #imm]
+            regs[(hw1 >> 8) & 7] = slots.get((hw1 & 0xff) * 4)
+        elif hw1 & 0xf800 == 0x9000:  # str rt, [sp, #imm]
+            slots[(hw1 & 0xff) * 4] = regs[(hw1 >> 8) & 7]
+        elif hw1 & 0xff00 == 0x4600:  # mov rd, rm
+            regs[(hw1 & 7) | ((hw1 >> 4) & 8)] = regs[(hw1 >> 3) & 0xf]
+        elif hw1 & 0xffc0 == 0x0000:  # movs rd, rm
+            regs[rt] = regs[rn]
+        elif hw1 & 0xf800 == 0xa000:  # adr rd, label
+            regs[(hw1 >> 8) & 7] = ('const', ((addr + 4) & ~3) + (hw1 & 0xff) * 4)
+        elif hw1 & 0xfe00 in (0xb400, 0xbc00) or hw1 & 0xff00 == 0xb000:  # push, pop, add/sub sp
+            if hw1 & 0xfe00 == 0xbc00:
+                clobber(*[n for n in range(8) if hw1 & (1 << n)])
+            slots.clear()
+        elif hw1 & 0xf800 == 0xc800:  # ldm
+            clobber(*[n for n in range(8) if hw1 & (1 << n)])
+        elif hw1 & 0xe000 == 0x2000 or hw1 & 0xf000 == 0xa000:  # imm8 forms, add rd, sp
+            if hw1 & 0xf800 != 0x2800:  # cmp writes nothing
+                clobber((hw1 >> 8) & 7)
+        elif hw1 & 0xff00 == 0x4400:  # add rdn, rm
+            clobber((hw1 & 7) | ((hw1 >> 4) & 8))
+        elif hw1 < 0x2000:  # shifts, adds and subs
+            clobber(rt)
+        elif hw1 & 0xfc00 == 0x4000:  # alu, where tst, cmp and cmn write nothing
+            if (hw1 >> 6) & 0xf not in (8, 10, 11):
+                clobber(rt)
+        elif 0x5600 <= hw1 < 0x6000 or hw1 & 0xf800 in (0x7800, 0x8800):  # other loads
+            clobber(rt)
+
+    def step32(self, addr, hw1, hw2, regs, slots, clobber):
+        rt, rn = hw2 >> 12, hw1 & 0xf
+        if hw1 == 0xf8df or hw1 == 0xf85f:  # ldr.w rt, [pc, #+-imm]
+            offset = hw2 & 0xfff
+            regs[rt] = self.literal(addr, offset if hw1 & 0x80 else -offset)
+        elif hw1 & 0xfff0 == 0xf8d0:  # ldr.w rt, [rn, #imm12]
+            if rn == 13:
+                regs[rt] = slots.get(hw2 & 0xfff)
+            else:
+                regs[rt] = self.load(regs[rn], hw2 & 0xfff)
+        elif hw1 & 0xfff0 == 0xf850 and hw2 & 0x0800:  # ldr rt, [rn, #+-imm8]{!}
+            offset = hw2 & 0xff if hw2 & 0x0200 else -(hw2 & 0xff)
+            value = self.load(regs[rn], offset) if hw2 & 0x0400 and rn != 13 else None
+            if hw2 & 0x0100 or not hw2 & 0x0400:
+                clobber(rn)
+            regs[rt] = value
+        elif hw1 & 0xfff0 == 0xf8c0:  # str.w rt, [rn, #imm12]
+            if rn == 13:
+                slots[hw2 & 0xfff] = regs[rt]
+            else:
+                self.store(regs[rn], hw2 & 0xfff, regs[rt])
+        elif hw1 & 0xfe00 == 0xe800:  # load/store multiple and dual
+            if hw1 & 0x0020:
+                clobber(rn)
+            if hw1 & 0x0040 and hw1 & 0x0010:  # ldrd
+                clobber(rt, (hw2 >> 8) & 0xf)
+            elif not hw1 & 0x0040 and hw1 & 0x0010:  # ldm, pop.w
+                clobber(*[n for n in range(16) if hw2 & (1 << n)])
+            if rn == 13:
+                slots.clear()
+        elif hw1 & 0xfe00 == 0xf800:  # other single loads and stores
+            if hw1 & 0x0010:
+                clobber(rt)
+        elif hw1 & 0xfe00 == 0xea00 or hw1 & 0xff00 in (0xfa00, 0xfb00) or (
+                hw1 & 0xf800 == 0xf000 and not hw2 & 0x8000):  # data processing
+            rd = (hw2 >> 8) & 0xf
+            if rd != 15:  # tst.w, cmp.w and friends
+                clobber(rd)
+            if hw1 & 0xff80 == 0xfb80:  # long multiplies
+                clobber(rt)
+        elif hw1 & 0xff00 == 0xee00 and hw1 & 0x0010 and hw2 & 0x0f00 in (0x0a00, 0x0b00):  # vmov rt, sN
+            clobber(rt)
+
+
+# ==== Call graph ====
+
+def analyze(pdex, functions, tables):
+    """Returns (update, rows, reachable): the update callback's address, and
+    for every API call site reachable from it (depth, function, site, path),
+    deepest first."""
+    by_start = {f[0]: f for f in functions}
+    scanner = Scanner(pdex, functions, tables)
+
+    # the API pointer reaches other functions through globals; a second pass
+    # sees the ones stored after their readers in address order
+    results = {}
+    for _ in range(2):
+        for function in functions:
+            results[function[0]] = scanner.scan(function, entry=function[0] == pdex.entry & ~1)
+
+    update = scanner.update
+    if update not in by_start:
+        update = None
+
+    def loop_depth(function_start, site):
+        return sum(1 for lo, hi in results[function_start][2] if lo <= site <= hi)
+
+    # deepest nesting each function is reached at, following direct calls
+    depth = {}
+    stack = [(update, 0, ())] if update is not None else []
+    while stack:
+        start, d, path = stack.pop()
+        if depth.get(start, -1) >= d or start in path:
+            continue
+        depth[start] = d
+        for site, target in results[start][0]:
+            if target in by_start:
+                stack.append((target, d + loop_depth(start, site), path + (start,)))
+
+    rows = []
+    for start, d in depth.items():
+        for site, path in results[start][1]:
+            rows.append((d + loop_depth(start, site), by_start[start][2], site, path))
+    rows.sort(key=lambda r: (-r[0], r[1], r[2]))
+    return update, rows, len(depth)
+
+
+def read_input(path):
+    """Reads a pdex.bin, or a linked pdex.elf with elf2pdex.py, and returns
+    (pdex, functions); an ELF's own function symbols name what it can."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:4] != b'\x7fELF':
+        pdex = pdex2elf.read_pdex(path)
+        return pdex, pdex2elf.recover_functions(pdex)
+
+    import elf2pdex
+    image, memsz, entry, relocations = elf2pdex.read_elf(data)
+    pdex = pdex2elf.Pdex()
+    pdex.filesz, pdex.memsz, pdex.entry, pdex.relnum = len(image), memsz, entry, len(relocations)
+    pdex.data = image + b''.join(struct.pack('<I', r) for r in relocations)
+    names = elf_function_names(data)
+    functions = [(start, size, names.get(start, name)) for start, size, name in pdex2elf.recover_functions(pdex)]
+    return pdex, functions
+
+
+def elf_function_names(data):
+    e_shoff, = struct.unpack_from('<I', data, 32)
+    e_shentsize, e_shnum = struct.unpack_from('<HH', data, 46)
+    sections = [struct.unpack_from('<10I', data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+    names = {}
+    for _, sh_type, _, _, sh_offset, sh_size, sh_link, _, _, _ in sections:
+        if sh_type != 2:  # SHT_SYMTAB
+            continue
+        strtab = sections[sh_link][4]
+        for st_name, st_value, _, st_info, _, _ in struct.iter_unpack('<IIIBBH', data[sh_offset:sh_offset + sh_size]):
+            if st_info & 0xf == 2 and st_name:  # STT_FUNC
+                name = data[strtab + st_name:data.index(b'\0', strtab + st_name)].decode()
+                names.setdefault(st_value & ~1, name)
+    return names
+
+
+def print_report(update, rows, reachable, functions, limit):
+    names = {f[0]: f[2] for f in functions}
+    if update is None:
+        print('No setUpdateCallback call with a known function found.')
+        return
+    print('Update callback: {} ({} functions reachable, {} API call sites)'.format(
+        names[update], reachable, len(rows)))
+    if not rows:
+        return
+    print('')
+    print('{:>5}  {:<24} {:>8}  {}'.format('depth', 'function', 'site', 'call'))
+    for d, function, site, path in rows[:limit]:
+        print('{:>5}  {:<24} {:>8x}  {}'.format(d, function, site, path))
+
+    totals = {}
+    for d, _, _, path in rows:
+        count, deepest = totals.get(path, (0, 0))
+        totals[path] = (count + 1, max(deepest, d))
+    print('')
+    print('{:>5}  {:>5}  {}'.format('sites', 'depth', 'call'))
+    for path, (count, deepest) in sorted(totals.items(), key=lambda t: (-t[1][1], -t[1][0], t[0])):
+        print('{:>5}  {:>5}  {}'.format(count, deepest, path))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdapiscan.py',
+        description='Lists the Playdate API calls reachable from the update callback of a pdex.bin.'
+    )
+    parser.add_argument('path', help='the path to the pdex.bin, or a linked pdex.elf')
+    parser.add_argument('--api', default=API_HEADER, help='the api.h to take member offsets from')
+    parser.add_argument('-n', '--limit', type=int, default=50, help='call sites to list (default 50)')
+    args = parser.parse_args()
+
+    pdex, functions = read_input(args.path)
+    update, rows, reachable = analyze(pdex, functions, read_api_tables(args.api))
+    print_report(update, rows, reachable, functions, args.limit)
@@ -0,0 +1,148 @@
+import argparse
+import json
+import os
+import struct
+
+# value types match json_value_type in deps/playdate/api.h
+JSON_NULL = 0
+JSON_TRUE = 1
+JSON_FALSE = 2
+JSON_INTEGER = 3
+JSON_FLOAT = 4
+JSON_STRING = 5
+JSON_ARRAY = 6
+JSON_TABLE = 7
+
+BAKE_MAGIC = b'PDBK'
+BAKE_VERSION = 1
+BAKE_HEADER_SIZE = 16
+
+
+def fnv1a(data):
+    h = 0x811c9dc5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xffffffff
+    return h
+
+
+class Baker:
+    def __init__(self):
+        self.body = bytearray(BAKE_HEADER_SIZE)
+        self.strings = bytearray()
+        self.interned = {}
+        self.string_fixups = []
+
+    def intern(self, s):
+        data = s.encode()
+        if data not in self.interned:
+            self.interned[data] = len(self.strings)
+            self.strings += data + b'\0'
+        return self.interned[data]
+
+    def align(self):
+        self.body += b'\0' * (-len(self.body) % 4)
+
+    def value(self, v):
+        # returns the 8 byte encoding of v; containers are laid out first
+        if v is None:
+            return bytes([JSON_NULL, 0, 0, 0]) + b'\0\0\0\0', None
+        if v is True:
+            return bytes([JSON_TRUE, 0, 0, 0]) + b'\0\0\0\0', None
+        if v is False:
+            return bytes([JSON_FALSE, 0, 0, 0]) + b'\0\0\0\0', None
+        if isinstance(v, int) and -(1 << 31) <= v < (1 << 31):
+            return bytes([JSON_INTEGER, 0, 0, 0]) + v.to_bytes(4, byteorder='little', signed=True), None
+        if isinstance(v, (int, float)):
+            return bytes([JSON_FLOAT, 0, 0, 0]) + struct.pack('<f', float(v)), None
+        if isinstance(v, str):
+            # string offsets are relative to the pool, patched once its position is known
+            return bytes([JSON_STRING, 0, 0, 0]) + self.intern(v).to_bytes(4, byteorder='little'), 'string'
+        if isinstance(v, list):
+            return bytes([JSON_ARRAY, 0, 0, 0]) + self.array(v).to_bytes(4, byteorder='little'), None
+        if isinstance(v, dict):
+            return bytes([JSON_TABLE, 0, 0, 0]) + self.table(v).to_bytes(4, byteorder='little'), None
+        raise ValueError('cannot bake {!r}'.format(v))
+
+    def emit(self, encoded):
+        data, fixup = encoded
+        if fixup == 'string':
+            self.string_fixups.append(len(self.body) + 4)
+        self.body += data
+
+    def array(self, items):
+        encoded = [self.value(item) for item in items]
+        self.align()
+        at = len(self.body)
+        self.body += len(items).to_bytes(4, byteorder='little')
+        for e in encoded:
+            self.emit(e)
+        return at
+
+    def table(self, items):
+        # entries sorted by key hash so lookups can binary search
+        keys = sorted(items.keys(), key=lambda k: (fnv1a(k.encode()), k))
+        encoded = [(k, self.value(items[k])) for k in keys]
+        self.align()
+        at = len(self.body)
+        self.body += len(keys).to_bytes(4, byteorder='little')
+        for k, e in encoded:
+            self.string_fixups.append(len(self.body))
+            self.body += self.intern(k).to_bytes(4, byteorder='little')
+            self.body += fnv1a(k.encode()).to_bytes(4, byteorder='little')
+            self.emit(e)
+        return at
+
+    def bake(self, doc):
+        root = self.value(doc)
+        self.align()
+        root_at = len(self.body)
+        self.emit(root)
+        self.align()
+
+        pool = len(self.body)
+        for at in self.string_fixups:
+            offset = int.from_bytes(self.body[at:at + 4], byteorder='little') + pool
+            self.body[at:at + 4] = offset.to_bytes(4, byteorder='little')
+        self.body += self.strings
+        self.body += b'\0' * (-len(self.body) % 4)
+
+        self.body[0:4] = BAKE_MAGIC
+        self.body[4:6] = BAKE_VERSION.to_bytes(2, byteorder='little')
+        self.body[8:12] = root_at.to_bytes(4, byteorder='little')
+        self.body[12:16] = len(self.body).to_bytes(4, byteorder='little')
+        return bytes(self.body)
+
+
+def bake_file(path, remove):
+    with open(path, 'rb') as f:
+        doc = json.loads(f.read().decode('utf-8'))
+    blob = Baker().bake(doc)
+    out = os.path.splitext(path)[0] + '.pdbk'
+    with open(out, 'wb') as f:
+        f.write(blob)
+    if remove:
+        os.remove(path)
+    return len(blob)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdbake.py',
+        description='Compiles JSON files into binary blobs read in place by src/baked.c.'
+    )
+    parser.add_argument('paths', nargs='+', help='JSON files or directories to bake')
+    parser.add_argument('--remove', action='store_true', help='delete the source JSON afterwards')
+    args = parser.parse_args()
+
+    files = []
+    for path in args.paths:
+        if os.path.isdir(path):
+            for dirpath, _, filenames in os.walk(path):
+                files += [os.path.join(dirpath, f) for f in sorted(filenames) if f.endswith('.json')]
+        else:
+            files.append(path)
+
+    for path in files:
+        raw = os.path.getsize(path)
+        size = bake_file(path, args.remove)
+        print('{}: {} -> {} bytes'.format(path, raw, size))
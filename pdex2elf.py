@@ -1,363 +1,471 @@
 import argparse
+import concurrent.futures
 import hashlib
+import json
+import os
+import struct
 import zlib
 
+CHUNK_SIZE = 1 << 16
+CACHE_FILE = '.pdex2elf-cache.json'
+CACHE_VERSION = 2  # bump when the ELF layout changes so cached outputs are redone
+
+ELF_TEXT_OFFSET = 0x10000
+
+
+class Pdex:
+    """A parsed pdex.bin: the header fields and the decompressed payload,
+    which is the text image followed by relnum little-endian u32 offsets."""
+
+    def __init__(self):
+        self.version = None
+        self.magic = None
+        self.flags = 0
+        self.checksum = None
+        self.filesz = 0
+        self.memsz = 0
+        self.entry = 0
+        self.relnum = 0
+        self.data = b''
+        self.computed_checksum = None
+        self.functions = []
+
+    @property
+    def text(self):
+        return self.data[:self.filesz]
+
+    def relocations(self):
+        end = self.filesz + 4 * self.relnum
+        return [r[0] for r in struct.iter_unpack('<I', self.data[self.filesz:end])]
+
+
+def read_header(f):
+    """Reads the header of the pdex.bin at the current position of f,
+    leaving f at the start of the payload."""
+    pdex = Pdex()
+    magic = f.read(12)
+    if magic in [b'Playdate PDX', b'Playdate BIN']:
+        pdex.flags = int.from_bytes(f.read(4), byteorder='little')
+        if pdex.flags & 0x40000000:
+            raise ValueError('the specified pdex.bin is encrypted')
+        pdex.version = '2.0'
+        pdex.magic = magic
+        pdex.checksum = f.read(16)
+        pdex.filesz, pdex.memsz, pdex.entry, pdex.relnum = struct.unpack('<4I', f.read(16))
+    else:
+        pdex.entry = int.from_bytes(magic[:4], byteorder='little') - 0x6000000c
+        pdex.filesz = int.from_bytes(magic[4:8], byteorder='little') - 0x6000000c
+        pdex.memsz = int.from_bytes(magic[8:], byteorder='little') - 0x6000000c
+        if pdex.entry < 0 or pdex.filesz < 0 or pdex.memsz < 0:
+            raise ValueError('the specified file is not a pdex.bin')
+        pdex.version = '1.0'
+    return pdex
+
+
+def read_pdex(path):
+    """Parses a pdex.bin, inflating a v2 payload chunk by chunk and hashing
+    the text as it arrives rather than holding the compressed file too."""
+    with open(path, 'rb') as f:
+        pdex = read_header(f)
+        md5 = hashlib.md5()
+        if pdex.version == '2.0':
+            inflater = zlib.decompressobj()
+            data = bytearray()
+            while True:
+                chunk = f.read(CHUNK_SIZE)
+                if not chunk:
+                    break
+                block = inflater.decompress(chunk)
+                if len(data) < pdex.filesz:
+                    md5.update(block[:pdex.filesz - len(data)])
+                data += block
+            tail = inflater.flush()
+            if len(data) < pdex.filesz:
+                md5.update(tail[:pdex.filesz - len(data)])
+            data += tail
+            pdex.data = bytes(data)
+            pdex.computed_checksum = md5.hexdigest()
+        else:
+            pdex.data = f.read()
+    return pdex
+
+
+def print_info(pdex):
+    print('pdex.bin info:')
+    print('  Version:           {}'.format(pdex.version))
+    if pdex.magic is not None:
+        print('  File signature:    {}'.format(pdex.magic.decode()))
+    print('  Flags:             {}'.format(pdex.flags))
+    if pdex.checksum is not None:
+        print('  Declared checksum: {}'.format(pdex.checksum.hex()))
+        print('  Computed checksum: {}'.format(pdex.computed_checksum))
+    print('  Entry point:       {}'.format(pdex.entry))
+    print('  File size:         {}'.format(pdex.filesz))
+    print('  Memory size:       {}'.format(pdex.memsz))
+    print('  Relocations:       {}'.format(pdex.relnum))
+    if pdex.functions:
+        print('  Functions:         {}'.format(len(pdex.functions)))
+
+
+# ==== Function recovery ====
+
+def halfword(text, addr):
+    return text[addr] | (text[addr + 1] << 8)
+
+
+def is_32bit(hw):
+    return (hw >> 11) in (0x1d, 0x1e, 0x1f)
+
+
+def bl_target(addr, hw1, hw2):
+    """Target of the Thumb-2 BL at addr, or None if it is not one."""
+    if hw1 & 0xf800 != 0xf000 or hw2 & 0xd000 != 0xd000:
+        return None
+    s = (hw1 >> 10) & 1
+    i1 = 1 - (((hw2 >> 13) & 1) ^ s)
+    i2 = 1 - (((hw2 >> 11) & 1) ^ s)
+    imm = (s << 24) | (i1 << 23) | (i2 << 22) | ((hw1 & 0x3ff) << 12) | ((hw2 & 0x7ff) << 1)
+    if s:
+        imm -= 1 << 25
+    return addr + 4 + imm
+
+
+def _is_prologue(hw1, hw2):
+    # push {..., lr} or push.w {..., lr}
+    return hw1 & 0xff00 == 0xb500 or (hw1 == 0xe92d and hw2 & 0x4000)
+
+
+def _ends_flow(hw1, hw2):
+    """True for instructions control never falls through: returns, tail
+    branches, and the nops and zero padding the linker puts between functions."""
+    if hw1 in (0x4770, 0xbf00, 0x0000) or hw1 & 0xff00 == 0xbd00 or hw1 & 0xf800 == 0xe000:
+        return True
+    if hw1 == 0xe8bd and hw2 & 0x8000:  # pop.w {..., pc}
+        return True
+    return hw1 & 0xf800 == 0xf000 and hw2 & 0xd000 == 0x9000  # b.w
+
+
+def recover_functions(pdex):
+    """Finds function starts in the text from the entry point, BL targets,
+    Thumb function pointers stored at relocated words, and push {..., lr}
+    prologues that follow the end of a previous function. Returns sorted
+    (address, size, name) tuples; a function ends after the last return or
+    tail branch before the next start, which leaves literal pools out."""
+    text = pdex.text
+    size = len(text) & ~1
+    starts = {pdex.entry & ~1: 'eventHandler'} if pdex.entry < size else {}
+
+    for offset in pdex.relocations():
+        if offset + 4 <= size:
+            value = struct.unpack_from('<I', text, offset)[0]
+            if value & 1 and value < size:
+                starts.setdefault(value & ~1, None)
+
+    # linear sweep; data in the text desynchronises it only briefly
+    flow_ends = []
+    prev_ends = True
+    addr = 0
+    while addr + 2 <= size:
+        hw1 = halfword(text, addr)
+        wide = is_32bit(hw1) and addr + 4 <= size
+        hw2 = halfword(text, addr + 2) if wide else 0
+        if wide:
+            target = bl_target(addr, hw1, hw2)
+            if target is not None and 0 <= target < size:
+                starts.setdefault(target, None)
+        if prev_ends and _is_prologue(hw1, hw2):
+            starts.setdefault(addr, None)
+        addr += 4 if wide else 2
+        prev_ends = _ends_flow(hw1, hw2)
+        if prev_ends and hw1 not in (0xbf00, 0x0000):
+            flow_ends.append(addr)
+
+    functions = []
+    ordered = sorted(starts)
+    end_index = 0
+    for i, start in enumerate(ordered):
+        limit = ordered[i + 1] if i + 1 < len(ordered) else size
+        while end_index < len(flow_ends) and flow_ends[end_index] <= start:
+            end_index += 1
+        end = limit
+        j = end_index
+        while j < len(flow_ends) and flow_ends[j] <= limit:
+            end = flow_ends[j]
+            j += 1
+        functions.append((start, end - start, starts[start] or 'sub_{:x}'.format(start)))
+    return functions
+
+
+def _pad(out, offset):
+    out += b'\x00' * (offset - len(out))
+
+
+def build_elf(pdex, functions=()):
+    """Returns the ELF image for pdex as one bytes object. functions, from
+    recover_functions(), become STT_FUNC symbols after a $t mapping symbol."""
+    text_index = 1
+    text_addr = 0
+    text_offset = ELF_TEXT_OFFSET
+    text_size = pdex.filesz
+
+    bss_index = 2
+    bss_addr = (pdex.filesz + 3) & ~3
+    bss_offset = text_offset + bss_addr
+    bss_size = pdex.memsz - pdex.filesz
+
+    rel_text_index = 3
+    rel_text_offset = bss_offset
+    rel_text_size = pdex.relnum * 8
+
+    symtab_index = 4
+    symtab_offset = (rel_text_offset + rel_text_size + 3) & ~3
+    # NULL, .text, then $t and the functions, eventHandler last as the only global
+    local_functions = [f for f in functions if f[2] != 'eventHandler']
+    global_functions = [f for f in functions if f[2] == 'eventHandler']
+    symbol_count = 2 + (1 + len(functions) if functions else 0)
+    first_global = symbol_count - len(global_functions)
+    symtab_size = symbol_count * 16
+
+    strtab_index = 5
+    strtab_data = b'\0'
+    if functions:
+        names = [b'$t'] + [f[2].encode() for f in local_functions + global_functions]
+        name_offsets = []
+        for n in names:
+            name_offsets.append(len(strtab_data))
+            strtab_data += n + b'\0'
+    strtab_offset = symtab_offset + symtab_size
+    strtab_size = len(strtab_data)
+
+    shstrtab_index = 6
+    shstrtab_data = b'\0.text\0.bss\0.rel.text\0.symtab\0.strtab\0.shstrtab\0'
+    shstrtab_offset = strtab_offset + strtab_size
+    shstrtab_size = len(shstrtab_data)
+
+    sh_offset = (shstrtab_offset + shstrtab_size + 3) & ~3
+
+    def name(section):
+        return shstrtab_data.index(b'\0' + section + b'\0') + 1
+
+    out = bytearray()
+
+    # ==== ELF header ====
+
+    out += struct.pack(
+        '<4sBBBBB7sHHIIIIIHHHHHH',
+        b'\x7fELF',
+        1,              # EI_CLASS: ELFCLASS32
+        1,              # EI_DATA: ELFDATA2LSB
+        1,              # EI_VERSION: EV_CURRENT
+        0,              # EI_OSABI: ELFOSABI_SYSV
+        0,              # EI_ABIVERSION
+        b'',            # EI_PAD
+        2,              # e_type: ET_EXEC
+        0x28,           # e_machine: EM_ARM
+        1,              # e_version: EV_CURRENT
+        pdex.entry,     # e_entry
+        0x34,           # e_phoff
+        sh_offset,      # e_shoff
+        0x05000400,     # e_flags: EF_ARM_EABI_VER5 | EF_ARM_ABI_FLOAT_HARD
+        0x34,           # e_ehsize
+        0x20,           # e_phentsize
+        1,              # e_phnum
+        0x28,           # e_shentsize
+        7,              # e_shnum
+        shstrtab_index  # e_shstrndx
+    )
+
+    # ==== Program header ====
+
+    out += struct.pack(
+        '<8I',
+        1,            # p_type: PT_LOAD
+        text_offset,  # p_offset
+        0,            # p_vaddr
+        0,            # p_paddr
+        pdex.filesz,  # p_filesz
+        pdex.memsz,   # p_memsz
+        7,            # p_flags: PF_X | PF_W | PF_R
+        text_offset   # p_align
+    )
+
+    # ==== .text section ====
+
+    _pad(out, text_offset)
+    out += pdex.data[:pdex.filesz]
+
+    # ==== .rel.text section ====
+
+    _pad(out, rel_text_offset)
+    r_info = struct.pack('<I', 2 | (text_index << 8))  # R_ARM_ABS32 against symbol 1
+    relocs = pdex.data[pdex.filesz:pdex.filesz + 4 * pdex.relnum]
+    out += b''.join(relocs[i:i + 4] + r_info for i in range(0, len(relocs), 4))
+
+    # ==== .symtab section ====
+
+    _pad(out, symtab_offset)
+    out += struct.pack('<IIIBBH', 0, 0, 0, 0, 0, 0)  # NULL
+    out += struct.pack(
+        '<IIIBBH',
+        text_addr,  # st_name
+        0,          # st_value
+        0,          # st_size
+        3,          # st_info: STB_LOCAL, STT_SECTION
+        0,          # st_other
+        text_index  # st_shndx
+    )
+    if functions:
+        out += struct.pack('<IIIBBH', name_offsets[0], 0, 0, 0, 0, text_index)  # $t: STB_LOCAL, STT_NOTYPE
+        for i, (addr, size, _) in enumerate(local_functions + global_functions):
+            binding = 1 if i >= len(local_functions) else 0  # STB_GLOBAL or STB_LOCAL
+            # st_value has the Thumb bit set, st_info is STT_FUNC
+            out += struct.pack('<IIIBBH', name_offsets[i + 1], addr | 1, size, (binding << 4) | 2, 0, text_index)
+
+    # ==== .strtab and .shstrtab sections ====
+
+    out += strtab_data
+    out += shstrtab_data
+
+    # ==== Section headers ====
+
+    # sh_name, sh_type, sh_flags, sh_addr, sh_offset, sh_size, sh_link, sh_info, sh_addralign, sh_entsize
+    _pad(out, sh_offset)
+    sections = [
+        (0, 0, 0, 0, 0, 0, 0, 0, 0, 0),  # NULL
+        # SHT_PROGBITS, SHF_WRITE | SHF_ALLOC | SHF_EXECINSTR | SHF_MERGE | SHF_STRINGS
+        (name(b'.text'), 1, 0x37, text_addr, text_offset, text_size, 0, 0, 8, 0),
+        # SHT_NOBITS, SHF_WRITE | SHF_ALLOC
+        (name(b'.bss'), 8, 0x03, bss_addr, bss_offset, bss_size, 0, 0, 4, 0),
+        # SHT_REL, SHF_INFO_LINK
+        (name(b'.rel.text'), 9, 0x40, 0, rel_text_offset, rel_text_size, symtab_index, text_index, 4, 8),
+        # SHT_SYMTAB
+        (name(b'.symtab'), 2, 0, 0, symtab_offset, symtab_size, strtab_index, first_global, 4, 16),
+        # SHT_STRTAB
+        (name(b'.strtab'), 3, 0, 0, strtab_offset, strtab_size, 0, 0, 1, 0),
+        # SHT_STRTAB
+        (name(b'.shstrtab'), 3, 0, 0, shstrtab_offset, shstrtab_size, 0, 0, 1, 0),
+    ]
+    for section in sections:
+        out += struct.pack('<10I', *section)
+
+    return bytes(out)
+
+
+def convert(pdex_path, elf_path, symbols=True):
+    pdex = read_pdex(pdex_path)
+    pdex.functions = recover_functions(pdex) if symbols else []
+    with open(elf_path, 'wb') as elf:
+        elf.write(build_elf(pdex, pdex.functions))
+    return pdex
+
+
+# ==== Batch mode ====
+
+def header_checksum(path):
+    """The MD5 a v2 header declares, or the MD5 of a v1 file; cheap enough
+    to decide whether a cached conversion is still good."""
+    with open(path, 'rb') as f:
+        pdex = read_header(f)
+        if pdex.checksum is not None:
+            return pdex.checksum.hex()
+        f.seek(0)
+        return hashlib.md5(f.read()).hexdigest()
+
+
+def find_pdex(roots, out_dir):
+    """Yields (pdex.bin, output ELF) pairs for files and directory trees,
+    mirroring each tree's layout under out_dir."""
+    for root in roots:
+        if os.path.isfile(root):
+            # Game.pdx/pdex.bin becomes Game.elf, anything else keeps its name
+            path = os.path.abspath(root)
+            if os.path.basename(path) == 'pdex.bin':
+                path = os.path.dirname(path)
+            yield root, os.path.join(out_dir, os.path.splitext(os.path.basename(path))[0] + '.elf')
+            continue
+        for dirpath, _, filenames in os.walk(root):
+            for filename in sorted(filenames):
+                if filename != 'pdex.bin':
+                    continue
+                rel = os.path.relpath(dirpath, os.path.dirname(os.path.normpath(root)))
+                yield os.path.join(dirpath, filename), os.path.join(out_dir, rel, 'pdex.elf')
+
+
+def _batch_job(job):
+    pdex_path, elf_path, symbols = job
+    try:
+        os.makedirs(os.path.dirname(elf_path) or '.', exist_ok=True)
+        pdex = convert(pdex_path, elf_path, symbols)
+        return pdex_path, elf_path, None, pdex.filesz
+    except (OSError, ValueError, zlib.error) as e:
+        return pdex_path, elf_path, str(e), 0
+
+
+def batch(roots, out_dir, jobs, force, symbols=True):
+    cache_path = os.path.join(out_dir, CACHE_FILE)
+    try:
+        with open(cache_path) as f:
+            cache = json.load(f)
+        if cache.get('version') != CACHE_VERSION:
+            cache = {}
+    except (OSError, ValueError):
+        cache = {}
+    entries = cache.get('entries', {})
+
+    todo, skipped, failed = [], 0, 0
+    checksums = {}
+    for pdex_path, elf_path in find_pdex(roots, out_dir):
+        try:
+            checksums[elf_path] = header_checksum(pdex_path) + ('' if symbols else '-nosymbols')
+        except (OSError, ValueError) as e:
+            print('{}: {}'.format(pdex_path, e))
+            failed += 1
+            continue
+        if not force and entries.get(elf_path) == checksums[elf_path] and os.path.exists(elf_path):
+            skipped += 1
+            continue
+        todo.append((pdex_path, elf_path, symbols))
+
+    converted = 0
+    with concurrent.futures.ProcessPoolExecutor(max_workers=jobs) as pool:
+        for pdex_path, elf_path, error, size in pool.map(_batch_job, todo):
+            if error:
+                print('{}: {}'.format(pdex_path, error))
+                entries.pop(elf_path, None)
+                failed += 1
+            else:
+                print('{} -> {} ({} bytes of code)'.format(pdex_path, elf_path, size))
+                entries[elf_path] = checksums[elf_path]
+                converted += 1
+
+    os.makedirs(out_dir, exist_ok=True)
+    with open(cache_path, 'w') as f:
+        json.dump({'version': CACHE_VERSION, 'entries': entries}, f, indent=1, sort_keys=True)
+    print('{} converted, {} unchanged, {} failed'.format(converted, skipped, failed))
+    return 1 if failed else 0
+
+
 if __name__ == '__main__':
     parser = argparse.ArgumentParser(
         prog='pdex2elf.py',
         description='Converts a Playdate pdex.bin file to an ELF file.'
     )
-    parser.add_argument('pdex', help='the path to the input pdex.bin')
-    parser.add_argument('elf', help='the path to the output ELF file')
+    parser.add_argument('paths', nargs='+', metavar='path',
+                        help='pdex.bin and output ELF, or with --batch the files and directories to convert')
+    parser.add_argument('--batch', metavar='OUT_DIR',
+                        help='convert every pdex.bin under the given paths into OUT_DIR')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(), help='parallel conversions in batch mode')
+    parser.add_argument('--force', action='store_true', help='ignore the batch cache and convert everything')
+    parser.add_argument('--no-symbols', dest='symbols', action='store_false',
+                        help='skip function recovery and emit only the .text section symbol')
     args = parser.parse_args()
 
-    with open(args.pdex, 'rb') as pdex:
-        pdex_magic = pdex.read(12)
-        if pdex_magic in [b'Playdate PDX', b'Playdate BIN']:
-            pdex_flags = int.from_bytes(pdex.read(4), byteorder='little')
-            if pdex_flags & 0x40000000:
-                raise ValueError('the specified pdex.bin is encrypted')
-            pdex_version = '2.0'
-            pdex_checksum = pdex.read(16)
-            pdex_filesz = int.from_bytes(pdex.read(4), byteorder='little')
-            pdex_memsz = int.from_bytes(pdex.read(4), byteorder='little')
-            pdex_entry = int.from_bytes(pdex.read(4), byteorder='little')
-            pdex_relnum = int.from_bytes(pdex.read(4), byteorder='little')
-            pdex_data = zlib.decompress(pdex.read())
-        else:
-            pdex_entry = int.from_bytes(pdex_magic[:4], byteorder='little') - 0x6000000c
-            pdex_filesz = int.from_bytes(pdex_magic[4:8], byteorder='little') - 0x6000000c
-            pdex_memsz = int.from_bytes(pdex_magic[8:], byteorder='little') - 0x6000000c
-            if pdex_entry < 0 or pdex_filesz < 0 or pdex_memsz < 0:
-                raise ValueError('the specified file is not a pdex.bin')
-            pdex_version = '1.0'
-            pdex_magic = None
-            pdex_flags = 0
-            pdex_relnum = 0
-            pdex_checksum = None
-            pdex_data = pdex.read()
-
-    print('pdex.bin info:')
-    print('  Version:           {}'.format(pdex_version))
-    if pdex_magic is not None:
-        print('  File signature:    {}'.format(pdex_magic.decode()))
-    print('  Flags:             {}'.format(pdex_flags))
-    if pdex_checksum is not None:
-        print('  Declared checksum: {}'.format(pdex_checksum.hex()))
-        print('  Computed checksum: {}'.format(hashlib.md5(pdex_data[:pdex_filesz]).hexdigest()))
-    print('  Entry point:       {}'.format(pdex_entry))
-    print('  File size:         {}'.format(pdex_filesz))
-    print('  Memory size:       {}'.format(pdex_memsz))
-    print('  Relocations:       {}'.format(pdex_relnum))
-
-    with open(args.elf, 'wb') as elf:
-        text_index = 1
-        text_addr = 0
-        text_offset = 0x10000
-        text_size = pdex_filesz
-
-        bss_index = 2
-        bss_addr = (pdex_filesz + 3) & ~3
-        bss_offset = text_offset + bss_addr
-        bss_size = pdex_memsz - pdex_filesz
-
-        rel_text_index = 3
-        rel_text_offset = bss_offset
-        rel_text_size = pdex_relnum * 8
-
-        symtab_index = 4
-        symtab_offset = (rel_text_offset + rel_text_size + 3) & ~3
-        symtab_size = 2 * 16
-
-        strtab_index = 5
-        strtab_data = b'\0'
-        strtab_offset = symtab_offset + symtab_size
-        strtab_size = len(strtab_data)
-
-        shstrtab_index = 6
-        shstrtab_data = b'\0.text\0.bss\0.rel.text\0.symtab\0.strtab\0.shstrtab\0'
-        shstrtab_offset = strtab_offset + strtab_size
-        shstrtab_size = len(shstrtab_data)
-
-        sh_offset = (shstrtab_offset + shstrtab_size + 3) & ~3
-
-        # ==== ELF header ====
-
-        # e_ident[EI_MAG0..EI_MAG3]
-        elf.write(b'\x7fELF')
-        # e_ident[EI_CLASS]
-        elf.write(b'\x01') # ELFCLASS32
-        # e_ident[EI_DATA]
-        elf.write(b'\x01') # ELFDATA2LSB
-        # e_ident[EI_VERSION]
-        elf.write(b'\x01') # EV_CURRENT
-        # e_ident[EI_OSABI]
-        elf.write(b'\x00') # ELFOSABI_SYSV
-        # e_ident[EI_ABIVERSION]
-        elf.write(b'\x00')
-        # e_ident[EI_PAD..(EI_NIDENT - 1)]
-        elf.write(b'\x00\x00\x00\x00\x00\x00\x00')
-        # e_type
-        elf.write(b'\x02\x00') # ET_EXEC
-        # e_machine
-        elf.write(b'\x28\x00') # EM_ARM
-        # e_version
-        elf.write(b'\x01\x00\x00\x00') # EV_CURRENT
-        # e_entry
-        elf.write(pdex_entry.to_bytes(4, byteorder='little'))
-        # e_phoff
-        elf.write(b'\x34\x00\x00\x00')
-        # e_shoff
-        elf.write(sh_offset.to_bytes(4, byteorder='little'))
-        # e_flags
-        elf.write(b'\x00\x04\x00\x05') # EF_ARM_EABI_VER5 | EF_ARM_ABI_FLOAT_HARD
-        # e_ehsize
-        elf.write(b'\x34\x00')
-        # e_phentsize
-        elf.write(b'\x20\x00')
-        # e_phnum
-        elf.write(b'\x01\x00')
-        # e_shentsize
-        elf.write(b'\x28\x00')
-        # e_shnum
-        elf.write(b'\x07\x00')
-        # e_shstrndx
-        elf.write(shstrtab_index.to_bytes(2, byteorder='little'))
-
-        # ==== Program header ====
-
-        # p_type
-        elf.write(b'\x01\x00\x00\x00') # PT_LOAD
-        # p_offset
-        elf.write(text_offset.to_bytes(4, byteorder='little'))
-        # p_vaddr
-        elf.write(b'\x00\x00\x00\x00')
-        # p_paddr
-        elf.write(b'\x00\x00\x00\x00')
-        # p_filesz
-        elf.write(pdex_filesz.to_bytes(4, byteorder='little'))
-        # p_memsz
-        elf.write(pdex_memsz.to_bytes(4, byteorder='little'))
-        # p_flags
-        elf.write(b'\x07\x00\x00\x00') # PF_X | PF_W | PF_R
-        # p_align
-        elf.write(text_offset.to_bytes(4, byteorder='little'))
-
-        # ==== .text section ====
-
-        elf.write(b'\x00' * (text_offset - elf.tell()))
-
-        elf.write(pdex_data[:pdex_filesz])
-
-        # ==== .rel.text section ====
-
-        elf.write(b'\x00' * (rel_text_offset - elf.tell()))
-
-        for i in range(pdex_filesz, pdex_filesz + 4 * pdex_relnum, 4):
-            # r_offset
-            elf.write(pdex_data[i:(i + 4)])
-            # r_info
-            elf.write(b'\x02')
-            elf.write(text_index.to_bytes(2, byteorder='little'))
-            elf.write(b'\x00')
-
-        # ==== .symtab section ====
-
-        elf.write(b'\x00' * (symtab_offset - elf.tell()))
-
-        # NULL
-        # st_name
-        elf.write(b'\x00\x00\x00\x00')
-        # st_value
-        elf.write(b'\x00\x00\x00\x00')
-        # st_size
-        elf.write(b'\x00\x00\x00\x00')
-        # st_info
-        elf.write(b'\x00') # STB_LOCAL, STT_NOTYPE
-        # st_other
-        elf.write(b'\x00')
-        # st_shndx
-        elf.write(b'\x00\x00')
-
-        # .text
-        # st_name
-        elf.write(text_addr.to_bytes(4, byteorder='little'))
-        # st_value
-        elf.write(b'\x00\x00\x00\x00')
-        # st_size
-        elf.write(b'\x00\x00\x00\x00')
-        # st_info
-        elf.write(b'\x03') # STB_LOCAL, STT_SECTION
-        # st_other
-        elf.write(b'\x00')
-        # st_shndx
-        elf.write(text_index.to_bytes(2, byteorder='little'))
-
-        # ==== .strtab section ====
-
-        elf.write(strtab_data)
-
-        # ==== .shstrtab section ====
-
-        elf.write(shstrtab_data)
-
-        # ==== Section headers ====
-
-        elf.write(b'\x00' * (sh_offset - elf.tell()))
-
-        # NULL
-        # sh_name
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_type
-        elf.write(b'\x00\x00\x00\x00') # SHT_NULL
-        # sh_flags
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addr
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_offset
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_size
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_link
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_info
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addralign
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x00\x00\x00\x00')
-
-        # .text
-        # sh_name
-        elf.write((shstrtab_data.index(b'\0.text\0') + 1).to_bytes(4, byteorder='little'))
-        # sh_type
-        elf.write(b'\x01\x00\x00\x00') # SHT_PROGBITS
-        # sh_flags
-        elf.write(b'\x37\x00\x00\x00') # SHF_WRITE | SHF_ALLOC | SHF_EXECINSTR | SHF_MERGE | SHF_STRINGS
-        # sh_addr
-        elf.write(text_addr.to_bytes(4, byteorder='little'))
-        # sh_offset
-        elf.write(text_offset.to_bytes(4, byteorder='little'))
-        # sh_size
-        elf.write(text_size.to_bytes(4, byteorder='little'))
-        # sh_link
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_info
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addralign
-        elf.write(b'\x08\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x00\x00\x00\x00')
-
-        # .bss
-        # sh_name
-        elf.write((shstrtab_data.index(b'\0.bss\0') + 1).to_bytes(4, byteorder='little'))
-        # sh_type
-        elf.write(b'\x08\x00\x00\x00') # SHT_NOBITS
-        # sh_flags
-        elf.write(b'\x03\x00\x00\x00') # SHF_WRITE | SHF_ALLOC
-        # sh_addr
-        elf.write(bss_addr.to_bytes(4, byteorder='little'))
-        # sh_offset
-        elf.write(bss_offset.to_bytes(4, byteorder='little'))
-        # sh_size
-        elf.write(bss_size.to_bytes(4, byteorder='little'))
-        # sh_link
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_info
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addralign
-        elf.write(b'\x04\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x00\x00\x00\x00')
-
-        # .rel.text
-        # sh_name
-        elf.write((shstrtab_data.index(b'\0.rel.text\0') + 1).to_bytes(4, byteorder='little'))
-        # sh_type
-        elf.write(b'\x09\x00\x00\x00') # SHT_REL
-        # sh_flags
-        elf.write(b'\x40\x00\x00\x00') # SHF_INFO_LINK
-        # sh_addr
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_offset
-        elf.write(rel_text_offset.to_bytes(4, byteorder='little'))
-        # sh_size
-        elf.write(rel_text_size.to_bytes(4, byteorder='little'))
-        # sh_link
-        elf.write(symtab_index.to_bytes(4, byteorder='little'))
-        # sh_info
-        elf.write(text_index.to_bytes(4, byteorder='little'))
-        # sh_addralign
-        elf.write(b'\x04\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x08\x00\x00\x00')
-
-        # .symtab
-        # sh_name
-        elf.write((shstrtab_data.index(b'\0.symtab\0') + 1).to_bytes(4, byteorder='little'))
-        # sh_type
-        elf.write(b'\x02\x00\x00\x00') # SHT_SYMTAB
-        # sh_flags
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addr
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_offset
-        elf.write(symtab_offset.to_bytes(4, byteorder='little'))
-        # sh_size
-        elf.write(symtab_size.to_bytes(4, byteorder='little'))
-        # sh_link
-        elf.write(strtab_index.to_bytes(4, byteorder='little'))
-        # sh_info
-        elf.write(b'\x02\x00\x00\x00')
-        # sh_addralign
-        elf.write(b'\x04\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x10\x00\x00\x00')
-
-        # .strtab
-        # sh_name
-        elf.write((shstrtab_data.index(b'\0.strtab\0') + 1).to_bytes(4, byteorder='little'))
-        # sh_type
-        elf.write(b'\x03\x00\x00\x00') # SHT_STRTAB
-        # sh_flags
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addr
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_offset
-        elf.write(strtab_offset.to_bytes(4, byteorder='little'))
-        # sh_size
-        elf.write(strtab_size.to_bytes(4, byteorder='little'))
-        # sh_link
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_info
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addralign
-        elf.write(b'\x01\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x00\x00\x00\x00')
-
-        # .shstrtab
-        # sh_name
-        elf.write((shstrtab_data.index(b'\0.shstrtab\0') + 1).to_bytes(4, byteorder='little'))
-        # sh_type
-        elf.write(b'\x03\x00\x00\x00') # SHT_STRTAB
-        # sh_flags
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addr
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_offset
-        elf.write(shstrtab_offset.to_bytes(4, byteorder='little'))
-        # sh_size
-        elf.write(shstrtab_size.to_bytes(4, byteorder='little'))
-        # sh_link
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_info
-        elf.write(b'\x00\x00\x00\x00')
-        # sh_addralign
-        elf.write(b'\x01\x00\x00\x00')
-        # sh_entsize
-        elf.write(b'\x00\x00\x00\x00')
+    if args.batch:
+        raise SystemExit(batch(args.paths, args.batch, args.jobs, args.force, args.symbols))
 
+    if len(args.paths) != 2:
+        parser.error('expected a pdex.bin and an output ELF path')
+    pdex_path, elf_path = args.paths
+    print_info(convert(pdex_path, elf_path, args.symbols))
     print('')
-    print("ELF file successfully written to '{}'".format(args.elf))
+    print("ELF file successfully written to '{}'".format(elf_path))
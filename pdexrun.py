@@ -0,0 +1,1594 @@
+import argparse
+import csv
+import math
+import os
+import re
+import struct
+
+import pdapiscan
+import pdex2elf
+
+# Runs a pdex.bin on the host with a Thumb-2 interpreter, for instruction
+# and memory traffic counts that do not depend on the machine running it.
+#
+# The image is loaded at --base with its relocations applied and bss zeroed,
+# then eventHandler gets kEventInit and a PlaydateAPI whose function pointers
+# all lead to trap addresses. A call through one runs a small Python
+# stand-in (see Host) instead: enough of system, graphics, display and file
+# for a game to start and run its frames headless, with every other function
+# returning 0, or a fresh zeroed block for the new*/load*/copy* ones. After
+# init, the function passed to setUpdateCallback runs once per frame.
+#
+# Counts per frame: instructions retired (including conditional ones that
+# did not pass), loads and stores (one per word, halfword or byte moved, so
+# an ldm of four registers is four loads) and API calls. They measure the
+# game's own code; what the API does behind a call is not counted.
+#
+# Covers the ARMv7E-M Thumb-2 instructions GCC emits for the Cortex-M7 and
+# the single-precision FPv5 ones; anything else stops the run with its
+# address, as does a fault.
+
+M32 = 0xffffffff
+
+BASE = 0x60000000         # where the image is loaded, like the device
+STACK_TOP = 0x20040000
+STACK_SIZE = 0x40000
+HEAP_BASE = 0x90000000
+HEAP_SIZE = 16 << 20
+API_BASE = 0x40000000     # the PlaydateAPI tables
+FRAME_BASE = 0x30000000   # the frame and display buffers
+TRAP_BASE = 0xf0000000    # API functions, 4 bytes apart
+EXIT = 0xeffffff0         # lr for calls from the host
+
+LCD_ROWSIZE = 52
+LCD_ROWS = 240
+FRAME_SIZE = LCD_ROWSIZE * LCD_ROWS
+
+kEventInit = 0
+kEventTerminate = 6
+
+_F32 = struct.Struct('<f')
+_U32 = struct.Struct('<I')
+
+
+class Fault(Exception):
+    pass
+
+
+def _sx(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value >> (bits - 1) else value
+
+
+def _float(bits):
+    return _F32.unpack(_U32.pack(bits))[0]
+
+
+def _bits(x):
+    try:
+        return _U32.unpack(_F32.pack(x))[0]
+    except OverflowError:
+        return 0xff800000 if x < 0 else 0x7f800000
+
+
+def _to_int(x, signed, rounding):
+    """VCVT to a 32-bit integer: saturating, NaN becomes 0."""
+    if x != x:
+        return 0
+    if not math.isinf(x):
+        x = rounding(x)
+    lo, hi = (-0x80000000, 0x7fffffff) if signed else (0, M32)
+    return int(max(lo, min(hi, x))) & M32
+
+
+def _round_away(x):
+    return math.floor(x + 0.5) if x >= 0 else math.ceil(x - 0.5)
+
+
+_ROUNDING = (_round_away, round, math.ceil, math.floor)  # VRINTA/N/P/M, VCVTA/N/P/M
+
+
+def _div(a, b):
+    if b == 0:
+        if a == 0 or a != a:
+            return math.nan
+        return math.copysign(math.inf, a) * math.copysign(1, b)
+    return a / b
+
+
+def _sqrt(a):
+    if a != a or a < 0:
+        return math.nan
+    return math.sqrt(a)
+
+
+def _shift_c(value, stype, amount, carry):
+    """Shift() with its carry out; stype 0-3 is LSL, LSR, ASR, ROR and 4 RRX."""
+    if stype == 4:
+        return (carry << 31) | (value >> 1), value & 1
+    if amount == 0:
+        return value, carry
+    if stype == 0:
+        if amount > 32:
+            return 0, 0
+        return (value << amount) & M32, (value >> (32 - amount)) & 1
+    if stype == 1:
+        if amount > 32:
+            return 0, 0
+        return value >> amount, (value >> (amount - 1)) & 1
+    if stype == 2:
+        if amount >= 32:
+            return (M32, 1) if value >> 31 else (0, 0)
+        return (_sx(value, 32) >> amount) & M32, (value >> (amount - 1)) & 1
+    amount &= 31
+    if amount == 0:
+        return value, value >> 31
+    result = ((value >> amount) | (value << (32 - amount))) & M32
+    return result, result >> 31
+
+
+def _expand_imm(imm12):
+    """ThumbExpandImm_C; a None carry leaves the flag as it is."""
+    if imm12 >> 10 == 0:
+        imm8 = imm12 & 0xff
+        kind = (imm12 >> 8) & 3
+        return (imm8, imm8 << 16 | imm8, imm8 << 24 | imm8 << 8, imm8 * 0x01010101)[kind], None
+    value = 0x80 | (imm12 & 0x7f)
+    amount = imm12 >> 7
+    result = ((value >> amount) | (value << (32 - amount))) & M32
+    return result, result >> 31
+
+
+def _decode_imm_shift(stype, imm5):
+    if stype in (1, 2) and imm5 == 0:
+        return stype, 32
+    if stype == 3 and imm5 == 0:
+        return 4, 1
+    return stype, imm5
+
+
+def _vfp_imm(imm8):
+    b = (imm8 >> 6) & 1
+    exponent = ((b ^ 1) << 7) | ((0x1f if b else 0) << 2) | ((imm8 >> 4) & 3)
+    return ((imm8 >> 7) << 31) | (exponent << 23) | ((imm8 & 0xf) << 19)
+
+
+def _register_list(mask):
+    return [n for n in range(16) if mask & (1 << n)]
+
+
+# ==== Memory ====
+
+class Memory:
+    def __init__(self):
+        self.regions = []
+        self.loads = 0
+        self.stores = 0
+        self._last = None
+
+    def map(self, start, size, name):
+        data = bytearray(size)
+        self.regions.append((start, start + size, data, name))
+        return data
+
+    def _find(self, addr, size):
+        region = self._last
+        if region is not None and region[0] <= addr and addr + size <= region[1]:
+            return region
+        for region in self.regions:
+            if region[0] <= addr and addr + size <= region[1]:
+                self._last = region
+                return region
+        raise Fault('access to unmapped address {:#010x}'.format(addr))
+
+    # what the game does, counted
+
+    def load(self, addr, size, signed=False):
+        self.loads += 1
+        start, _, data, _ = self._find(addr, size)
+        return int.from_bytes(data[addr - start:addr - start + size], 'little', signed=signed) & M32
+
+    def store(self, addr, size, value):
+        self.stores += 1
+        start, _, data, _ = self._find(addr, size)
+        data[addr - start:addr - start + size] = (value & ((1 << (size * 8)) - 1)).to_bytes(size, 'little')
+
+    # what the host does on its behalf, not counted
+
+    def read(self, addr, size):
+        start, _, data, _ = self._find(addr, size)
+        return bytes(data[addr - start:addr - start + size])
+
+    def write(self, addr, blob):
+        start, _, data, _ = self._find(addr, len(blob))
+        data[addr - start:addr - start + len(blob)] = blob
+
+    def word(self, addr):
+        return _U32.unpack(self.read(addr, 4))[0]
+
+    def cstring(self, addr):
+        start, end, data, _ = self._find(addr, 1)
+        stop = data.index(0, addr - start)
+        return bytes(data[addr - start:stop]).decode('utf-8', 'replace')
+
+
+# ==== Interpreter ====
+
+class Cpu:
+    def __init__(self, memory, trap):
+        self.mem = memory
+        self.trap = trap  # called with the trap index when pc reaches one
+        self.r = [0] * 16
+        self.n = self.z = self.c = self.v = 0
+        self.s = [0] * 32
+        self.fpscr = 0
+        self.it = []
+        self.in_it = False
+        self.next = 0
+        self.cache = {}
+        self.instructions = 0
+
+    def call(self, addr, args, limit):
+        """Runs the function at addr until it returns to the host; limit
+        bounds the instructions so a hung game stops with an error."""
+        r = self.r
+        for i, value in enumerate(args):
+            r[i] = value & M32
+        r[14] = EXIT | 1
+        pc = addr & ~1
+        count = 0
+        cache = self.cache
+        try:
+            while pc != EXIT:
+                if pc >= TRAP_BASE:
+                    self.trap((pc - TRAP_BASE) >> 2)
+                    pc = r[14] & ~1
+                    continue
+                entry = cache.get(pc)
+                if entry is None:
+                    entry = cache[pc] = self.decode(pc)
+                handler, operands, size = entry
+                r[15] = pc + 4
+                self.next = pc + size
+                if self.it:
+                    self.in_it = True
+                    if self.passed(self.it.pop(0)):
+                        handler(*operands)
+                else:
+                    self.in_it = False
+                    handler(*operands)
+                pc = self.next
+                count += 1
+                if count > limit:
+                    raise Fault('no return after {} instructions'.format(limit))
+        except Fault as e:
+            raise Fault('{} (pc {:#010x}, lr {:#010x})'.format(e, pc, r[14]))
+        finally:
+            self.instructions += count
+        return r[0]
+
+    def passed(self, cond):
+        n, z, c, v = self.n, self.z, self.c, self.v
+        if cond < 8:
+            return (z, not z, c, not c, n, not n, v, not v)[cond]
+        return (c and not z, not c or z, n == v, n != v, not z and n == v, z or n != v, True, True)[cond - 8]
+
+    def setr(self, rd, value):
+        if rd == 15:
+            self.next = value & ~1
+        else:
+            self.r[rd] = value & M32
+
+    def flags(self, result, c=None, v=None):
+        self.n = result >> 31
+        self.z = int(result == 0)
+        if c is not None:
+            self.c = c
+        if v is not None:
+            self.v = v
+
+    def add_c(self, a, b, carry):
+        total = a + b + carry
+        result = total & M32
+        v = int((a ^ result) & (b ^ result) & 0x80000000 != 0)
+        return result, int(total > M32), v
+
+    def alu(self, op, s, rd, a, b, carry):
+        """The data-processing operations by their Thumb-2 opcode; rd 15
+        with s set is tst, teq, cmn or cmp and writes nothing."""
+        c = v = None
+        if op == 0:
+            result = a & b
+        elif op == 1:
+            result = a & ~b & M32
+        elif op == 2:
+            result = a | b
+        elif op == 3:
+            result = (a | ~b) & M32
+        elif op == 4:
+            result = a ^ b
+        elif op == 8:
+            result, c, v = self.add_c(a, b, 0)
+        elif op == 10:
+            result, c, v = self.add_c(a, b, self.c)
+        elif op == 11:
+            result, c, v = self.add_c(a, ~b & M32, self.c)
+        elif op == 13:
+            result, c, v = self.add_c(a, ~b & M32, 1)
+        elif op == 14:
+            result, c, v = self.add_c(~a & M32, b, 1)
+        else:
+            raise Fault('unsupported data-processing opcode {}'.format(op))
+        if s:
+            self.flags(result, carry if c is None else c, v)
+        if rd != 15 or not s:
+            self.setr(rd, result)
+
+    # -- Handlers -------------------------------------------------------------
+
+    def i_nop(self):
+        pass
+
+    def i_undefined(self, message):
+        raise Fault(message)
+
+    def i_shift_imm(self, rd, rm, stype, amount, s):
+        result, c = _shift_c(self.r[rm], stype, amount, self.c)
+        if s == 2:
+            s = not self.in_it
+        if s:
+            self.flags(result, c)
+        self.setr(rd, result)
+
+    def i_shift_reg(self, rd, rn, rm, stype, s):
+        result, c = _shift_c(self.r[rn], stype, self.r[rm] & 0xff, self.c)
+        if s == 2:
+            s = not self.in_it
+        if s:
+            self.flags(result, c)
+        self.setr(rd, result)
+
+    def i_dp_imm(self, op, s, rd, rn, imm, carry):
+        if s == 2:
+            s = not self.in_it
+        a = 0 if rn == 15 and op in (2, 3) else self.r[rn]
+        self.alu(op, s, rd, a, imm, self.c if carry is None else carry)
+
+    def i_dp_reg(self, op, s, rd, rn, rm, stype, amount):
+        if s == 2:
+            s = not self.in_it
+        b, carry = _shift_c(self.r[rm], stype, amount, self.c)
+        a = 0 if rn == 15 and op in (2, 3) else self.r[rn]
+        self.alu(op, s, rd, a, b, carry)
+
+    def i_mul(self, rd, rn, rm, s):
+        result = (self.r[rn] * self.r[rm]) & M32
+        if s == 2 and not self.in_it:
+            self.flags(result)
+        self.r[rd] = result
+
+    def i_mla(self, rd, rn, rm, ra, subtract):
+        product = self.r[rn] * self.r[rm]
+        self.r[rd] = (self.r[ra] - product if subtract else self.r[ra] + product) & M32
+
+    def i_smulxy(self, rd, rn, rm, ra, n_high, m_high):
+        a = _sx(self.r[rn] >> (16 if n_high else 0), 16)
+        b = _sx(self.r[rm] >> (16 if m_high else 0), 16)
+        self.r[rd] = (a * b + (_sx(self.r[ra], 32) if ra != 15 else 0)) & M32
+
+    def i_smmul(self, rd, rn, rm, ra, rounded):
+        result = _sx(self.r[rn], 32) * _sx(self.r[rm], 32)
+        if ra != 15:
+            result += _sx(self.r[ra], 32) << 32
+        if rounded:
+            result += 0x80000000
+        self.r[rd] = (result >> 32) & M32
+
+    def i_mull(self, rdlo, rdhi, rn, rm, signed, accumulate):
+        a, b = self.r[rn], self.r[rm]
+        if signed:
+            a, b = _sx(a, 32), _sx(b, 32)
+        result = a * b
+        if accumulate:
+            result += (self.r[rdhi] << 32) | self.r[rdlo]
+        self.r[rdlo] = result & M32
+        self.r[rdhi] = (result >> 32) & M32
+
+    def i_div(self, rd, rn, rm, signed):
+        a, b = self.r[rn], self.r[rm]
+        if b == 0:
+            result = 0
+        elif signed:
+            a, b = _sx(a, 32), _sx(b, 32)
+            result = abs(a) // abs(b)
+            if (a < 0) != (b < 0):
+                result = -result
+        else:
+            result = a // b
+        self.r[rd] = result & M32
+
+    def i_extend(self, rd, rn, rm, rotate, bits, signed):
+        value = self.r[rm]
+        if rotate:
+            value = ((value >> rotate) | (value << (32 - rotate))) & M32
+        value &= (1 << bits) - 1
+        if signed:
+            value = _sx(value, bits)
+        if rn != 15:
+            value += self.r[rn]
+        self.r[rd] = value & M32
+
+    def i_rev(self, rd, rm, kind):
+        value = self.r[rm]
+        if kind == 0:
+            result = int.from_bytes(value.to_bytes(4, 'little'), 'big')
+        elif kind == 1:
+            result = ((value & 0x00ff00ff) << 8) | ((value >> 8) & 0x00ff00ff)
+        elif kind == 2:
+            result = int('{:032b}'.format(value)[::-1], 2)
+        else:
+            result = _sx(((value & 0xff) << 8) | ((value >> 8) & 0xff), 16) & M32
+        self.r[rd] = result
+
+    def i_clz(self, rd, rm):
+        self.r[rd] = 32 - self.r[rm].bit_length()
+
+    def i_mov_imm(self, rd, imm, s):
+        if s == 2 and not self.in_it:
+            self.flags(imm)
+        self.r[rd] = imm
+
+    def i_movt(self, rd, imm16):
+        self.r[rd] = (self.r[rd] & 0xffff) | (imm16 << 16)
+
+    def i_add_imm(self, rd, rn, imm):
+        self.setr(rd, self.r[rn] + imm)
+
+    def i_adr(self, rd, addr):
+        self.r[rd] = addr & M32
+
+    def i_bitfield(self, kind, rd, rn, lsb, width):
+        mask = (1 << width) - 1
+        if kind == 'bfi':
+            source = self.r[rn] & mask if rn != 15 else 0
+            self.r[rd] = (self.r[rd] & ~(mask << lsb) & M32) | (source << lsb)
+        else:
+            value = (self.r[rn] >> lsb) & mask
+            self.r[rd] = (_sx(value, width) & M32) if kind == 'sbfx' else value
+
+    def i_sat(self, rd, rn, stype, amount, bits, signed):
+        value = _sx(_shift_c(self.r[rn], stype, amount, 0)[0], 32)
+        lo, hi = (-(1 << (bits - 1)), (1 << (bits - 1)) - 1) if signed else (0, (1 << bits) - 1)
+        self.r[rd] = max(lo, min(hi, value)) & M32
+
+    # branches
+
+    def i_b(self, target):
+        self.next = target
+
+    def i_bcond(self, cond, target):
+        if self.passed(cond):
+            self.next = target
+
+    def i_bl(self, target, ret):
+        self.r[14] = ret | 1
+        self.next = target
+
+    def i_bx(self, rm, link, ret):
+        target = self.r[rm]
+        if link:
+            self.r[14] = ret | 1
+        self.next = target & ~1
+
+    def i_cbz(self, rn, nonzero, target):
+        if (self.r[rn] != 0) == nonzero:
+            self.next = target
+
+    def i_it(self, firstcond, mask):
+        count = 4 - ((mask & -mask).bit_length() - 1)
+        conds = [firstcond]
+        for i in range(1, count):
+            conds.append((firstcond & 0xe) | ((mask >> (4 - i)) & 1))
+        self.it = conds
+
+    def i_tb(self, rn, rm, half):
+        base = self.r[rn]
+        if half:
+            offset = self.mem.load((base + (self.r[rm] << 1)) & M32, 2)
+        else:
+            offset = self.mem.load((base + self.r[rm]) & M32, 1)
+        self.next = self.r[15] + offset * 2
+
+    def i_mrs(self, rd, sysm):
+        if sysm < 8:  # the APSR variants
+            self.r[rd] = (self.n << 31) | (self.z << 30) | (self.c << 29) | (self.v << 28)
+        else:
+            self.r[rd] = 0
+
+    def i_msr(self, rn, sysm, mask):
+        if sysm < 8 and mask & 2:
+            value = self.r[rn]
+            self.n, self.z, self.c, self.v = (value >> 31) & 1, (value >> 30) & 1, (value >> 29) & 1, (value >> 28) & 1
+
+    # loads and stores
+
+    def i_ldr(self, rt, rn, offset, size, signed, index, wback):
+        base = self.r[rn]
+        addr = (base + offset) & M32
+        value = self.mem.load(addr if index else base, size, signed)
+        if wback:
+            self.r[rn] = addr
+        self.setr(rt, value)
+
+    def i_ldr_reg(self, rt, rn, rm, shift, size, signed):
+        value = self.mem.load((self.r[rn] + (self.r[rm] << shift)) & M32, size, signed)
+        self.setr(rt, value)
+
+    def i_ldr_lit(self, rt, addr, size, signed):
+        self.setr(rt, self.mem.load(addr, size, signed))
+
+    def i_str(self, rt, rn, offset, size, index, wback):
+        base = self.r[rn]
+        addr = (base + offset) & M32
+        self.mem.store(addr if index else base, size, self.r[rt])
+        if wback:
+            self.r[rn] = addr
+
+    def i_str_reg(self, rt, rn, rm, shift, size):
+        self.mem.store((self.r[rn] + (self.r[rm] << shift)) & M32, size, self.r[rt])
+
+    def i_ldrd(self, rt, rt2, rn, offset, index, wback):
+        base = self.r[rn] if rn != 15 else self.r[15] & ~3
+        addr = (base + offset) & M32
+        at = addr if index else base
+        first = self.mem.load(at, 4)
+        second = self.mem.load((at + 4) & M32, 4)
+        if wback:
+            self.r[rn] = addr
+        self.r[rt], self.r[rt2] = first, second
+
+    def i_strd(self, rt, rt2, rn, offset, index, wback):
+        base = self.r[rn]
+        addr = (base + offset) & M32
+        at = addr if index else base
+        self.mem.store(at, 4, self.r[rt])
+        self.mem.store((at + 4) & M32, 4, self.r[rt2])
+        if wback:
+            self.r[rn] = addr
+
+    def i_ldrex(self, rt, rn, offset, size):
+        self.r[rt] = self.mem.load((self.r[rn] + offset) & M32, size)
+
+    def i_strex(self, rd, rt, rn, offset, size):
+        self.mem.store((self.r[rn] + offset) & M32, size, self.r[rt])
+        self.r[rd] = 0  # nothing else runs, so it always succeeds
+
+    def i_ldm(self, rn, registers, wback, before):
+        addr = self.r[rn]
+        if before:
+            addr = (addr - 4 * len(registers)) & M32
+        start = addr
+        values = []
+        for _ in registers:
+            values.append(self.mem.load(addr, 4))
+            addr = (addr + 4) & M32
+        if wback and rn not in registers:
+            self.r[rn] = start if before else addr
+        for reg, value in zip(registers, values):
+            self.setr(reg, value)
+
+    def i_stm(self, rn, registers, wback, before):
+        addr = self.r[rn]
+        if before:
+            addr = (addr - 4 * len(registers)) & M32
+        start = addr
+        for reg in registers:
+            self.mem.store(addr, 4, self.r[reg])
+            addr = (addr + 4) & M32
+        if wback:
+            self.r[rn] = start if before else addr
+
+    # floating point, single precision
+
+    def i_vldr(self, sd, rn, offset, count):
+        base = self.r[rn] if rn != 15 else self.r[15] & ~3
+        addr = (base + offset) & M32
+        for i in range(count):
+            self.s[sd + i] = self.mem.load((addr + 4 * i) & M32, 4)
+
+    def i_vstr(self, sd, rn, offset, count):
+        addr = (self.r[rn] + offset) & M32
+        for i in range(count):
+            self.mem.store((addr + 4 * i) & M32, 4, self.s[sd + i])
+
+    def i_vldm(self, sd, rn, count, wback, before):
+        addr = self.r[rn]
+        if before:
+            addr = (addr - 4 * count) & M32
+        for i in range(count):
+            self.s[sd + i] = self.mem.load((addr + 4 * i) & M32, 4)
+        if wback:
+            self.r[rn] = addr if before else (addr + 4 * count) & M32
+
+    def i_vstm(self, sd, rn, count, wback, before):
+        addr = self.r[rn]
+        if before:
+            addr = (addr - 4 * count) & M32
+        for i in range(count):
+            self.mem.store((addr + 4 * i) & M32, 4, self.s[sd + i])
+        if wback:
+            self.r[rn] = addr if before else (addr + 4 * count) & M32
+
+    def i_vmov_core(self, rt, sn, to_core):
+        if to_core:
+            self.setr(rt, self.s[sn])
+        else:
+            self.s[sn] = self.r[rt]
+
+    def i_vmov_core2(self, rt, rt2, sm, to_core):
+        if to_core:
+            self.r[rt], self.r[rt2] = self.s[sm], self.s[sm + 1]
+        else:
+            self.s[sm], self.s[sm + 1] = self.r[rt], self.r[rt2]
+
+    def i_vmov(self, sd, value):
+        self.s[sd] = value
+
+    def i_vmov_reg(self, sd, sm, kind):
+        bits = self.s[sm]
+        if kind == 'abs':
+            bits &= 0x7fffffff
+        elif kind == 'neg':
+            bits ^= 0x80000000
+        elif kind == 'sqrt':
+            bits = _bits(_sqrt(_float(bits)))
+        self.s[sd] = bits
+
+    def i_varith(self, op, sd, sn, sm):
+        a, b = _float(self.s[sn]), _float(self.s[sm])
+        if op == 'add':
+            result = a + b
+        elif op == 'sub':
+            result = a - b
+        elif op == 'mul':
+            result = a * b
+        elif op == 'nmul':
+            result = -(a * b)
+        elif op == 'div':
+            result = _div(a, b)
+        elif op == 'max':
+            result = b if a != a else a if b != b else max(a, b)
+        else:
+            result = b if a != a else a if b != b else min(a, b)
+        self.s[sd] = _bits(result)
+
+    def i_vmac(self, sd, sn, sm, negate_product, negate_acc, fused):
+        product = _float(self.s[sn]) * _float(self.s[sm])
+        if not fused:
+            product = _float(_bits(product))
+        if negate_product:
+            product = -product
+        acc = _float(self.s[sd])
+        self.s[sd] = _bits((-acc if negate_acc else acc) + product)
+
+    def i_vcmp(self, sd, sm, zero):
+        a = _float(self.s[sd])
+        b = 0.0 if zero else _float(self.s[sm])
+        if a != a or b != b:
+            nzcv = 0x3
+        elif a == b:
+            nzcv = 0x6
+        elif a < b:
+            nzcv = 0x8
+        else:
+            nzcv = 0x2
+        self.fpscr = (self.fpscr & 0x0fffffff) | (nzcv << 28)
+
+    def i_vmrs(self, rt):
+        if rt == 15:
+            nzcv = self.fpscr >> 28
+            self.n, self.z, self.c, self.v = nzcv >> 3, (nzcv >> 2) & 1, (nzcv >> 1) & 1, nzcv & 1
+        else:
+            self.r[rt] = self.fpscr
+
+    def i_vmsr(self, rt):
+        self.fpscr = self.r[rt]
+
+    def i_vcvt_from_int(self, sd, sm, signed):
+        value = self.s[sm]
+        self.s[sd] = _bits(float(_sx(value, 32) if signed else value))
+
+    def i_vcvt_to_int(self, sd, sm, signed, rounding):
+        self.s[sd] = _to_int(_float(self.s[sm]), signed, rounding)
+
+    def i_vrint(self, sd, sm, rounding):
+        x = _float(self.s[sm])
+        self.s[sd] = self.s[sm] if x != x or math.isinf(x) else _bits(math.copysign(rounding(x), x))
+
+    def i_vsel(self, sd, sn, sm, cond):
+        self.s[sd] = self.s[sn] if self.passed(cond) else self.s[sm]
+
+    # -- Decoding -------------------------------------------------------------
+
+    def decode(self, pc):
+        hw1 = self.mem.load(pc, 2)
+        self.mem.loads -= 1  # fetches are not data traffic
+        if pdex2elf.is_32bit(hw1):
+            hw2 = self.mem.load(pc + 2, 2)
+            self.mem.loads -= 1
+            handler, operands = self.decode32(pc, hw1, hw2)
+            return handler, operands, 4
+        handler, operands = self.decode16(pc, hw1)
+        return handler, operands, 2
+
+    def unsupported(self, pc, hw1, hw2=None):
+        text = '{:04x}'.format(hw1) if hw2 is None else '{:04x} {:04x}'.format(hw1, hw2)
+        return self.i_undefined, ('unsupported instruction {} at {:#010x}'.format(text, pc),)
+
+    def decode16(self, pc, hw):
+        rd, rn, rm = hw & 7, (hw >> 3) & 7, (hw >> 6) & 7
+        if hw < 0x1800:  # lsl, lsr, asr by immediate
+            stype, amount = _decode_imm_shift((hw >> 11) & 3, (hw >> 6) & 0x1f)
+            return self.i_shift_imm, (rd, rn, stype, amount, 2)
+        if hw < 0x2000:  # add and sub, register or imm3
+            op = 13 if hw & 0x0200 else 8
+            if hw & 0x0400:
+                return self.i_dp_imm, (op, 2, rd, rn, rm, 0)
+            return self.i_dp_reg, (op, 2, rd, rn, rm, 0, 0)
+        if hw < 0x4000:  # mov, cmp, add, sub imm8
+            rdn, imm8 = (hw >> 8) & 7, hw & 0xff
+            kind = (hw >> 11) & 3
+            if kind == 0:
+                return self.i_mov_imm, (rdn, imm8, 2)
+            if kind == 1:
+                return self.i_dp_imm, (13, 1, 15, rdn, imm8, 0)
+            return self.i_dp_imm, (8 if kind == 2 else 13, 2, rdn, rdn, imm8, 0)
+        if hw < 0x4400:  # data processing
+            op = (hw >> 6) & 0xf
+            rm = rn
+            if op in (2, 3, 4, 7):
+                return self.i_shift_reg, (rd, rd, rm, {2: 0, 3: 1, 4: 2, 7: 3}[op], 2)
+            if op == 13:
+                return self.i_mul, (rd, rd, rm, 2)
+            if op == 9:  # rsb rd, rm, #0
+                return self.i_dp_imm, (14, 2, rd, rm, 0, 0)
+            alu = {0: (0, 2, rd), 1: (4, 2, rd), 5: (10, 2, rd), 6: (11, 2, rd), 8: (0, 1, 15), 10: (13, 1, 15),
+                   11: (8, 1, 15), 12: (2, 2, rd), 14: (1, 2, rd), 15: (3, 2, rd)}[op]
+            rn = 15 if op == 15 else rd
+            return self.i_dp_reg, (alu[0], alu[1], alu[2], rn, rm, 0, 0)
+        if hw < 0x4800:  # add, cmp, mov on high registers, bx, blx
+            rdn = (hw & 7) | ((hw >> 4) & 8)
+            rm = (hw >> 3) & 0xf
+            kind = (hw >> 8) & 3
+            if kind == 0:
+                return self.i_dp_reg, (8, 0, rdn, rdn, rm, 0, 0)
+            if kind == 1:
+                return self.i_dp_reg, (13, 1, 15, rdn, rm, 0, 0)
+            if kind == 2:
+                return self.i_dp_reg, (2, 0, rdn, 15, rm, 0, 0)
+            return self.i_bx, (rm, hw & 0x80, pc + 2)
+        if hw < 0x5000:  # ldr literal
+            return self.i_ldr_lit, ((hw >> 8) & 7, ((pc + 4) & ~3) + (hw & 0xff) * 4, 4, False)
+        if hw < 0x6000:  # register offset
+            op = (hw >> 9) & 7
+            if op < 3:
+                return self.i_str_reg, (rd, rn, rm, 0, (4, 2, 1)[op])
+            size, signed = {3: (1, True), 4: (4, False), 5: (2, False), 6: (1, False), 7: (2, True)}[op]
+            return self.i_ldr_reg, (rd, rn, rm, 0, size, signed)
+        if hw < 0x9000:  # immediate offset
+            size = 4 if hw < 0x7000 else 1 if hw < 0x8000 else 2
+            offset = ((hw >> 6) & 0x1f) * size
+            if hw & 0x0800:
+                return self.i_ldr, (rd, rn, offset, size, False, True, False)
+            return self.i_str, (rd, rn, offset, size, True, False)
+        if hw < 0xa000:  # sp relative
+            rt = (hw >> 8) & 7
+            if hw & 0x0800:
+                return self.i_ldr, (rt, 13, (hw & 0xff) * 4, 4, False, True, False)
+            return self.i_str, (rt, 13, (hw & 0xff) * 4, 4, True, False)
+        if hw < 0xa800:
+            return self.i_adr, ((hw >> 8) & 7, ((pc + 4) & ~3) + (hw & 0xff) * 4)
+        if hw < 0xb000:
+            return self.i_add_imm, ((hw >> 8) & 7, 13, (hw & 0xff) * 4)
+        if hw < 0xc000:
+            return self.decode_misc16(pc, hw)
+        if hw < 0xd000:  # stm, ldm
+            rn = (hw >> 8) & 7
+            registers = _register_list(hw & 0xff)
+            if hw & 0x0800:
+                return self.i_ldm, (rn, registers, True, False)
+            return self.i_stm, (rn, registers, True, False)
+        if hw < 0xe000:
+            cond = (hw >> 8) & 0xf
+            if cond >= 0xe:
+                return self.unsupported(pc, hw)
+            return self.i_bcond, (cond, pc + 4 + _sx(hw, 8) * 2)
+        if hw < 0xe800:
+            return self.i_b, (pc + 4 + _sx(hw, 11) * 2,)
+        return self.unsupported(pc, hw)
+
+    def decode_misc16(self, pc, hw):
+        if hw & 0xff00 == 0xb000:  # add, sub sp
+            imm = (hw & 0x7f) * 4
+            return self.i_add_imm, (13, 13, -imm if hw & 0x80 else imm)
+        if hw & 0xf500 == 0xb100:  # cbz, cbnz
+            offset = ((hw >> 3) & 0x1f) * 2 | ((hw >> 9) & 1) << 6
+            return self.i_cbz, (hw & 7, bool(hw & 0x0800), pc + 4 + offset)
+        if hw & 0xff00 == 0xb200:  # sxth, sxtb, uxth, uxtb
+            kind = (hw >> 6) & 3
+            return self.i_extend, (hw & 7, 15, (hw >> 3) & 7, 0, 16 if kind in (0, 2) else 8, kind < 2)
+        if hw & 0xfe00 == 0xb400:  # push
+            registers = _register_list((hw & 0xff) | ((hw & 0x100) << 6))
+            return self.i_stm, (13, registers, True, True)
+        if hw & 0xfe00 == 0xbc00:  # pop
+            registers = _register_list((hw & 0xff) | ((hw & 0x100) << 7))
+            return self.i_ldm, (13, registers, True, False)
+        if hw & 0xffe8 == 0xb660:  # cps
+            return self.i_nop, ()
+        if hw & 0xff00 == 0xba00 and (hw >> 6) & 3 != 2:  # rev, rev16, revsh
+            return self.i_rev, (hw & 7, (hw >> 3) & 7, (0, 1, None, 3)[(hw >> 6) & 3])
+        if hw & 0xff00 == 0xbf00:
+            if hw & 0xf:
+                return self.i_it, ((hw >> 4) & 0xf, hw & 0xf)
+            return self.i_nop, ()
+        return self.unsupported(pc, hw)
+
+    def decode32(self, pc, hw1, hw2):
+        op1 = (hw1 >> 11) & 3
+        op2 = (hw1 >> 4) & 0x7f
+        if op1 == 1:
+            if op2 & 0x64 == 0x00:
+                return self.decode_ldm32(pc, hw1, hw2)
+            if op2 & 0x64 == 0x04:
+                return self.decode_dual(pc, hw1, hw2)
+            if op2 & 0x60 == 0x20:
+                return self.decode_dp_reg(pc, hw1, hw2)
+            return self.decode_coprocessor(pc, hw1, hw2)
+        if op1 == 2:
+            if hw2 & 0x8000:
+                return self.decode_branch(pc, hw1, hw2)
+            if op2 & 0x20 == 0:
+                return self.decode_dp_imm(pc, hw1, hw2)
+            return self.decode_plain_imm(pc, hw1, hw2)
+        if op2 & 0x71 == 0x00:
+            return self.decode_store(pc, hw1, hw2)
+        if op2 & 0x61 == 0x01 and op2 & 0x06 != 0x06:
+            return self.decode_load(pc, hw1, hw2)
+        if op2 & 0x70 == 0x20:
+            return self.decode_dp_register(pc, hw1, hw2)
+        if op2 & 0x78 == 0x30:
+            return self.decode_multiply(pc, hw1, hw2)
+        if op2 & 0x78 == 0x38:
+            return self.decode_long_multiply(pc, hw1, hw2)
+        if op2 & 0x40:
+            return self.decode_coprocessor(pc, hw1, hw2)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_ldm32(self, pc, hw1, hw2):
+        mode = (hw1 >> 7) & 3
+        if mode not in (1, 2):
+            return self.unsupported(pc, hw1, hw2)
+        rn = hw1 & 0xf
+        registers = _register_list(hw2)
+        wback = bool(hw1 & 0x20)
+        if hw1 & 0x10:
+            return self.i_ldm, (rn, registers, wback, mode == 2)
+        return self.i_stm, (rn, registers, wback, mode == 2)
+
+    def decode_dual(self, pc, hw1, hw2):
+        rn, rt = hw1 & 0xf, hw2 >> 12
+        if hw1 & 0xfff0 == 0xe840:
+            return self.i_strex, ((hw2 >> 8) & 0xf, rt, rn, (hw2 & 0xff) * 4, 4)
+        if hw1 & 0xfff0 == 0xe850:
+            return self.i_ldrex, (rt, rn, (hw2 & 0xff) * 4, 4)
+        if hw1 & 0xffe0 == 0xe8c0:
+            kind = (hw2 >> 4) & 0xf
+            if hw1 & 0x10 and kind in (0, 1):
+                return self.i_tb, (rn, hw2 & 0xf, kind == 1)
+            if kind in (4, 5):
+                size = 1 if kind == 4 else 2
+                if hw1 & 0x10:
+                    return self.i_ldrex, (rt, rn, 0, size)
+                return self.i_strex, (hw2 & 0xf, rt, rn, 0, size)
+            return self.unsupported(pc, hw1, hw2)
+        index, up, wback = bool(hw1 & 0x100), hw1 & 0x80, bool(hw1 & 0x20)
+        offset = (hw2 & 0xff) * 4
+        if not up:
+            offset = -offset
+        rt2 = (hw2 >> 8) & 0xf
+        if hw1 & 0x10:
+            return self.i_ldrd, (rt, rt2, rn, offset, index, wback)
+        return self.i_strd, (rt, rt2, rn, offset, index, wback)
+
+    def decode_dp_reg(self, pc, hw1, hw2):
+        op = (hw1 >> 5) & 0xf
+        if op in (5, 6, 7, 9, 12, 15):
+            return self.unsupported(pc, hw1, hw2)
+        stype, amount = _decode_imm_shift((hw2 >> 4) & 3, ((hw2 >> 10) & 0x1c) | ((hw2 >> 6) & 3))
+        return self.i_dp_reg, (op, bool(hw1 & 0x10), (hw2 >> 8) & 0xf, hw1 & 0xf, hw2 & 0xf, stype, amount)
+
+    def decode_dp_imm(self, pc, hw1, hw2):
+        op = (hw1 >> 5) & 0xf
+        if op in (5, 6, 7, 9, 12, 15):
+            return self.unsupported(pc, hw1, hw2)
+        imm, carry = _expand_imm(((hw1 >> 10) & 1) << 11 | ((hw2 >> 12) & 7) << 8 | (hw2 & 0xff))
+        return self.i_dp_imm, (op, bool(hw1 & 0x10), (hw2 >> 8) & 0xf, hw1 & 0xf, imm, carry)
+
+    def decode_plain_imm(self, pc, hw1, hw2):
+        op = (hw1 >> 4) & 0x1f
+        rn, rd = hw1 & 0xf, (hw2 >> 8) & 0xf
+        imm12 = ((hw1 >> 10) & 1) << 11 | ((hw2 >> 12) & 7) << 8 | (hw2 & 0xff)
+        lsb = ((hw2 >> 10) & 0x1c) | ((hw2 >> 6) & 3)
+        if op in (0x00, 0x0a):  # addw, subw, adr.w
+            imm = -imm12 if op == 0x0a else imm12
+            if rn == 15:
+                return self.i_adr, (rd, ((pc + 4) & ~3) + imm)
+            return self.i_add_imm, (rd, rn, imm)
+        if op in (0x04, 0x0c):  # movw, movt
+            imm16 = (hw1 & 0xf) << 12 | imm12
+            if op == 0x04:
+                return self.i_mov_imm, (rd, imm16, 0)
+            return self.i_movt, (rd, imm16)
+        if op in (0x10, 0x12, 0x18, 0x1a) and not (op & 2 and lsb == 0):  # ssat, usat but not the 16-bit forms
+            signed = op < 0x18
+            return self.i_sat, (rd, rn, 2 if op & 2 else 0, lsb, (hw2 & 0x1f) + signed, signed)
+        if op == 0x14:
+            return self.i_bitfield, ('sbfx', rd, rn, lsb, (hw2 & 0x1f) + 1)
+        if op == 0x1c:
+            return self.i_bitfield, ('ubfx', rd, rn, lsb, (hw2 & 0x1f) + 1)
+        if op == 0x16:
+            return self.i_bitfield, ('bfi', rd, rn, lsb, (hw2 & 0x1f) - lsb + 1)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_branch(self, pc, hw1, hw2):
+        if hw2 & 0x5000 == 0x5000:
+            return self.i_bl, (pdex2elf.bl_target(pc, hw1, hw2), pc + 4)
+        if hw2 & 0x5000 == 0x1000:
+            target = pdapiscan.branch_target(pc, hw1, hw2, True)
+            return self.i_b, (target,)
+        if hw2 & 0x5000 == 0x0000:
+            if (hw1 >> 7) & 7 != 7:
+                return self.i_bcond, ((hw1 >> 6) & 0xf, pdapiscan.branch_target(pc, hw1, hw2, True))
+            if hw1 & 0xffe0 == 0xf380:  # msr
+                return self.i_msr, (hw1 & 0xf, hw2 & 0xff, (hw2 >> 10) & 3)
+            if hw1 & 0xffe0 == 0xf3e0:  # mrs
+                return self.i_mrs, ((hw2 >> 8) & 0xf, hw2 & 0xff)
+            if hw1 in (0xf3af, 0xf3bf):  # hints, barriers
+                return self.i_nop, ()
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_store(self, pc, hw1, hw2):
+        size = (1, 2, 4, None)[(hw1 >> 5) & 3]
+        rn, rt = hw1 & 0xf, hw2 >> 12
+        if size is None or rn == 15:
+            return self.unsupported(pc, hw1, hw2)
+        if hw1 & 0x80:
+            return self.i_str, (rt, rn, hw2 & 0xfff, size, True, False)
+        if hw2 & 0x800:
+            offset = hw2 & 0xff if hw2 & 0x200 else -(hw2 & 0xff)
+            return self.i_str, (rt, rn, offset, size, bool(hw2 & 0x400), bool(hw2 & 0x100))
+        if hw2 & 0xfc0 == 0:
+            return self.i_str_reg, (rt, rn, hw2 & 0xf, (hw2 >> 4) & 3, size)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_load(self, pc, hw1, hw2):
+        size = (1, 2, 4)[(hw1 >> 5) & 3]
+        signed = bool(hw1 & 0x100)
+        rn, rt = hw1 & 0xf, hw2 >> 12
+        if rt == 15 and size < 4:  # pld, pli
+            return self.i_nop, ()
+        if rn == 15:
+            offset = hw2 & 0xfff
+            return self.i_ldr_lit, (rt, ((pc + 4) & ~3) + (offset if hw1 & 0x80 else -offset), size, signed)
+        if hw1 & 0x80:
+            return self.i_ldr, (rt, rn, hw2 & 0xfff, size, signed, True, False)
+        if hw2 & 0x800:
+            offset = hw2 & 0xff if hw2 & 0x200 else -(hw2 & 0xff)
+            return self.i_ldr, (rt, rn, offset, size, signed, bool(hw2 & 0x400), bool(hw2 & 0x100))
+        if hw2 & 0xfc0 == 0:
+            return self.i_ldr_reg, (rt, rn, hw2 & 0xf, (hw2 >> 4) & 3, size, signed)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_dp_register(self, pc, hw1, hw2):
+        rn, rd, rm = hw1 & 0xf, (hw2 >> 8) & 0xf, hw2 & 0xf
+        if hw1 & 0xff80 == 0xfa00 and hw2 & 0xf0f0 == 0xf000:  # shifts by register
+            return self.i_shift_reg, (rd, rn, rm, (hw1 >> 5) & 3, bool(hw1 & 0x10))
+        if hw1 & 0xff80 == 0xfa00 and hw2 & 0xf080 == 0xf080:  # sxt(a)h, uxt(a)h, sxt(a)b, uxt(a)b
+            op = (hw1 >> 4) & 7
+            if op not in (0, 1, 4, 5):
+                return self.unsupported(pc, hw1, hw2)
+            return self.i_extend, (rd, rn, rm, ((hw2 >> 4) & 3) * 8, 16 if op < 2 else 8, op in (0, 4))
+        if hw1 & 0xfff0 == 0xfa90 and hw2 & 0xf0c0 == 0xf080:  # rev, rev16, rbit, revsh
+            return self.i_rev, (rd, rm, (0, 1, 2, 3)[(hw2 >> 4) & 3])
+        if hw1 & 0xfff0 == 0xfab0 and hw2 & 0xf0f0 == 0xf080:
+            return self.i_clz, (rd, rm)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_multiply(self, pc, hw1, hw2):
+        op1, op2 = (hw1 >> 4) & 7, (hw2 >> 4) & 3
+        rn, ra, rd, rm = hw1 & 0xf, hw2 >> 12, (hw2 >> 8) & 0xf, hw2 & 0xf
+        if op1 == 0 and op2 == 0:
+            if ra == 15:
+                return self.i_mul, (rd, rn, rm, 0)
+            return self.i_mla, (rd, rn, rm, ra, False)
+        if op1 == 0 and op2 == 1:
+            return self.i_mla, (rd, rn, rm, ra, True)
+        if op1 == 1:
+            return self.i_smulxy, (rd, rn, rm, ra, hw2 & 0x20, hw2 & 0x10)
+        if op1 == 5 and op2 < 2:
+            return self.i_smmul, (rd, rn, rm, ra, op2 == 1)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_long_multiply(self, pc, hw1, hw2):
+        op1, op2 = (hw1 >> 4) & 7, (hw2 >> 4) & 0xf
+        rn, rdlo, rdhi, rm = hw1 & 0xf, hw2 >> 12, (hw2 >> 8) & 0xf, hw2 & 0xf
+        if op2 == 0 and op1 in (0, 2, 4, 6):
+            return self.i_mull, (rdlo, rdhi, rn, rm, op1 in (0, 4), op1 >= 4)
+        if op2 == 0xf and op1 in (1, 3):
+            return self.i_div, (rdhi, rn, rm, op1 == 1)
+        return self.unsupported(pc, hw1, hw2)
+
+    def decode_coprocessor(self, pc, hw1, hw2):
+        coproc = (hw2 >> 8) & 0xf
+        if coproc not in (0xa, 0xb):
+            return self.unsupported(pc, hw1, hw2)
+        double = coproc == 0xb
+        d = ((hw2 >> 12) & 0xf) << 1 | ((hw1 >> 6) & 1)
+        if double:
+            d = (((hw1 >> 6) & 1) << 4 | ((hw2 >> 12) & 0xf)) * 2
+        n = (hw1 & 0xf) << 1 | ((hw2 >> 7) & 1)
+        m = (hw2 & 0xf) << 1 | ((hw2 >> 5) & 1)
+
+        if hw1 & 0xfe00 == 0xec00:  # loads, stores and 64-bit moves
+            p, u, w, load = hw1 & 0x100, hw1 & 0x80, hw1 & 0x20, hw1 & 0x10
+            rn = hw1 & 0xf
+            if not p and not u and not w:
+                if not hw1 & 0x40:
+                    return self.unsupported(pc, hw1, hw2)
+                sm = ((hw2 & 0xf) << 1 | ((hw2 >> 5) & 1)) if not double else (((hw2 >> 5) & 1) << 4 | (hw2 & 0xf)) * 2
+                return self.i_vmov_core2, (hw2 >> 12, hw1 & 0xf, sm, bool(load))
+            count = hw2 & 0xff  # words either way
+            if p and not w:
+                offset = (hw2 & 0xff) * 4
+                words = 2 if double else 1
+                handler = self.i_vldr if load else self.i_vstr
+                return handler, (d, rn, offset if u else -offset, words)
+            if p == 0 and u or p and not u and w:
+                handler = self.i_vldm if load else self.i_vstm
+                return handler, (d, rn, count, bool(w), bool(p))
+            return self.unsupported(pc, hw1, hw2)
+
+        if hw1 & 0xff00 == 0xee00 and hw2 & 0x10:  # core register transfers
+            if double:
+                return self.unsupported(pc, hw1, hw2)
+            if hw1 & 0xffe0 == 0xee00 and hw2 & 0x7f == 0x10:
+                return self.i_vmov_core, (hw2 >> 12, n, bool(hw1 & 0x10))
+            if hw1 == 0xeef1 and hw2 & 0xfff == 0xa10:
+                return self.i_vmrs, (hw2 >> 12,)
+            if hw1 == 0xeee1 and hw2 & 0xfff == 0xa10:
+                return self.i_vmsr, (hw2 >> 12,)
+            return self.unsupported(pc, hw1, hw2)
+
+        if double:  # the Playdate's FPU is single precision
+            return self.unsupported(pc, hw1, hw2)
+
+        if hw1 & 0xff00 == 0xfe00:  # FPv5 additions
+            if hw1 & 0xff80 == 0xfe00 and not hw2 & 0x50:
+                return self.i_vsel, (d, n, m, (0, 6, 10, 12)[(hw1 >> 4) & 3])
+            if hw1 & 0xffb0 == 0xfe80 and hw2 & 0x10 == 0:
+                return self.i_varith, ('min' if hw2 & 0x40 else 'max', d, n, m)
+            if hw1 & 0xffbc == 0xfeb8 and hw2 & 0xd0 == 0x40:
+                return self.i_vrint, (d, m, _ROUNDING[hw1 & 3])
+            if hw1 & 0xffbc == 0xfebc and hw2 & 0x50 == 0x40:
+                return self.i_vcvt_to_int, (d, m, bool(hw2 & 0x80), _ROUNDING[hw1 & 3])
+            return self.unsupported(pc, hw1, hw2)
+
+        opc = hw1 & 0xffb0
+        op = hw2 & 0x40
+        if opc == 0xee00:
+            return self.i_vmac, (d, n, m, bool(op), False, False)
+        if opc == 0xee10:
+            return self.i_vmac, (d, n, m, bool(op), True, False)
+        if opc == 0xee20:
+            return self.i_varith, ('nmul' if op else 'mul', d, n, m)
+        if opc == 0xee30:
+            return self.i_varith, ('sub' if op else 'add', d, n, m)
+        if opc == 0xee80 and not op:
+            return self.i_varith, ('div', d, n, m)
+        if opc == 0xee90:
+            return self.i_vmac, (d, n, m, bool(op), True, True)
+        if opc == 0xeea0:
+            return self.i_vmac, (d, n, m, bool(op), False, True)
+        if opc != 0xeeb0:
+            return self.unsupported(pc, hw1, hw2)
+
+        opc2 = hw1 & 0xf
+        opc3 = (hw2 >> 6) & 3
+        if not opc3 & 1:
+            return self.i_vmov, (d, _vfp_imm((hw1 & 0xf) << 4 | (hw2 & 0xf)))
+        if opc2 == 0:
+            return self.i_vmov_reg, (d, m, 'mov' if opc3 == 1 else 'abs')
+        if opc2 == 1:
+            return self.i_vmov_reg, (d, m, 'neg' if opc3 == 1 else 'sqrt')
+        if opc2 in (4, 5):
+            return self.i_vcmp, (d, m, opc2 == 5)
+        if opc2 == 6:  # vrintr, vrintz
+            return self.i_vrint, (d, m, math.trunc if opc3 == 3 else round)
+        if opc2 == 7 and opc3 == 1:  # vrintx
+            return self.i_vrint, (d, m, round)
+        if opc2 == 8:
+            return self.i_vcvt_from_int, (d, m, opc3 == 3)
+        if opc2 in (12, 13):
+            return self.i_vcvt_to_int, (d, m, opc2 == 13, math.trunc if opc3 == 3 else round)
+        return self.unsupported(pc, hw1, hw2)
+
+
+# ==== Stand-in API ====
+
+class GuestError(Exception):
+    pass
+
+
+class Host:
+    """The API the game sees. Each implemented function is a method named
+    after its path with -> as _, reading its arguments from the registers."""
+
+    def __init__(self, memory, tables, pdx_dir, data_dir, quiet):
+        self.mem = memory
+        self.cpu = None
+        self.paths = []
+        self.calls = {}
+        self.frame = 0
+        self.pdx_dir = pdx_dir
+        self.data_dir = data_dir
+        self.quiet = quiet
+        self.update = None
+        self.userdata = 0
+
+        self.heap = memory.map(HEAP_BASE, HEAP_SIZE, 'heap')
+        self.heap_top = HEAP_BASE
+        self.blocks = {}  # address -> size
+        self.free = {}    # rounded size -> addresses
+        self.bitmaps = {}  # address -> (width, height, rowbytes, data)
+        self.files = {}   # SDFile* -> [bytearray, position, path or None]
+        self.error = 0
+
+        memory.map(FRAME_BASE, FRAME_SIZE * 2, 'frame')
+        self.api = self.layout(tables, memory)
+
+    def layout(self, tables, memory):
+        """Builds the PlaydateAPI and its tables in memory; function
+        pointers are trap addresses indexing self.paths."""
+        def measure(name):
+            total = len(tables[name]) * 4
+            for _, table in tables[name]:
+                if table:
+                    total += measure(table)
+            return total
+
+        data = memory.map(API_BASE, measure('PlaydateAPI'), 'api')
+        top = [API_BASE]
+
+        def place(name, path):
+            addr = top[0]
+            top[0] += len(tables[name]) * 4
+            for i, (member, table) in enumerate(tables[name]):
+                if table:
+                    value = place(table, path + member + '->')
+                else:
+                    value = TRAP_BASE + 4 * len(self.paths) | 1
+                    self.paths.append(path + member)
+                _U32.pack_into(data, addr - API_BASE + 4 * i, value)
+            return addr
+
+        return place('PlaydateAPI', '')
+
+    def trap(self, index):
+        path = self.paths[index]
+        self.calls[path] = self.calls.get(path, 0) + 1
+        r = self.cpu.r
+        handler = getattr(self, path.replace('->', '_'), None)
+        if handler is not None:
+            result = handler()
+        elif path.split('->')[-1].startswith(('new', 'load', 'copy')):
+            result = self.alloc(64)
+        else:
+            result = 0
+        if isinstance(result, float):
+            self.cpu.s[0] = _bits(result)
+        else:
+            r[0] = (result or 0) & M32
+            self.cpu.s[0] = 0
+
+    def arg(self, i):
+        if i < 4:
+            return self.cpu.r[i]
+        return self.mem.word(self.cpu.r[13] + 4 * (i - 4))
+
+    def format(self, fmt_addr, first):
+        """printf for the variadic functions: integers take a core register
+        or stack slot each, doubles an aligned pair of them."""
+        fmt = self.mem.cstring(fmt_addr)
+        slot = [first]
+
+        def take(wide):
+            if wide and slot[0] % 2:
+                slot[0] += 1
+            lo = self.arg(slot[0])
+            slot[0] += 1
+            if not wide:
+                return lo
+            hi = self.arg(slot[0])
+            slot[0] += 1
+            return hi << 32 | lo
+
+        def convert(match):
+            flags, width, precision, length, kind = match.groups()
+            if kind == '%':
+                return '%'
+            if width == '*':
+                width = str(_sx(take(False), 32))
+            if precision == '*':
+                precision = str(_sx(take(False), 32))
+            spec = '%' + (flags or '') + (width or '') + ('.' + precision if precision is not None else '')
+            if kind in 'fFeEgG':
+                return (spec + kind) % struct.unpack('<d', struct.pack('<Q', take(True)))[0]
+            if kind == 's':
+                addr = take(False)
+                return (spec + 's') % (self.mem.cstring(addr) if addr else '(null)')
+            if kind == 'p':
+                return (spec + 'x') % take(False)
+            value = take(length == 'll')
+            bits = 64 if length == 'll' else 32
+            if kind in 'di':
+                value = _sx(value, bits)
+            if kind == 'c':
+                return (spec + 'c') % chr(value & 0xff)
+            return (spec + ('d' if kind == 'u' else kind)) % value
+
+        return re.sub(r'%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|z|j|t)?([diouxXcsfFeEgGp%])', convert, fmt)
+
+    # -- Heap -----------------------------------------------------------------
+
+    def alloc(self, size):
+        rounded = max(16, (size + 15) & ~15)
+        reuse = self.free.get(rounded)
+        if reuse:
+            addr = reuse.pop()
+            self.mem.write(addr, bytes(rounded))
+        else:
+            addr = self.heap_top
+            if addr + rounded > HEAP_BASE + HEAP_SIZE:
+                return 0
+            self.heap_top += rounded
+        self.blocks[addr] = rounded
+        return addr
+
+    def system_realloc(self):
+        ptr, size = self.arg(0), self.arg(1)
+        if size == 0:
+            if ptr in self.blocks:
+                self.free.setdefault(self.blocks.pop(ptr), []).append(ptr)
+            return 0
+        addr = self.alloc(size)
+        if addr and ptr in self.blocks:
+            old = self.blocks[ptr]
+            self.mem.write(addr, self.mem.read(ptr, min(old, size)))
+            self.free.setdefault(self.blocks.pop(ptr), []).append(ptr)
+        return addr
+
+    def string(self, text):
+        blob = text.encode() + b'\0'
+        addr = self.alloc(len(blob))
+        self.mem.write(addr, blob)
+        return addr
+
+    # -- system ---------------------------------------------------------------
+
+    def system_formatString(self):
+        text = self.format(self.arg(1), 2)
+        if self.arg(0):
+            self.mem.write(self.arg(0), _U32.pack(self.string(text)))
+        return len(text.encode())
+
+    def system_logToConsole(self):
+        text = self.format(self.arg(0), 1)
+        if not self.quiet:
+            print(text)
+
+    def system_error(self):
+        raise GuestError(self.format(self.arg(0), 1))
+
+    def system_getCurrentTimeMilliseconds(self):
+        return self.frame * 1000 // 30
+
+    def system_getElapsedTime(self):
+        return self.frame / 30.0
+
+    def system_getSecondsSinceEpoch(self):
+        if self.arg(0):
+            self.mem.write(self.arg(0), _U32.pack(0))
+        return 0
+
+    def system_setUpdateCallback(self):
+        self.update, self.userdata = self.arg(0), self.arg(1)
+
+    def system_getButtonState(self):
+        for i in range(3):
+            if self.arg(i):
+                self.mem.write(self.arg(i), _U32.pack(0))
+
+    def system_getAccelerometer(self):
+        for i in range(3):
+            if self.arg(i):
+                self.mem.write(self.arg(i), _U32.pack(0))
+
+    def system_getCrankChange(self):
+        return 0.0
+
+    def system_getCrankAngle(self):
+        return 0.0
+
+    def system_isCrankDocked(self):
+        return 1
+
+    def system_getBatteryPercentage(self):
+        return 100.0
+
+    def system_getBatteryVoltage(self):
+        return 4.2
+
+    # -- graphics and display -------------------------------------------------
+
+    def graphics_getFrame(self):
+        return FRAME_BASE
+
+    def graphics_getDisplayFrame(self):
+        return FRAME_BASE + FRAME_SIZE
+
+    def graphics_clear(self):
+        color = self.arg(0)
+        if color in (0, 1):
+            self.mem.write(FRAME_BASE, (b'\xff' if color else b'\x00') * FRAME_SIZE)
+
+    def graphics_display(self):
+        self.mem.write(FRAME_BASE + FRAME_SIZE, self.mem.read(FRAME_BASE, FRAME_SIZE))
+
+    def graphics_newBitmap(self):
+        width, height = _sx(self.arg(0), 32), _sx(self.arg(1), 32)
+        rowbytes = ((max(width, 0) + 31) // 32) * 4
+        handle = self.alloc(16)
+        data = self.alloc(max(rowbytes * max(height, 0), 1))
+        self.bitmaps[handle] = (width, height, rowbytes, data)
+        return handle
+
+    def graphics_getBitmapData(self):
+        width, height, rowbytes, data = self.bitmaps.get(self.arg(0), (0, 0, 0, 0))
+        for i, value in enumerate((width, height, rowbytes, 0, data)):
+            addr = self.arg(i + 1)
+            if addr:
+                self.mem.write(addr, _U32.pack(value & M32))
+
+    def display_getWidth(self):
+        return 400
+
+    def display_getHeight(self):
+        return 240
+
+    # -- file -----------------------------------------------------------------
+
+    def file_path(self, name, read_data):
+        """Where a game path lives on the host, or None outside the sandbox."""
+        name = os.path.normpath(name).lstrip('/')
+        if name.startswith('..'):
+            return None
+        if read_data and self.data_dir and os.path.exists(os.path.join(self.data_dir, name)):
+            return os.path.join(self.data_dir, name)
+        if self.pdx_dir and os.path.exists(os.path.join(self.pdx_dir, name)):
+            return os.path.join(self.pdx_dir, name)
+        return None
+
+    def fail(self, message):
+        self.error = self.string(message)
+        return _sx(M32, 32)
+
+    def file_geterr(self):
+        return self.error
+
+    def file_open(self):
+        name, mode = self.mem.cstring(self.arg(0)), self.arg(1)
+        if mode & 0xc:  # kFileWrite, kFileAppend
+            if not self.data_dir:
+                self.fail('no --data directory to write to')
+                return 0
+            target = os.path.join(self.data_dir, os.path.normpath(name).lstrip('/'))
+            contents = bytearray()
+            if mode & 0x8 and os.path.exists(target):
+                with open(target, 'rb') as f:
+                    contents = bytearray(f.read())
+            handle = self.alloc(16)
+            self.files[handle] = [contents, len(contents), target]
+            return handle
+        path = self.file_path(name, mode & 0x2)
+        if path is None or os.path.isdir(path):
+            self.fail('{}: not found'.format(name))
+            return 0
+        with open(path, 'rb') as f:
+            handle = self.alloc(16)
+            self.files[handle] = [bytearray(f.read()), 0, None]
+        return handle
+
+    def file_close(self):
+        entry = self.files.pop(self.arg(0), None)
+        if entry is None:
+            return self.fail('bad file')
+        if entry[2]:
+            os.makedirs(os.path.dirname(entry[2]) or '.', exist_ok=True)
+            with open(entry[2], 'wb') as f:
+                f.write(entry[0])
+        return 0
+
+    def file_read(self):
+        entry = self.files.get(self.arg(0))
+        if entry is None:
+            return self.fail('bad file')
+        contents, position, _ = entry
+        chunk = bytes(contents[position:position + self.arg(2)])
+        if chunk:
+            self.mem.write(self.arg(1), chunk)
+        entry[1] += len(chunk)
+        return len(chunk)
+
+    def file_write(self):
+        entry = self.files.get(self.arg(0))
+        if entry is None or entry[2] is None:
+            return self.fail('bad file')
+        blob = self.mem.read(self.arg(1), self.arg(2)) if self.arg(2) else b''
+        entry[0][entry[1]:entry[1] + len(blob)] = blob
+        entry[1] += len(blob)
+        return len(blob)
+
+    def file_tell(self):
+        entry = self.files.get(self.arg(0))
+        return entry[1] if entry else self.fail('bad file')
+
+    def file_seek(self):
+        entry = self.files.get(self.arg(0))
+        if entry is None:
+            return self.fail('bad file')
+        pos, whence = _sx(self.arg(1), 32), self.arg(2)
+        base = (0, entry[1], len(entry[0]))[whence] if whence < 3 else 0
+        entry[1] = max(0, base + pos)
+        return 0
+
+    def file_stat(self):
+        path = self.file_path(self.mem.cstring(self.arg(0)), True)
+        if path is None:
+            return self.fail('not found')
+        isdir = os.path.isdir(path)
+        self.mem.write(self.arg(1), struct.pack('<8I', isdir, 0 if isdir else os.path.getsize(path), 2024, 1, 1, 0, 0, 0))
+        return 0
+
+
+# ==== Running ====
+
+def load(pdex, memory, base):
+    """Maps the image at base with relocations applied; returns the entry."""
+    image = memory.map(base, (pdex.memsz + 3) & ~3, 'image')
+    image[:pdex.filesz] = pdex.text
+    for offset in pdex.relocations():
+        value = _U32.unpack_from(image, offset)[0]
+        _U32.pack_into(image, offset, (value + base) & M32)
+    return base + pdex.entry
+
+
+def run(pdex, frames, base=BASE, pdx_dir=None, data_dir=None, limit=50000000, quiet=False, api=pdapiscan.API_HEADER):
+    """Returns (rows, host): one (frame, instructions, loads, stores, api
+    calls) row for init and each update, and the Host for its call counts."""
+    memory = Memory()
+    memory.map(STACK_TOP - STACK_SIZE, STACK_SIZE, 'stack')
+    host = Host(memory, pdapiscan.read_api_tables(api), pdx_dir, data_dir, quiet)
+    cpu = Cpu(memory, host.trap)
+    host.cpu = cpu
+    entry = load(pdex, memory, base)
+    cpu.r[13] = STACK_TOP
+
+    rows = []
+
+    def measure(label, addr, args):
+        before = (cpu.instructions, memory.loads, memory.stores, sum(host.calls.values()))
+        result = cpu.call(addr, args, limit)
+        after = (cpu.instructions, memory.loads, memory.stores, sum(host.calls.values()))
+        rows.append((label,) + tuple(a - b for a, b in zip(after, before)))
+        return result
+
+    if measure('init', entry, (host.api, kEventInit, 0)) != 0:
+        raise GuestError('eventHandler returned an error for kEventInit')
+    if host.update is None:
+        raise GuestError('the game did not call setUpdateCallback')
+    for frame in range(frames):
+        host.frame = frame
+        measure(frame, host.update, (host.userdata,))
+    cpu.call(entry, (host.api, kEventTerminate, 0), limit)
+    return rows, host
+
+
+COLUMNS = ('frame', 'instructions', 'loads', 'stores', 'api_calls')
+
+
+def write_csv(path, rows):
+    with open(path, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(COLUMNS)
+        writer.writerows(rows)
+
+
+def totals(rows):
+    return [sum(int(row[i]) for row in rows if row[0] != 'init') for i in range(1, len(COLUMNS))]
+
+
+def compare(base_path, rows, threshold):
+    """Prints the per-frame totals against a previous --csv; returns 1 if
+    any grew by more than threshold percent."""
+    with open(base_path, newline='') as f:
+        base_rows = list(csv.reader(f))[1:]
+    old, new = totals(base_rows), totals(rows)
+    frames = max(1, len([r for r in rows if r[0] != 'init']))
+    old_frames = max(1, len([r for r in base_rows if r[0] != 'init']))
+    status = 0
+    for name, a, b in zip(COLUMNS[1:], old, new):
+        a, b = a / old_frames, b / frames
+        change = (b - a) * 100 / a if a else 0.0
+        flag = ''
+        if change > threshold:
+            flag = '  REGRESSION'
+            status = 1
+        print('{:<13} {:>14.1f} -> {:>14.1f} per frame  {:+6.2f}%{}'.format(name, a, b, change, flag))
+    return status
+
+
+def print_report(rows, host, calls):
+    print('{:>6} {:>12} {:>10} {:>10} {:>6}'.format(*COLUMNS[:4], 'api'))
+    for row in rows:
+        print('{:>6} {:>12} {:>10} {:>10} {:>6}'.format(*row))
+    frames = [row for row in rows if row[0] != 'init']
+    if frames:
+        total = totals(rows)
+        print('{:>6} {:>12.0f} {:>10.0f} {:>10.0f} {:>6.1f}'.format('mean', *[t / len(frames) for t in total]))
+    if calls:
+        print('')
+        for path, count in sorted(host.calls.items(), key=lambda c: (-c[1], c[0])):
+            print('{:>8}  {}'.format(count, path))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdexrun.py',
+        description='Runs a Playdate pdex.bin in a Thumb-2 interpreter and counts instructions, '
+                    'memory accesses and API calls per frame.'
+    )
+    parser.add_argument('pdex', help='the path to the pdex.bin')
+    parser.add_argument('-n', '--frames', type=int, default=30, help='update callbacks to run (default 30)')
+    parser.add_argument('--base', type=lambda s: int(s, 0), default=BASE, help='load address (default 0x60000000)')
+    parser.add_argument('--pdx', help='directory file->open reads from (build/Source)')
+    parser.add_argument('--data', help='directory for kFileReadData and writes; writes fail without it')
+    parser.add_argument('--limit', type=int, default=50000000, help='instructions allowed per call from the host')
+    parser.add_argument('--csv', help='write the per-frame counts to this file')
+    parser.add_argument('--compare', metavar='BASE_CSV', help='compare the per-frame means against a previous --csv')
+    parser.add_argument('--threshold', type=float, default=1.0, help='percent growth --compare fails on (default 1)')
+    parser.add_argument('--calls', action='store_true', help='list the API calls made, by count')
+    parser.add_argument('--quiet', action='store_true', help='drop logToConsole output')
+    args = parser.parse_args()
+
+    try:
+        rows, host = run(pdex2elf.read_pdex(args.pdex), args.frames, args.base, args.pdx, args.data, args.limit,
+                         args.quiet)
+    except (Fault, GuestError) as e:
+        raise SystemExit('pdexrun.py: {}'.format(e))
+
+    print_report(rows, host, args.calls)
+    if args.csv:
+        write_csv(args.csv, rows)
+    if args.compare:
+        print('')
+        raise SystemExit(compare(args.compare, rows, args.threshold))
@@ -0,0 +1,222 @@
+import argparse
+import os
+import re
+
+# Generates Lua glue for C functions annotated in a header:
+#
+#   // @lua
+#   float vec_length(float x, float y);
+#
+#   // @lua class=enemy name=spawn
+#   int enemy_spawn(int kind, float x, float y, float* outX, float* outY);
+#
+# Plain functions are registered with addFunction under their C name (or
+# name=...). Functions tagged with class=... are grouped into one static
+# class per name and registered with registerClass. Pointer parameters
+# named out* become extra return values, pushed after the C return value.
+#
+# Wrappers check the argument count and then each argument's type, one
+# getArgType per argument, and raise a Lua error on a mismatch. Building the
+# generated file with -DLUAGEN_CHECK_TYPES=0 leaves only the count check,
+# for code that has been proven not to need it.
+
+ANNOTATION = re.compile(r'^\s*//\s*@lua\b(?P<opts>.*)$')
+PROTOTYPE = re.compile(r'^\s*(?P<ret>[\w\s\*]+?)\s*\b(?P<name>\w+)\s*\((?P<args>[^)]*)\)\s*;')
+
+# C type -> (lua getter, lua pusher, getArgType value, local type)
+TYPES = {
+    'int': ('getArgInt', 'pushInt', 'kTypeInt', 'int'),
+    'float': ('getArgFloat', 'pushFloat', 'kTypeFloat', 'float'),
+    'bool': ('getArgBool', 'pushBool', 'kTypeBool', 'int'),
+    'const char*': ('getArgString', 'pushString', 'kTypeString', 'const char*'),
+    'LCDBitmap*': ('getBitmap', 'pushBitmap', 'kTypeObject', 'LCDBitmap*'),
+    'LCDSprite*': ('getSprite', 'pushSprite', 'kTypeObject', 'LCDSprite*'),
+}
+
+
+def normalize(ctype):
+    ctype = re.sub(r'\s+', ' ', ctype.strip())
+    return ctype.replace(' *', '*')
+
+
+def parse_param(param):
+    param = param.strip()
+    m = re.match(r'^(?P<type>.*?[\s\*])(?P<name>\w+)$', param)
+    if m is None:
+        raise ValueError('cannot parse parameter {!r}'.format(param))
+    return normalize(m.group('type')), m.group('name')
+
+
+def parse(path):
+    functions = []
+    pending = None
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            m = ANNOTATION.match(line)
+            if m:
+                pending = dict(opt.split('=', 1) for opt in m.group('opts').split() if '=' in opt)
+                continue
+            if pending is None or not line.strip():
+                continue
+            m = PROTOTYPE.match(line)
+            if m is None:
+                raise ValueError('{}:{}: @lua must precede a one-line prototype'.format(path, lineno))
+
+            args = m.group('args').strip()
+            params = [] if args in ('', 'void') else [parse_param(p) for p in args.split(',')]
+            ins, outs = [], []
+            for ctype, name in params:
+                if name.startswith('out') and ctype.endswith('*') and ctype[:-1] in TYPES:
+                    outs.append((ctype[:-1], name))
+                elif ctype in TYPES:
+                    ins.append((ctype, name))
+                else:
+                    raise ValueError('{}:{}: unsupported parameter type {!r}'.format(path, lineno, ctype))
+
+            ret = normalize(m.group('ret'))
+            if ret != 'void' and ret not in TYPES:
+                raise ValueError('{}:{}: unsupported return type {!r}'.format(path, lineno, ret))
+
+            functions.append({
+                'cname': m.group('name'),
+                'lname': pending.get('name', m.group('name')),
+                'cls': pending.get('class'),
+                'ret': ret,
+                'ins': ins,
+                'outs': outs,
+            })
+            pending = None
+    return functions
+
+
+def wrapper(fn):
+    lines = []
+    lines.append('static int lua_{}(lua_State* L) {{'.format(fn['cname']))
+    lines.append('  const struct playdate_lua* lua = playdate->lua;')
+    lines.append('  if (lua->getArgCount() != {}) {{'.format(len(fn['ins'])))
+    lines.append('    playdate->system->error("{}: expected {} arguments");'.format(fn['lname'], len(fn['ins'])))
+    lines.append('    return 0;')
+    lines.append('  }')
+    if fn['ins']:
+        lines.append('#if LUAGEN_CHECK_TYPES')
+        for pos, (ctype, name) in enumerate(fn['ins'], 1):
+            check = 'lua->getArgType({}, NULL) != {}'.format(pos, TYPES[ctype][2])
+            if ctype == 'float':  # Lua integers convert to float
+                check = '!isNumber({})'.format(pos)
+            lines.append('  if ({}) {{'.format(check))
+            lines.append('    playdate->system->error("{}: bad type for {}");'.format(fn['lname'], name))
+            lines.append('    return 0;')
+            lines.append('  }')
+        lines.append('#endif')
+    for pos, (ctype, name) in enumerate(fn['ins'], 1):
+        lines.append('  {} {} = lua->{}({});'.format(TYPES[ctype][3], name, TYPES[ctype][0], pos))
+    for ctype, name in fn['outs']:
+        lines.append('  {} {} = 0;'.format(ctype, name))
+
+    call_args = [name for _, name in fn['ins']] + ['&' + name for _, name in fn['outs']]
+    call = '{}({})'.format(fn['cname'], ', '.join(call_args))
+    results = 0
+    if fn['ret'] == 'void':
+        lines.append('  {};'.format(call))
+    else:
+        lines.append('  {} result = {};'.format(TYPES[fn['ret']][3], call))
+        lines.append('  lua->{}(result);'.format(TYPES[fn['ret']][1]))
+        results += 1
+    for ctype, name in fn['outs']:
+        lines.append('  lua->{}({});'.format(TYPES[ctype][1], name))
+        results += 1
+    lines.append('  return {};'.format(results))
+    lines.append('}')
+    return lines
+
+
+def generate(header, functions, module):
+    out = []
+    out.append('// Generated by pdluagen.py from {}. Do not edit.'.format(os.path.basename(header)))
+    out.append('')
+    out.append('#include <playdate/api.h>')
+    out.append('#include "{}"'.format(os.path.basename(header)))
+    out.append('#include "{}_lua.h"'.format(module))
+    out.append('')
+    out.append('extern PlaydateAPI* playdate;')
+    out.append('')
+    out.append('#ifndef LUAGEN_CHECK_TYPES')
+    out.append('#define LUAGEN_CHECK_TYPES 1')
+    out.append('#endif')
+    out.append('')
+    out.append('#if LUAGEN_CHECK_TYPES')
+    out.append('static inline int isNumber(int pos) {')
+    out.append('  enum LuaType type = playdate->lua->getArgType(pos, NULL);')
+    out.append('  return type == kTypeFloat || type == kTypeInt;')
+    out.append('}')
+    out.append('#endif')
+    out.append('')
+    for fn in functions:
+        out += wrapper(fn)
+        out.append('')
+
+    classes = {}
+    for fn in functions:
+        if fn['cls']:
+            classes.setdefault(fn['cls'], []).append(fn)
+    for cls, fns in classes.items():
+        out.append('static const lua_reg {}_{}_reg[] = {{'.format(module, cls))
+        for fn in fns:
+            out.append('  {{ "{}", lua_{} }},'.format(fn['lname'], fn['cname']))
+        out.append('  { NULL, NULL }')
+        out.append('};')
+        out.append('')
+
+    out.append('int luagen_register_{}(const char** outErr) {{'.format(module))
+    for fn in functions:
+        if not fn['cls']:
+            out.append('  if (!playdate->lua->addFunction(lua_{}, "{}", outErr)) return 0;'.format(fn['cname'], fn['lname']))
+    for cls in classes:
+        out.append('  if (!playdate->lua->registerClass("{}", {}_{}_reg, NULL, 1, outErr)) return 0;'.format(cls, module, cls))
+    out.append('  return 1;')
+    out.append('}')
+    return '\n'.join(out) + '\n'
+
+
+def generate_header(header, module):
+    guard = '{}_LUA_H'.format(module.upper())
+    out = []
+    out.append('// Generated by pdluagen.py from {}. Do not edit.'.format(os.path.basename(header)))
+    out.append('')
+    out.append('#ifndef {}'.format(guard))
+    out.append('#define {}'.format(guard))
+    out.append('')
+    out.append('// call from kEventInitLua; returns 0 and sets outErr on failure')
+    out.append('int luagen_register_{}(const char** outErr);'.format(module))
+    out.append('')
+    out.append('#endif // {}'.format(guard))
+    return '\n'.join(out) + '\n'
+
+
+def write_if_changed(path, text):
+    # unchanged output keeps its mtime, so incremental builds skip it
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdluagen.py',
+        description='Generates Lua bindings for @lua annotated C prototypes.'
+    )
+    parser.add_argument('headers', nargs='+', help='annotated headers; <name>_lua.c/.h are written next to each')
+    args = parser.parse_args()
+
+    for header in args.headers:
+        functions = parse(header)
+        if not functions:
+            continue
+        module = os.path.splitext(os.path.basename(header))[0]
+        out = os.path.splitext(header)[0] + '_lua'
+        write_if_changed(out + '.h', generate_header(header, module))
+        write_if_changed(out + '.c', generate(header, functions, module))
+        print('{}: {} functions -> {}.c'.format(header, len(functions), out))
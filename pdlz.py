@@ -0,0 +1,169 @@
+import argparse
+import zlib
+
+# LZ4 block format, decoded on device by src/lz.c
+MIN_MATCH = 4
+MAX_OFFSET = 65535
+HASH_BITS = 16
+LAST_LITERALS = 5  # keep the tail as literals so the stream ends on them
+
+FRAME_MAGIC = b'PDLZ'
+
+
+def _length(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def _sequence(out, literals, match_len, offset):
+    lit = len(literals)
+    token = (min(lit, 15) << 4)
+    if match_len:
+        token |= min(match_len - MIN_MATCH, 15)
+    out.append(token)
+    if lit >= 15:
+        _length(out, lit - 15)
+    out += literals
+    if match_len:
+        out += offset.to_bytes(2, byteorder='little')
+        if match_len - MIN_MATCH >= 15:
+            _length(out, match_len - MIN_MATCH - 15)
+
+
+def compress(data):
+    n = len(data)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    limit = n - LAST_LITERALS
+    misses = 0
+
+    while i + MIN_MATCH <= limit:
+        key = data[i:i + MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = i
+        if candidate is None or i - candidate > MAX_OFFSET:
+            # skip faster through incompressible runs, like lz4's acceleration
+            misses += 1
+            i += 1 + (misses >> 6)
+            continue
+        misses = 0
+
+        # extend backwards over pending literals, then forwards
+        while i > anchor and candidate > 0 and data[i - 1] == data[candidate - 1]:
+            i -= 1
+            candidate -= 1
+        length = MIN_MATCH
+        while i + length < limit and data[i + length] == data[candidate + length]:
+            length += 1
+
+        _sequence(out, data[anchor:i], length, i - candidate)
+        for j in range(i + 1, min(i + length, limit - MIN_MATCH), 2):
+            table[data[j:j + MIN_MATCH]] = j
+        i += length
+        anchor = i
+
+    _sequence(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+
+def decompress(block, raw_size):
+    out = bytearray()
+    i = 0
+    while len(out) < raw_size:
+        token = block[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = block[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += block[i:i + lit]
+        i += lit
+        if len(out) >= raw_size:
+            break
+        offset = block[i] | (block[i + 1] << 8)
+        i += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                b = block[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        length += MIN_MATCH
+        start = len(out) - offset
+        if offset >= length:
+            out += out[start:start + length]
+        else:
+            for k in range(length):
+                out.append(out[start + k])
+    return bytes(out)
+
+
+def frame(data):
+    block = compress(data)
+    return FRAME_MAGIC + len(data).to_bytes(4, byteorder='little') + len(block).to_bytes(4, byteorder='little') + block
+
+
+def unframe(blob):
+    if blob[:4] != FRAME_MAGIC:
+        raise ValueError('not a PDLZ file')
+    raw_size = int.from_bytes(blob[4:8], byteorder='little')
+    size = int.from_bytes(blob[8:12], byteorder='little')
+    return decompress(blob[12:12 + size], raw_size)
+
+
+def bench(paths):
+    # sizes only: decode speed, which is what the device pays for, is timed
+    # against zlib's inflate by pdbench's io/lz_assets and io/zlib_assets
+    print('{:<32} {:>10} {:>10} {:>8} {:>10} {:>8}'.format('file', 'raw', 'pdlz', 'ratio', 'zlib', 'ratio'))
+    for path in paths:
+        with open(path, 'rb') as f:
+            data = f.read()
+        block = compress(data)
+        zblock = zlib.compress(data, 9)
+        if decompress(block, len(data)) != data:
+            raise ValueError('round trip failed for {}'.format(path))
+
+        print('{:<32} {:>10} {:>10} {:>7.1f}% {:>10} {:>7.1f}%'.format(
+            path[-32:], len(data), len(block), 100.0 * len(block) / max(len(data), 1),
+            len(zblock), 100.0 * len(zblock) / max(len(data), 1)))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdlz.py',
+        description='Compresses files into PDLZ frames for the on-device LZ decoder.'
+    )
+    sub = parser.add_subparsers(dest='command', required=True)
+    c = sub.add_parser('compress', help='write a PDLZ frame')
+    c.add_argument('input')
+    c.add_argument('output')
+    c.add_argument('--zlib', help='also write the input as a zlib stream here, for comparisons')
+    d = sub.add_parser('decompress', help='expand a PDLZ frame')
+    d.add_argument('input')
+    d.add_argument('output')
+    b = sub.add_parser('bench', help='report compressed sizes against zlib')
+    b.add_argument('files', nargs='+')
+    args = parser.parse_args()
+
+    if args.command == 'bench':
+        bench(args.files)
+    else:
+        with open(args.input, 'rb') as f:
+            data = f.read()
+        result = frame(data) if args.command == 'compress' else unframe(data)
+        with open(args.output, 'wb') as f:
+            f.write(result)
+        if args.command == 'compress' and args.zlib:
+            with open(args.zlib, 'wb') as f:
+                f.write(zlib.compress(data, 9))
+        print('{}: {} -> {} bytes'.format(args.input, len(data), len(result)))
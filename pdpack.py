@@ -0,0 +1,119 @@
+import argparse
+import os
+
+import pdlz
+
+PACK_MAGIC = b'PDPK'
+PACK_VERSION = 1
+PACK_HEADER_SIZE = 16
+PACK_ENTRY_SIZE = 24
+
+CODEC_STORED = 0
+CODEC_LZ = 1
+
+
+def fnv1a(name):
+    h = 0x811c9dc5
+    for b in name.encode():
+        h = ((h ^ b) * 0x01000193) & 0xffffffff
+    return h
+
+
+def collect(root, exclude):
+    paths = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for filename in sorted(filenames):
+            if filename.startswith('.'):
+                continue
+            if os.path.splitext(filename)[1].lstrip('.').lower() in exclude:
+                continue
+            full = os.path.join(dirpath, filename)
+            paths.append((os.path.relpath(full, root).replace(os.sep, '/'), full))
+    return paths
+
+
+def build_pack(entries, align, compress):
+    # index sorted by (hash, name) so the runtime can binary search it
+    entries = sorted(entries, key=lambda e: (fnv1a(e[0]), e[0]))
+
+    names = bytearray()
+    name_offsets = []
+    for name, _ in entries:
+        name_offsets.append(len(names))
+        names += name.encode() + b'\0'
+
+    data_offset = PACK_HEADER_SIZE + PACK_ENTRY_SIZE * len(entries) + len(names)
+    data_offset = (data_offset + align - 1) & ~(align - 1)
+
+    index = bytearray()
+    payload = bytearray()
+    for (name, data), name_offset in zip(entries, name_offsets):
+        stored, entry_codec = data, CODEC_STORED
+        if compress:
+            packed = pdlz.compress(data)
+            if len(packed) < len(data):
+                stored, entry_codec = packed, CODEC_LZ
+        payload += b'\0' * (-len(payload) % align)
+        index += fnv1a(name).to_bytes(4, byteorder='little')
+        index += name_offset.to_bytes(4, byteorder='little')
+        index += (data_offset + len(payload)).to_bytes(4, byteorder='little')
+        index += len(stored).to_bytes(4, byteorder='little')
+        index += len(data).to_bytes(4, byteorder='little')
+        index += entry_codec.to_bytes(1, byteorder='little')
+        index += b'\0\0\0'
+        payload += stored
+
+    header = bytearray()
+    header += PACK_MAGIC
+    header += PACK_VERSION.to_bytes(2, byteorder='little')
+    header += align.to_bytes(2, byteorder='little')
+    header += len(entries).to_bytes(4, byteorder='little')
+    header += len(names).to_bytes(4, byteorder='little')
+
+    body = header + index + names
+    return body + b'\0' * (data_offset - len(body)) + payload
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdpack.py',
+        description='Packs a directory of assets into a single indexed archive.'
+    )
+    parser.add_argument('dir', help='the asset directory to pack')
+    parser.add_argument('pack', help='the path to the output pack file')
+    parser.add_argument('--align', type=int, default=16, help='entry alignment in bytes (power of two)')
+    parser.add_argument('--exclude', default='', help='comma separated extensions to leave as loose files')
+    parser.add_argument('--compress', action='store_true', help='LZ compress entries that get smaller')
+    parser.add_argument('--remove', action='store_true', help='delete packed files from dir afterwards')
+    args = parser.parse_args()
+
+    if args.align <= 0 or args.align & (args.align - 1):
+        raise ValueError('alignment must be a power of two')
+
+    exclude = set(e.strip().lstrip('.').lower() for e in args.exclude.split(',') if e.strip())
+    files = collect(args.dir, exclude)
+
+    entries = []
+    for name, full in files:
+        with open(full, 'rb') as f:
+            entries.append((name, f.read()))
+
+    names = [name for name, _ in entries]
+    hashes = [fnv1a(name) for name in names]
+    if len(set(hashes)) != len(hashes):
+        print('warning: hash collision in index, lookups fall back to name compare')
+
+    pack = build_pack(entries, args.align, args.compress)
+    with open(args.pack, 'wb') as out:
+        out.write(pack)
+
+    if args.remove:
+        for _, full in files:
+            os.remove(full)
+
+    raw = sum(len(data) for _, data in entries)
+    print('pack info:')
+    print('  Entries:           {}'.format(len(entries)))
+    print('  Raw size:          {}'.format(raw))
+    print('  Pack size:         {}'.format(len(pack)))
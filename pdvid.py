@@ -0,0 +1,466 @@
+import argparse
+import os
+import random
+import struct
+import time
+import zlib
+
+# 1bpp delta video, decoded on device by src/vid.c straight into the frame
+# buffer. Bits follow the frame buffer: 1 is white.
+#
+# File: "PDVD", u16 version, u16 width, u16 height, u32 frames, f32 rate,
+# then one record per frame: u8 flags, a changed-row bitmap (delta frames
+# only, bit r & 7 of byte r >> 3), then the ops of every changed row. Key
+# frames hold every row and store it; delta frames XOR it into the previous
+# frame. Rows are decoded top to bottom, or bottom to top with VID_BOTTOM_UP.
+# Row ops cover the row exactly, left to right:
+#   0x00-0x3f  n + 1 bytes unchanged (zero in a key frame)
+#   0x40       the whole row follows as it is
+#   0x41 o     the row is a copy of row r + o, nothing follows
+#   0x42 o s   the row starts as row r + o shifted s pixels right, and its
+#              remaining ops XOR onto that, key frame or not
+#   0x80-0xbf  (n & 0x3f) + 1 literal bytes follow
+#   0xc0-0xff  (n & 0x3f) + 1 repeats of the byte that follows
+# 0x40-0x42 only start a row; o and s are signed bytes. Copies read rows as
+# they stand at that point: rows already decoded in this frame hold the new
+# frame, the others the previous one, which key frames may not rely on.
+VID_MAGIC = b'PDVD'
+VID_VERSION = 2
+VID_KEY = 1
+VID_BOTTOM_UP = 2
+
+OP_STORED = 0x40
+OP_COPY = 0x41
+OP_SHIFT = 0x42
+
+MAX_SKIP = 64
+MAX_RUN = 64
+MAX_OFFSET = 127
+NEAR_ROWS = 8   # rows either side tried as moved with changes, besides exact copies
+MAX_SHIFT = 8   # pixels tried for sideways moves
+TRY_MOVES = 8   # rows whose plain ops are this short are not worth a search
+KEEP_MOVES = 2  # best guesses by changed bytes that are encoded in full
+
+# the built-in format, for size comparisons
+PDV_MAGIC = b'Playdate VID\0\0\0\0'
+PDV_IFRAME = 1
+PDV_PFRAME = 2
+
+
+def row_bytes(width):
+    return (width + 7) >> 3
+
+
+def _run(data, i, value):
+    j = i
+    while j < len(data) and data[j] == value:
+        j += 1
+    return j - i
+
+
+def encode_row(delta):
+    out = bytearray()
+    i = 0
+    n = len(delta)
+    while i < n:
+        run = _run(delta, i, delta[i])
+        if delta[i] == 0:
+            run = min(run, MAX_SKIP)
+            out.append(run - 1)
+        elif run >= 3:
+            run = min(run, MAX_RUN)
+            out += bytes((0xc0 | (run - 1), delta[i]))
+        else:
+            # literals up to the next zero pair or run of three
+            j = i
+            while j < n and j - i < MAX_RUN:
+                if delta[j] == 0 and (j + 1 == n or delta[j + 1] == 0):
+                    break
+                if _run(delta, j, delta[j]) >= 3:
+                    break
+                j += 1
+            run = j - i
+            out.append(0x80 | (run - 1))
+            out += delta[i:j]
+        i += run
+    return out
+
+
+def xor(a, b):
+    return (int.from_bytes(a, 'big') ^ int.from_bytes(b, 'big')).to_bytes(len(a), 'big')
+
+
+def shift_row(row, s):
+    # vacated pixels are clear, as in src/vid.c
+    if s == 0:
+        return row
+    v = int.from_bytes(row, 'big')
+    v = v >> s if s > 0 else (v << -s) & ((1 << (len(row) * 8)) - 1)
+    return v.to_bytes(len(row), 'big')
+
+
+def _changed_bytes(a, b):
+    d = xor(a, b)
+    return len(d) - d.count(0)
+
+
+def encode_rows(prev, frame, rows, key, order):
+    # state is what each row of the target holds at this point of decoding,
+    # None where a key frame may not rely on it
+    height = len(frame)
+    state = [None] * height if key else list(prev)
+    holding = {}
+    for r, row in enumerate(state):
+        if row is not None:
+            holding.setdefault(row, set()).add(r)
+    zero = bytes(len(frame[0]))
+    out = bytearray()
+    for r in sorted(rows, reverse=order == VID_BOTTOM_UP):
+        target = frame[r]
+        best = bytes((OP_STORED,)) + target
+        plain = encode_row(xor(target, zero if key else state[r]))
+        if len(plain) < len(best):
+            best = plain
+
+        if len(best) > 2:
+            for source in holding.get(target, ()):
+                if source != r and abs(source - r) <= MAX_OFFSET:
+                    best = bytes((OP_COPY, (source - r) & 0xff))
+                    break
+
+        if len(best) > TRY_MOVES:
+            moves = []
+            for o in range(-NEAR_ROWS, NEAR_ROWS + 1):
+                if o and 0 <= r + o < height and state[r + o] is not None:
+                    moves.append((o, 0))
+            if not key:
+                moves += [(0, s) for s in range(-MAX_SHIFT, MAX_SHIFT + 1) if s]
+            guesses = sorted(moves, key=lambda m: _changed_bytes(target, shift_row(state[r + m[0]], m[1])))
+            for o, s in guesses[:KEEP_MOVES]:
+                ops = encode_row(xor(target, shift_row(state[r + o], s)))
+                if 3 + len(ops) < len(best):
+                    best = bytes((OP_SHIFT, o & 0xff, s & 0xff)) + ops
+
+        out += best
+        if state[r] is not None:
+            holding[state[r]].discard(r)
+        state[r] = target
+        holding.setdefault(target, set()).add(r)
+    return out
+
+
+def encode_frame(prev, frame, key):
+    if key:
+        rows = range(len(frame))
+        mask = b''
+    else:
+        rows = [r for r, (a, b) in enumerate(zip(prev, frame)) if a != b]
+        mask = bytearray((len(frame) + 7) >> 3)
+        for r in rows:
+            mask[r >> 3] |= 1 << (r & 7)
+    best = None
+    for order in (0, VID_BOTTOM_UP):
+        data = encode_rows(prev, frame, rows, key, order)
+        if best is None or len(data) < len(best[1]):
+            best = (order, data)
+    flags = (VID_KEY if key else 0) | best[0]
+    return bytes((flags,)) + bytes(mask) + bytes(best[1])
+
+
+def encode(frames, width, height, rate, key_interval):
+    out = bytearray(VID_MAGIC + struct.pack('<HHHIf', VID_VERSION, width, height, len(frames), rate))
+    prev = None
+    for n, frame in enumerate(frames):
+        key = prev is None or (key_interval and n % key_interval == 0)
+        data = encode_frame(prev, frame, True) if key else encode_frame(prev, frame, False)
+        if not key:
+            # a cut costs less as a key frame
+            whole = encode_frame(prev, frame, True)
+            if len(whole) <= len(data):
+                data = whole
+        out += data
+        prev = frame
+    return bytes(out)
+
+
+def decode(blob):
+    if blob[:4] != VID_MAGIC:
+        raise ValueError('not a PDVD file')
+    version, width, height, count, rate = struct.unpack_from('<HHHIf', blob, 4)
+    if version != VID_VERSION:
+        raise ValueError('unsupported PDVD version {}'.format(version))
+    stride = row_bytes(width)
+    pos = 18
+    frame = [bytes(stride) for _ in range(height)]
+    frames = []
+    for _ in range(count):
+        flags = blob[pos]
+        pos += 1
+        key = flags & VID_KEY
+        if key:
+            changed = list(range(height))
+        else:
+            mask = blob[pos:pos + ((height + 7) >> 3)]
+            pos += len(mask)
+            changed = [r for r in range(height) if mask[r >> 3] >> (r & 7) & 1]
+        if flags & VID_BOTTOM_UP:
+            changed.reverse()
+        for r in changed:
+            op = blob[pos]
+            if op == OP_STORED:
+                frame[r] = blob[pos + 1:pos + 1 + stride]
+                pos += 1 + stride
+                continue
+            if op == OP_COPY:
+                frame[r] = frame[r + struct.unpack_from('b', blob, pos + 1)[0]]
+                pos += 2
+                continue
+            row = bytearray(stride if key else frame[r])
+            xor_ops = not key
+            if op == OP_SHIFT:
+                o, s = struct.unpack_from('bb', blob, pos + 1)
+                row = bytearray(shift_row(frame[r + o], s))
+                xor_ops = True
+                pos += 3
+            x = 0
+            while x < stride:
+                op = blob[pos]
+                pos += 1
+                if op < 0x40:
+                    x += op + 1
+                    continue
+                if op < 0x80:
+                    raise ValueError('row op {:#x} inside a row'.format(op))
+                n = (op & 0x3f) + 1
+                data = blob[pos:pos + n] if op < 0xc0 else bytes((blob[pos],)) * n
+                pos += n if op < 0xc0 else 1
+                for k in range(n):
+                    row[x + k] = row[x + k] ^ data[k] if xor_ops else data[k]
+                x += n
+            frame[r] = bytes(row)
+        frames.append(list(frame))
+    return width, height, rate, frames
+
+
+def pdv(frames, width, height, rate):
+    # zlib per frame, P-frames XOR against the previous one, like pdc's output
+    chunks = []
+    types = []
+    prev = None
+    for frame in frames:
+        raw = b''.join(frame)
+        if prev is None:
+            chunks.append(zlib.compress(raw, 9))
+            types.append(PDV_IFRAME)
+        else:
+            chunks.append(zlib.compress(bytes(x ^ y for x, y in zip(prev, raw)), 9))
+            types.append(PDV_PFRAME)
+        prev = raw
+    out = bytearray(PDV_MAGIC + struct.pack('<HHfHH', len(frames), 0, rate, width, height))
+    offset = 0
+    for chunk, kind in zip(chunks, types):
+        out += struct.pack('<I', offset << 2 | kind)
+        offset += len(chunk)
+    out += struct.pack('<I', offset << 2)
+    for chunk in chunks:
+        out += chunk
+    return bytes(out)
+
+
+def read_pbm(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    tokens = []
+    pos = 0
+    while len(tokens) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            pos = data.index(b'\n', pos)
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        tokens.append(data[start:pos])
+    kind, width, height = tokens[0], int(tokens[1]), int(tokens[2])
+    stride = row_bytes(width)
+    if kind == b'P4':
+        pixels = data[pos + 1:pos + 1 + stride * height]
+        rows = [pixels[r * stride:(r + 1) * stride] for r in range(height)]
+    elif kind == b'P1':
+        bits = [c == ord('1') for c in data[pos:] if c in b'01']
+        rows = []
+        for r in range(height):
+            row = bytearray(stride)
+            for x in range(width):
+                if bits[r * width + x]:
+                    row[x >> 3] |= 0x80 >> (x & 7)
+            rows.append(bytes(row))
+    else:
+        raise ValueError('{}: not a PBM file'.format(path))
+    # PBM 1 is black, the frame buffer's is white; padding bits stay clear
+    pad = (0xff << (stride * 8 - width)) & 0xff
+    rows = [bytes(b ^ 0xff for b in row[:-1]) + bytes(((row[-1] ^ 0xff) & pad,)) for row in rows]
+    return width, height, rows
+
+
+def load_frames(path, size):
+    if os.path.isdir(path):
+        names = sorted(n for n in os.listdir(path) if n.lower().endswith('.pbm'))
+        if not names:
+            raise ValueError('{}: no .pbm frames'.format(path))
+        frames = []
+        width = height = None
+        for name in names:
+            w, h, rows = read_pbm(os.path.join(path, name))
+            if width is not None and (w, h) != (width, height):
+                raise ValueError('{}: frame size {}x{} differs from {}x{}'.format(name, w, h, width, height))
+            width, height = w, h
+            frames.append(rows)
+        return width, height, frames
+
+    # raw frame buffer rows, one frame after another
+    if size is None:
+        raise ValueError('{}: raw input needs --size'.format(path))
+    width, height = size
+    stride = row_bytes(width)
+    with open(path, 'rb') as f:
+        data = f.read()
+    frame_size = stride * height
+    if len(data) % frame_size:
+        raise ValueError('{}: {} bytes is not a whole number of {}x{} frames'.format(path, len(data), width, height))
+    frames = []
+    for at in range(0, len(data), frame_size):
+        frames.append([data[at + r * stride:at + (r + 1) * stride] for r in range(height)])
+    return width, height, frames
+
+
+# -- Samples ------------------------------------------------------------------
+
+def _blank(width, height, value):
+    return [bytearray([value] * row_bytes(width)) for _ in range(height)]
+
+
+def _box(rows, x0, y0, w, h, white):
+    for y in range(max(y0, 0), min(y0 + h, len(rows))):
+        row = rows[y]
+        for x in range(max(x0, 0), min(x0 + w, len(row) * 8)):
+            if white:
+                row[x >> 3] |= 0x80 >> (x & 7)
+            else:
+                row[x >> 3] &= ~(0x80 >> (x & 7)) & 0xff
+
+
+def sample(kind, count=90, width=400, height=240):
+    frames = []
+    rng = random.Random(1)
+    stride = row_bytes(width)
+    if kind == 'sprite':
+        # a box bouncing over a dithered background, mostly unchanged rows
+        background = [bytes([0xaa if y & 1 else 0x55] * stride) for y in range(height)]
+        x, y, dx, dy = 10, 20, 7, 5
+        for _ in range(count):
+            rows = [bytearray(row) for row in background]
+            _box(rows, x, y, 32, 32, False)
+            frames.append([bytes(row) for row in rows])
+            x, y = x + dx, y + dy
+            if x < 0 or x + 32 > width:
+                dx = -dx
+            if y < 0 or y + 32 > height:
+                dy = -dy
+    elif kind == 'scroll':
+        # a pattern panning sideways two pixels a frame, every row changes
+        pattern = [[rng.getrandbits(8) for _ in range(stride * 2)] for _ in range(16)]
+        for n in range(count):
+            shift = n * 2
+            rows = []
+            for y in range(height):
+                source = pattern[(y >> 2) & 15]
+                bits = int.from_bytes(bytes(source), 'big')
+                span = stride * 16
+                bits = ((bits << (shift % span)) | (bits >> (span - shift % span))) & ((1 << span) - 1)
+                rows.append(bits.to_bytes(stride * 2, 'big')[:stride])
+            frames.append(rows)
+    elif kind == 'wipe':
+        # a dithered picture revealed a few rows at a time, then a cut to black
+        picture = [bytes(rng.getrandbits(8) & (0xff if y & 2 else 0x0f) for _ in range(stride)) for y in range(height)]
+        for n in range(count):
+            reveal = min(height, n * height // max(count - 10, 1))
+            rows = [picture[y] if y < reveal else bytes(stride) for y in range(height)]
+            if n >= count - 10:
+                rows = [bytes(stride)] * height
+            frames.append(rows)
+    else:
+        raise ValueError('unknown sample {}'.format(kind))
+    return width, height, frames
+
+
+SAMPLES = ('sprite', 'scroll', 'wipe')
+
+
+# -- Commands -----------------------------------------------------------------
+
+def bench(clips, rate, key_interval):
+    print('{:<24} {:>6} {:>10} {:>10} {:>8} {:>10} {:>8} {:>10}'.format(
+        'clip', 'frames', 'raw', 'pdvid', 'ratio', 'pdv', 'ratio', 'rows/frame'))
+    for name, (width, height, frames) in clips:
+        t = time.perf_counter()
+        blob = encode(frames, width, height, rate, key_interval)
+        elapsed = time.perf_counter() - t
+        if decode(blob)[3] != [list(f) for f in frames]:
+            raise ValueError('round trip failed for {}'.format(name))
+        raw = len(frames) * height * row_bytes(width)
+        builtin = len(pdv(frames, width, height, rate))
+        changed = sum(sum(a != b for a, b in zip(p, f)) for p, f in zip([frames[0]] + frames, frames)) + height
+        print('{:<24} {:>6} {:>10} {:>10} {:>7.1f}% {:>10} {:>7.1f}% {:>10.1f}  ({:.2f}s)'.format(
+            name[-24:], len(frames), raw, len(blob), 100.0 * len(blob) / raw,
+            builtin, 100.0 * builtin / raw, changed / len(frames), elapsed))
+
+
+def write(path, data):
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        prog='pdvid.py',
+        description='Encodes 1bpp clips into PDVD delta video for the on-device decoder in src/vid.c.'
+    )
+    sub = parser.add_subparsers(dest='command', required=True)
+    e = sub.add_parser('encode', help='write a PDVD file from a directory of .pbm frames or a raw frame dump')
+    e.add_argument('input')
+    e.add_argument('output')
+    s = sub.add_parser('sample', help='write one of the synthetic sample clips')
+    s.add_argument('kind', choices=SAMPLES)
+    s.add_argument('output')
+    s.add_argument('--frames', type=int, default=90)
+    b = sub.add_parser('bench', help='report size against raw frames and the built-in .pdv format')
+    b.add_argument('inputs', nargs='*')
+    b.add_argument('--samples', action='store_true', help='include the synthetic sample clips')
+    for p in (e, s, b):
+        p.add_argument('--rate', type=float, default=30, help='frames per second (default 30)')
+        p.add_argument('--key', type=int, default=0, help='key frame interval, 0 for only the first (default)')
+    for p in (e, b):
+        p.add_argument('--size', type=lambda v: tuple(int(n) for n in v.split('x')), help='WxH of raw input')
+    for p in (e, s):
+        p.add_argument('--pdv', help='also write the clip in the built-in .pdv format here')
+    args = parser.parse_args()
+
+    if args.command == 'bench':
+        clips = [(path, load_frames(path, args.size)) for path in args.inputs]
+        if args.samples:
+            clips += [(kind, sample(kind)) for kind in SAMPLES]
+        if not clips:
+            parser.error('no clips: give inputs or --samples')
+        bench(clips, args.rate, args.key)
+    else:
+        if args.command == 'encode':
+            width, height, frames = load_frames(args.input, args.size)
+        else:
+            width, height, frames = sample(args.kind, args.frames)
+        blob = encode(frames, width, height, args.rate, args.key)
+        write(args.output, blob)
+        if args.pdv:
+            write(args.pdv, pdv(frames, width, height, args.rate))
+        print('{}: {} frames {}x{} -> {} bytes'.format(args.output, len(frames), width, height, len(blob)))
@@ -0,0 +1,125 @@
+#include "assetpack.h"
+
+extern PlaydateAPI* playdate;
+
+#define ASSETPACK_HEADER_SIZE 16
+
+static uint32_t fnv1a(const char* s) {
+  uint32_t h = 0x811c9dc5;
+  while (*s) h = (h ^ (uint8_t)*s++) * 0x01000193;
+  return h;
+}
+
+static inline uint32_t le32(const uint8_t* b) {
+  return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+AssetPack* assetpack_open(const char* path, const char** outErr) {
+  SDFile* file = playdate->file->open(path, kFileRead | kFileReadData);
+  if (file == NULL) {
+    if (outErr) *outErr = playdate->file->geterr();
+    return NULL;
+  }
+
+  uint8_t header[ASSETPACK_HEADER_SIZE];
+  if (playdate->file->read(file, header, sizeof(header)) != sizeof(header) || memcmp(header, "PDPK", 4) != 0) {
+    if (outErr) *outErr = "not an asset pack";
+    playdate->file->close(file);
+    return NULL;
+  }
+  if ((header[4] | (header[5] << 8)) != ASSETPACK_VERSION) {
+    if (outErr) *outErr = "unsupported asset pack version";
+    playdate->file->close(file);
+    return NULL;
+  }
+
+  int count = le32(header + 8);
+  uint32_t namesSize = le32(header + 12);
+  uint32_t tableSize = count * sizeof(AssetPackEntry) + namesSize;
+
+  // index and names are read in one go and used in place
+  AssetPack* pack = playdate->system->realloc(NULL, sizeof(AssetPack));
+  void* alloc = playdate->system->realloc(NULL, tableSize);
+  if (pack == NULL || alloc == NULL || playdate->file->read(file, alloc, tableSize) != (int)tableSize) {
+    if (outErr) *outErr = "truncated asset pack";
+    if (pack) playdate->system->realloc(pack, 0);
+    if (alloc) playdate->system->realloc(alloc, 0);
+    playdate->file->close(file);
+    return NULL;
+  }
+
+  pack->file = file;
+  pack->count = count;
+  pack->align = header[6] | (header[7] << 8);
+  pack->alloc = alloc;
+  pack->entries = alloc;
+  pack->names = (const char*)alloc + count * sizeof(AssetPackEntry);
+  return pack;
+}
+
+void assetpack_close(AssetPack* pack) {
+  playdate->file->close(pack->file);
+  playdate->system->realloc(pack->alloc, 0);
+  playdate->system->realloc(pack, 0);
+}
+
+int assetpack_find(AssetPack* pack, const char* name) {
+  uint32_t hash = fnv1a(name);
+  int lo = 0, hi = pack->count;
+
+  while (lo < hi) {
+    int mid = (lo + hi) >> 1;
+    if (pack->entries[mid].hash < hash) lo = mid + 1;
+    else hi = mid;
+  }
+  for (; lo < pack->count && pack->entries[lo].hash == hash; lo++) {
+    if (strcmp(pack->names + pack->entries[lo].name, name) == 0) return lo;
+  }
+  return -1;
+}
+
+int assetpack_begin(AssetPack* pack, int index, void* dst, uint32_t cap, LZDecoder* dec) {
+  if (index < 0 || index >= pack->count) return -1;
+  AssetPackEntry* e = &pack->entries[index];
+  if (cap < e->rawSize) return -1;
+
+  if (e->codec == kAssetPackLZ) lz_init(dec, dst, e->rawSize, 0);
+  else if (e->codec == kAssetPackStored) lz_initStored(dec, dst, e->rawSize);
+  else return -1;
+
+  lz_attachFile(dec, pack->file, e->offset, e->size);
+  return 0;
+}
+
+int assetpack_read(AssetPack* pack, int index, void* dst, uint32_t cap) {
+  if (index < 0 || index >= pack->count) return -1;
+  AssetPackEntry* e = &pack->entries[index];
+  if (cap < e->rawSize) return -1;
+
+  if (e->codec == kAssetPackStored) {
+    if (playdate->file->seek(pack->file, e->offset, SEEK_SET) < 0) return -1;
+    return playdate->file->read(pack->file, dst, e->size);
+  }
+
+  LZDecoder dec;
+  if (assetpack_begin(pack, index, dst, cap, &dec) < 0) return -1;
+  while (!lz_done(&dec)) {
+    if (lz_decode(&dec, UINT32_MAX) <= 0 && !lz_done(&dec)) return -1;
+  }
+  return e->rawSize;
+}
+
+void* assetpack_load(AssetPack* pack, const char* name, uint32_t* outSize) {
+  int index = assetpack_find(pack, name);
+  if (index < 0) return NULL;
+
+  uint32_t size = assetpack_size(pack, index);
+  void* data = playdate->system->realloc(NULL, size ? size : 1);
+  if (data == NULL) return NULL;
+  if (assetpack_read(pack, index, data, size) != (int)size) {
+    playdate->system->realloc(data, 0);
+    return NULL;
+  }
+  if (outSize) *outSize = size;
+  return data;
+}
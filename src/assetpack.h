@@ -0,0 +1,65 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <playdate/api.h>
+#include "lz.h"
+
+// Reader for the single-file asset pack written by pdpack.py. Opening a pack
+// costs one open and one read for the header, index and names; each entry is
+// then loaded with one seek and one read straight into caller memory, or
+// streamed through the LZ decoder in LZ_CHUNK reads when it is compressed.
+//
+// Layout (little-endian):
+//   header  "PDPK", u16 version, u16 align, u32 count, u32 namesSize
+//   index   count x AssetPackEntry, sorted by (hash, name)
+//   names   NUL terminated paths relative to the packed directory
+//   data    entries, each aligned to `align`
+
+#define ASSETPACK_VERSION 1
+
+typedef enum
+{
+  kAssetPackStored = 0,
+  kAssetPackLZ = 1, // LZ4 block, see lz.h
+} AssetPackCodec;
+
+typedef struct
+{
+  uint32_t hash; // FNV-1a of the name
+  uint32_t name; // offset into the names block
+  uint32_t offset;
+  uint32_t size; // bytes stored in the pack
+  uint32_t rawSize; // bytes after decoding
+  uint8_t codec;
+  uint8_t pad[3];
+} AssetPackEntry;
+
+typedef struct
+{
+  SDFile* file;
+  int count;
+  int align;
+  AssetPackEntry* entries;
+  const char* names;
+  void* alloc;
+} AssetPack;
+
+AssetPack* assetpack_open(const char* path, const char** outErr);
+void assetpack_close(AssetPack* pack);
+
+int assetpack_find(AssetPack* pack, const char* name); // entry index or -1
+static inline uint32_t assetpack_size(AssetPack* pack, int index) { return pack->entries[index].rawSize; }
+static inline const char* assetpack_name(AssetPack* pack, int index) { return pack->names + pack->entries[index].name; }
+
+// loads entry `index` into dst, which must hold assetpack_size() bytes;
+// returns bytes written or -1
+int assetpack_read(AssetPack* pack, int index, void* dst, uint32_t cap);
+
+// incremental variant: sets dec up to load entry `index` into dst, then call
+// lz_decode()/lz_decodeFor() once per frame until lz_done()
+int assetpack_begin(AssetPack* pack, int index, void* dst, uint32_t cap, LZDecoder* dec);
+
+// convenience: looks up name and loads it into a new allocation
+void* assetpack_load(AssetPack* pack, const char* name, uint32_t* outSize);
+
+#endif // ASSETPACK_H
@@ -0,0 +1,296 @@
+#include "assets.h"
+#include "timing.h"
+
+extern PlaydateAPI* playdate;
+
+#define ASSETS_FONT_ESTIMATE 4096 // fonts expose no size; used when stat fails
+
+typedef enum
+{
+  kEntryFree,
+  kEntryQueued,
+  kEntryLoaded
+} EntryState;
+
+typedef struct
+{
+  EntryState state;
+  AssetType type;
+  char* path;
+  uint32_t hash;
+  void* object;
+  uint32_t bytes;
+  uint32_t refs;
+  uint32_t lastUsed;
+  uint32_t loadUs;
+  uint16_t generation;
+} AssetEntry;
+
+static AssetEntry entries[ASSETS_MAX];
+static AssetStats stats;
+static uint32_t tick;
+
+static uint16_t queue[ASSETS_MAX];
+static int queueHead, queueCount;
+
+// -- Handles ------------------------------------------------------------------
+
+static inline AssetHandle makeHandle(int index) {
+  return ((uint32_t)entries[index].generation << 16) | (uint32_t)(index + 1);
+}
+
+static AssetEntry* resolve(AssetHandle handle) {
+  int index = (int)(handle & 0xffff) - 1;
+  if (index < 0 || index >= ASSETS_MAX) return NULL;
+  AssetEntry* e = &entries[index];
+  if (e->state != kEntryLoaded || e->generation != (handle >> 16)) return NULL;
+  e->lastUsed = ++tick;
+  return e;
+}
+
+static uint32_t pathHash(const char* s) {
+  uint32_t h = 0x811c9dc5;
+  while (*s) h = (h ^ (uint8_t)*s++) * 0x01000193;
+  return h;
+}
+
+static int find(AssetType type, const char* path, uint32_t hash) {
+  for (int i = 0; i < ASSETS_MAX; i++) {
+    AssetEntry* e = &entries[i];
+    if (e->state != kEntryFree && e->hash == hash && e->type == type && strcmp(e->path, path) == 0) return i;
+  }
+  return -1;
+}
+
+static int allocEntry(AssetType type, const char* path, uint32_t hash) {
+  for (int i = 0; i < ASSETS_MAX; i++) {
+    AssetEntry* e = &entries[i];
+    if (e->state != kEntryFree) continue;
+    size_t len = strlen(path) + 1;
+    e->path = playdate->system->realloc(NULL, len);
+    if (e->path == NULL) return -1;
+    memcpy(e->path, path, len);
+    e->type = type;
+    e->hash = hash;
+    e->object = NULL;
+    e->bytes = e->refs = e->loadUs = 0;
+    e->lastUsed = ++tick;
+    e->state = kEntryQueued;
+    return i;
+  }
+  playdate->system->logToConsole("assets: table full, cannot track %s", path);
+  return -1;
+}
+
+// -- Loading and eviction -----------------------------------------------------
+
+static uint32_t measure(AssetEntry* e) {
+  int width, height, rowbytes, count;
+  uint8_t *mask, *data;
+  FileStat st;
+
+  switch (e->type) {
+    case kAssetBitmap:
+      playdate->graphics->getBitmapData(e->object, &width, &height, &rowbytes, &mask, &data);
+      return rowbytes * height * (mask ? 2 : 1);
+
+    case kAssetBitmapTable: {
+      playdate->graphics->getBitmapTableInfo(e->object, &count, &width);
+      LCDBitmap* first = playdate->graphics->getTableBitmap(e->object, 0);
+      if (first == NULL) return 0;
+      playdate->graphics->getBitmapData(first, &width, &height, &rowbytes, &mask, &data);
+      return count * rowbytes * height * (mask ? 2 : 1);
+    }
+
+    case kAssetFont: {
+      char* pft = NULL;
+      playdate->system->formatString(&pft, "%s.pft", e->path);
+      int found = pft && playdate->file->stat(pft, &st) == 0;
+      if (pft) playdate->system->realloc(pft, 0);
+      return found ? st.size : ASSETS_FONT_ESTIMATE;
+    }
+
+    case kAssetSample: {
+      SoundFormat format;
+      uint32_t rate, length;
+      playdate->sound->sample->getData(e->object, &data, &format, &rate, &length);
+      return length;
+    }
+  }
+  return 0;
+}
+
+static void unload(AssetEntry* e) {
+  switch (e->type) {
+    case kAssetBitmap: playdate->graphics->freeBitmap(e->object); break;
+    case kAssetBitmapTable: playdate->graphics->freeBitmapTable(e->object); break;
+    case kAssetFont: playdate->system->realloc(e->object, 0); break; // no freeFont in the C API
+    case kAssetSample: playdate->sound->sample->freeSample(e->object); break;
+  }
+  stats.resident -= e->bytes;
+  stats.count--;
+  e->object = NULL;
+  e->bytes = 0;
+}
+
+static void freeEntry(AssetEntry* e) {
+  if (e->state == kEntryLoaded) unload(e);
+  playdate->system->realloc(e->path, 0);
+  e->path = NULL;
+  e->state = kEntryFree;
+  e->generation++;
+}
+
+// evicts least recently used unreferenced assets until `incoming` more bytes fit
+static void makeRoom(uint32_t incoming, const AssetEntry* keep) {
+  while (stats.resident + incoming > stats.budget) {
+    AssetEntry* victim = NULL;
+    for (int i = 0; i < ASSETS_MAX; i++) {
+      AssetEntry* e = &entries[i];
+      if (e->state != kEntryLoaded || e->refs || e == keep) continue;
+      if (victim == NULL || e->lastUsed < victim->lastUsed) victim = e;
+    }
+    if (victim == NULL) return; // everything is in use, go over budget
+    freeEntry(victim);
+    stats.evictions++;
+  }
+}
+
+static int load(AssetEntry* e) {
+  const char* err = NULL;
+  timing_init();
+  uint32_t start = timing_now();
+
+  switch (e->type) {
+    case kAssetBitmap: e->object = playdate->graphics->loadBitmap(e->path, &err); break;
+    case kAssetBitmapTable: e->object = playdate->graphics->loadBitmapTable(e->path, &err); break;
+    case kAssetFont: e->object = playdate->graphics->loadFont(e->path, &err); break;
+    case kAssetSample: e->object = playdate->sound->sample->load(e->path); break;
+  }
+  if (e->object == NULL) {
+    playdate->system->logToConsole("assets: cannot load %s: %s", e->path, err ? err : "unknown error");
+    return -1;
+  }
+
+  e->loadUs = timing_ticksToMicros(timing_now() - start);
+  e->bytes = measure(e);
+  e->state = kEntryLoaded;
+  stats.loadUs += e->loadUs;
+  stats.resident += e->bytes;
+  stats.count++;
+  makeRoom(0, e);
+  return 0;
+}
+
+// -- Public API ---------------------------------------------------------------
+
+void assets_init(uint32_t budgetBytes) {
+  for (int i = 0; i < ASSETS_MAX; i++) {
+    if (entries[i].state != kEntryFree) freeEntry(&entries[i]);
+  }
+  memset(&stats, 0, sizeof(stats));
+  stats.budget = budgetBytes;
+  queueHead = queueCount = 0;
+}
+
+AssetHandle assets_acquire(AssetType type, const char* path) {
+  uint32_t hash = pathHash(path);
+  int index = find(type, path, hash);
+
+  if (index >= 0 && entries[index].state == kEntryLoaded) {
+    stats.hits++;
+  }
+  else {
+    if (index < 0) index = allocEntry(type, path, hash);
+    if (index < 0) return 0;
+    stats.misses++;
+    if (load(&entries[index]) < 0) {
+      if (entries[index].state == kEntryQueued) freeEntry(&entries[index]);
+      return 0;
+    }
+  }
+
+  AssetEntry* e = &entries[index];
+  e->refs++;
+  e->lastUsed = ++tick;
+  return makeHandle(index);
+}
+
+void assets_retain(AssetHandle handle) {
+  AssetEntry* e = resolve(handle);
+  if (e) e->refs++;
+}
+
+void assets_release(AssetHandle handle) {
+  AssetEntry* e = resolve(handle);
+  if (e == NULL || e->refs == 0) return;
+  if (--e->refs == 0) makeRoom(0, NULL);
+}
+
+static void* object(AssetHandle handle, AssetType type) {
+  AssetEntry* e = resolve(handle);
+  return e && e->type == type ? e->object : NULL;
+}
+
+LCDBitmap* assets_bitmap(AssetHandle handle) { return object(handle, kAssetBitmap); }
+LCDBitmapTable* assets_bitmapTable(AssetHandle handle) { return object(handle, kAssetBitmapTable); }
+LCDFont* assets_font(AssetHandle handle) { return object(handle, kAssetFont); }
+AudioSample* assets_sample(AssetHandle handle) { return object(handle, kAssetSample); }
+
+void assets_prefetch(AssetType type, const char* path) {
+  uint32_t hash = pathHash(path);
+  int index = find(type, path, hash);
+  if (index >= 0) {
+    entries[index].lastUsed = ++tick;
+    return;
+  }
+  if (queueCount >= ASSETS_MAX) return;
+
+  index = allocEntry(type, path, hash);
+  if (index < 0) return;
+  queue[(queueHead + queueCount++) % ASSETS_MAX] = index;
+}
+
+int assets_pending(void) {
+  return queueCount;
+}
+
+void assets_update(uint32_t budgetUs) {
+  timing_init();
+  uint32_t start = timing_now();
+
+  // always make progress, even if one load alone blows the budget
+  while (queueCount > 0) {
+    AssetEntry* e = &entries[queue[queueHead]];
+    queueHead = (queueHead + 1) % ASSETS_MAX;
+    queueCount--;
+
+    // acquired synchronously (or freed) since it was queued
+    if (e->state != kEntryQueued) continue;
+
+    if (load(e) < 0) freeEntry(e);
+    else stats.prefetched++;
+
+    if (timing_ticksToMicros(timing_now() - start) >= budgetUs) break;
+  }
+}
+
+void assets_purge(void) {
+  for (int i = 0; i < ASSETS_MAX; i++) {
+    if (entries[i].state == kEntryLoaded && entries[i].refs == 0) freeEntry(&entries[i]);
+  }
+}
+
+void assets_stats(AssetStats* out) {
+  *out = stats;
+}
+
+void assets_log(void) {
+  playdate->system->logToConsole("assets: %u resident, %u/%u bytes, %u hits, %u misses, %u prefetched, %u evicted, %ums loading",
+    stats.count, stats.resident, stats.budget, stats.hits, stats.misses, stats.prefetched, stats.evictions, stats.loadUs / 1000);
+  for (int i = 0; i < ASSETS_MAX; i++) {
+    AssetEntry* e = &entries[i];
+    if (e->state != kEntryLoaded) continue;
+    playdate->system->logToConsole("  %s: %u bytes, %u refs, loaded in %uus", e->path, e->bytes, e->refs, e->loadUs);
+  }
+}
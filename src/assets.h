@@ -0,0 +1,64 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <playdate/api.h>
+
+// Shared, budgeted asset cache for bitmaps, bitmap tables, fonts and audio
+// samples. Assets are deduplicated by path and handed out as refcounted
+// handles; released assets stay resident until the memory budget forces the
+// least recently used of them out. Upcoming scenes can be prefetched: queued
+// paths are loaded by assets_update() a few at a time, within a per-frame
+// time budget, so playdate_update never stalls on a batch of loads.
+
+#define ASSETS_MAX 256
+
+typedef enum
+{
+  kAssetBitmap,
+  kAssetBitmapTable,
+  kAssetFont,
+  kAssetSample
+} AssetType;
+
+typedef uint32_t AssetHandle; // 0 is never a valid handle
+
+typedef struct
+{
+  uint32_t budget;
+  uint32_t resident; // bytes held by loaded assets
+  uint32_t count;
+  uint32_t hits;
+  uint32_t misses; // synchronous loads in assets_acquire
+  uint32_t prefetched;
+  uint32_t evictions;
+  uint32_t loadUs; // total time spent loading
+} AssetStats;
+
+void assets_init(uint32_t budgetBytes);
+
+// returns a referenced handle, loading synchronously if the asset is not
+// resident yet; 0 if it cannot be loaded
+AssetHandle assets_acquire(AssetType type, const char* path);
+void assets_retain(AssetHandle handle);
+void assets_release(AssetHandle handle);
+
+LCDBitmap* assets_bitmap(AssetHandle handle);
+LCDBitmapTable* assets_bitmapTable(AssetHandle handle);
+LCDFont* assets_font(AssetHandle handle);
+AudioSample* assets_sample(AssetHandle handle);
+
+// queue an asset for background loading; it stays unreferenced (and
+// evictable) until acquired
+void assets_prefetch(AssetType type, const char* path);
+int assets_pending(void);
+
+// call once per frame: works through the prefetch queue for about budgetUs
+void assets_update(uint32_t budgetUs);
+
+// frees every unreferenced asset
+void assets_purge(void);
+
+void assets_stats(AssetStats* out);
+void assets_log(void); // per asset: path, bytes, refs, load time
+
+#endif // ASSETS_H
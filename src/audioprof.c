@@ -0,0 +1,262 @@
+#include "audioprof.h"
+
+extern PlaydateAPI* playdate;
+
+#define AUDIOPROF_LINE_HEIGHT 16
+
+struct AudioProbe
+{
+  const char* name;
+
+  AudioSourceFunction* source;
+  effectProc* effect;
+  synthRenderFunc render;
+  void* userdata;
+  SoundEffect* owner; // effect this probe wraps, to find it from effectProc
+
+  // written only by the audio thread
+  volatile uint32_t calls;
+  volatile uint32_t late;
+  volatile uint32_t underruns;
+  volatile uint32_t lastUs;
+  volatile uint32_t worstUs;
+  volatile uint32_t totalUs;
+  volatile uint32_t histogram[AUDIOPROF_BUCKETS];
+
+  // written by the update loop, acknowledged by the audio thread
+  volatile uint32_t resetRequested;
+  volatile uint32_t resetDone;
+};
+
+// generator callbacks all receive the same userdata, so a synth gets its own
+// context carrying the real userdata. copies share the original probe.
+typedef struct
+{
+  AudioProbe* probe;
+  synthRenderFunc render;
+  synthNoteOnFunc noteOn;
+  synthReleaseFunc release;
+  synthSetParameterFunc setparam;
+  synthDeallocFunc dealloc;
+  synthCopyUserdata copyUserdata;
+  void* userdata;
+} SynthContext;
+
+static AudioProbe probes[AUDIOPROF_MAX_PROBES];
+static volatile int probeCount;
+static int budgetPercent = 100;
+
+static inline int bucket(uint32_t us) {
+  int b = 0;
+  while (us && b < AUDIOPROF_BUCKETS - 1) {
+    us >>= 1;
+    b++;
+  }
+  return b;
+}
+
+AudioProbe* audioprof_probe(const char* name) {
+  if (probeCount == 0) timing_init();
+  if (probeCount >= AUDIOPROF_MAX_PROBES) {
+    playdate->system->logToConsole("audioprof: no probe left for %s", name);
+    return NULL;
+  }
+  AudioProbe* probe = &probes[probeCount];
+  memset(probe, 0, sizeof(*probe));
+  probe->name = name;
+  probeCount++;
+  return probe;
+}
+
+void audioprof_setBudget(int percent) {
+  budgetPercent = percent > 0 ? percent : 100;
+}
+
+void audioprof_end(AudioProbe* probe, uint32_t start, int nframes, int produced) {
+  uint32_t us = timing_ticksToMicros(timing_now() - start);
+
+  if (probe->resetRequested != probe->resetDone) {
+    probe->calls = probe->late = probe->underruns = 0;
+    probe->worstUs = probe->totalUs = 0;
+    for (int i = 0; i < AUDIOPROF_BUCKETS; i++) probe->histogram[i] = 0;
+    probe->resetDone = probe->resetRequested;
+  }
+
+  uint32_t deadlineUs = (uint32_t)nframes * 1000000u / AUDIOPROF_SAMPLE_RATE;
+  deadlineUs = deadlineUs * budgetPercent / 100;
+
+  probe->calls++;
+  probe->lastUs = us;
+  probe->totalUs += us;
+  if (us > probe->worstUs) probe->worstUs = us;
+  if (us > deadlineUs) probe->late++;
+  if (produced < nframes) probe->underruns++;
+  probe->histogram[bucket(us)]++;
+}
+
+// -- AudioSourceFunction ------------------------------------------------------
+
+static int sourceShim(void* context, int16_t* left, int16_t* right, int len) {
+  AudioProbe* probe = context;
+  uint32_t start = audioprof_begin();
+  int result = probe->source(probe->userdata, left, right, len);
+  audioprof_end(probe, start, len, result ? len : 0);
+  return result;
+}
+
+SoundSource* audioprof_addSource(AudioSourceFunction* callback, void* context, int stereo, const char* name) {
+  AudioProbe* probe = audioprof_probe(name);
+  if (probe == NULL) return playdate->sound->addSource(callback, context, stereo);
+  probe->source = callback;
+  probe->userdata = context;
+  return playdate->sound->addSource(sourceShim, probe, stereo);
+}
+
+SoundSource* audioprof_addCallbackSource(SoundChannel* channel, AudioSourceFunction* callback, void* context, int stereo, const char* name) {
+  AudioProbe* probe = audioprof_probe(name);
+  if (probe == NULL) return playdate->sound->channel->addCallbackSource(channel, callback, context, stereo);
+  probe->source = callback;
+  probe->userdata = context;
+  return playdate->sound->channel->addCallbackSource(channel, sourceShim, probe, stereo);
+}
+
+// -- effectProc ---------------------------------------------------------------
+
+static int effectShim(SoundEffect* e, int32_t* left, int32_t* right, int nsamples, int bufactive) {
+  AudioProbe* probe = NULL;
+  for (int i = 0; i < probeCount; i++) {
+    if (probes[i].owner == e) {
+      probe = &probes[i];
+      break;
+    }
+  }
+  if (probe == NULL) return 0;
+
+  uint32_t start = audioprof_begin();
+  int result = probe->effect(e, left, right, nsamples, bufactive);
+  audioprof_end(probe, start, nsamples, nsamples);
+  return result;
+}
+
+SoundEffect* audioprof_newEffect(effectProc* proc, void* userdata, const char* name) {
+  AudioProbe* probe = audioprof_probe(name);
+  if (probe == NULL) return playdate->sound->effect->newEffect(proc, userdata);
+  probe->effect = proc;
+  probe->owner = playdate->sound->effect->newEffect(effectShim, userdata);
+  return probe->owner;
+}
+
+// -- synthRenderFunc ----------------------------------------------------------
+
+static int renderShim(void* userdata, int32_t* left, int32_t* right, int nsamples, uint32_t rate, int32_t drate) {
+  SynthContext* ctx = userdata;
+  uint32_t start = audioprof_begin();
+  int result = ctx->render(ctx->userdata, left, right, nsamples, rate, drate);
+  audioprof_end(ctx->probe, start, nsamples, result);
+  return result;
+}
+
+static void noteOnShim(void* userdata, MIDINote note, float velocity, float len) {
+  SynthContext* ctx = userdata;
+  if (ctx->noteOn) ctx->noteOn(ctx->userdata, note, velocity, len);
+}
+
+static void releaseShim(void* userdata, int stop) {
+  SynthContext* ctx = userdata;
+  if (ctx->release) ctx->release(ctx->userdata, stop);
+}
+
+static int setParameterShim(void* userdata, int parameter, float value) {
+  SynthContext* ctx = userdata;
+  return ctx->setparam ? ctx->setparam(ctx->userdata, parameter, value) : 0;
+}
+
+static void deallocShim(void* userdata) {
+  SynthContext* ctx = userdata;
+  if (ctx->dealloc) ctx->dealloc(ctx->userdata);
+  playdate->system->realloc(ctx, 0);
+}
+
+static void* copyShim(void* userdata) {
+  SynthContext* ctx = userdata;
+  SynthContext* copy = playdate->system->realloc(NULL, sizeof(SynthContext));
+  *copy = *ctx;
+  if (ctx->copyUserdata) copy->userdata = ctx->copyUserdata(ctx->userdata);
+  return copy;
+}
+
+void audioprof_setGenerator(PDSynth* synth, int stereo, synthRenderFunc render, synthNoteOnFunc noteOn, synthReleaseFunc release, synthSetParameterFunc setparam, synthDeallocFunc dealloc, synthCopyUserdata copyUserdata, void* userdata, const char* name) {
+  AudioProbe* probe = audioprof_probe(name);
+  if (probe == NULL) {
+    playdate->sound->synth->setGenerator(synth, stereo, render, noteOn, release, setparam, dealloc, copyUserdata, userdata);
+    return;
+  }
+  SynthContext* ctx = playdate->system->realloc(NULL, sizeof(SynthContext));
+  *ctx = (SynthContext){
+    .probe = probe, .render = render, .noteOn = noteOn, .release = release,
+    .setparam = setparam, .dealloc = dealloc, .copyUserdata = copyUserdata,
+    .userdata = userdata
+  };
+  playdate->sound->synth->setGenerator(synth, stereo, renderShim, noteOnShim, releaseShim, setParameterShim, deallocShim, copyShim, ctx);
+}
+
+// -- Reporting ----------------------------------------------------------------
+
+int audioprof_count(void) {
+  return probeCount;
+}
+
+void audioprof_snapshot(int index, AudioProbeStats* out) {
+  AudioProbe* probe = &probes[index];
+  out->name = probe->name;
+  out->calls = probe->calls;
+  out->late = probe->late;
+  out->underruns = probe->underruns;
+  out->lastUs = probe->lastUs;
+  out->worstUs = probe->worstUs;
+  out->totalUs = probe->totalUs;
+  for (int i = 0; i < AUDIOPROF_BUCKETS; i++) out->histogram[i] = probe->histogram[i];
+}
+
+uint32_t audioprof_percentile(const AudioProbeStats* stats, int percent) {
+  uint32_t total = 0;
+  for (int i = 0; i < AUDIOPROF_BUCKETS; i++) total += stats->histogram[i];
+  if (total == 0) return 0;
+
+  uint32_t target = (total * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (int i = 0; i < AUDIOPROF_BUCKETS; i++) {
+    seen += stats->histogram[i];
+    if (seen >= target) return i == 0 ? 0 : (1u << i) - 1;
+  }
+  return stats->worstUs;
+}
+
+void audioprof_reset(void) {
+  for (int i = 0; i < probeCount; i++) probes[i].resetRequested++;
+}
+
+void audioprof_log(void) {
+  AudioProbeStats s;
+  for (int i = 0; i < probeCount; i++) {
+    audioprof_snapshot(i, &s);
+    playdate->system->logToConsole(
+      "audioprof: %s calls=%u avg=%uus p50<=%uus p99<=%uus worst=%uus late=%u underruns=%u",
+      s.name, s.calls, s.calls ? s.totalUs / s.calls : 0,
+      audioprof_percentile(&s, 50), audioprof_percentile(&s, 99),
+      s.worstUs, s.late, s.underruns);
+  }
+}
+
+void audioprof_draw(int x, int y) {
+  AudioProbeStats s;
+  for (int i = 0; i < probeCount; i++) {
+    audioprof_snapshot(i, &s);
+    char* line = NULL;
+    int len = playdate->system->formatString(&line, "%s p99 %u max %u late %u xrun %u",
+      s.name, audioprof_percentile(&s, 99), s.worstUs, s.late, s.underruns);
+    if (line == NULL) continue;
+    playdate->graphics->drawText(line, len, kASCIIEncoding, x, y + i * AUDIOPROF_LINE_HEIGHT);
+    playdate->system->realloc(line, 0);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef AUDIOPROF_H
+#define AUDIOPROF_H
+
+#include <playdate/api.h>
+#include "timing.h"
+
+// Audio callback profiler. Register a callback through one of the wrappers
+// below instead of the matching playdate->sound call; the callback itself is
+// untouched and still receives its own context/userdata. Every invocation is
+// timed on the audio thread and compared against the block deadline (the
+// time it takes to play back the requested number of frames).
+//
+// Counters have a single writer (the audio thread) and are read without
+// locks from the update loop, so a snapshot may be one render stale.
+
+#define AUDIOPROF_MAX_PROBES 16
+#define AUDIOPROF_BUCKETS 16 // log2 microsecond histogram, 0us .. 16ms+
+#define AUDIOPROF_SAMPLE_RATE 44100
+
+typedef struct AudioProbe AudioProbe;
+
+typedef struct
+{
+  const char* name;
+  uint32_t calls;
+  uint32_t late;      // render took longer than its share of the block deadline
+  uint32_t underruns; // render produced no output or fewer frames than asked
+  uint32_t lastUs;
+  uint32_t worstUs;
+  uint32_t totalUs;
+  uint32_t histogram[AUDIOPROF_BUCKETS];
+} AudioProbeStats;
+
+// wrapped equivalents of playdate->sound->addSource / channel->addCallbackSource
+SoundSource* audioprof_addSource(AudioSourceFunction* callback, void* context, int stereo, const char* name);
+SoundSource* audioprof_addCallbackSource(SoundChannel* channel, AudioSourceFunction* callback, void* context, int stereo, const char* name);
+
+// wrapped equivalent of playdate->sound->effect->newEffect
+SoundEffect* audioprof_newEffect(effectProc* proc, void* userdata, const char* name);
+
+// wrapped equivalent of playdate->sound->synth->setGenerator
+void audioprof_setGenerator(PDSynth* synth, int stereo, synthRenderFunc render, synthNoteOnFunc noteOn, synthReleaseFunc release, synthSetParameterFunc setparam, synthDeallocFunc dealloc, synthCopyUserdata copyUserdata, void* userdata, const char* name);
+
+// manual instrumentation for anything else running on the audio thread
+AudioProbe* audioprof_probe(const char* name);
+static inline uint32_t audioprof_begin(void) { return timing_now(); }
+void audioprof_end(AudioProbe* probe, uint32_t start, int nframes, int produced);
+
+// fraction of the block deadline a single callback may use before it counts
+// as late, in percent (default 100)
+void audioprof_setBudget(int percent);
+
+// reading results from the update loop
+int audioprof_count(void);
+void audioprof_snapshot(int index, AudioProbeStats* out);
+uint32_t audioprof_percentile(const AudioProbeStats* stats, int percent); // upper bound, in us
+void audioprof_reset(void); // applied by the audio thread on its next render
+
+void audioprof_log(void);
+void audioprof_draw(int x, int y);
+
+#endif // AUDIOPROF_H
@@ -0,0 +1,109 @@
+#include "baked.h"
+
+extern PlaydateAPI* playdate;
+
+#define BAKED_HEADER_SIZE 16
+#define BAKED_ENTRY_SIZE 16
+
+typedef struct
+{
+  uint32_t key;
+  uint32_t hash;
+  BakedValue value;
+} BakedEntry;
+
+static uint32_t fnv1a(const char* s) {
+  uint32_t h = 0x811c9dc5;
+  while (*s) h = (h ^ (uint8_t)*s++) * 0x01000193;
+  return h;
+}
+
+static inline uint32_t le32(const uint8_t* b) {
+  return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+int baked_open(BakedBlob* blob, const void* data, uint32_t size) {
+  const uint8_t* b = data;
+  if (size < BAKED_HEADER_SIZE || memcmp(b, "PDBK", 4) != 0) return -1;
+  if ((b[4] | (b[5] << 8)) != BAKED_VERSION || le32(b + 12) > size) return -1;
+  if (((uintptr_t)b & 3) != 0) return -1; // values are read in place
+
+  blob->base = b;
+  blob->size = size;
+  blob->alloc = NULL;
+  return 0;
+}
+
+int baked_load(BakedBlob* blob, const char* path) {
+  FileStat st;
+  if (playdate->file->stat(path, &st) < 0) return -1;
+
+  SDFile* file = playdate->file->open(path, kFileRead | kFileReadData);
+  if (file == NULL) return -1;
+
+  void* data = playdate->system->realloc(NULL, st.size);
+  int n = data ? playdate->file->read(file, data, st.size) : -1;
+  playdate->file->close(file);
+
+  if (n != (int)st.size || baked_open(blob, data, st.size) < 0) {
+    if (data) playdate->system->realloc(data, 0);
+    return -1;
+  }
+  blob->alloc = data;
+  return 0;
+}
+
+void baked_free(BakedBlob* blob) {
+  if (blob->alloc) playdate->system->realloc(blob->alloc, 0);
+  blob->alloc = NULL;
+  blob->base = NULL;
+}
+
+const BakedValue* baked_root(const BakedBlob* blob) {
+  return (const BakedValue*)(blob->base + le32(blob->base + 8));
+}
+
+int baked_count(const BakedBlob* blob, const BakedValue* v) {
+  if (v == NULL || (v->type != kJSONArray && v->type != kJSONTable)) return 0;
+  return *(const uint32_t*)(blob->base + v->data.offset);
+}
+
+const BakedValue* baked_at(const BakedBlob* blob, const BakedValue* array, int index) {
+  if (array == NULL || array->type != kJSONArray) return NULL;
+  const uint32_t* container = (const uint32_t*)(blob->base + array->data.offset);
+  if (index < 0 || (uint32_t)index >= container[0]) return NULL;
+  return (const BakedValue*)(container + 1) + index;
+}
+
+static inline const BakedEntry* entries(const BakedBlob* blob, const BakedValue* table) {
+  return (const BakedEntry*)(blob->base + table->data.offset + 4);
+}
+
+const BakedValue* baked_get(const BakedBlob* blob, const BakedValue* table, const char* key) {
+  if (table == NULL || table->type != kJSONTable) return NULL;
+
+  const BakedEntry* e = entries(blob, table);
+  int count = baked_count(blob, table);
+  uint32_t hash = fnv1a(key);
+
+  int lo = 0, hi = count;
+  while (lo < hi) {
+    int mid = (lo + hi) >> 1;
+    if (e[mid].hash < hash) lo = mid + 1;
+    else hi = mid;
+  }
+  for (; lo < count && e[lo].hash == hash; lo++) {
+    if (strcmp((const char*)blob->base + e[lo].key, key) == 0) return &e[lo].value;
+  }
+  return NULL;
+}
+
+const char* baked_keyAt(const BakedBlob* blob, const BakedValue* table, int index) {
+  if (table == NULL || table->type != kJSONTable || index < 0 || index >= baked_count(blob, table)) return NULL;
+  return (const char*)blob->base + entries(blob, table)[index].key;
+}
+
+const BakedValue* baked_valueAt(const BakedBlob* blob, const BakedValue* table, int index) {
+  if (table == NULL || table->type != kJSONTable || index < 0 || index >= baked_count(blob, table)) return NULL;
+  return &entries(blob, table)[index].value;
+}
@@ -0,0 +1,78 @@
+#ifndef BAKED_H
+#define BAKED_H
+
+#include <playdate/api.h>
+
+// Reader for JSON baked into binary by pdbake.py. The blob is used exactly as
+// it sits in memory: values are 8 bytes, containers and strings are found
+// through offsets from the start of the blob, so loading is one read and
+// lookups involve no parsing. Value types are the json_value_type constants.
+//
+// Layout (little-endian, 4 byte aligned):
+//   header  "PDBK", u16 version, u16 reserved, u32 root, u32 size
+//   array   u32 count, count x BakedValue
+//   table   u32 count, count x { u32 key, u32 hash, BakedValue }, sorted by hash
+//   strings interned, NUL terminated, at the end
+
+#define BAKED_VERSION 1
+
+typedef struct
+{
+  uint8_t type;
+  uint8_t pad[3];
+  union
+  {
+    int32_t intval;
+    float floatval;
+    uint32_t offset; // strings, arrays and tables
+  } data;
+} BakedValue;
+
+typedef struct
+{
+  const uint8_t* base;
+  uint32_t size;
+  void* alloc; // owned copy when loaded from a file
+} BakedBlob;
+
+// validates and wraps a blob already in memory (e.g. from assetpack_load)
+int baked_open(BakedBlob* blob, const void* data, uint32_t size);
+int baked_load(BakedBlob* blob, const char* path);
+void baked_free(BakedBlob* blob);
+
+const BakedValue* baked_root(const BakedBlob* blob);
+
+static inline int baked_int(const BakedValue* v) {
+  if (v == NULL) return 0;
+  switch (v->type) {
+    case kJSONInteger: return v->data.intval;
+    case kJSONFloat:   return (int)v->data.floatval;
+    case kJSONTrue:    return 1;
+    default:           return 0;
+  }
+}
+
+static inline float baked_float(const BakedValue* v) {
+  if (v == NULL) return 0;
+  switch (v->type) {
+    case kJSONInteger: return (float)v->data.intval;
+    case kJSONFloat:   return v->data.floatval;
+    case kJSONTrue:    return 1.0f;
+    default:           return 0.0f;
+  }
+}
+
+static inline const char* baked_string(const BakedBlob* blob, const BakedValue* v) {
+  return v && v->type == kJSONString ? (const char*)blob->base + v->data.offset : NULL;
+}
+
+int baked_count(const BakedBlob* blob, const BakedValue* v); // array or table size
+
+const BakedValue* baked_at(const BakedBlob* blob, const BakedValue* array, int index);
+const BakedValue* baked_get(const BakedBlob* blob, const BakedValue* table, const char* key);
+
+// table iteration in stored (hash) order
+const char* baked_keyAt(const BakedBlob* blob, const BakedValue* table, int index);
+const BakedValue* baked_valueAt(const BakedBlob* blob, const BakedValue* table, int index);
+
+#endif // BAKED_H
@@ -0,0 +1,227 @@
+#include "bufio.h"
+
+extern PlaydateAPI* playdate;
+
+BufFile* bufio_open(const char* path, FileOptions mode, int bufsize) {
+  SDFile* file = playdate->file->open(path, mode);
+  if (file == NULL) return NULL;
+
+  if (bufsize <= 0) bufsize = BUFIO_DEFAULT_SIZE;
+  bufsize = (bufsize + BUFIO_ALIGN - 1) & ~(BUFIO_ALIGN - 1);
+
+  BufFile* f = playdate->system->realloc(NULL, sizeof(BufFile));
+  void* alloc = playdate->system->realloc(NULL, bufsize + BUFIO_ALIGN - 1);
+  if (f == NULL || alloc == NULL) {
+    if (f) playdate->system->realloc(f, 0);
+    if (alloc) playdate->system->realloc(alloc, 0);
+    playdate->file->close(file);
+    return NULL;
+  }
+
+  memset(f, 0, sizeof(BufFile));
+  f->file = file;
+  f->writing = (mode & (kFileWrite | kFileAppend)) != 0;
+  f->alloc = alloc;
+  f->buffer = (uint8_t*)(((uintptr_t)alloc + BUFIO_ALIGN - 1) & ~(uintptr_t)(BUFIO_ALIGN - 1));
+  f->size = bufsize;
+
+  if (mode & kFileAppend) {
+    f->start = playdate->file->tell(file);
+    if (f->start < 0) f->start = 0;
+  }
+  return f;
+}
+
+static int drain(BufFile* f) {
+  if (!f->writing || f->dirty == 0) return 0;
+
+  int written = playdate->file->write(f->file, f->buffer, f->dirty);
+  if (written != f->dirty) return -1;
+
+  f->start += f->dirty;
+  f->pos = f->dirty = 0;
+  return 0;
+}
+
+int bufio_flush(BufFile* f) {
+  return drain(f);
+}
+
+int bufio_close(BufFile* f) {
+  int result = drain(f);
+  if (f->writing && result == 0) result = playdate->file->flush(f->file) < 0 ? -1 : 0;
+  if (playdate->file->close(f->file) < 0) result = -1;
+  playdate->system->realloc(f->alloc, 0);
+  playdate->system->realloc(f, 0);
+  return result;
+}
+
+static int refill(BufFile* f) {
+  f->start += f->fill;
+  f->pos = f->fill = 0;
+  int n = playdate->file->read(f->file, f->buffer, f->size);
+  if (n < 0) return -1;
+  f->fill = n;
+  return n;
+}
+
+int bufio_read(BufFile* f, void* buf, unsigned int len) {
+  if (f->writing) return -1;
+
+  uint8_t* out = buf;
+  unsigned int done = 0;
+
+  while (done < len) {
+    int avail = f->fill - f->pos;
+    if (avail > 0) {
+      unsigned int n = (unsigned int)avail < len - done ? (unsigned int)avail : len - done;
+      memcpy(out + done, f->buffer + f->pos, n);
+      f->pos += n;
+      done += n;
+      continue;
+    }
+
+    // large remainder: read straight into the caller's memory
+    if (len - done >= (unsigned int)f->size) {
+      f->start += f->fill;
+      f->pos = f->fill = 0;
+      int n = playdate->file->read(f->file, out + done, len - done);
+      if (n < 0) return done ? (int)done : -1;
+      f->start += n;
+      done += n;
+      break;
+    }
+
+    int n = refill(f);
+    if (n < 0) return done ? (int)done : -1;
+    if (n == 0) break;
+  }
+  return (int)done;
+}
+
+int bufio_write(BufFile* f, const void* buf, unsigned int len) {
+  if (!f->writing) return -1;
+
+  const uint8_t* in = buf;
+  unsigned int done = 0;
+
+  while (done < len) {
+    int room = f->size - f->dirty;
+    unsigned int n = (unsigned int)room < len - done ? (unsigned int)room : len - done;
+
+    // nothing buffered and a full buffer's worth left: skip the copy
+    if (f->dirty == 0 && len - done >= (unsigned int)f->size) {
+      int written = playdate->file->write(f->file, in + done, len - done);
+      if (written < 0) return done ? (int)done : -1;
+      f->start += written;
+      done += written;
+      break;
+    }
+
+    memcpy(f->buffer + f->dirty, in + done, n);
+    f->dirty += n;
+    f->pos = f->dirty;
+    done += n;
+
+    if (f->dirty == f->size && drain(f) < 0) return -1;
+  }
+  return (int)done;
+}
+
+int bufio_tell(BufFile* f) {
+  return f->start + f->pos;
+}
+
+int bufio_seek(BufFile* f, int pos, int whence) {
+  if (f->writing) {
+    if (drain(f) < 0) return -1;
+  }
+  else {
+    int target = -1;
+    if (whence == SEEK_SET) target = pos;
+    else if (whence == SEEK_CUR) target = f->start + f->pos + pos;
+
+    // still inside the read-ahead window: no file operation needed
+    if (target >= f->start && target <= f->start + f->fill) {
+      f->pos = target - f->start;
+      return 0;
+    }
+    if (whence == SEEK_CUR) {
+      pos = target;
+      whence = SEEK_SET;
+    }
+  }
+
+  int result = playdate->file->seek(f->file, pos, whence);
+  if (result < 0) return -1;
+
+  if (whence == SEEK_SET) f->start = pos;
+  else f->start = playdate->file->tell(f->file);
+  f->pos = f->fill = f->dirty = 0;
+  return 0;
+}
+
+// -- Typed access -------------------------------------------------------------
+
+static inline int readExact(BufFile* f, uint8_t* b, int len) {
+  // fast path straight out of the buffer
+  if (!f->writing && f->fill - f->pos >= len) {
+    memcpy(b, f->buffer + f->pos, len);
+    f->pos += len;
+    return 0;
+  }
+  return bufio_read(f, b, len) == len ? 0 : -1;
+}
+
+int bufio_readU8(BufFile* f, uint8_t* out) {
+  return readExact(f, out, 1);
+}
+
+int bufio_readU16(BufFile* f, uint16_t* out) {
+  uint8_t b[2];
+  if (readExact(f, b, 2) < 0) return -1;
+  *out = (uint16_t)(b[0] | (b[1] << 8));
+  return 0;
+}
+
+int bufio_readU32(BufFile* f, uint32_t* out) {
+  uint8_t b[4];
+  if (readExact(f, b, 4) < 0) return -1;
+  *out = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+  return 0;
+}
+
+int bufio_readS16(BufFile* f, int16_t* out) {
+  return bufio_readU16(f, (uint16_t*)out);
+}
+
+int bufio_readS32(BufFile* f, int32_t* out) {
+  return bufio_readU32(f, (uint32_t*)out);
+}
+
+int bufio_readFloat(BufFile* f, float* out) {
+  uint32_t bits;
+  if (bufio_readU32(f, &bits) < 0) return -1;
+  memcpy(out, &bits, 4);
+  return 0;
+}
+
+int bufio_writeU8(BufFile* f, uint8_t v) {
+  return bufio_write(f, &v, 1) == 1 ? 0 : -1;
+}
+
+int bufio_writeU16(BufFile* f, uint16_t v) {
+  uint8_t b[2] = { v & 0xff, v >> 8 };
+  return bufio_write(f, b, 2) == 2 ? 0 : -1;
+}
+
+int bufio_writeU32(BufFile* f, uint32_t v) {
+  uint8_t b[4] = { v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24 };
+  return bufio_write(f, b, 4) == 4 ? 0 : -1;
+}
+
+int bufio_writeFloat(BufFile* f, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, 4);
+  return bufio_writeU32(f, bits);
+}
@@ -0,0 +1,52 @@
+#ifndef BUFIO_H
+#define BUFIO_H
+
+#include <playdate/api.h>
+
+// Buffered stream over playdate->file. Reads are served from an aligned
+// read-ahead buffer refilled with one large read; writes are coalesced and
+// reach the file on flush, seek, close or when the buffer fills up. Files
+// opened with kFileWrite or kFileAppend are write streams, anything else is
+// a read stream. Functions mirror playdate->file and return -1 on error.
+
+#define BUFIO_DEFAULT_SIZE 4096
+#define BUFIO_ALIGN 32 // Cortex-M7 D-cache line
+
+typedef struct
+{
+  SDFile* file;
+  int writing;
+
+  uint8_t* buffer; // aligned view into alloc
+  void* alloc;
+  int size;
+
+  int start; // file offset of buffer[0]
+  int fill;  // valid bytes in buffer when reading
+  int pos;   // cursor relative to start
+  int dirty; // pending bytes in buffer[0..dirty) when writing
+} BufFile;
+
+BufFile* bufio_open(const char* path, FileOptions mode, int bufsize); // bufsize <= 0 uses BUFIO_DEFAULT_SIZE
+int bufio_close(BufFile* f);
+
+int bufio_read(BufFile* f, void* buf, unsigned int len);
+int bufio_write(BufFile* f, const void* buf, unsigned int len);
+int bufio_flush(BufFile* f);
+int bufio_tell(BufFile* f);
+int bufio_seek(BufFile* f, int pos, int whence);
+
+// little-endian typed access, 0 on success and -1 on short read/write
+int bufio_readU8(BufFile* f, uint8_t* out);
+int bufio_readU16(BufFile* f, uint16_t* out);
+int bufio_readU32(BufFile* f, uint32_t* out);
+int bufio_readS16(BufFile* f, int16_t* out);
+int bufio_readS32(BufFile* f, int32_t* out);
+int bufio_readFloat(BufFile* f, float* out);
+
+int bufio_writeU8(BufFile* f, uint8_t v);
+int bufio_writeU16(BufFile* f, uint16_t v);
+int bufio_writeU32(BufFile* f, uint32_t v);
+int bufio_writeFloat(BufFile* f, float v);
+
+#endif // BUFIO_H
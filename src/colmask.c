@@ -0,0 +1,279 @@
+#include "colmask.h"
+
+extern PlaydateAPI* playdate;
+
+typedef enum
+{
+  kSlotFree,
+  kSlotUsed,
+  kSlotDeleted
+} SlotState;
+
+typedef struct
+{
+  LCDBitmap* bitmap;
+  ColMask* mask;
+  uint8_t flip;
+  uint8_t state;
+} CacheSlot;
+
+static CacheSlot cache[COLMASK_CACHE_SIZE];
+static int slotsTaken; // used or deleted, probes stop at free slots
+static uint32_t cacheBytes;
+
+static LCDSpriteCollisionFilterProc* response;
+static LCDSprite* moving;
+static float moveDx, moveDy;
+static LCDSprite* rejected[COLMASK_MAX_REJECTED];
+static int rejectedCount;
+
+// -- Masks --------------------------------------------------------------------
+
+static uint32_t maskBytes(const ColMask* m) {
+  return sizeof(ColMask) + 32u * m->height * m->words * sizeof(uint32_t) + m->height * 2u * sizeof(int16_t);
+}
+
+ColMask* colmask_build(LCDBitmap* bitmap, LCDBitmapFlip flip) {
+  int width, height, rowbytes;
+  uint8_t *opaque, *data;
+  playdate->graphics->getBitmapData(bitmap, &width, &height, &rowbytes, &opaque, &data);
+
+  int words = ((width + 31) >> 5) + 1;
+  uint32_t rowWords = (uint32_t)height * words;
+  ColMask shape = { .width = width, .height = height, .words = words };
+  ColMask* m = playdate->system->realloc(NULL, maskBytes(&shape));
+  if (m == NULL) return NULL;
+  *m = shape;
+
+  // the words first, they need the alignment
+  uint32_t* bits = (uint32_t*)(m + 1);
+  for (int s = 0; s < 32; s++) m->shifted[s] = bits + s * rowWords;
+  m->spans = (int16_t*)(bits + 32 * rowWords);
+  memset(bits, 0, rowWords * sizeof(uint32_t));
+
+  int flipX = flip & kBitmapFlippedX, flipY = flip & kBitmapFlippedY;
+  m->top = height;
+  m->bottom = -1;
+  m->left = width;
+  m->right = -1;
+  for (int y = 0; y < height; y++) {
+    const uint8_t* src = opaque ? opaque + (flipY ? height - 1 - y : y) * rowbytes : NULL;
+    uint32_t* row = m->shifted[0] + y * words;
+    int first = width, last = -1;
+    for (int x = 0; x < width; x++) {
+      int sx = flipX ? width - 1 - x : x;
+      if (src && !(src[sx >> 3] & (0x80 >> (sx & 7)))) continue;
+      row[x >> 5] |= 0x80000000u >> (x & 31);
+      if (first == width) first = x;
+      last = x;
+    }
+    m->spans[2 * y] = first;
+    m->spans[2 * y + 1] = last;
+    if (last < 0) continue;
+    if (m->top == height) m->top = y;
+    m->bottom = y;
+    if (first < m->left) m->left = first;
+    if (last > m->right) m->right = last;
+  }
+
+  for (int s = 1; s < 32; s++) {
+    const uint32_t* src = m->shifted[0];
+    uint32_t* dst = m->shifted[s];
+    for (int y = 0; y < height; y++, src += words, dst += words) {
+      uint32_t carry = 0;
+      for (int w = 0; w < words; w++) {
+        dst[w] = (src[w] >> s) | carry;
+        carry = src[w] << (32 - s);
+      }
+    }
+  }
+  return m;
+}
+
+void colmask_free(ColMask* m) {
+  if (m) playdate->system->realloc(m, 0);
+}
+
+int colmask_overlap(const ColMask* a, int ax, int ay, const ColMask* b, int bx, int by) {
+  // b to the right of a, so only b is ever shifted
+  if (bx < ax) {
+    const ColMask* t = a;
+    a = b;
+    b = t;
+    int tx = ax, ty = ay;
+    ax = bx;
+    ay = by;
+    bx = tx;
+    by = ty;
+  }
+  if (a->bottom < a->top || b->bottom < b->top) return 0;
+
+  // everything below in a's coordinates
+  int dx = bx - ax, dy = by - ay;
+  if (b->left + dx > a->right || b->right + dx < a->left) return 0;
+  int y0 = a->top > b->top + dy ? a->top : b->top + dy;
+  int y1 = a->bottom < b->bottom + dy ? a->bottom : b->bottom + dy;
+  if (y0 > y1) return 0;
+
+  int wordOffset = dx >> 5;
+  const uint32_t* rowA = a->shifted[0] + y0 * a->words;
+  const uint32_t* rowB = b->shifted[dx & 31] + (y0 - dy) * b->words;
+  const int16_t* spanA = a->spans + 2 * y0;
+  const int16_t* spanB = b->spans + 2 * (y0 - dy);
+  for (int y = y0; y <= y1; y++, rowA += a->words, rowB += b->words, spanA += 2, spanB += 2) {
+    int lo = spanA[0] > spanB[0] + dx ? spanA[0] : spanB[0] + dx;
+    int hi = spanA[1] < spanB[1] + dx ? spanA[1] : spanB[1] + dx;
+    if (lo > hi) continue;
+    for (int w = lo >> 5; w <= hi >> 5; w++) {
+      if (rowA[w] & rowB[w - wordOffset]) return 1;
+    }
+  }
+  return 0;
+}
+
+// -- Cache --------------------------------------------------------------------
+
+static inline uint32_t slotFor(LCDBitmap* bitmap, LCDBitmapFlip flip) {
+  uint32_t h = (uint32_t)(uintptr_t)bitmap ^ flip;
+  return (h * 0x9e3779b1u) >> 16;
+}
+
+ColMask* colmask_get(LCDBitmap* bitmap, LCDBitmapFlip flip) {
+  uint32_t i = slotFor(bitmap, flip);
+  int reuse = -1;
+  for (int probe = 0; probe < COLMASK_CACHE_SIZE; probe++, i++) {
+    CacheSlot* s = &cache[i & (COLMASK_CACHE_SIZE - 1)];
+    if (s->state == kSlotFree) break;
+    if (s->state == kSlotDeleted) {
+      if (reuse < 0) reuse = i & (COLMASK_CACHE_SIZE - 1);
+      continue;
+    }
+    if (s->bitmap == bitmap && s->flip == flip) return s->mask;
+  }
+
+  // keep a quarter free so misses stay short
+  if (reuse < 0 && slotsTaken >= COLMASK_CACHE_SIZE * 3 / 4) {
+    playdate->system->logToConsole("colmask: cache full, mask not cached");
+    return NULL;
+  }
+  ColMask* m = colmask_build(bitmap, flip);
+  if (m == NULL) return NULL;
+  if (reuse < 0) {
+    reuse = i & (COLMASK_CACHE_SIZE - 1);
+    slotsTaken++;
+  }
+  cache[reuse] = (CacheSlot){ bitmap, m, flip, kSlotUsed };
+  cacheBytes += maskBytes(m);
+  return m;
+}
+
+int colmask_cacheTable(LCDBitmapTable* table, int flipMask) {
+  int count = 0, err = 0;
+  playdate->graphics->getBitmapTableInfo(table, &count, NULL);
+  for (int i = 0; i < count; i++) {
+    LCDBitmap* bitmap = playdate->graphics->getTableBitmap(table, i);
+    for (int flip = 0; flip < 4; flip++) {
+      if ((flipMask & (1 << flip)) && colmask_get(bitmap, flip) == NULL) err = -1;
+    }
+  }
+  return err;
+}
+
+void colmask_forget(LCDBitmap* bitmap) {
+  for (int i = 0; i < COLMASK_CACHE_SIZE; i++) {
+    CacheSlot* s = &cache[i];
+    if (s->state != kSlotUsed || s->bitmap != bitmap) continue;
+    cacheBytes -= maskBytes(s->mask);
+    colmask_free(s->mask);
+    s->mask = NULL;
+    s->state = kSlotDeleted;
+  }
+}
+
+void colmask_clear(void) {
+  for (int i = 0; i < COLMASK_CACHE_SIZE; i++) {
+    if (cache[i].state == kSlotUsed) colmask_free(cache[i].mask);
+  }
+  memset(cache, 0, sizeof(cache));
+  slotsTaken = 0;
+  cacheBytes = 0;
+}
+
+uint32_t colmask_cacheBytes(void) {
+  return cacheBytes;
+}
+
+// -- Sprites ------------------------------------------------------------------
+
+static inline int pixel(float v) {
+  int i = (int)v;
+  return i - (v < i);
+}
+
+static ColMask* spriteMask(LCDSprite* sprite, int* x, int* y) {
+  LCDBitmap* image = playdate->sprite->getImage(sprite);
+  if (image == NULL) return NULL;
+  PDRect bounds = playdate->sprite->getBounds(sprite);
+  if (sprite == moving) {
+    bounds.x += moveDx;
+    bounds.y += moveDy;
+  }
+  *x = pixel(bounds.x);
+  *y = pixel(bounds.y);
+  return colmask_get(image, playdate->sprite->getImageFlip(sprite));
+}
+
+static int touching(LCDSprite* a, LCDSprite* b) {
+  int ax, ay, bx, by;
+  ColMask* ma = spriteMask(a, &ax, &ay);
+  ColMask* mb = spriteMask(b, &bx, &by);
+  // without an image or a mask the rectangles have the last word
+  if (ma == NULL || mb == NULL) return 1;
+  return colmask_overlap(ma, ax, ay, mb, bx, by);
+}
+
+void colmask_setResponse(LCDSpriteCollisionFilterProc* proc) {
+  response = proc;
+}
+
+SpriteCollisionResponseType colmask_filter(LCDSprite* sprite, LCDSprite* other) {
+  int hit = touching(sprite, other);
+  if (sprite == moving) {
+    for (int i = 0; i < rejectedCount; i++) {
+      if (rejected[i] == other) rejected[i--] = rejected[--rejectedCount];
+    }
+    if (!hit && rejectedCount < COLMASK_MAX_REJECTED) rejected[rejectedCount++] = other;
+  }
+  if (!hit) return kCollisionTypeOverlap;
+  return response ? response(sprite, other) : kCollisionTypeSlide;
+}
+
+static int wasRejected(LCDSprite* other) {
+  for (int i = 0; i < rejectedCount; i++) {
+    if (rejected[i] == other) return 1;
+  }
+  return 0;
+}
+
+SpriteCollisionInfo* colmask_moveWithCollisions(LCDSprite* sprite, float goalX, float goalY, float* actualX, float* actualY, int* len) {
+  float x, y;
+  playdate->sprite->getPosition(sprite, &x, &y);
+  moving = sprite;
+  moveDx = goalX - x;
+  moveDy = goalY - y;
+  rejectedCount = 0;
+  SpriteCollisionInfo* results = playdate->sprite->moveWithCollisions(sprite, goalX, goalY, actualX, actualY, len);
+  moving = NULL;
+
+  int kept = 0;
+  for (int i = 0; i < *len; i++) {
+    if (results[i].responseType == kCollisionTypeOverlap && wasRejected(results[i].other)) continue;
+    results[kept++] = results[i];
+  }
+  *len = kept;
+  return results;
+}
+
+int colmask_spritesOverlap(LCDSprite* a, LCDSprite* b) {
+  return touching(a, b);
+}
@@ -0,0 +1,73 @@
+#ifndef COLMASK_H
+#define COLMASK_H
+
+#include <playdate/api.h>
+
+// Pixel-exact collision masks prepared ahead of time. A ColMask holds, for
+// one bitmap under one flip, the opaque pixels as rows of 32-bit words in 32
+// copies shifted right by 0..31 bits, plus the first and last opaque column
+// of every row and the opaque bounding box. Testing two masks at any pixel
+// offset then rejects on the bounding boxes, walks only the shared rows,
+// skips rows whose spans do not meet and ANDs just the words under the
+// meeting span, with no shifting at test time. checkMaskCollision works
+// from the bitmaps on every call instead.
+//
+// Opaque means set in the bitmap's mask, or every pixel of a bitmap without
+// one. The shifted copies make a mask about 32 * height * (width / 32 + 2)
+// words, 8 KiB for a 32x32 sprite, so masks are built once and cached per
+// bitmap and flip; cache whole bitmap tables up front with
+// colmask_cacheTable() to keep building out of the game loop.
+//
+// For sprites, colmask_filter is an LCDSpriteCollisionFilterProc that runs
+// the mask test as a narrowphase: pairs whose pixels touch get the response
+// from colmask_setResponse's proc (slide if none is set), pairs that only
+// overlap as rectangles get kCollisionTypeOverlap so they never block.
+// colmask_moveWithCollisions() wraps moveWithCollisions to test the moving
+// sprite at its goal rather than where it starts, and drops the pairs the
+// narrowphase rejected from the results.
+
+#define COLMASK_CACHE_SIZE 512 // cached bitmap/flip pairs, a power of two
+#define COLMASK_MAX_REJECTED 32 // rejected pairs remembered per move
+
+typedef struct
+{
+  int16_t width, height;
+  int16_t top, bottom;  // opaque rows, bottom < top when there are none
+  int16_t left, right;  // opaque columns
+  int16_t words;        // 32-bit words per row in each shifted copy
+  int16_t* spans;       // first and last opaque column per row, first > last when empty
+  uint32_t* shifted[32]; // rows shifted right by the index, most significant bit leftmost
+} ColMask;
+
+// uncached; NULL if out of memory
+ColMask* colmask_build(LCDBitmap* bitmap, LCDBitmapFlip flip);
+void colmask_free(ColMask* m);
+
+// 1 if any opaque pixels meet with a's top left at (ax, ay) and b's at (bx, by)
+int colmask_overlap(const ColMask* a, int ax, int ay, const ColMask* b, int bx, int by);
+
+// -- Cache --------------------------------------------------------------------
+
+// the cached mask, built on first use; NULL if out of memory or the cache is full
+ColMask* colmask_get(LCDBitmap* bitmap, LCDBitmapFlip flip);
+
+// builds every frame of a table for the flips set in flipMask (1 << flip);
+// 0, or -1 if some could not be cached
+int colmask_cacheTable(LCDBitmapTable* table, int flipMask);
+
+void colmask_forget(LCDBitmap* bitmap); // call before freeing a cached bitmap
+void colmask_clear(void);
+uint32_t colmask_cacheBytes(void);
+
+// -- Sprites ------------------------------------------------------------------
+
+// the response for pixel collisions, NULL for kCollisionTypeSlide
+void colmask_setResponse(LCDSpriteCollisionFilterProc* response);
+SpriteCollisionResponseType colmask_filter(LCDSprite* sprite, LCDSprite* other);
+
+SpriteCollisionInfo* colmask_moveWithCollisions(LCDSprite* sprite, float goalX, float goalY, float* actualX, float* actualY, int* len);
+
+// the mask test on two sprites where they stand, using their images and flips
+int colmask_spritesOverlap(LCDSprite* a, LCDSprite* b);
+
+#endif // COLMASK_H
@@ -0,0 +1,351 @@
+#include "flow.h"
+#include "timing.h"
+
+extern PlaydateAPI* playdate;
+
+const int8_t flow_dx[9] = { 1, 1, 0, -1, -1, -1, 0, 1, 0 };
+const int8_t flow_dy[9] = { 0, 1, 1, 1, 0, -1, -1, -1, 0 };
+
+static inline uint32_t tileCount(const FlowGrid* grid) {
+  return (uint32_t)(grid->height + 2) * grid->stride;
+}
+
+static void neighbourOffsets(const FlowGrid* grid, int* off) {
+  for (int k = 0; k < 8; k++) off[k] = flow_dy[k] * grid->stride + flow_dx[k];
+}
+
+// -- Grid ---------------------------------------------------------------------
+
+FlowGrid* flow_newGrid(int width, int height) {
+  FlowGrid* grid = playdate->system->realloc(NULL, sizeof(FlowGrid));
+  if (grid == NULL) return NULL;
+  grid->width = width;
+  grid->height = height;
+  grid->stride = width + 2;
+  grid->fields = NULL;
+  uint32_t tiles = tileCount(grid);
+  grid->cost = playdate->system->realloc(NULL, tiles);
+  grid->scratch = playdate->system->realloc(NULL, (tiles + FLOW_MAX_PENDING) * sizeof(uint32_t));
+  if (grid->cost == NULL || grid->scratch == NULL) {
+    flow_freeGrid(grid);
+    return NULL;
+  }
+
+  memset(grid->cost, FLOW_BLOCKED, tiles);
+  for (int y = 0; y < height; y++) memset(grid->cost + flow_index(grid, 0, y), 1, width);
+  return grid;
+}
+
+void flow_freeGrid(FlowGrid* grid) {
+  if (grid == NULL) return;
+  while (grid->fields) flow_freeField(grid->fields);
+  if (grid->cost) playdate->system->realloc(grid->cost, 0);
+  if (grid->scratch) playdate->system->realloc(grid->scratch, 0);
+  playdate->system->realloc(grid, 0);
+}
+
+static int isGoal(const FlowField* f, uint32_t index) {
+  for (int i = 0; i < f->goalCount; i++) {
+    if (f->goals[i] == index) return 1;
+  }
+  return 0;
+}
+
+void flow_setCost(FlowGrid* grid, int x, int y, uint8_t cost) {
+  if ((unsigned)x >= (unsigned)grid->width || (unsigned)y >= (unsigned)grid->height) return;
+  uint32_t i = flow_index(grid, x, y);
+  if (cost == 0) cost = 1;
+  if (grid->cost[i] == cost) return;
+  grid->cost[i] = cost;
+
+  for (FlowField* f = grid->fields; f; f = f->next) {
+    if (f->rebuild) continue;
+    if (isGoal(f, i) || f->pendingCount == FLOW_MAX_PENDING) f->rebuild = 1;
+    else f->pending[f->pendingCount++] = i;
+  }
+}
+
+uint8_t flow_cost(const FlowGrid* grid, int x, int y) {
+  if ((unsigned)x >= (unsigned)grid->width || (unsigned)y >= (unsigned)grid->height) return FLOW_BLOCKED;
+  return grid->cost[flow_index(grid, x, y)];
+}
+
+// -- Fields -------------------------------------------------------------------
+
+FlowField* flow_newField(FlowGrid* grid) {
+  FlowField* f = playdate->system->realloc(NULL, sizeof(FlowField));
+  if (f == NULL) return NULL;
+  memset(f, 0, sizeof(FlowField));
+  f->grid = grid;
+  uint32_t tiles = tileCount(grid);
+  f->dist = playdate->system->realloc(NULL, tiles * sizeof(uint16_t));
+  f->dir = playdate->system->realloc(NULL, tiles);
+  if (f->dist == NULL || f->dir == NULL) {
+    if (f->dist) playdate->system->realloc(f->dist, 0);
+    if (f->dir) playdate->system->realloc(f->dir, 0);
+    playdate->system->realloc(f, 0);
+    return NULL;
+  }
+  memset(f->dist, 0xff, tiles * sizeof(uint16_t));
+  memset(f->dir, FLOW_NONE, tiles);
+  f->next = grid->fields;
+  grid->fields = f;
+  return f;
+}
+
+void flow_freeField(FlowField* f) {
+  if (f == NULL) return;
+  for (FlowField** p = &f->grid->fields; *p; p = &(*p)->next) {
+    if (*p == f) {
+      *p = f->next;
+      break;
+    }
+  }
+  playdate->system->realloc(f->dist, 0);
+  playdate->system->realloc(f->dir, 0);
+  if (f->goals) playdate->system->realloc(f->goals, 0);
+  if (f->heap) playdate->system->realloc(f->heap, 0);
+  playdate->system->realloc(f, 0);
+}
+
+int flow_addGoal(FlowField* f, int x, int y) {
+  const FlowGrid* grid = f->grid;
+  if ((unsigned)x >= (unsigned)grid->width || (unsigned)y >= (unsigned)grid->height) return -1;
+  if (f->goalCount == f->goalCapacity) {
+    int capacity = f->goalCapacity ? f->goalCapacity * 2 : 4;
+    uint32_t* goals = playdate->system->realloc(f->goals, capacity * sizeof(uint32_t));
+    if (goals == NULL) return -1;
+    f->goals = goals;
+    f->goalCapacity = capacity;
+  }
+  f->goals[f->goalCount++] = flow_index(grid, x, y);
+  f->rebuild = 1;
+  return 0;
+}
+
+int flow_setGoal(FlowField* f, int x, int y) {
+  flow_clearGoals(f);
+  return flow_addGoal(f, x, y);
+}
+
+void flow_clearGoals(FlowField* f) {
+  f->goalCount = 0;
+  f->rebuild = 1;
+}
+
+int flow_ready(const FlowField* f) {
+  return !f->rebuild && f->heapCount == 0 && f->pendingCount == 0 && !f->sweep;
+}
+
+// -- Heap ---------------------------------------------------------------------
+
+// stale entries are left in and skipped when popped
+static int push(FlowField* f, uint32_t index, uint32_t dist) {
+  if (f->heapCount == f->heapCapacity) {
+    int capacity = f->heapCapacity ? f->heapCapacity * 2 : 256;
+    FlowNode* heap = playdate->system->realloc(f->heap, capacity * sizeof(FlowNode));
+    if (heap == NULL) return -1;
+    f->heap = heap;
+    f->heapCapacity = capacity;
+  }
+  FlowNode* heap = f->heap;
+  int i = f->heapCount++;
+  while (i > 0) {
+    int parent = (i - 1) >> 1;
+    if (heap[parent].dist <= dist) break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = (FlowNode){ index, dist };
+  return 0;
+}
+
+static FlowNode pop(FlowField* f) {
+  FlowNode* heap = f->heap;
+  FlowNode top = heap[0];
+  FlowNode last = heap[--f->heapCount];
+  int n = f->heapCount, i = 0;
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= n) break;
+    if (child + 1 < n && heap[child + 1].dist < heap[child].dist) child++;
+    if (last.dist <= heap[child].dist) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = last;
+  return top;
+}
+
+// -- Passes -------------------------------------------------------------------
+
+static inline uint32_t step(int k, uint8_t cost) {
+  return (k & 1 ? 3u : 2u) * cost;
+}
+
+// diagonal steps need both tiles beside the corner open
+static inline int canStep(const uint8_t* cost, const int* off, uint32_t from, int k) {
+  if (cost[from + off[k]] == FLOW_BLOCKED) return 0;
+  return !(k & 1) || (cost[from + off[k - 1]] != FLOW_BLOCKED && cost[from + off[(k + 1) & 7]] != FLOW_BLOCKED);
+}
+
+static int expand(FlowField* f, const int* off, uint32_t i, uint32_t d) {
+  const uint8_t* cost = f->grid->cost;
+  for (int k = 0; k < 8; k++) {
+    if (!canStep(cost, off, i, k)) continue;
+    uint32_t n = i + off[k];
+    // an agent on n pays for n on its way to i
+    uint32_t nd = d + step(k, cost[n]);
+    if (nd >= FLOW_FAR) nd = FLOW_FAR - 1;
+    if (nd < f->dist[n]) {
+      f->dist[n] = nd;
+      f->dir[n] = (k + 4) & 7;
+      if (push(f, n, nd) < 0) return -1;
+    }
+  }
+  return 0;
+}
+
+static int startRebuild(FlowField* f) {
+  const uint8_t* cost = f->grid->cost;
+  memset(f->dist, 0xff, tileCount(f->grid) * sizeof(uint16_t));
+  f->heapCount = 0;
+  f->pendingCount = 0;
+  f->rebuild = 0;
+  f->sweep = 1;
+  f->stats.rebuilds++;
+  for (int i = 0; i < f->goalCount; i++) {
+    uint32_t g = f->goals[i];
+    if (cost[g] == FLOW_BLOCKED) continue;
+    f->dist[g] = 0;
+    f->dir[g] = FLOW_NONE;
+    if (push(f, g, 0) < 0) return -1;
+  }
+  return 0;
+}
+
+// a changed tile is also the corner of the diagonal steps beside it
+static inline int cutsCorner(const FlowField* f, const int* off, uint32_t u, uint32_t t) {
+  int d = f->dir[u];
+  return (d & 1) && d < FLOW_NONE && (u + off[d - 1] == t || u + off[(d + 1) & 7] == t);
+}
+
+// resets every tile whose path ran through or past a changed tile, gives
+// each the best distance its remaining neighbours offer and queues it, and
+// queues the changed tiles' neighbours again for any steps that opened up
+static int repair(FlowField* f, const int* off) {
+  const uint8_t* cost = f->grid->cost;
+  uint32_t* list = f->grid->scratch;
+  uint32_t count = 0;
+  for (int p = 0; p < f->pendingCount; p++) {
+    uint32_t t = f->pending[p];
+    f->dist[t] = FLOW_FAR;
+    list[count++] = t;
+    for (int k = 0; k < 8; k++) {
+      uint32_t u = t + off[k];
+      if (f->dist[u] != FLOW_FAR && f->dist[u] != 0 && cutsCorner(f, off, u, t)) {
+        f->dist[u] = FLOW_FAR;
+        list[count++] = u;
+      }
+    }
+  }
+
+  for (uint32_t h = 0; h < count; h++) {
+    uint32_t x = list[h];
+    for (int k = 0; k < 8; k++) {
+      uint32_t u = x + off[k];
+      // u steps onto x: its direction points back along k
+      if (f->dist[u] != FLOW_FAR && f->dist[u] != 0 && f->dir[u] == ((k + 4) & 7)) {
+        f->dist[u] = FLOW_FAR;
+        list[count++] = u;
+      }
+    }
+  }
+
+  for (uint32_t h = 0; h < count; h++) {
+    uint32_t x = list[h];
+    if (cost[x] == FLOW_BLOCKED) {
+      f->dir[x] = FLOW_NONE;
+      continue;
+    }
+    uint32_t best = FLOW_FAR;
+    int bestDir = FLOW_NONE;
+    for (int k = 0; k < 8; k++) {
+      uint32_t n = x + off[k];
+      if (f->dist[n] == FLOW_FAR || !canStep(cost, off, x, k)) continue;
+      uint32_t d = f->dist[n] + step(k, cost[x]);
+      if (d >= FLOW_FAR) d = FLOW_FAR - 1;
+      if (d < best) {
+        best = d;
+        bestDir = k;
+      }
+    }
+    if (best == FLOW_FAR || best >= f->dist[x]) continue;
+    f->dist[x] = best;
+    f->dir[x] = bestDir;
+    if (push(f, x, best) < 0) return -1;
+  }
+
+  for (int p = 0; p < f->pendingCount; p++) {
+    for (int k = 0; k < 8; k++) {
+      uint32_t n = f->pending[p] + off[k];
+      if (f->dist[n] != FLOW_FAR && push(f, n, f->dist[n]) < 0) return -1;
+    }
+  }
+  f->pendingCount = 0;
+  f->stats.repairs += count;
+  f->sweep = 1;
+  return 0;
+}
+
+// 1 when the field is ready, 0 when the budget ran out
+static int work(FlowField* f, uint32_t start, uint32_t budgetUs) {
+  int off[8];
+  neighbourOffsets(f->grid, off);
+  for (;;) {
+    if (f->rebuild && startRebuild(f) < 0) return -1;
+
+    int slice = 0;
+    while (f->heapCount > 0) {
+      if (++slice == FLOW_SLICE) {
+        slice = 0;
+        if (timing_ticksToMicros(timing_now() - start) >= budgetUs) return 0;
+      }
+      FlowNode node = pop(f);
+      if (node.dist != f->dist[node.index]) continue;
+      f->stats.expanded++;
+      if (expand(f, off, node.index, node.dist) < 0) return -1;
+    }
+
+    if (f->pendingCount > 0) {
+      if (repair(f, off) < 0) return -1;
+      continue;
+    }
+    if (f->sweep) {
+      uint32_t tiles = tileCount(f->grid);
+      for (uint32_t i = 0; i < tiles; i++) {
+        if (f->dist[i] == FLOW_FAR) f->dir[i] = FLOW_NONE;
+      }
+      f->sweep = 0;
+    }
+    return 1;
+  }
+}
+
+int flow_update(FlowGrid* grid, uint32_t budgetUs) {
+  timing_init();
+  uint32_t start = timing_now();
+  int ready = 1, worked = 0;
+  for (FlowField* f = grid->fields; f; f = f->next) {
+    if (flow_ready(f)) continue;
+    // every call makes some progress, even on a spent budget
+    if (worked++ && timing_ticksToMicros(timing_now() - start) >= budgetUs) return 0;
+    int r = work(f, start, budgetUs);
+    if (r < 0) {
+      playdate->system->logToConsole("flow: out of memory");
+      return -1;
+    }
+    if (r == 0) ready = 0;
+  }
+  return ready;
+}
@@ -0,0 +1,120 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+#include <playdate/api.h>
+
+// Grid flow fields for moving many agents toward shared goals. A field
+// holds, for every tile, the cost of the cheapest path to the nearest goal
+// and the direction of the next step on it, so an agent anywhere on the
+// map looks its direction up with flow_dir() instead of searching. One
+// field serves every agent heading for the same goals.
+//
+// Fields are built with Dijkstra's algorithm from the goals outwards and
+// are never built inside the setters: flow_update() does the work under a
+// time budget and picks up where it stopped on the next call, so a large
+// map is spread over several frames. Until a field is ready, tiles not yet
+// reached keep their previous direction.
+//
+// Changing a tile's cost repairs the fields instead of rebuilding them: the
+// tiles whose path ran through it are reset and filled in again from their
+// neighbours, which is cheap unless the tile was close to a goal. Moving a
+// goal rebuilds the field.
+//
+// Tiles cost 1..254 to stand on, FLOW_BLOCKED is a wall. A straight step
+// costs twice the tile's cost and a diagonal three times; diagonals may not
+// cut a blocked corner. Distances saturate at FLOW_FAR - 1.
+//
+// Layout: each array is row-major with a one-tile blocked border, so the
+// eight neighbours of a tile are fixed offsets with no bounds checks, and an
+// agent's lookup touches one byte.
+
+#define FLOW_BLOCKED 255
+#define FLOW_NONE 8 // direction at goals, walls and unreachable tiles
+#define FLOW_FAR 0xffff
+#define FLOW_MAX_PENDING 64 // cost changes queued per field before it rebuilds instead
+#define FLOW_SLICE 64 // tiles expanded between clock checks
+
+typedef struct FlowField FlowField;
+
+typedef struct
+{
+  int width, height;
+  int stride;       // width + 2
+  uint8_t* cost;    // (height + 2) * stride
+  uint32_t* scratch; // one entry per tile and pending change, for repairs
+  FlowField* fields;
+} FlowGrid;
+
+typedef struct
+{
+  uint32_t index;
+  uint32_t dist;
+} FlowNode;
+
+typedef struct
+{
+  uint32_t expanded; // tiles settled, over all passes
+  uint32_t rebuilds;
+  uint32_t repairs;  // tiles reset by cost changes
+} FlowStats;
+
+struct FlowField
+{
+  FlowGrid* grid;
+  FlowField* next;
+  uint16_t* dist;
+  uint8_t* dir;
+
+  uint32_t* goals;
+  int goalCount, goalCapacity;
+  int rebuild;       // goals changed, start over
+  FlowNode* heap;
+  int heapCount, heapCapacity;
+  uint32_t pending[FLOW_MAX_PENDING]; // changed tiles, repaired after the current pass
+  int pendingCount;
+  int sweep;         // tiles left unreachable get FLOW_NONE when the pass ends
+  FlowStats stats;
+};
+
+// directions 0..7 run clockwise from east; FLOW_NONE is (0, 0)
+extern const int8_t flow_dx[9], flow_dy[9];
+
+// an open grid, every tile costing 1; NULL if out of memory
+FlowGrid* flow_newGrid(int width, int height);
+void flow_freeGrid(FlowGrid* grid); // also frees its fields
+
+void flow_setCost(FlowGrid* grid, int x, int y, uint8_t cost);
+uint8_t flow_cost(const FlowGrid* grid, int x, int y); // FLOW_BLOCKED outside the map
+
+FlowField* flow_newField(FlowGrid* grid);
+void flow_freeField(FlowField* f);
+
+// replace or extend the goals; goals on walls are ignored. -1 if the tile is
+// outside the map or out of memory
+int flow_setGoal(FlowField* f, int x, int y);
+int flow_addGoal(FlowField* f, int x, int y);
+void flow_clearGoals(FlowField* f);
+
+// works on every field of the grid for about budgetUs; 1 once they are all
+// ready, 0 with work left, -1 if out of memory
+int flow_update(FlowGrid* grid, uint32_t budgetUs);
+int flow_ready(const FlowField* f);
+
+static inline uint32_t flow_index(const FlowGrid* grid, int x, int y) {
+  return (uint32_t)(y + 1) * grid->stride + x + 1;
+}
+
+// next step from tile (x, y) as a direction index, FLOW_NONE outside the map
+static inline int flow_dir(const FlowField* f, int x, int y) {
+  const FlowGrid* g = f->grid;
+  if ((unsigned)x >= (unsigned)g->width || (unsigned)y >= (unsigned)g->height) return FLOW_NONE;
+  return f->dir[flow_index(g, x, y)];
+}
+
+static inline uint16_t flow_distance(const FlowField* f, int x, int y) {
+  const FlowGrid* g = f->grid;
+  if ((unsigned)x >= (unsigned)g->width || (unsigned)y >= (unsigned)g->height) return FLOW_FAR;
+  return f->dist[flow_index(g, x, y)];
+}
+
+#endif // FLOW_H
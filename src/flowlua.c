@@ -0,0 +1,63 @@
+#include "flowlua.h"
+
+extern PlaydateAPI* playdate;
+
+static FlowGrid* grid;
+static FlowField* fields[FLOWLUA_MAX_FIELDS];
+static int fieldCount;
+
+FlowGrid* flowlua_grid(void) {
+  return grid;
+}
+
+FlowField* flowlua_field(int field) {
+  return field >= 1 && field <= fieldCount ? fields[field - 1] : NULL;
+}
+
+int flowlua_setMap(int width, int height) {
+  flow_freeGrid(grid);
+  grid = NULL;
+  fieldCount = 0;
+  if (width <= 0 || height <= 0) return -1;
+  grid = flow_newGrid(width, height);
+  return grid ? 0 : -1;
+}
+
+void flowlua_setCost(int x, int y, int cost) {
+  if (grid == NULL) return;
+  flow_setCost(grid, x, y, cost < 1 ? 1 : cost > FLOW_BLOCKED ? FLOW_BLOCKED : cost);
+}
+
+int flowlua_newField(void) {
+  if (grid == NULL || fieldCount == FLOWLUA_MAX_FIELDS) return 0;
+  FlowField* f = flow_newField(grid);
+  if (f == NULL) return 0;
+  fields[fieldCount++] = f;
+  return fieldCount;
+}
+
+int flowlua_setGoal(int field, int x, int y) {
+  FlowField* f = flowlua_field(field);
+  return f ? flow_setGoal(f, x, y) : -1;
+}
+
+int flowlua_addGoal(int field, int x, int y) {
+  FlowField* f = flowlua_field(field);
+  return f ? flow_addGoal(f, x, y) : -1;
+}
+
+int flowlua_update(int budgetUs) {
+  return grid ? flow_update(grid, budgetUs > 0 ? budgetUs : 0) : 1;
+}
+
+void flowlua_step(int field, int x, int y, int* outDx, int* outDy) {
+  FlowField* f = flowlua_field(field);
+  int d = f ? flow_dir(f, x, y) : FLOW_NONE;
+  *outDx = flow_dx[d];
+  *outDy = flow_dy[d];
+}
+
+int flowlua_distance(int field, int x, int y) {
+  FlowField* f = flowlua_field(field);
+  return f ? flow_distance(f, x, y) : FLOW_FAR;
+}
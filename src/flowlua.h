@@ -0,0 +1,53 @@
+#ifndef FLOWLUA_H
+#define FLOWLUA_H
+
+#include "flow.h"
+
+// Flow fields for Lua games. Lua cannot hold a FlowGrid*, so this keeps one
+// map for the game and numbers its fields from 1. The functions below are
+// bound by pdluagen.py into a static "flow" class; call
+// luagen_register_flowlua() from kEventInitLua.
+//
+//   flow.setMap(100, 60)
+//   flow.setCost(x, y, 255)            -- a wall
+//   local f = flow.newField()
+//   flow.setGoal(f, px, py)
+//   flow.update(1000)                  -- every frame, a budget in us
+//   local dx, dy = flow.step(f, tx, ty)
+//
+// flow.step is the hot one, made once per agent per frame: both components
+// of the step come back from a single call. Tiles are 0-based as in flow.h.
+
+#define FLOWLUA_MAX_FIELDS 16
+
+FlowGrid* flowlua_grid(void);        // NULL until setMap
+FlowField* flowlua_field(int field); // NULL if there is no such field
+
+// replaces the map and its fields; 0, or -1 if out of memory
+// @lua class=flow name=setMap
+int flowlua_setMap(int width, int height);
+
+// @lua class=flow name=setCost
+void flowlua_setCost(int x, int y, int cost);
+
+// a field number, 0 if there is no map, no room or no memory
+// @lua class=flow name=newField
+int flowlua_newField(void);
+
+// @lua class=flow name=setGoal
+int flowlua_setGoal(int field, int x, int y);
+
+// @lua class=flow name=addGoal
+int flowlua_addGoal(int field, int x, int y);
+
+// @lua class=flow name=update
+int flowlua_update(int budgetUs);
+
+// (0, 0) at goals, walls, unreachable tiles and unknown fields
+// @lua class=flow name=step
+void flowlua_step(int field, int x, int y, int* outDx, int* outDy);
+
+// @lua class=flow name=distance
+int flowlua_distance(int field, int x, int y);
+
+#endif // FLOWLUA_H
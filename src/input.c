@@ -0,0 +1,112 @@
+#include "input.h"
+
+extern PlaydateAPI* playdate;
+
+static InputEvent* ring;
+static uint32_t mask;
+static volatile uint32_t head; // next slot to write, only the producer moves it
+static volatile uint32_t tail; // next slot to read, only the consumer moves it
+static InputStats stats;
+
+static int push(PDButtons button, int down, uint32_t when, int injected) {
+  if (ring == NULL) return -1;
+  const struct playdate_sys* sys = playdate->system;
+  uint32_t h = head;
+  if (h - tail > mask) {
+    stats.dropped++;
+    return -1;
+  }
+
+  InputEvent* e = &ring[h & mask];
+  e->when = when;
+  e->queued = sys->getCurrentTimeMilliseconds();
+  e->button = button;
+  e->down = down != 0;
+  e->injected = injected;
+  e->crankAngle = sys->getCrankAngle();
+  sys->getAccelerometer(&e->accel[0], &e->accel[1], &e->accel[2]);
+  head = h + 1; // publish after the slot is written
+
+  // injected events may be stamped ahead of the clock
+  uint32_t delay = e->queued >= when ? e->queued - when : 0;
+  stats.events++;
+  stats.injected += injected;
+  stats.deliverTotalMs += delay;
+  if (delay > stats.deliverMaxMs) stats.deliverMaxMs = delay;
+  return 0;
+}
+
+static int buttonCallback(PDButtons button, int down, uint32_t when, void* userdata) {
+  push(button, down, when, 0);
+  return 0;
+}
+
+int input_start(int capacity) {
+  uint32_t size = 1;
+  while (size < (uint32_t)capacity) size <<= 1;
+  if (ring == NULL || size != mask + 1) {
+    InputEvent* grown = playdate->system->realloc(ring, size * sizeof(InputEvent));
+    if (grown == NULL) return -1;
+    ring = grown;
+    mask = size - 1;
+  }
+  head = tail = 0;
+  playdate->system->setButtonCallback(buttonCallback, NULL, size);
+  return 0;
+}
+
+void input_stop(void) {
+  if (ring == NULL) return;
+  playdate->system->setButtonCallback(NULL, NULL, 0);
+  playdate->system->realloc(ring, 0);
+  ring = NULL;
+  head = tail = 0;
+}
+
+int input_peek(InputEvent* out) {
+  uint32_t t = tail;
+  if (t == head) return 0;
+  *out = ring[t & mask];
+  return 1;
+}
+
+int input_next(InputEvent* out) {
+  if (!input_peek(out)) return 0;
+  tail = tail + 1;
+
+  uint32_t now = playdate->system->getCurrentTimeMilliseconds();
+  uint32_t delay = now >= out->when ? now - out->when : 0;
+  stats.consumed++;
+  stats.consumeTotalMs += delay;
+  if (delay > stats.consumeMaxMs) stats.consumeMaxMs = delay;
+  return 1;
+}
+
+int input_count(void) {
+  return (int)(head - tail);
+}
+
+void input_clear(void) {
+  tail = head;
+}
+
+int input_inject(PDButtons button, int down, uint32_t when) {
+  return push(button, down, when, 1);
+}
+
+void input_stats(InputStats* out) {
+  *out = stats;
+}
+
+void input_resetStats(void) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void input_log(void) {
+  uint32_t events = stats.events ? stats.events : 1;
+  uint32_t consumed = stats.consumed ? stats.consumed : 1;
+  playdate->system->logToConsole("input: %u events (%u injected, %u dropped), delivered avg %ums max %ums, consumed avg %ums max %ums",
+    stats.events, stats.injected, stats.dropped,
+    stats.deliverTotalMs / events, stats.deliverMaxMs,
+    stats.consumeTotalMs / consumed, stats.consumeMaxMs);
+}
@@ -0,0 +1,70 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <playdate/api.h>
+
+// Ordered, timestamped button events. Polling getButtonState once a frame
+// only says which buttons went down or up since the last poll: two presses
+// of different buttons in one frame come out unordered and a quick tap on
+// the same button is lost. input_start() installs a button callback that
+// copies every event, with the `when` the system gives it, into a ring the
+// game drains with input_next() in its update, oldest first.
+//
+// The system calls the button callback just before the update, for events
+// that happened during the previous frame, so `when` is the useful time and
+// the delay between the two is reported in the stats. The crank angle and
+// accelerometer are sampled when each event is queued, which is the closest
+// the API gets to reading them at the moment of the press; enable the
+// accelerometer with setPeripheralsEnabled for those to be meaningful.
+//
+// The ring has one producer (the callback, or input_inject) and one
+// consumer (the game), so neither side takes a lock. When it is full new
+// events are dropped and counted. Times are on the getCurrentTimeMilliseconds
+// clock.
+//
+// Start the queue after replay_record/replay_play, like any other button
+// callback, and recorded events are replayed through it with their original
+// times. input_inject() feeds synthetic events through the same path for
+// tests and demos.
+
+typedef struct
+{
+  uint32_t when;   // ms, when the button changed
+  uint32_t queued; // ms, when the event reached the queue
+  PDButtons button;
+  uint8_t down;
+  uint8_t injected;
+  float crankAngle; // sampled when queued
+  float accel[3];
+} InputEvent;
+
+typedef struct
+{
+  uint32_t events;   // queued, including injected ones
+  uint32_t injected;
+  uint32_t dropped;  // the ring was full
+  uint32_t consumed;
+  uint32_t deliverTotalMs, deliverMaxMs; // when to queued
+  uint32_t consumeTotalMs, consumeMaxMs; // when to input_next
+} InputStats;
+
+// capacity is rounded up to a power of two and also passed to the system as
+// its own queue size; -1 if the ring cannot be allocated
+int input_start(int capacity);
+void input_stop(void); // removes the callback and frees the ring
+
+// 1 and the oldest event in *out, or 0 if the queue is empty
+int input_next(InputEvent* out);
+int input_peek(InputEvent* out); // same without removing it
+int input_count(void);
+void input_clear(void);
+
+// queues an event as if the system had reported it; 0, or -1 if the queue
+// is not started or full
+int input_inject(PDButtons button, int down, uint32_t when);
+
+void input_stats(InputStats* out);
+void input_resetStats(void);
+void input_log(void);
+
+#endif // INPUT_H
@@ -0,0 +1,232 @@
+#include "jsonbind.h"
+
+extern PlaydateAPI* playdate;
+
+typedef struct
+{
+  JsonSchema* schema; // NULL for a subtree being skipped
+  const JsonField* array; // set when this frame is an array
+  uint8_t* base;
+  const JsonField* pending; // field accepted by shouldDecodeTableValueForKey
+  int index; // array element accepted by shouldDecodeArrayValueAtIndex
+  int count;
+} BindFrame;
+
+typedef struct
+{
+  json_decoder decoder;
+  BindFrame frames[JSONBIND_MAX_DEPTH];
+  int depth;
+  int overflow; // levels nested past JSONBIND_MAX_DEPTH, all skipped
+  int started;
+  const char* error;
+} Binder;
+
+// -- Perfect hash -------------------------------------------------------------
+
+static inline uint32_t keyHash(const char* key, uint32_t seed) {
+  uint32_t h = 0x811c9dc5 ^ seed;
+  while (*key) h = (h ^ (uint8_t)*key++) * 0x01000193;
+  return h ^ (h >> 15);
+}
+
+int jsonbind_prepare(JsonSchema* schema) {
+  if (schema->mask) return 0;
+  if (schema->count > JSONBIND_MAX_FIELDS) return -1;
+
+  uint32_t size = 2;
+  while (size < 2 * (uint32_t)schema->count) size <<= 1;
+
+  // the table is at least twice the field count, so a collision-free seed
+  // turns up after a handful of tries
+  for (uint32_t seed = 1; ; seed++) {
+    memset(schema->slots, 0, sizeof(schema->slots));
+    int ok = 1;
+    for (int i = 0; i < schema->count && ok; i++) {
+      uint32_t slot = keyHash(schema->fields[i].name, seed) & (size - 1);
+      if (schema->slots[slot]) ok = 0;
+      else schema->slots[slot] = i + 1;
+    }
+    if (ok) {
+      schema->seed = seed;
+      break;
+    }
+    if (seed == 0xffff) {
+      if (size == sizeof(schema->slots)) return -1;
+      size <<= 1;
+      seed = 0;
+    }
+  }
+  schema->mask = size - 1;
+
+  for (int i = 0; i < schema->count; i++) {
+    if (schema->fields[i].schema && jsonbind_prepare(schema->fields[i].schema) < 0) return -1;
+  }
+  return 0;
+}
+
+int jsonbind_find(const JsonSchema* schema, const char* key) {
+  int slot = schema->slots[keyHash(key, schema->seed) & schema->mask];
+  if (slot == 0 || strcmp(schema->fields[slot - 1].name, key) != 0) return -1;
+  return slot - 1;
+}
+
+// -- Value storage ------------------------------------------------------------
+
+static void store(uint8_t* dst, int type, int size, json_value value) {
+  switch (type) {
+    case kBindInt:
+      *(int*)dst = json_intValue(value);
+      break;
+    case kBindFloat:
+      *(float*)dst = json_floatValue(value);
+      break;
+    case kBindBool:
+      *(int*)dst = json_boolValue(value) != 0;
+      break;
+    case kBindString:
+      if (value.type == kJSONString && size > 0) {
+        strncpy((char*)dst, value.data.stringval, size - 1);
+        dst[size - 1] = '\0';
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// -- Decoder callbacks --------------------------------------------------------
+
+static BindFrame skipFrame;
+
+static inline BindFrame* top(json_decoder* decoder) {
+  Binder* b = decoder->userdata;
+  return b->overflow ? &skipFrame : &b->frames[b->depth];
+}
+
+static void decodeError(json_decoder* decoder, const char* error, int linenum) {
+  Binder* b = decoder->userdata;
+  b->error = error;
+}
+
+static int shouldDecodeTableValueForKey(json_decoder* decoder, const char* key) {
+  BindFrame* f = top(decoder);
+  if (f->schema == NULL || f->array) return 0;
+  int i = jsonbind_find(f->schema, key);
+  f->pending = i < 0 ? NULL : &f->schema->fields[i];
+  return i >= 0;
+}
+
+static int shouldDecodeArrayValueAtIndex(json_decoder* decoder, int pos) {
+  BindFrame* f = top(decoder);
+  if (f->array == NULL) return 0;
+  f->index = pos - 1;
+  return f->index >= 0 && (uint32_t)f->index < f->array->capacity;
+}
+
+static void willDecodeSublist(json_decoder* decoder, const char* name, json_value_type type) {
+  Binder* b = decoder->userdata;
+  if (!b->started) {
+    b->started = 1;
+    // the root ("_root") maps onto the frame set up by decode()
+    if (b->frames[0].pending == NULL) return;
+  }
+
+  BindFrame* parent = &b->frames[b->depth];
+  BindFrame child = { NULL, NULL, NULL, NULL, 0, 0 };
+
+  if (parent->array && parent->array->elemType == kBindTable && type == kJSONTable) {
+    child.schema = parent->array->schema;
+    child.base = parent->base + parent->index * parent->array->size;
+  }
+  else if (parent->pending && !parent->array) {
+    const JsonField* field = parent->pending;
+    if (field->type == kBindTable && type == kJSONTable) {
+      child.schema = field->schema;
+      child.base = parent->base + field->offset;
+    }
+    else if (field->type == kBindArray && type == kJSONArray) {
+      child.schema = parent->schema;
+      child.array = field;
+      child.base = parent->base + field->offset;
+    }
+  }
+
+  if (b->overflow || b->depth + 1 >= JSONBIND_MAX_DEPTH) {
+    b->overflow++;
+    return;
+  }
+  b->frames[++b->depth] = child;
+}
+
+static void* didDecodeSublist(json_decoder* decoder, const char* name, json_value_type type) {
+  Binder* b = decoder->userdata;
+  BindFrame* f = &b->frames[b->depth];
+  if (b->overflow) {
+    b->overflow--;
+    return NULL;
+  }
+  if (b->depth == 0) return NULL;
+
+  if (f->array) {
+    BindFrame* parent = &b->frames[b->depth - 1];
+    *(int*)(parent->base + f->array->countOffset) = f->count;
+  }
+  b->depth--;
+  return NULL;
+}
+
+static void didDecodeTableValue(json_decoder* decoder, const char* key, json_value value) {
+  BindFrame* f = top(decoder);
+  const JsonField* field = f->pending;
+  if (field == NULL || value.type == kJSONArray || value.type == kJSONTable) return;
+  store(f->base + field->offset, field->type, field->size, value);
+}
+
+static void didDecodeArrayValue(json_decoder* decoder, int pos, json_value value) {
+  BindFrame* f = top(decoder);
+  if (f->array == NULL || pos < 1 || (uint32_t)pos > f->array->capacity) return;
+  if (pos > f->count) f->count = pos;
+  if (value.type == kJSONArray || value.type == kJSONTable) return;
+  store(f->base + (pos - 1) * f->array->size, f->array->elemType, f->array->size, value);
+}
+
+static void setup(Binder* b, JsonSchema* schema, void* out) {
+  memset(b, 0, sizeof(Binder));
+  b->decoder.decodeError = decodeError;
+  b->decoder.willDecodeSublist = willDecodeSublist;
+  b->decoder.shouldDecodeTableValueForKey = shouldDecodeTableValueForKey;
+  b->decoder.didDecodeTableValue = didDecodeTableValue;
+  b->decoder.shouldDecodeArrayValueAtIndex = shouldDecodeArrayValueAtIndex;
+  b->decoder.didDecodeArrayValue = didDecodeArrayValue;
+  b->decoder.didDecodeSublist = didDecodeSublist;
+  b->decoder.userdata = b;
+  b->frames[0].schema = schema;
+  b->frames[0].base = out;
+}
+
+int jsonbind_decode(JsonSchema* schema, void* out, json_reader reader, const char** outErr) {
+  if (jsonbind_prepare(schema) < 0) {
+    if (outErr) *outErr = "schema has too many fields";
+    return 0;
+  }
+  Binder b;
+  setup(&b, schema, out);
+  json_value root;
+  int ok = playdate->json->decode(&b.decoder, reader, &root);
+  if (outErr) *outErr = b.error;
+  return ok && b.error == NULL;
+}
+
+int jsonbind_decodeString(JsonSchema* schema, void* out, const char* json, const char** outErr) {
+  if (jsonbind_prepare(schema) < 0) {
+    if (outErr) *outErr = "schema has too many fields";
+    return 0;
+  }
+  Binder b;
+  setup(&b, schema, out);
+  json_value root;
+  int ok = playdate->json->decodeString(&b.decoder, json, &root);
+  if (outErr) *outErr = b.error;
+  return ok && b.error == NULL;
+}
@@ -0,0 +1,82 @@
+#ifndef JSONBIND_H
+#define JSONBIND_H
+
+#include <stddef.h>
+#include <playdate/api.h>
+
+// Schema-driven binding for playdate->json. Describe a struct once as a list
+// of fields (JSON key, offset, type) and decode straight into it: keys are
+// dispatched through a perfect hash built by jsonbind_prepare(), values are
+// written in place, and keys the schema does not name are refused in
+// shouldDecodeTableValueForKey so the decoder skips their whole subtree.
+//
+//   typedef struct { int hp; float speed; char name[16]; } Enemy;
+//   static const JsonField enemyFields[] = {
+//     JSONBIND_INT(Enemy, hp),
+//     JSONBIND_FLOAT(Enemy, speed),
+//     JSONBIND_STRING(Enemy, name),
+//   };
+//   static JsonSchema enemySchema = JSONBIND_SCHEMA(enemyFields);
+
+#define JSONBIND_MAX_FIELDS 64
+#define JSONBIND_MAX_DEPTH 16
+
+typedef enum
+{
+  kBindInt,    // int
+  kBindFloat,  // float
+  kBindBool,   // int, 0 or 1
+  kBindString, // char[size], truncated and always terminated
+  kBindTable,  // nested struct described by schema
+  kBindArray   // elem[capacity] with stride size, element count stored at countOffset
+} JsonBindType;
+
+typedef struct JsonSchema JsonSchema;
+
+typedef struct
+{
+  const char* name;
+  uint32_t offset;
+  uint8_t type;
+  uint8_t elemType; // arrays: type of each element
+  uint32_t size;    // string capacity or array stride
+  uint32_t capacity;
+  uint32_t countOffset;
+  JsonSchema* schema; // nested table, or table array element
+} JsonField;
+
+struct JsonSchema
+{
+  const JsonField* fields;
+  int count;
+
+  // perfect hash, filled in by jsonbind_prepare()
+  uint32_t seed;
+  uint32_t mask;
+  uint8_t slots[2 * JSONBIND_MAX_FIELDS]; // field index + 1, 0 when empty
+};
+
+#define JSONBIND_SCHEMA(fields) { fields, sizeof(fields) / sizeof((fields)[0]), 0, 0, {0} }
+
+#define JSONBIND_KEY(key, T, m, t) { key, offsetof(T, m), t, 0, sizeof(((T*)0)->m), 0, 0, NULL }
+#define JSONBIND_INT(T, m) JSONBIND_KEY(#m, T, m, kBindInt)
+#define JSONBIND_FLOAT(T, m) JSONBIND_KEY(#m, T, m, kBindFloat)
+#define JSONBIND_BOOL(T, m) JSONBIND_KEY(#m, T, m, kBindBool)
+#define JSONBIND_STRING(T, m) JSONBIND_KEY(#m, T, m, kBindString)
+#define JSONBIND_TABLE(T, m, s) { #m, offsetof(T, m), kBindTable, 0, sizeof(((T*)0)->m), 0, 0, &(s) }
+#define JSONBIND_ARRAY(T, m, count, et) \
+  { #m, offsetof(T, m), kBindArray, et, sizeof(((T*)0)->m[0]), sizeof(((T*)0)->m) / sizeof(((T*)0)->m[0]), offsetof(T, count), NULL }
+#define JSONBIND_TABLE_ARRAY(T, m, count, s) \
+  { #m, offsetof(T, m), kBindArray, kBindTable, sizeof(((T*)0)->m[0]), sizeof(((T*)0)->m) / sizeof(((T*)0)->m[0]), offsetof(T, count), &(s) }
+
+// builds the key hash for schema and every schema nested in it; called
+// lazily by the decode functions, returns -1 if a schema has too many fields
+int jsonbind_prepare(JsonSchema* schema);
+
+// index of key in schema->fields, or -1
+int jsonbind_find(const JsonSchema* schema, const char* key);
+
+int jsonbind_decode(JsonSchema* schema, void* out, json_reader reader, const char** outErr);
+int jsonbind_decodeString(JsonSchema* schema, void* out, const char* json, const char** outErr);
+
+#endif // JSONBIND_H
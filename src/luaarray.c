@@ -0,0 +1,265 @@
+#include "luaarray.h"
+
+extern PlaydateAPI* playdate;
+
+static const char* typeNames[] = { "int16", "int32", "float", "fixed" };
+
+// -- C side -------------------------------------------------------------------
+
+LuaArray* luaarray_new(LuaArrayType type, uint32_t count) {
+  LuaArray* a = playdate->system->realloc(NULL, sizeof(LuaArray));
+  if (a == NULL) return NULL;
+  a->type = type;
+  a->count = a->capacity = 0;
+  a->data = NULL;
+  if (luaarray_resize(a, count) < 0) {
+    playdate->system->realloc(a, 0);
+    return NULL;
+  }
+  return a;
+}
+
+void luaarray_free(LuaArray* array) {
+  if (array == NULL) return;
+  if (array->data) playdate->system->realloc(array->data, 0);
+  playdate->system->realloc(array, 0);
+}
+
+// grows geometrically, new elements are zeroed
+int luaarray_resize(LuaArray* array, uint32_t count) {
+  int stride = luaarray_stride(array->type);
+  if (count > array->capacity) {
+    uint32_t capacity = array->capacity ? array->capacity : 16;
+    while (capacity < count) capacity *= 2;
+    void* data = playdate->system->realloc(array->data, capacity * stride);
+    if (data == NULL) return -1;
+    array->data = data;
+    array->capacity = capacity;
+  }
+  if (count > array->count) {
+    memset((uint8_t*)array->data + array->count * stride, 0, (count - array->count) * stride);
+  }
+  array->count = count;
+  return 0;
+}
+
+float luaarray_get(const LuaArray* array, uint32_t index) {
+  switch (array->type) {
+    case kLuaArrayInt16: return ((const int16_t*)array->data)[index];
+    case kLuaArrayInt32: return (float)((const int32_t*)array->data)[index];
+    case kLuaArrayFloat: return ((const float*)array->data)[index];
+    case kLuaArrayFixed: return ((const int32_t*)array->data)[index] * (1.0f / 65536.0f);
+  }
+  return 0;
+}
+
+void luaarray_set(LuaArray* array, uint32_t index, float value) {
+  switch (array->type) {
+    case kLuaArrayInt16: ((int16_t*)array->data)[index] = (int16_t)value; break;
+    case kLuaArrayInt32: ((int32_t*)array->data)[index] = (int32_t)value; break;
+    case kLuaArrayFloat: ((float*)array->data)[index] = value; break;
+    case kLuaArrayFixed: ((int32_t*)array->data)[index] = (int32_t)(value * 65536.0f); break;
+  }
+}
+
+LuaUDObject* luaarray_push(LuaArray* array) {
+  return playdate->lua->pushObject(array, LUAARRAY_CLASS, 0);
+}
+
+LuaArray* luaarray_arg(int pos) {
+  return playdate->lua->getArgObject(pos, LUAARRAY_CLASS, NULL);
+}
+
+int luaarray_view(int pos, LuaArrayType type, LuaArrayView* out) {
+  switch (playdate->lua->getArgType(pos, NULL)) {
+    case kTypeString: {
+      size_t len = 0;
+      out->data = playdate->lua->getArgBytes(pos, &len);
+      out->count = len / luaarray_stride(type);
+      out->type = type;
+      out->array = NULL;
+      return 0;
+    }
+    case kTypeObject: {
+      LuaArray* a = luaarray_arg(pos);
+      if (a == NULL || a->type != type) return -1;
+      out->data = a->data;
+      out->count = a->count;
+      out->type = type;
+      out->array = a;
+      return 0;
+    }
+    default:
+      return -1;
+  }
+}
+
+// -- Lua side -----------------------------------------------------------------
+
+// integers go through getArgInt/pushInt so int32 values stay exact
+static inline void setFromArg(LuaArray* a, uint32_t index, int pos) {
+  if (a->type == kLuaArrayInt16) ((int16_t*)a->data)[index] = (int16_t)playdate->lua->getArgInt(pos);
+  else if (a->type == kLuaArrayInt32) ((int32_t*)a->data)[index] = playdate->lua->getArgInt(pos);
+  else luaarray_set(a, index, playdate->lua->getArgFloat(pos));
+}
+
+static inline void push(const LuaArray* a, uint32_t index) {
+  if (a->type == kLuaArrayInt16) playdate->lua->pushInt(((const int16_t*)a->data)[index]);
+  else if (a->type == kLuaArrayInt32) playdate->lua->pushInt(((const int32_t*)a->data)[index]);
+  else playdate->lua->pushFloat(luaarray_get(a, index));
+}
+
+static LuaArray* self(const char* method) {
+  LuaArray* a = luaarray_arg(1);
+  if (a == NULL) playdate->system->error("luaarray.%s: expected a luaarray", method);
+  return a;
+}
+
+// converts a 1-based Lua index; count is the number of elements that must fit
+static int checkIndex(LuaArray* a, int pos, uint32_t count, const char* method) {
+  int i = playdate->lua->getArgInt(pos) - 1;
+  if (i < 0 || (uint32_t)i + count > a->count) {
+    playdate->system->error("luaarray.%s: index %d out of range (count %u)", method, i + 1, a->count);
+    return -1;
+  }
+  return i;
+}
+
+static int array_new(lua_State* L) {
+  const char* name = playdate->lua->getArgString(1);
+  int count = playdate->lua->getArgInt(2);
+  for (int type = 0; name && type < 4; type++) {
+    if (strcmp(name, typeNames[type]) != 0) continue;
+    LuaArray* a = luaarray_new(type, count > 0 ? count : 0);
+    if (a == NULL) {
+      playdate->system->error("luaarray.new: out of memory");
+      return 0;
+    }
+    luaarray_push(a);
+    return 1;
+  }
+  playdate->system->error("luaarray.new: unknown type %s", name ? name : "(nil)");
+  return 0;
+}
+
+static int array_gc(lua_State* L) {
+  luaarray_free(luaarray_arg(1));
+  return 0;
+}
+
+static int array_count(lua_State* L) {
+  LuaArray* a = self("count");
+  if (a == NULL) return 0;
+  playdate->lua->pushInt(a->count);
+  return 1;
+}
+
+static int array_type(lua_State* L) {
+  LuaArray* a = self("type");
+  if (a == NULL) return 0;
+  playdate->lua->pushString(typeNames[a->type]);
+  return 1;
+}
+
+static int array_resize(lua_State* L) {
+  LuaArray* a = self("resize");
+  int count = playdate->lua->getArgInt(2);
+  if (a && (count < 0 || luaarray_resize(a, count) < 0)) playdate->system->error("luaarray.resize: cannot resize to %d", count);
+  return 0;
+}
+
+static int array_fill(lua_State* L) {
+  LuaArray* a = self("fill");
+  if (a == NULL || a->count == 0) return 0;
+  setFromArg(a, 0, 2);
+  int stride = luaarray_stride(a->type);
+  for (uint32_t i = 1; i < a->count; i++) memcpy((uint8_t*)a->data + i * stride, a->data, stride);
+  return 0;
+}
+
+static int array_get(lua_State* L) {
+  LuaArray* a = self("get");
+  int i = a ? checkIndex(a, 2, 1, "get") : -1;
+  if (i < 0) return 0;
+  push(a, i);
+  return 1;
+}
+
+static int array_set(lua_State* L) {
+  LuaArray* a = self("set");
+  int i = a ? checkIndex(a, 2, 1, "set") : -1;
+  if (i >= 0) setFromArg(a, i, 3);
+  return 0;
+}
+
+// a:setMany(start, v1, v2, ...)
+static int array_setMany(lua_State* L) {
+  LuaArray* a = self("setMany");
+  int n = playdate->lua->getArgCount() - 2;
+  int i = a && n > 0 ? checkIndex(a, 2, n, "setMany") : -1;
+  if (i < 0) return 0;
+  for (int k = 0; k < n; k++) setFromArg(a, i + k, 3 + k);
+  return 0;
+}
+
+// a:getMany(start, n) returns n values
+static int array_getMany(lua_State* L) {
+  LuaArray* a = self("getMany");
+  int n = playdate->lua->getArgInt(3);
+  int i = a && n > 0 ? checkIndex(a, 2, n, "getMany") : -1;
+  if (i < 0) return 0;
+  for (int k = 0; k < n; k++) push(a, i + k);
+  return n;
+}
+
+// a:setBytes(s [, start]) copies a binary string over the array, growing it
+static int array_setBytes(lua_State* L) {
+  LuaArray* a = self("setBytes");
+  if (a == NULL) return 0;
+  size_t len = 0;
+  const char* bytes = playdate->lua->getArgBytes(2, &len);
+  int start = playdate->lua->getArgCount() >= 3 ? playdate->lua->getArgInt(3) - 1 : 0;
+  int stride = luaarray_stride(a->type);
+  uint32_t end = start + len / stride;
+  if (bytes == NULL || start < 0 || (end > a->count && luaarray_resize(a, end) < 0)) {
+    playdate->system->error("luaarray.setBytes: bad arguments");
+    return 0;
+  }
+  memcpy((uint8_t*)a->data + start * stride, bytes, (len / stride) * stride);
+  return 0;
+}
+
+// a:bytes([start, n]) returns the contents as one binary string
+static int array_bytes(lua_State* L) {
+  LuaArray* a = self("bytes");
+  if (a == NULL) return 0;
+  int i = 0, n = a->count;
+  if (playdate->lua->getArgCount() >= 3) {
+    n = playdate->lua->getArgInt(3);
+    i = checkIndex(a, 2, n, "bytes");
+    if (i < 0) return 0;
+  }
+  int stride = luaarray_stride(a->type);
+  playdate->lua->pushBytes((const char*)a->data + i * stride, n * stride);
+  return 1;
+}
+
+static const lua_reg arrayClass[] = {
+  { "new", array_new },
+  { "__gc", array_gc },
+  { "count", array_count },
+  { "type", array_type },
+  { "resize", array_resize },
+  { "fill", array_fill },
+  { "get", array_get },
+  { "set", array_set },
+  { "getMany", array_getMany },
+  { "setMany", array_setMany },
+  { "setBytes", array_setBytes },
+  { "bytes", array_bytes },
+  { NULL, NULL }
+};
+
+int luaarray_register(const char** outErr) {
+  return playdate->lua->registerClass(LUAARRAY_CLASS, arrayClass, NULL, 0, outErr);
+}
@@ -0,0 +1,76 @@
+#ifndef LUAARRAY_H
+#define LUAARRAY_H
+
+#include <playdate/api.h>
+
+// Packed numeric arrays shared between Lua and C. A LuaArray is a Lua
+// userdata over one contiguous buffer of int16, int32, float or 16.16 fixed
+// values: scripts fill it with a few bulk calls (setMany, setBytes) and pass
+// the whole thing to C as a single argument, where it is processed in place
+// through a typed pointer. Binary strings from Lua work as read-only views
+// too, so data built with string.pack crosses with one getArgBytes.
+//
+// Lua side, after luaarray_register():
+//   local a = luaarray.new("int16", 256)
+//   a:setMany(1, x1, y1, x2, y2)     -- any number of values per call
+//   local x, y = a:getMany(1, 2)
+//   a:setBytes(s), a:bytes()          -- raw little-endian contents
+//   a:get(i), a:set(i, v), a:count(), a:resize(n), a:fill(v), a:type()
+// Indices are 1-based on the Lua side and 0-based in C.
+
+#define LUAARRAY_CLASS "luaarray"
+
+typedef enum
+{
+  kLuaArrayInt16,
+  kLuaArrayInt32,
+  kLuaArrayFloat,
+  kLuaArrayFixed // 16.16, stored as int32
+} LuaArrayType;
+
+typedef struct
+{
+  LuaArrayType type;
+  uint32_t count;
+  uint32_t capacity;
+  void* data;
+} LuaArray;
+
+typedef struct
+{
+  LuaArrayType type;
+  uint32_t count;
+  const void* data;
+  LuaArray* array; // NULL when viewing a string
+} LuaArrayView;
+
+int luaarray_register(const char** outErr); // call from kEventInitLua
+
+LuaArray* luaarray_new(LuaArrayType type, uint32_t count);
+void luaarray_free(LuaArray* array);
+int luaarray_resize(LuaArray* array, uint32_t count);
+
+static inline int luaarray_stride(LuaArrayType type) {
+  return type == kLuaArrayInt16 ? 2 : 4;
+}
+
+// hands a C-owned array to Lua, which frees it when collected
+LuaUDObject* luaarray_push(LuaArray* array);
+
+// the luaarray at stack position pos, or NULL
+LuaArray* luaarray_arg(int pos);
+
+// a luaarray or a binary string at pos, as `type` elements; -1 if pos holds
+// neither or an array of another type
+int luaarray_view(int pos, LuaArrayType type, LuaArrayView* out);
+
+// typed access for in-place processing; NULL on a type mismatch
+static inline int16_t* luaarray_int16(LuaArray* a) { return a && a->type == kLuaArrayInt16 ? a->data : NULL; }
+static inline int32_t* luaarray_int32(LuaArray* a) { return a && a->type == kLuaArrayInt32 ? a->data : NULL; }
+static inline float* luaarray_float(LuaArray* a) { return a && a->type == kLuaArrayFloat ? a->data : NULL; }
+static inline int32_t* luaarray_fixed(LuaArray* a) { return a && a->type == kLuaArrayFixed ? a->data : NULL; }
+
+float luaarray_get(const LuaArray* array, uint32_t index);
+void luaarray_set(LuaArray* array, uint32_t index, float value);
+
+#endif // LUAARRAY_H
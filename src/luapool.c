@@ -0,0 +1,147 @@
+#include "luapool.h"
+
+extern PlaydateAPI* playdate;
+
+typedef struct PoolNode
+{
+  struct PoolNode* next; // free list link
+  LuaPool* pool;
+  LuaUDObject* ud;   // set while Lua owns the object
+  uint32_t retains;
+} PoolNode;
+
+// node headers are padded so objects behind them stay 8 byte aligned
+#define NODE_HEADER ((sizeof(PoolNode) + 7) & ~(size_t)7)
+
+typedef struct PoolBlock
+{
+  struct PoolBlock* next;
+} PoolBlock;
+
+struct LuaPool
+{
+  const char* className;
+  size_t objectSize;
+  size_t nodeSize;
+  PoolNode* free;
+  PoolBlock* blocks;
+
+  LuaPoolStats stats; // created/reused/collected are the last frame's
+  uint32_t created, reused, collected;
+};
+
+static LuaPool pools[LUAPOOL_MAX];
+static int poolCount;
+
+static inline void* objectOf(PoolNode* node) { return (uint8_t*)node + NODE_HEADER; }
+static inline PoolNode* nodeOf(void* object) { return (PoolNode*)((uint8_t*)object - NODE_HEADER); }
+
+static int grow(LuaPool* pool, int count) {
+  PoolBlock* block = playdate->system->realloc(NULL, NODE_HEADER + count * pool->nodeSize);
+  if (block == NULL) return -1;
+  block->next = pool->blocks;
+  pool->blocks = block;
+
+  uint8_t* p = (uint8_t*)block + NODE_HEADER;
+  for (int i = 0; i < count; i++, p += pool->nodeSize) {
+    PoolNode* node = (PoolNode*)p;
+    node->pool = pool;
+    node->ud = NULL;
+    node->retains = 0;
+    node->next = pool->free;
+    pool->free = node;
+  }
+  pool->stats.allocated += count;
+  return 0;
+}
+
+LuaPool* luapool_new(const char* className, size_t objectSize, const lua_reg* methods, int prealloc, const char** outErr) {
+  if (poolCount >= LUAPOOL_MAX) {
+    if (outErr) *outErr = "luapool: too many pools";
+    return NULL;
+  }
+  if (!playdate->lua->registerClass(className, methods, NULL, 0, outErr)) return NULL;
+
+  LuaPool* pool = &pools[poolCount++];
+  memset(pool, 0, sizeof(LuaPool));
+  pool->className = className;
+  pool->objectSize = objectSize;
+  pool->nodeSize = NODE_HEADER + ((objectSize + 7) & ~(size_t)7);
+  if (prealloc > 0 && grow(pool, prealloc) < 0) {
+    if (outErr) *outErr = "luapool: out of memory";
+    poolCount--;
+    return NULL;
+  }
+  return pool;
+}
+
+void* luapool_push(LuaPool* pool) {
+  if (pool->free != NULL) pool->reused++;
+  else if (grow(pool, LUAPOOL_BLOCK) == 0) pool->created++;
+  else return NULL;
+
+  PoolNode* node = pool->free;
+  pool->free = node->next;
+  node->next = NULL;
+  node->retains = 0;
+
+  void* object = objectOf(node);
+  memset(object, 0, pool->objectSize);
+  node->ud = playdate->lua->pushObject(object, (char*)pool->className, 0);
+  pool->stats.live++;
+  return object;
+}
+
+void* luapool_arg(LuaPool* pool, int pos) {
+  return playdate->lua->getArgObject(pos, (char*)pool->className, NULL);
+}
+
+int luapool_gc(LuaPool* pool) {
+  void* object = luapool_arg(pool, 1);
+  if (object == NULL) return 0;
+
+  PoolNode* node = nodeOf(object);
+  node->ud = NULL;
+  node->retains = 0;
+  node->next = pool->free;
+  pool->free = node;
+  pool->stats.live--;
+  pool->collected++;
+  return 0;
+}
+
+void luapool_retain(void* object) {
+  PoolNode* node = nodeOf(object);
+  if (node->ud == NULL) return;
+  playdate->lua->retainObject(node->ud);
+  node->retains++;
+}
+
+void luapool_release(void* object) {
+  PoolNode* node = nodeOf(object);
+  if (node->ud == NULL || node->retains == 0) return;
+  node->retains--;
+  playdate->lua->releaseObject(node->ud);
+}
+
+void luapool_frame(void) {
+  for (int i = 0; i < poolCount; i++) {
+    LuaPool* pool = &pools[i];
+    pool->stats.created = pool->created;
+    pool->stats.reused = pool->reused;
+    pool->stats.collected = pool->collected;
+    pool->created = pool->reused = pool->collected = 0;
+  }
+}
+
+void luapool_stats(const LuaPool* pool, LuaPoolStats* out) {
+  *out = pool->stats;
+}
+
+void luapool_log(void) {
+  for (int i = 0; i < poolCount; i++) {
+    const LuaPool* pool = &pools[i];
+    playdate->system->logToConsole("luapool %s: %u live, %u allocated, last frame %u created, %u reused, %u collected",
+      pool->className, pool->stats.live, pool->stats.allocated, pool->stats.created, pool->stats.reused, pool->stats.collected);
+  }
+}
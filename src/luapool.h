@@ -0,0 +1,58 @@
+#ifndef LUAPOOL_H
+#define LUAPOOL_H
+
+#include <playdate/api.h>
+
+// Recycled native backing structs for Lua userdata. Each pool serves one
+// registered class: luapool_push hands out a zeroed struct from the pool's
+// free list (allocating a block of them only when it runs dry) and pushes it
+// as a userdata, and the class's __gc hands it back instead of freeing it.
+// Objects C updates every frame (player position, camera rect) can be
+// retained so scripts keep one userdata for them instead of getting a fresh
+// one per frame. Every pool counts objects created and reused per frame.
+//
+//   static LuaPool* vecPool;
+//   static int vec_gc(lua_State* L) { return luapool_gc(vecPool); }
+//   static const lua_reg vecClass[] = { { "__gc", vec_gc }, ... };
+//
+//   vecPool = luapool_new("vec", sizeof(Vec), vecClass, 64, &err);
+//   Vec* v = luapool_push(vecPool);
+
+#define LUAPOOL_MAX 16
+#define LUAPOOL_BLOCK 32 // objects allocated at once when the free list is empty
+
+typedef struct
+{
+  uint32_t live;      // objects currently owned by Lua
+  uint32_t allocated; // backing structs, live or free
+  uint32_t created;   // last frame: pushes that had to allocate
+  uint32_t reused;    // last frame: pushes served from the free list
+  uint32_t collected; // last frame: objects returned by __gc
+} LuaPoolStats;
+
+typedef struct LuaPool LuaPool;
+
+// registers the class and preallocates objects; NULL with outErr set on failure
+LuaPool* luapool_new(const char* className, size_t objectSize, const lua_reg* methods, int prealloc, const char** outErr);
+
+// pushes a zeroed object of the pool's class onto the Lua stack
+void* luapool_push(LuaPool* pool);
+
+// the pool's object at stack position pos, or NULL
+void* luapool_arg(LuaPool* pool, int pos);
+
+// call from the class's __gc; returns the object to the free list
+int luapool_gc(LuaPool* pool);
+
+// keep an object alive across frames even when scripts drop it, so C can
+// update it in place; release hands it back to the GC
+void luapool_retain(void* object);
+void luapool_release(void* object);
+
+// call once per frame to roll the per-frame counters
+void luapool_frame(void);
+
+void luapool_stats(const LuaPool* pool, LuaPoolStats* out);
+void luapool_log(void);
+
+#endif // LUAPOOL_H
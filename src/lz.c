@@ -0,0 +1,285 @@
+#include "lz.h"
+#include "timing.h"
+
+extern PlaydateAPI* playdate;
+
+#define LZ_MIN_MATCH 4
+#define LZ_COPY_SLOP 3 // word copies may write this far past a match
+#define LZ_SLICE 4096  // output step for time budgeted decoding
+
+void lz_init(LZDecoder* dec, void* dst, uint32_t rawSize, int safe) {
+  dec->state = rawSize ? kLZToken : kLZDone;
+  dec->safe = safe;
+  dec->dst = dst;
+  dec->pos = 0;
+  dec->rawSize = rawSize;
+  dec->in = NULL;
+  dec->inLen = dec->inPos = 0;
+  dec->length = dec->offset = 0;
+  dec->token = dec->offsetBytes = 0;
+  dec->file = NULL;
+  dec->fileOffset = dec->fileRemaining = 0;
+}
+
+void lz_initStored(LZDecoder* dec, void* dst, uint32_t rawSize) {
+  lz_init(dec, dst, rawSize, 1);
+  if (rawSize) dec->state = kLZStored;
+}
+
+void lz_feed(LZDecoder* dec, const void* src, uint32_t len) {
+  dec->in = src;
+  dec->inLen = len;
+  dec->inPos = 0;
+}
+
+void lz_attachFile(LZDecoder* dec, SDFile* file, uint32_t offset, uint32_t size) {
+  dec->file = file;
+  dec->fileOffset = offset;
+  dec->fileRemaining = size;
+  lz_feed(dec, dec->buffer, 0);
+}
+
+int lz_openFrame(LZDecoder* dec, SDFile* file, void* dst, uint32_t cap, int safe) {
+  uint8_t frame[LZ_FRAME_SIZE];
+  int at = playdate->file->tell(file);
+  if (at < 0 || playdate->file->read(file, frame, LZ_FRAME_SIZE) != LZ_FRAME_SIZE) return -1;
+  if (memcmp(frame, "PDLZ", 4) != 0) return -1;
+
+  uint32_t rawSize = frame[4] | (frame[5] << 8) | (frame[6] << 16) | ((uint32_t)frame[7] << 24);
+  uint32_t size = frame[8] | (frame[9] << 8) | (frame[10] << 16) | ((uint32_t)frame[11] << 24);
+  if (rawSize > cap) return -1;
+
+  lz_init(dec, dst, rawSize, safe);
+  lz_attachFile(dec, file, at + LZ_FRAME_SIZE, size);
+  return rawSize;
+}
+
+static int refill(LZDecoder* dec) {
+  if (dec->inPos < dec->inLen) return 1;
+  if (dec->fileRemaining == 0) return 0;
+
+  uint32_t n = dec->fileRemaining < LZ_CHUNK ? dec->fileRemaining : LZ_CHUNK;
+  if (playdate->file->seek(dec->file, dec->fileOffset, SEEK_SET) < 0) return -1;
+  if (playdate->file->read(dec->file, dec->buffer, n) != (int)n) return -1;
+
+  dec->fileOffset += n;
+  dec->fileRemaining -= n;
+  lz_feed(dec, dec->buffer, n);
+  return 1;
+}
+
+static inline void copyMatch(uint8_t* op, uint32_t offset, uint32_t len) {
+  const uint8_t* ip = op - offset;
+  uint8_t* end = op + len;
+  if (offset >= 4) {
+    do {
+      memcpy(op, ip, 4);
+      op += 4;
+      ip += 4;
+    } while (op < end);
+  }
+  else {
+    while (op < end) *op++ = *ip++;
+  }
+}
+
+// Whole sequences while input and output are comfortably in range. Stops at
+// the first sequence that might cross the end of either buffer or run past
+// maxOut and rewinds to its start, leaving the edges and long runs to the
+// resumable byte-wise path below.
+static uint32_t decodeFast(LZDecoder* dec, uint32_t maxOut) {
+  const uint8_t* ip = dec->in + dec->inPos;
+  const uint8_t* iend = dec->in + dec->inLen;
+  uint8_t* op = dec->dst + dec->pos;
+  uint8_t* const ostart = op;
+  uint8_t* const oend = dec->dst + dec->rawSize;
+  uint8_t* const olimit = maxOut < (uint32_t)(oend - op) ? op + maxOut : oend;
+
+  while (op < olimit) {
+    const uint8_t* seq = ip;
+    if (iend - ip < 2) break;
+
+    uint8_t token = *ip++;
+    uint32_t lit = token >> 4;
+    if (lit == 15) {
+      uint8_t b;
+      do {
+        if (ip >= iend) goto rewind;
+        b = *ip++;
+        lit += b;
+      } while (b == 255);
+    }
+    if ((uint32_t)(iend - ip) < lit + 2 || (uint32_t)(olimit - op) < lit) goto rewind;
+    memcpy(op, ip, lit);
+    op += lit;
+    ip += lit;
+
+    if (op == oend) {
+      dec->state = kLZDone;
+      break;
+    }
+
+    uint32_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    uint32_t len = token & 15;
+    if (len == 15) {
+      uint8_t b;
+      do {
+        if (ip >= iend) goto rewind_literals;
+        b = *ip++;
+        len += b;
+      } while (b == 255);
+    }
+    len += LZ_MIN_MATCH;
+
+    if ((uint32_t)(olimit - op) < len || (uint32_t)(oend - op) < len + LZ_COPY_SLOP) goto rewind_literals;
+    if (dec->safe && (offset == 0 || offset > (uint32_t)(op - dec->dst))) {
+      dec->state = kLZError;
+      break;
+    }
+    copyMatch(op, offset, len);
+    op += len;
+    continue;
+
+  rewind_literals:
+    op -= lit;
+  rewind:
+    ip = seq;
+    break;
+  }
+
+  dec->inPos = ip - dec->in;
+  dec->pos = op - dec->dst;
+  return op - ostart;
+}
+
+int lz_decode(LZDecoder* dec, uint32_t maxOut) {
+  uint32_t produced = 0;
+
+  while (produced < maxOut) {
+    if (dec->state == kLZDone) break;
+    if (dec->state == kLZError) return -1;
+
+    // matches need no input, so drain them before asking for more
+    if (dec->state == kLZMatch) {
+      uint32_t n = dec->length;
+      if (n > maxOut - produced) n = maxOut - produced;
+      if (n > dec->rawSize - dec->pos) {
+        dec->state = kLZError;
+        return -1;
+      }
+      uint8_t* op = dec->dst + dec->pos;
+      const uint8_t* ip = op - dec->offset;
+      if (dec->offset >= n) memcpy(op, ip, n);
+      else {
+        for (uint32_t i = 0; i < n; i++) op[i] = ip[i];
+      }
+      dec->pos += n;
+      produced += n;
+      dec->length -= n;
+      if (dec->length == 0) dec->state = dec->pos == dec->rawSize ? kLZDone : kLZToken;
+      continue;
+    }
+    if (dec->state == kLZLiterals && dec->length == 0) {
+      dec->state = dec->pos == dec->rawSize ? kLZDone : kLZOffset;
+      dec->offset = 0;
+      dec->offsetBytes = 0;
+      continue;
+    }
+
+    int more = refill(dec);
+    if (more < 0) {
+      dec->state = kLZError;
+      return -1;
+    }
+    if (more == 0) break;
+
+    if (dec->state == kLZToken) {
+      produced += decodeFast(dec, maxOut - produced);
+      if (dec->state != kLZToken || produced >= maxOut || dec->inPos == dec->inLen) continue;
+    }
+
+    uint32_t b;
+    uint32_t n;
+    switch (dec->state) {
+      case kLZToken:
+        dec->token = dec->in[dec->inPos++];
+        dec->length = dec->token >> 4;
+        dec->state = dec->length == 15 ? kLZLiteralLength : kLZLiterals;
+        break;
+
+      case kLZLiteralLength:
+        b = dec->in[dec->inPos++];
+        dec->length += b;
+        if (b != 255) dec->state = kLZLiterals;
+        break;
+
+      case kLZLiterals:
+      case kLZStored:
+        n = dec->state == kLZStored ? dec->rawSize - dec->pos : dec->length;
+        if (n > dec->inLen - dec->inPos) n = dec->inLen - dec->inPos;
+        if (n > maxOut - produced) n = maxOut - produced;
+        if (n > dec->rawSize - dec->pos) {
+          dec->state = kLZError;
+          return -1;
+        }
+        memcpy(dec->dst + dec->pos, dec->in + dec->inPos, n);
+        dec->pos += n;
+        dec->inPos += n;
+        produced += n;
+        if (dec->state == kLZStored) {
+          if (dec->pos == dec->rawSize) dec->state = kLZDone;
+          break;
+        }
+        dec->length -= n;
+        if (dec->length == 0) {
+          dec->state = dec->pos == dec->rawSize ? kLZDone : kLZOffset;
+          dec->offset = 0;
+          dec->offsetBytes = 0;
+        }
+        break;
+
+      case kLZOffset:
+        dec->offset |= dec->in[dec->inPos++] << (8 * dec->offsetBytes);
+        if (++dec->offsetBytes < 2) break;
+        if (dec->offset == 0 || dec->offset > dec->pos) {
+          dec->state = kLZError;
+          return -1;
+        }
+        dec->length = dec->token & 15;
+        if (dec->length == 15) dec->state = kLZMatchLength;
+        else {
+          dec->length += LZ_MIN_MATCH;
+          dec->state = kLZMatch;
+        }
+        break;
+
+      case kLZMatchLength:
+        b = dec->in[dec->inPos++];
+        dec->length += b;
+        if (b != 255) {
+          dec->length += LZ_MIN_MATCH;
+          dec->state = kLZMatch;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+  return produced;
+}
+
+int lz_decodeFor(LZDecoder* dec, uint32_t budgetUs) {
+  timing_init();
+  uint32_t start = timing_now();
+  int total = 0;
+  while (!lz_done(dec)) {
+    int n = lz_decode(dec, LZ_SLICE);
+    if (n < 0) return -1;
+    if (n == 0) break; // waiting for input
+    total += n;
+    if (timing_ticksToMicros(timing_now() - start) >= budgetUs) break;
+  }
+  return total;
+}
@@ -0,0 +1,83 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <playdate/api.h>
+
+// Resumable decoder for LZ4 block streams produced by pdlz.py. The output
+// buffer is the window, so decoding needs no heap; input comes either from
+// memory (lz_feed) or straight from an SDFile through a small fixed buffer
+// inside the decoder. Each lz_decode call stops after about maxOut bytes and
+// picks up mid-sequence on the next call, so a large asset can be spread over
+// several frames.
+//
+// Trusted assets built by pdlz.py can skip match offset validation; pass
+// safe=1 for anything else.
+//
+// Standalone files start with a 12 byte frame: "PDLZ", u32 rawSize, u32 size.
+
+#define LZ_CHUNK 2048
+#define LZ_FRAME_SIZE 12
+
+typedef enum
+{
+  kLZToken,
+  kLZLiteralLength,
+  kLZLiterals,
+  kLZOffset,
+  kLZMatchLength,
+  kLZMatch,
+  kLZStored, // uncompressed input, copied through
+  kLZDone,
+  kLZError
+} LZState;
+
+typedef struct
+{
+  LZState state;
+  int safe;
+
+  uint8_t* dst;
+  uint32_t pos;
+  uint32_t rawSize;
+
+  const uint8_t* in;
+  uint32_t inLen;
+  uint32_t inPos;
+
+  uint32_t length; // literal or match bytes left in the current sequence
+  uint32_t offset;
+  uint8_t token;
+  uint8_t offsetBytes;
+
+  SDFile* file; // optional streaming source
+  uint32_t fileOffset;
+  uint32_t fileRemaining;
+  uint8_t buffer[LZ_CHUNK];
+} LZDecoder;
+
+void lz_init(LZDecoder* dec, void* dst, uint32_t rawSize, int safe);
+void lz_initStored(LZDecoder* dec, void* dst, uint32_t rawSize);
+
+// supply the next slice of compressed input; only valid once the previous
+// slice is consumed (lz_needsInput)
+void lz_feed(LZDecoder* dec, const void* src, uint32_t len);
+
+// stream `size` bytes of input starting at `offset` in file. The decoder seeks
+// before every refill, so the file may be shared with other readers.
+void lz_attachFile(LZDecoder* dec, SDFile* file, uint32_t offset, uint32_t size);
+
+// reads a PDLZ frame header at the current position and attaches the rest
+// of the file; returns the decoded size or -1 when dst is too small
+int lz_openFrame(LZDecoder* dec, SDFile* file, void* dst, uint32_t cap, int safe);
+
+// decodes up to roughly maxOut bytes; returns bytes produced or -1 on corrupt input
+int lz_decode(LZDecoder* dec, uint32_t maxOut);
+
+// decodes in slices until budgetUs has elapsed or the stream ends
+int lz_decodeFor(LZDecoder* dec, uint32_t budgetUs);
+
+static inline int lz_done(const LZDecoder* dec) { return dec->state == kLZDone; }
+static inline int lz_failed(const LZDecoder* dec) { return dec->state == kLZError; }
+static inline int lz_needsInput(const LZDecoder* dec) { return dec->inPos == dec->inLen && dec->fileRemaining == 0; }
+
+#endif // LZ_H
@@ -1,5 +1,6 @@
 #define PLAYDATE_SETUP
 #include <playdate/api.h>
+#include "replay.h"
 
 extern PlaydateAPI* playdate;
 
@@ -12,5 +13,6 @@ int playdate_init(void) {
 
 // Runs every frame
 int playdate_update(void) {
+  replay_frame();
   return 0;
 }
@@ -0,0 +1,127 @@
+#include "pacing.h"
+#include "replay.h"
+
+extern PlaydateAPI* playdate;
+
+static int enabled;
+static int idle;
+static float activeRate = 30;
+static float idleRate = 5;
+static int idleAfter;
+static int quietFrames;
+static int holdFrames;
+
+static float lastAngle;
+static int lastDocked;
+static uint32_t lastMs;
+static PacingStats stats;
+
+// getCrankChange is not used: it reports the change to its first caller
+// in a frame, which has to be the game
+static int sawInput(void) {
+  const struct playdate_sys* sys = playdate->system;
+  PDButtons current, pushed, released;
+  sys->getButtonState(&current, &pushed, &released);
+  float angle = sys->getCrankAngle();
+  int docked = sys->isCrankDocked();
+
+  int input = current || pushed || released || angle != lastAngle || docked != lastDocked;
+  lastAngle = angle;
+  lastDocked = docked;
+  return input;
+}
+
+// charges the time since the previous frame to the rate it ran at
+static void account(void) {
+  uint32_t now = playdate->system->getCurrentTimeMilliseconds();
+  if (idle) stats.idleMs += now - lastMs;
+  else stats.activeMs += now - lastMs;
+  lastMs = now;
+}
+
+static void wake(void) {
+  idle = 0;
+  quietFrames = 0;
+  stats.wakes++;
+  playdate->display->setRefreshRate(activeRate);
+}
+
+void pacing_enable(float active, float idleFps, int after) {
+  activeRate = active;
+  idleRate = idleFps;
+  idleAfter = after > 0 ? after : 1;
+  enabled = 1;
+  idle = 0;
+  quietFrames = 0;
+  lastAngle = playdate->system->getCrankAngle();
+  lastDocked = playdate->system->isCrankDocked();
+  lastMs = playdate->system->getCurrentTimeMilliseconds();
+  playdate->display->setRefreshRate(activeRate);
+}
+
+void pacing_disable(void) {
+  if (!enabled) return;
+  account();
+  if (idle) wake();
+  enabled = 0;
+}
+
+void pacing_hold(int frames) {
+  if (frames > holdFrames) holdFrames = frames;
+  if (enabled && idle) {
+    account();
+    wake();
+  }
+}
+
+int pacing_isIdle(void) {
+  return idle;
+}
+
+int pacing_update(int (*update)(void)) {
+  if (!enabled) return update();
+
+  account();
+  if (replay_mode() != kReplayIdle) {
+    if (idle) wake();
+    stats.activeFrames++;
+    return update();
+  }
+
+  int input = sawInput();
+  if (idle) {
+    if (!input) {
+      stats.idleFrames++;
+      return 0;
+    }
+    wake();
+  }
+
+  stats.activeFrames++;
+  int drawn = update();
+  if (holdFrames > 0) holdFrames--;
+
+  if (input || drawn || holdFrames > 0) {
+    quietFrames = 0;
+  } else if (++quietFrames >= idleAfter) {
+    idle = 1;
+    playdate->display->setRefreshRate(idleRate);
+  }
+  return drawn;
+}
+
+void pacing_stats(PacingStats* out) {
+  *out = stats;
+}
+
+void pacing_resetStats(void) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void pacing_log(void) {
+  uint32_t total = stats.activeMs + stats.idleMs;
+  playdate->system->logToConsole("pacing: active %u.%03us (%u updates), idle %u.%03us (%u skipped, %u%%), %u wakes",
+    stats.activeMs / 1000, stats.activeMs % 1000, stats.activeFrames,
+    stats.idleMs / 1000, stats.idleMs % 1000, stats.idleFrames,
+    total ? (unsigned)((uint64_t)stats.idleMs * 100 / total) : 0, stats.wakes);
+}
@@ -0,0 +1,44 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <playdate/api.h>
+
+// Adaptive frame pacing. The setup shim in api.h runs every update through
+// pacing_update(); until pacing_enable() that is a plain call. Once enabled,
+// a frame is quiet when no button is held, pressed or released, the crank
+// has not moved or been docked, the update returned 0 (nothing to display)
+// and nothing holds the game awake. After idleAfter quiet frames the refresh
+// rate drops to the idle rate and updates are skipped; the first frame that
+// sees input restores the active rate and runs the update in that frame.
+//
+// Input is polled, so while idle a press waits up to one idle frame to be
+// noticed. Animations and timers that must keep running without input call
+// pacing_hold() for the frames they need. While replay.h is recording or
+// playing, every update runs at the active rate: replay_frame() lives in
+// the update and is what feeds the input that would wake the game.
+
+typedef struct
+{
+  uint32_t activeMs, idleMs; // time spent at each rate
+  uint32_t activeFrames;     // updates run
+  uint32_t idleFrames;       // updates skipped
+  uint32_t wakes;            // idle to active transitions
+} PacingStats;
+
+// rates in frames per second, idleAfter in quiet frames
+void pacing_enable(float activeRate, float idleRate, int idleAfter);
+void pacing_disable(void); // back to the active rate for good
+
+// stay at the active rate for at least this many more frames; wakes the
+// game if it is idle
+void pacing_hold(int frames);
+int pacing_isIdle(void);
+
+void pacing_stats(PacingStats* out);
+void pacing_resetStats(void);
+void pacing_log(void);
+
+// called by the setup shim with the game's update
+int pacing_update(int (*update)(void));
+
+#endif // PACING_H
@@ -0,0 +1,284 @@
+#include "replay.h"
+#include "bufio.h"
+
+extern PlaydateAPI* playdate;
+
+enum
+{
+  kHasButtons = 1 << 0, // u8 current, u8 pushed, u8 released
+  kHasCrank = 1 << 1,   // float change, float angle
+  kHasDocked = 1 << 2,  // u8 docked
+  kHasAccel = 1 << 3,   // float x, y, z
+  kHasEvents = 1 << 4   // u8 count, count x (u8 button, u8 down, u32 when)
+};
+
+typedef struct
+{
+  uint8_t button;
+  uint8_t down;
+  uint32_t when;
+} ButtonEvent;
+
+typedef struct
+{
+  PDButtons current, pushed, released;
+  float crankChange, crankAngle;
+  int docked;
+  float accel[3];
+  ButtonEvent events[REPLAY_MAX_EVENTS];
+  int eventCount;
+} FrameInput;
+
+static ReplayMode mode;
+static BufFile* file;
+static uint32_t frameIndex;
+
+static PlaydateAPI* realApi;
+static PlaydateAPI shadowApi;
+static struct playdate_sys shadowSys;
+
+static FrameInput input; // what the game sees this frame
+static FrameInput last;  // previous frame, for change detection
+static ButtonEvent pending[REPLAY_MAX_EVENTS]; // recorded since the last frame
+static int pendingCount;
+static int crankRead;
+static uint8_t nextFlags; // replay reads one record ahead to see the end coming
+static int hasNext;
+
+static PDButtonCallbackFunction* gameCallback;
+static void* gameUserdata;
+static int gameQueueSize;
+
+// -- Shadow API ---------------------------------------------------------------
+
+static void getButtonState(PDButtons* current, PDButtons* pushed, PDButtons* released) {
+  if (current) *current = input.current;
+  if (pushed) *pushed = input.pushed;
+  if (released) *released = input.released;
+}
+
+// like the device, the change is reported to the first call in a frame
+static float getCrankChange(void) {
+  if (crankRead) return 0;
+  crankRead = 1;
+  return input.crankChange;
+}
+
+static float getCrankAngle(void) {
+  return input.crankAngle;
+}
+
+static int isCrankDocked(void) {
+  return input.docked;
+}
+
+static void getAccelerometer(float* x, float* y, float* z) {
+  if (x) *x = input.accel[0];
+  if (y) *y = input.accel[1];
+  if (z) *z = input.accel[2];
+}
+
+static int recordCallback(PDButtons button, int down, uint32_t when, void* userdata) {
+  if (pendingCount < REPLAY_MAX_EVENTS) pending[pendingCount++] = (ButtonEvent){ button, down != 0, when };
+  return gameCallback ? gameCallback(button, down, when, gameUserdata) : 0;
+}
+
+static void setButtonCallback(PDButtonCallbackFunction* cb, void* userdata, int queuesize) {
+  gameCallback = cb;
+  gameUserdata = userdata;
+  gameQueueSize = queuesize;
+  // replayed events come from the file, recorded ones pass through recordCallback
+  if (mode == kReplayRecording) realApi->system->setButtonCallback(cb ? recordCallback : NULL, NULL, queuesize);
+}
+
+static void install(ReplayMode newMode) {
+  realApi = playdate;
+  shadowSys = *realApi->system;
+  shadowSys.getButtonState = getButtonState;
+  shadowSys.getCrankChange = getCrankChange;
+  shadowSys.getCrankAngle = getCrankAngle;
+  shadowSys.isCrankDocked = isCrankDocked;
+  shadowSys.getAccelerometer = getAccelerometer;
+  shadowSys.setButtonCallback = setButtonCallback;
+  shadowApi = *realApi;
+  shadowApi.system = &shadowSys;
+
+  mode = newMode;
+  frameIndex = 0;
+  pendingCount = 0;
+  memset(&input, 0, sizeof(input));
+  memset(&last, 0, sizeof(last));
+  playdate = &shadowApi;
+}
+
+// -- Recording ----------------------------------------------------------------
+
+static int writeFrame(const FrameInput* in, const FrameInput* prev) {
+  uint8_t flags = 0;
+  if (in->pushed || in->released || in->current != prev->current) flags |= kHasButtons;
+  if (in->crankChange != 0 || in->crankAngle != prev->crankAngle) flags |= kHasCrank;
+  if (in->docked != prev->docked) flags |= kHasDocked;
+  if (memcmp(in->accel, prev->accel, sizeof(in->accel)) != 0) flags |= kHasAccel;
+  if (in->eventCount) flags |= kHasEvents;
+
+  int err = bufio_writeU8(file, flags);
+  if (flags & kHasButtons) {
+    err |= bufio_writeU8(file, in->current);
+    err |= bufio_writeU8(file, in->pushed);
+    err |= bufio_writeU8(file, in->released);
+  }
+  if (flags & kHasCrank) {
+    err |= bufio_writeFloat(file, in->crankChange);
+    err |= bufio_writeFloat(file, in->crankAngle);
+  }
+  if (flags & kHasDocked) err |= bufio_writeU8(file, in->docked);
+  if (flags & kHasAccel) {
+    for (int i = 0; i < 3; i++) err |= bufio_writeFloat(file, in->accel[i]);
+  }
+  if (flags & kHasEvents) {
+    err |= bufio_writeU8(file, in->eventCount);
+    for (int i = 0; i < in->eventCount; i++) {
+      err |= bufio_writeU8(file, in->events[i].button);
+      err |= bufio_writeU8(file, in->events[i].down);
+      err |= bufio_writeU32(file, in->events[i].when);
+    }
+  }
+  return err ? -1 : 0;
+}
+
+static void recordFrame(void) {
+  const struct playdate_sys* sys = realApi->system;
+  last = input;
+  sys->getButtonState(&input.current, &input.pushed, &input.released);
+  input.crankChange = sys->getCrankChange();
+  input.crankAngle = sys->getCrankAngle();
+  input.docked = sys->isCrankDocked();
+  sys->getAccelerometer(&input.accel[0], &input.accel[1], &input.accel[2]);
+  memcpy(input.events, pending, pendingCount * sizeof(ButtonEvent));
+  input.eventCount = pendingCount;
+  pendingCount = 0;
+
+  if (writeFrame(&input, &last) < 0) {
+    realApi->system->logToConsole("replay: write failed after %u frames, recording stopped", frameIndex);
+    replay_stop();
+  }
+}
+
+int replay_record(const char* path) {
+  if (mode != kReplayIdle) replay_stop();
+  file = bufio_open(path, kFileWrite, 0);
+  if (file == NULL) return -1;
+  if (bufio_write(file, "PDRP", 4) != 4 || bufio_writeU32(file, REPLAY_VERSION) < 0) {
+    bufio_close(file);
+    file = NULL;
+    return -1;
+  }
+  install(kReplayRecording);
+  return 0;
+}
+
+// -- Replay -------------------------------------------------------------------
+
+static int readFrame(FrameInput* in, uint8_t flags) {
+  uint8_t u8;
+
+  // held state carries over, per-frame state does not
+  in->pushed = in->released = 0;
+  in->crankChange = 0;
+  in->eventCount = 0;
+
+  int err = 0;
+  if (flags & kHasButtons) {
+    err |= bufio_readU8(file, &u8);
+    in->current = u8;
+    err |= bufio_readU8(file, &u8);
+    in->pushed = u8;
+    err |= bufio_readU8(file, &u8);
+    in->released = u8;
+  }
+  if (flags & kHasCrank) {
+    err |= bufio_readFloat(file, &in->crankChange);
+    err |= bufio_readFloat(file, &in->crankAngle);
+  }
+  if (flags & kHasDocked) {
+    err |= bufio_readU8(file, &u8);
+    in->docked = u8;
+  }
+  if (flags & kHasAccel) {
+    for (int i = 0; i < 3; i++) err |= bufio_readFloat(file, &in->accel[i]);
+  }
+  if (flags & kHasEvents) {
+    err |= bufio_readU8(file, &u8);
+    if (u8 > REPLAY_MAX_EVENTS) return -1;
+    in->eventCount = u8;
+    for (int i = 0; i < in->eventCount; i++) {
+      err |= bufio_readU8(file, &in->events[i].button);
+      err |= bufio_readU8(file, &in->events[i].down);
+      err |= bufio_readU32(file, &in->events[i].when);
+    }
+  }
+  return err ? -1 : 0;
+}
+
+static void playFrame(void) {
+  if (!hasNext || readFrame(&input, nextFlags) < 0) {
+    realApi->system->logToConsole("replay: finished after %u frames", frameIndex);
+    replay_stop();
+    return;
+  }
+  hasNext = bufio_readU8(file, &nextFlags) == 0;
+  for (int i = 0; i < input.eventCount && gameCallback; i++) {
+    const ButtonEvent* e = &input.events[i];
+    gameCallback(e->button, e->down, e->when, gameUserdata);
+  }
+}
+
+int replay_play(const char* path) {
+  if (mode != kReplayIdle) replay_stop();
+  file = bufio_open(path, kFileReadData | kFileRead, 0);
+  if (file == NULL) return -1;
+
+  char magic[4];
+  uint32_t version;
+  if (bufio_read(file, magic, 4) != 4 || memcmp(magic, "PDRP", 4) != 0 ||
+      bufio_readU32(file, &version) < 0 || version != REPLAY_VERSION) {
+    bufio_close(file);
+    file = NULL;
+    return -1;
+  }
+  install(kReplayPlaying);
+  hasNext = bufio_readU8(file, &nextFlags) == 0;
+  return 0;
+}
+
+// -- Control ------------------------------------------------------------------
+
+void replay_frame(void) {
+  if (mode == kReplayIdle) return;
+  crankRead = 0;
+  if (mode == kReplayRecording) recordFrame();
+  else playFrame();
+  if (mode != kReplayIdle) frameIndex++;
+}
+
+void replay_stop(void) {
+  if (mode == kReplayIdle) return;
+  if (file) bufio_close(file);
+  file = NULL;
+  mode = kReplayIdle;
+  playdate = realApi;
+  // the game's callback goes back to receiving real input directly
+  if (gameCallback) playdate->system->setButtonCallback(gameCallback, gameUserdata, gameQueueSize);
+}
+
+int replay_finished(void) {
+  return mode == kReplayPlaying ? !hasNext : mode == kReplayIdle;
+}
+
+ReplayMode replay_mode(void) {
+  return mode;
+}
+
+uint32_t replay_frameIndex(void) {
+  return frameIndex;
+}
@@ -0,0 +1,51 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <playdate/api.h>
+
+// Input recording and replay. While active, the global playdate pointer is
+// swapped for a copy of the API whose input functions (getButtonState,
+// getCrankChange, getCrankAngle, isCrankDocked, getAccelerometer and
+// setButtonCallback) go through this module, so the rest of the game needs
+// no changes beyond calling replay_frame() first thing in its update.
+//
+// Recording samples the real input once per frame and writes what changed;
+// replay feeds the recorded values back through the same functions, calling
+// the game's button callback with the original `when` timestamps before the
+// frame's update. Start recording or replay before the game installs its
+// button callback (or have it install the callback again afterwards) so the
+// callback is routed through here.
+//
+// Anything else the game reads (clock, random seeds) is not captured, so a
+// replay is only as deterministic as the game is given its inputs; on the
+// host, --fixed takes care of the clock.
+//
+// File: "PDRP", u32 version, then one record per frame: u8 flags followed
+// by the fields the flags name, little-endian.
+
+#define REPLAY_VERSION 1
+#define REPLAY_MAX_EVENTS 16 // button callback events kept per frame
+
+typedef enum
+{
+  kReplayIdle,
+  kReplayRecording,
+  kReplayPlaying
+} ReplayMode;
+
+// both return 0, or -1 if the file cannot be opened or is not a replay
+int replay_record(const char* path);
+int replay_play(const char* path);
+
+// call at the top of the update callback, before reading any input;
+// replay ends by itself when the file runs out
+void replay_frame(void);
+
+// finishes the recording or abandons the replay, restoring the real API
+void replay_stop(void);
+
+ReplayMode replay_mode(void);
+int replay_finished(void); // 1 once every recorded frame has been replayed
+uint32_t replay_frameIndex(void); // frames recorded or replayed so far
+
+#endif // REPLAY_H
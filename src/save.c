@@ -0,0 +1,320 @@
+#include "save.h"
+#include "timing.h"
+
+extern PlaydateAPI* playdate;
+
+#define SAVE_CHUNK 4096
+#define SAVE_HEADER_SIZE 12
+#define SAVE_RECORD_SIZE 16
+
+// -- CRC-32 (IEEE), nibble table ----------------------------------------------
+
+static const uint32_t crcTable[16] = {
+  0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+  0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+uint32_t save_crc32(uint32_t crc, const void* data, uint32_t len) {
+  const uint8_t* p = data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ crcTable[crc & 15];
+    crc = (crc >> 4) ^ crcTable[crc & 15];
+  }
+  return ~crc;
+}
+
+// -- Paths and encoding -------------------------------------------------------
+
+static void sectionPath(SaveStore* store, const char id[4], int slot, char* out) {
+  size_t n = strlen(store->dir);
+  memcpy(out, store->dir, n);
+  out[n++] = '/';
+  memcpy(out + n, id, 4);
+  n += 4;
+  out[n++] = '.';
+  out[n++] = slot ? 'b' : 'a';
+  out[n] = '\0';
+}
+
+static void filePath(SaveStore* store, const char* name, char* out) {
+  size_t n = strlen(store->dir);
+  memcpy(out, store->dir, n);
+  out[n++] = '/';
+  strcpy(out + n, name);
+}
+
+static inline uint32_t le32(const uint8_t* b) {
+  return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static inline void put32(uint8_t* b, uint32_t v) {
+  b[0] = v & 0xff;
+  b[1] = (v >> 8) & 0xff;
+  b[2] = (v >> 16) & 0xff;
+  b[3] = v >> 24;
+}
+
+static SaveSection* findSection(SaveStore* store, const char id[4]) {
+  for (int i = 0; i < store->count; i++) {
+    if (memcmp(store->sections[i].id, id, 4) == 0) return &store->sections[i];
+  }
+  return NULL;
+}
+
+// -- Setup and loading --------------------------------------------------------
+
+void save_init(SaveStore* store, const char* dir) {
+  memset(store, 0, sizeof(SaveStore));
+  strncpy(store->dir, dir, SAVE_MAX_PATH - 16);
+  playdate->file->mkdir(store->dir);
+}
+
+int save_addSection(SaveStore* store, const char id[4], uint16_t version, void* data, uint32_t size, SaveMigrateFunction* migrate) {
+  if (store->count >= SAVE_MAX_SECTIONS || findSection(store, id)) return -1;
+  SaveSection* s = &store->sections[store->count++];
+  memset(s, 0, sizeof(SaveSection));
+  memcpy(s->id, id, 4);
+  s->version = version;
+  s->data = data;
+  s->size = size;
+  s->migrate = migrate;
+  return 0;
+}
+
+static int readFile(const char* path, void* dst, uint32_t size) {
+  SDFile* file = playdate->file->open(path, kFileReadData);
+  if (file == NULL) return -1;
+  int n = playdate->file->read(file, dst, size);
+  playdate->file->close(file);
+  return n == (int)size ? 0 : -1;
+}
+
+static int loadSection(SaveStore* store, SaveSection* s, const SaveRecord* r) {
+  char path[SAVE_MAX_PATH];
+  sectionPath(store, r->id, r->slot, path);
+
+  if (r->version == s->version && r->size == s->size) {
+    if (readFile(path, s->data, s->size) < 0 || save_crc32(0, s->data, s->size) != r->crc) return -1;
+    return 0;
+  }
+  if (s->migrate == NULL) return -1;
+
+  void* old = playdate->system->realloc(NULL, r->size ? r->size : 1);
+  if (old == NULL) return -1;
+  int result = -1;
+  if (readFile(path, old, r->size) == 0 && save_crc32(0, old, r->size) == r->crc) {
+    result = s->migrate(s->data, s->size, old, r->size, r->version);
+  }
+  playdate->system->realloc(old, 0);
+  return result;
+}
+
+int save_load(SaveStore* store) {
+  char path[SAVE_MAX_PATH];
+  uint8_t buffer[SAVE_HEADER_SIZE + SAVE_RECORD_SIZE * SAVE_MAX_SECTIONS];
+
+  // manifest.tmp only survives on its own if we crashed between unlinking
+  // the old manifest and renaming the new one into place
+  filePath(store, "manifest", path);
+  SDFile* file = playdate->file->open(path, kFileReadData);
+  if (file == NULL) {
+    filePath(store, "manifest.tmp", path);
+    file = playdate->file->open(path, kFileReadData);
+  }
+  if (file == NULL) return 0;
+
+  int n = playdate->file->read(file, buffer, sizeof(buffer));
+  playdate->file->close(file);
+  if (n < SAVE_HEADER_SIZE || memcmp(buffer, "PDSV", 4) != 0) return -1;
+
+  store->generation = le32(buffer + 4);
+  uint32_t count = le32(buffer + 8);
+  if (count > SAVE_MAX_SECTIONS || n < (int)(SAVE_HEADER_SIZE + count * SAVE_RECORD_SIZE)) return -1;
+
+  int restored = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t* b = buffer + SAVE_HEADER_SIZE + i * SAVE_RECORD_SIZE;
+    SaveRecord r;
+    memcpy(r.id, b, 4);
+    r.version = b[4] | (b[5] << 8);
+    r.slot = b[6];
+    r.pad = 0;
+    r.size = le32(b + 8);
+    r.crc = le32(b + 12);
+
+    SaveSection* s = findSection(store, r.id);
+    if (s == NULL) continue;
+    if (loadSection(store, s, &r) < 0) {
+      playdate->system->logToConsole("save: section %.4s is damaged, using defaults", r.id);
+      continue;
+    }
+    s->saved = r;
+    s->present = 1;
+    restored++;
+  }
+  return restored;
+}
+
+// -- Saving -------------------------------------------------------------------
+
+int save_begin(SaveStore* store) {
+  if (store->state != kSaveIdle) return -1;
+
+  int changed = 0;
+  for (int i = 0; i < store->count; i++) {
+    SaveSection* s = &store->sections[i];
+    uint32_t crc = save_crc32(0, s->data, s->size);
+    s->pending = !s->present || crc != s->saved.crc || s->size != s->saved.size || s->version != s->saved.version;
+    s->crc = crc;
+    if (s->pending) changed++;
+  }
+
+  store->state = kSaveWriting;
+  store->current = 0;
+  store->written = 0;
+  store->file = NULL;
+  store->lastBytes = 0;
+  store->lastSections = changed;
+  return changed;
+}
+
+static int commit(SaveStore* store) {
+  uint8_t buffer[SAVE_HEADER_SIZE + SAVE_RECORD_SIZE * SAVE_MAX_SECTIONS];
+  uint32_t count = 0;
+
+  for (int i = 0; i < store->count; i++) {
+    SaveSection* s = &store->sections[i];
+    if (!s->present && !s->pending) continue;
+
+    SaveRecord r = s->saved;
+    if (s->pending) {
+      memcpy(r.id, s->id, 4);
+      r.version = s->version;
+      r.slot = s->present ? !s->saved.slot : 0;
+      r.size = s->size;
+      r.crc = s->crc;
+    }
+
+    uint8_t* b = buffer + SAVE_HEADER_SIZE + count * SAVE_RECORD_SIZE;
+    memcpy(b, r.id, 4);
+    b[4] = r.version & 0xff;
+    b[5] = r.version >> 8;
+    b[6] = r.slot;
+    b[7] = 0;
+    put32(b + 8, r.size);
+    put32(b + 12, r.crc);
+    count++;
+  }
+
+  memcpy(buffer, "PDSV", 4);
+  put32(buffer + 4, store->generation + 1);
+  put32(buffer + 8, count);
+
+  char tmp[SAVE_MAX_PATH], path[SAVE_MAX_PATH];
+  filePath(store, "manifest.tmp", tmp);
+  filePath(store, "manifest", path);
+
+  SDFile* file = playdate->file->open(tmp, kFileWrite);
+  if (file == NULL) return -1;
+  uint32_t size = SAVE_HEADER_SIZE + count * SAVE_RECORD_SIZE;
+  int ok = playdate->file->write(file, buffer, size) == (int)size && playdate->file->flush(file) >= 0;
+  playdate->file->close(file);
+  if (!ok) return -1;
+
+  if (playdate->file->rename(tmp, path) < 0) {
+    playdate->file->unlink(path, 0);
+    if (playdate->file->rename(tmp, path) < 0) return -1;
+  }
+
+  // the new manifest is live: adopt its records
+  for (int i = 0; i < store->count; i++) {
+    SaveSection* s = &store->sections[i];
+    if (!s->pending) continue;
+    s->saved.slot = s->present ? !s->saved.slot : 0;
+    memcpy(s->saved.id, s->id, 4);
+    s->saved.version = s->version;
+    s->saved.size = s->size;
+    s->saved.crc = s->crc;
+    s->present = 1;
+    s->pending = 0;
+  }
+  store->generation++;
+  store->lastBytes += size;
+  return 0;
+}
+
+static void abortSave(SaveStore* store) {
+  if (store->file) playdate->file->close(store->file);
+  store->file = NULL;
+  store->state = kSaveIdle;
+  for (int i = 0; i < store->count; i++) store->sections[i].pending = 0;
+}
+
+int save_step(SaveStore* store, uint32_t budgetUs) {
+  timing_init();
+  uint32_t start = timing_now();
+
+  while (store->state == kSaveWriting) {
+    if (store->current >= store->count) {
+      store->state = kSaveCommit;
+      break;
+    }
+    SaveSection* s = &store->sections[store->current];
+    if (!s->pending) {
+      store->current++;
+      continue;
+    }
+
+    if (store->file == NULL) {
+      char path[SAVE_MAX_PATH];
+      sectionPath(store, s->id, s->present ? !s->saved.slot : 0, path);
+      store->file = playdate->file->open(path, kFileWrite);
+      store->written = 0;
+      if (store->file == NULL) {
+        abortSave(store);
+        return -1;
+      }
+    }
+
+    uint32_t n = s->size - store->written;
+    if (n > SAVE_CHUNK) n = SAVE_CHUNK;
+    if (n && playdate->file->write(store->file, (uint8_t*)s->data + store->written, n) != (int)n) {
+      abortSave(store);
+      return -1;
+    }
+    store->written += n;
+    store->lastBytes += n;
+
+    if (store->written == s->size) {
+      int ok = playdate->file->flush(store->file) >= 0;
+      playdate->file->close(store->file);
+      store->file = NULL;
+      if (!ok) {
+        abortSave(store);
+        return -1;
+      }
+      store->current++;
+    }
+
+    if (timing_ticksToMicros(timing_now() - start) >= budgetUs) return 1;
+  }
+
+  if (store->state == kSaveCommit) {
+    int result = store->lastSections ? commit(store) : 0;
+    if (result < 0) {
+      abortSave(store);
+      return -1;
+    }
+    store->state = kSaveIdle;
+  }
+  return 0;
+}
+
+int save_write(SaveStore* store) {
+  int changed = save_begin(store);
+  if (changed < 0) return -1;
+  if (save_step(store, UINT32_MAX) < 0) return -1;
+  return changed;
+}
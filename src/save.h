@@ -0,0 +1,93 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <playdate/api.h>
+
+// Binary save game store. The game registers its state as sections: a four
+// character id, a schema version and a block of memory. Each section has two
+// files on disk (A/B) and a small manifest records which one is current,
+// with its version, size and CRC-32:
+//
+//   <dir>/manifest     "PDSV", u32 generation, u32 count, count x SaveRecord
+//   <dir>/<id>.a/.b    raw section bytes
+//
+// Saving writes only sections whose CRC changed into their inactive file,
+// then writes manifest.tmp and renames it over manifest. A crash at any point
+// leaves the previous manifest pointing at intact files.
+//
+// On load, sections saved with an older version are passed to the section's
+// migrate callback; sections the game no longer knows are ignored and new
+// ones keep whatever the game initialised them with.
+
+#define SAVE_MAX_SECTIONS 16
+#define SAVE_MAX_PATH 64
+
+typedef int SaveMigrateFunction(void* dst, uint32_t dstSize, const void* old, uint32_t oldSize, uint16_t oldVersion);
+
+typedef struct
+{
+  char id[4];
+  uint16_t version;
+  uint8_t slot; // 0 = .a, 1 = .b
+  uint8_t pad;
+  uint32_t size;
+  uint32_t crc;
+} SaveRecord;
+
+typedef struct
+{
+  char id[4];
+  uint16_t version;
+  void* data;
+  uint32_t size;
+  SaveMigrateFunction* migrate;
+
+  SaveRecord saved; // what the current manifest says about this section
+  int present;
+  int pending; // changed, waiting to be written by the running save
+  uint32_t crc; // CRC of data when the running save began
+} SaveSection;
+
+typedef enum
+{
+  kSaveIdle,
+  kSaveWriting,
+  kSaveCommit
+} SaveState;
+
+typedef struct
+{
+  char dir[SAVE_MAX_PATH];
+  SaveSection sections[SAVE_MAX_SECTIONS];
+  int count;
+  uint32_t generation;
+
+  // incremental save in progress
+  SaveState state;
+  int current;
+  uint32_t written;
+  SDFile* file;
+
+  uint32_t lastBytes; // bytes written by the last completed save
+  uint32_t lastSections;
+} SaveStore;
+
+void save_init(SaveStore* store, const char* dir);
+int save_addSection(SaveStore* store, const char id[4], uint16_t version, void* data, uint32_t size, SaveMigrateFunction* migrate);
+
+// loads every known section from disk; returns the number of sections
+// restored, 0 when there is no save yet and -1 on error
+int save_load(SaveStore* store);
+
+// blocking save of all changed sections; returns sections written or -1
+int save_write(SaveStore* store);
+
+// incremental save: save_begin() snapshots which sections changed, then each
+// save_step() writes for about budgetUs. Returns 1 while work remains, 0 once
+// committed and -1 on error. Section data must not change until committed.
+int save_begin(SaveStore* store);
+int save_step(SaveStore* store, uint32_t budgetUs);
+
+uint32_t save_crc32(uint32_t crc, const void* data, uint32_t len);
+
+#endif // SAVE_H
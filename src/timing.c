@@ -0,0 +1,35 @@
+#include "timing.h"
+
+#if TARGET_PLAYDATE
+
+#include <playdate/api.h>
+
+extern PlaydateAPI* playdate;
+
+#define CALIBRATE_MS 2
+
+uint32_t timing_ticksPerUs = 168;
+static int calibrated;
+
+static unsigned int nextMillisecond(void) {
+  unsigned int now = playdate->system->getCurrentTimeMilliseconds();
+  unsigned int ms;
+  while ((ms = playdate->system->getCurrentTimeMilliseconds()) == now) {}
+  return ms;
+}
+
+// cycles between two millisecond edges, rounded to whole MHz
+void timing_calibrate(void) {
+  if (calibrated) return;
+  calibrated = 1;
+  unsigned int first = nextMillisecond();
+  uint32_t start = timing_now();
+  unsigned int last = first;
+  while (last - first < CALIBRATE_MS) last = nextMillisecond();
+  uint32_t cycles = timing_now() - start;
+  uint32_t mhz = (cycles + (last - first) * 500) / ((last - first) * 1000);
+  // a clock that stalls or jumps keeps the Rev A rate
+  if (mhz >= 48 && mhz <= 480) timing_ticksPerUs = mhz;
+}
+
+#endif // TARGET_PLAYDATE
@@ -0,0 +1,62 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+// Cheap free-running tick counter, safe to read from the audio thread.
+// On device this is the Cortex-M7 DWT cycle counter, elsewhere it is a
+// monotonic nanosecond clock. Only differences between two reads are
+// meaningful; the counter wraps every few seconds. timing_init() is
+// idempotent, call it before the first timing_now().
+//
+// The core clock differs between device revisions (168 MHz on Rev A, 180 MHz
+// on Rev B), so the first timing_init() measures it against the system
+// millisecond clock, spinning for about 2 ms. Call it at startup rather than
+// from the audio callback.
+
+#if TARGET_PLAYDATE
+
+extern uint32_t timing_ticksPerUs; // 168 until measured
+void timing_calibrate(void);
+
+#define TIMING_TICKS_PER_US timing_ticksPerUs
+
+#define TIMING_DEMCR      (*(volatile uint32_t*)0xE000EDFC)
+#define TIMING_DWT_CTRL   (*(volatile uint32_t*)0xE0001000)
+#define TIMING_DWT_CYCCNT (*(volatile uint32_t*)0xE0001004)
+#define TIMING_DWT_LAR    (*(volatile uint32_t*)0xE0001FB0)
+
+static inline void timing_init(void) {
+  if (!(TIMING_DWT_CTRL & 1)) {
+    TIMING_DEMCR |= (1 << 24); // TRCENA
+    TIMING_DWT_LAR = 0xC5ACCE55;
+    TIMING_DWT_CTRL |= 1; // CYCCNTENA
+  }
+  timing_calibrate();
+}
+
+static inline uint32_t timing_now(void) {
+  return TIMING_DWT_CYCCNT;
+}
+
+#else
+
+#include <time.h>
+
+#define TIMING_TICKS_PER_US 1000
+
+static inline void timing_init(void) {}
+
+static inline uint32_t timing_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+#endif // TARGET_PLAYDATE
+
+static inline uint32_t timing_ticksToMicros(uint32_t ticks) {
+  return ticks / TIMING_TICKS_PER_US;
+}
+
+#endif // TIMING_H
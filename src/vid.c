@@ -0,0 +1,225 @@
+#include "vid.h"
+
+extern PlaydateAPI* playdate;
+
+enum
+{
+  kVidKey = 1 << 0,
+  kVidBottomUp = 1 << 1
+};
+
+// row ops that only start a row, see pdvid.py
+enum
+{
+  kVidStored = 0x40,
+  kVidCopy = 0x41,
+  kVidShift = 0x42
+};
+
+static uint32_t readU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// makes at least `need` bytes available from pos, unless the file ends;
+// returns the bytes available or -1 on a read error
+static int refill(VidPlayer* v, int need) {
+  int avail = v->fill - v->pos;
+  if (avail >= need || v->eof) return avail;
+  memmove(v->buffer, v->buffer + v->pos, avail);
+  v->pos = 0;
+  v->fill = avail;
+  while (v->fill < need && !v->eof) {
+    int n = playdate->file->read(v->file, v->buffer + v->fill, VID_CHUNK - v->fill);
+    if (n < 0) return -1;
+    v->stats.reads++;
+    v->stats.bytesRead += n;
+    v->fill += n;
+    v->eof = n == 0;
+  }
+  return v->fill;
+}
+
+VidPlayer* vid_open(const char* path) {
+  SDFile* file = playdate->file->open(path, kFileRead | kFileReadData);
+  if (file == NULL) return NULL;
+
+  uint8_t h[VID_HEADER_SIZE];
+  if (playdate->file->read(file, h, VID_HEADER_SIZE) != VID_HEADER_SIZE || memcmp(h, "PDVD", 4) != 0 ||
+      (h[4] | (h[5] << 8)) != VID_VERSION) {
+    playdate->file->close(file);
+    return NULL;
+  }
+  int width = h[6] | (h[7] << 8);
+  int height = h[8] | (h[9] << 8);
+  if (width == 0 || width > LCD_COLUMNS || height == 0 || height > LCD_ROWS) {
+    playdate->file->close(file);
+    return NULL;
+  }
+
+  VidPlayer* v = playdate->system->realloc(NULL, sizeof(VidPlayer));
+  if (v == NULL) {
+    playdate->file->close(file);
+    return NULL;
+  }
+  memset(v, 0, sizeof(VidPlayer));
+  v->file = file;
+  v->width = width;
+  v->height = height;
+  v->rowBytes = (width + 7) >> 3;
+  v->frameCount = readU32(h + 10);
+  uint32_t rate = readU32(h + 14);
+  memcpy(&v->frameRate, &rate, sizeof(float));
+  vid_setTarget(v, NULL, 0);
+  vid_setPosition(v, (LCD_COLUMNS - width) / 2, (LCD_ROWS - height) / 2);
+  return v;
+}
+
+void vid_close(VidPlayer* v) {
+  if (v == NULL) return;
+  playdate->file->close(v->file);
+  playdate->system->realloc(v, 0);
+}
+
+int vid_setPosition(VidPlayer* v, int x, int y) {
+  x >>= 3;
+  if (v->target) return -1; // a target buffer is the video's own size
+  if (x < 0 || y < 0 || (x + v->rowBytes) * 8 > LCD_COLUMNS || y + v->height > LCD_ROWS) return -1;
+  v->x = x;
+  v->y = y;
+  return 0;
+}
+
+void vid_setTarget(VidPlayer* v, uint8_t* data, int rowBytes) {
+  v->target = data;
+  v->stride = data ? rowBytes : LCD_ROWSIZE;
+  v->x = v->y = 0;
+}
+
+int vid_rewind(VidPlayer* v) {
+  if (playdate->file->seek(v->file, VID_HEADER_SIZE, SEEK_SET) < 0) return -1;
+  v->pos = v->fill = 0;
+  v->eof = 0;
+  v->current = 0;
+  return 0;
+}
+
+// row src shifted s pixels right (left if negative) into dst, vacated
+// pixels clear; dst and src may be the same row
+static void shiftRow(uint8_t* dst, const uint8_t* src, int n, int s) {
+  uint8_t row[LCD_ROWSIZE];
+  int bytes = (s < 0 ? -s : s) >> 3;
+  int bits = (s < 0 ? -s : s) & 7;
+  for (int i = 0; i < n; i++) {
+    int at = s < 0 ? i + bytes : i - bytes;
+    int hi = at >= 0 && at < n ? src[at] : 0;
+    int lo = s < 0 ? (at + 1 < n ? src[at + 1] : 0) : (at >= 1 && at <= n ? src[at - 1] : 0);
+    if (bits == 0) row[i] = hi;
+    else if (s < 0) row[i] = (hi << bits) | (lo >> (8 - bits));
+    else row[i] = (hi >> bits) | (lo << (8 - bits));
+  }
+  memcpy(dst, row, n);
+}
+
+// applies the ops of one row of the video to it; -1 if they run past the
+// row or the input, or start from a row outside the video
+static int decodeRow(VidPlayer* v, uint8_t* base, int row, int key) {
+  const uint8_t* in = v->buffer + v->pos;
+  const uint8_t* end = v->buffer + v->fill;
+  uint8_t* dst = base + row * v->stride;
+  if (in == end) return -1;
+
+  if (*in == kVidStored) {
+    if (end - in < 1 + v->rowBytes) return -1;
+    memcpy(dst, in + 1, v->rowBytes);
+    v->pos += 1 + v->rowBytes;
+    return 0;
+  }
+  if (*in == kVidCopy || *in == kVidShift) {
+    int shift = *in == kVidShift;
+    if (end - in < 2 + shift) return -1;
+    int from = row + (int8_t)in[1];
+    if (from < 0 || from >= v->height) return -1;
+    if (shift) shiftRow(dst, base + from * v->stride, v->rowBytes, (int8_t)in[2]);
+    else if (from != row) memcpy(dst, base + from * v->stride, v->rowBytes);
+    in += 2 + shift;
+    if (!shift) {
+      v->pos = in - v->buffer;
+      return 0;
+    }
+    key = 0; // the rest XORs onto the shifted row
+  }
+
+  int x = 0;
+  while (x < v->rowBytes) {
+    if (in == end) return -1;
+    uint8_t op = *in++;
+    if ((op & 0xc0) == 0x40) return -1; // row ops only start a row
+    int len = (op & 0x3f) + 1;
+    if (len > v->rowBytes - x) return -1;
+
+    if (op < 0x80) {
+      if (key) memset(dst + x, 0, len);
+    }
+    else if (op < 0xc0) {
+      if (end - in < len) return -1;
+      if (key) memcpy(dst + x, in, len);
+      else {
+        for (int i = 0; i < len; i++) dst[x + i] ^= in[i];
+      }
+      in += len;
+    }
+    else {
+      if (in == end) return -1;
+      uint8_t value = *in++;
+      if (key) memset(dst + x, value, len);
+      else {
+        for (int i = 0; i < len; i++) dst[x + i] ^= value;
+      }
+    }
+    x += len;
+  }
+  v->pos = in - v->buffer;
+  return 0;
+}
+
+static void markRows(VidPlayer* v, int first, int last) {
+  if (v->target == NULL) playdate->graphics->markUpdatedRows(v->y + first, v->y + last);
+}
+
+int vid_decodeFrame(VidPlayer* v) {
+  if (vid_done(v)) return 0;
+
+  int maskBytes = (v->height + 7) >> 3;
+  if (refill(v, 1 + maskBytes) < 1) return -1;
+  int flags = v->buffer[v->pos++];
+  int key = flags & kVidKey;
+
+  // copied out, refills move the buffer
+  uint8_t mask[(LCD_ROWS + 7) >> 3];
+  if (!key) {
+    if (v->fill - v->pos < maskBytes) return -1;
+    memcpy(mask, v->buffer + v->pos, maskBytes);
+    v->pos += maskBytes;
+  }
+
+  uint8_t* base = (v->target ? v->target : playdate->graphics->getFrame()) + v->y * v->stride + v->x;
+  int first = -1, last = -1; // span of changed rows to mark, in either order
+  for (int i = 0; i < v->height; i++) {
+    int row = flags & kVidBottomUp ? v->height - 1 - i : i;
+    if (!key && !(mask[row >> 3] >> (row & 7) & 1)) continue;
+    if (refill(v, VID_MAX_ROW) < 0 || decodeRow(v, base, row, key) < 0) return -1;
+    v->stats.rowsChanged++;
+    if (row == last + 1 && first >= 0) last = row;
+    else if (row == first - 1) first = row;
+    else {
+      if (first >= 0) markRows(v, first, last);
+      first = last = row;
+    }
+  }
+  if (first >= 0) markRows(v, first, last);
+
+  v->current++;
+  v->stats.frames++;
+  v->stats.keyFrames += key;
+  return 1;
+}
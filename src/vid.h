@@ -0,0 +1,72 @@
+#ifndef VID_H
+#define VID_H
+
+#include <playdate/api.h>
+
+// Player for PDVD delta video made by pdvid.py. Instead of decoding whole
+// frames into a context bitmap like playdate->graphics->video, each frame
+// is applied in place: changed rows are XORed (or, in key frames, stored)
+// straight into the frame buffer, unchanged rows are not touched, and
+// markUpdatedRows is called for the changed spans only. A row may also be
+// stored whole, or copied from another row of the video, shifted sideways
+// if need be, which is what keeps scrolling clips small. The file is
+// streamed through a small buffer inside the player.
+//
+// Because deltas apply to what is already on screen, nothing else may draw
+// over the video's rectangle while it plays; after drawing over it, rewind
+// (the first frame is always a key frame). The player does not pace itself:
+// call vid_decodeFrame() once per video frame, which at a refresh rate equal
+// to the clip's rate is once per update.
+
+#define VID_VERSION 2
+#define VID_HEADER_SIZE 18
+#define VID_CHUNK 1024
+#define VID_MAX_ROW (3 + 2 * LCD_ROWSIZE) // ops for one row, at worst a shift and a literal per byte
+
+typedef struct
+{
+  uint32_t frames;      // decoded
+  uint32_t keyFrames;
+  uint32_t rowsChanged; // rows written, summed over frames
+  uint32_t bytesRead;   // from the file
+  uint32_t reads;       // playdate->file->read calls
+} VidStats;
+
+typedef struct
+{
+  SDFile* file;
+  int width, height;
+  int rowBytes;
+  uint32_t frameCount;
+  uint32_t current; // next frame to decode
+  float frameRate;
+
+  uint8_t* target; // NULL for the frame buffer
+  int stride;
+  int x, y;        // target position, x in bytes
+
+  int pos, fill;   // window into buffer
+  int eof;
+  VidStats stats;
+  uint8_t buffer[VID_CHUNK];
+} VidPlayer;
+
+// opens a PDVD file from the pdx or the data directory, centred on screen;
+// NULL if it cannot be read, is not a video or is larger than the screen
+VidPlayer* vid_open(const char* path);
+void vid_close(VidPlayer* v);
+
+// x is rounded down to a multiple of 8; -1 if the video would not fit
+int vid_setPosition(VidPlayer* v, int x, int y);
+
+// decode into a buffer of the video's size instead of the frame buffer,
+// e.g. bitmap data; NULL goes back to the frame buffer. Resets the position.
+void vid_setTarget(VidPlayer* v, uint8_t* data, int rowBytes);
+
+// applies the next frame: 1, 0 at the end, or -1 for a corrupt file
+int vid_decodeFrame(VidPlayer* v);
+int vid_rewind(VidPlayer* v);
+
+static inline int vid_done(const VidPlayer* v) { return v->current >= v->frameCount; }
+
+#endif // VID_H